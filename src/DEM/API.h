@@ -24,6 +24,12 @@
 #include <DEM/BdrsAndObjs.h>
 #include <DEM/Models.h>
 #include <DEM/AuxClasses.h>
+#include <DEM/utils/BinaryFrame.hpp>
+#include <DEM/utils/CsvFrame.hpp>
+#include <DEM/utils/ClumpCsv.hpp>
+#include <DEM/utils/StepMetrics.hpp>
+#include <core/utils/AsyncWriter.hpp>
+#include <core/utils/TraceRecorder.hpp>
 
 /// Main namespace for the DEM-Engine package.
 namespace deme {
@@ -35,10 +41,8 @@ class DEMInspector;
 class DEMTracker;
 
 //////////////////////////////////////////////////////////////
-// TODO LIST: 1. Variable ts size (MAX_VEL flavor uses tracked max cp vel)
-//            2. Allow ext obj init CoM setting
+// TODO LIST: 2. Allow ext obj init CoM setting
 //            3. Instruct how many dT steps should at LEAST do before receiving kT update
-//            4. Sleepers that don't participate CD or integration
 //            9. wT takes care of an extra output when it crashes
 //            10. Recover sph--mesh contact pairs in restarted sim by mesh name
 //            11. A dry-run to map contact pair file with current clump batch based on cnt points location
@@ -56,18 +60,27 @@ class DEMSolver {
 
     /// Instruct the dimension of the `world'. On initialization, this info will be used to figure out how to assign the
     /// num of voxels in each direction. If your `useful' domain is not box-shaped, then define a box that contains your
-    /// domian.
-    void InstructBoxDomainDimension(float x, float y, float z, const std::string& dir_exact = "none");
+    /// domian. See the other overload for periodic_dirs.
+    void InstructBoxDomainDimension(float x,
+                                    float y,
+                                    float z,
+                                    const std::string& dir_exact = "none",
+                                    const std::string& periodic_dirs = "none");
     /// @brief Set the size of the simulation `world'.
     /// @param x Lower and upper limit for X coordinate.
     /// @param y Lower and upper limit for Y coordinate.
     /// @param z Lower and upper limit for Z coordinate.
     /// @param dir_exact The direction for which the user-instructed size must strictly agree with the actual generated
     /// size. Pick between "X", "Y", "Z" or "none".
+    /// @param periodic_dirs The directions in which the box given here is periodic, such as "X", "XY" or "XYZ" (or
+    /// "none"). Clumps leaving the box through a periodic face re-enter from the opposite one, and sphere--sphere
+    /// contacts across the face are found. Meshes and analytical objects are not periodic. Each periodic length should
+    /// well exceed the largest sphere diameter plus the bin size.
     void InstructBoxDomainDimension(const std::pair<float, float>& x,
                                     const std::pair<float, float>& y,
                                     const std::pair<float, float>& z,
-                                    const std::string& dir_exact = "none");
+                                    const std::string& dir_exact = "none",
+                                    const std::string& periodic_dirs = "none");
 
     /// Instruct if and how we should add boundaries to the simulation world upon initialization. Choose between `none',
     /// `all' (add 6 boundary planes) and `top_open' (add 5 boundary planes and leave the z-directon top open). Also
@@ -88,11 +101,19 @@ class DEMSolver {
     void SetInitTimeStep(double ts_size) { m_ts_size = ts_size; }
     /// Return the number of clumps that are currently in the simulation.
     size_t GetNumClumps() const { return nOwnerClumps; }
+    /// Return the number of owners (clumps, meshes and analytical objects) that are currently in the simulation.
+    size_t GetNumOwners() const { return nOwnerBodies; }
     /// @brief Get the number of kT-reported potential contact pairs.
     /// @return Number of potential contact pairs.
     size_t GetNumContacts() const { return dT->getNumContacts(); }
+    /// Get the number of steps dT executed since the thread collaboration stats were last cleared.
+    size_t GetNumDynamicSteps() const { return dT->nTotalSteps; }
+    /// Get the number of contact detections kT executed since the thread collaboration stats were last cleared.
+    size_t GetNumKinematicUpdates() const;
+    /// Get an estimate of the device memory that the kT- and dT-owned arrays currently take, in bytes.
+    size_t GetDeviceMemUsage() const { return kT->estimateMemUsage() + dT->estimateMemUsage(); }
     /// Get the current time step size in simulation.
-    double GetTimeStepSize() const { return m_ts_size; }
+    double GetTimeStepSize() const { return sys_initialized ? dT->getStepSize() : m_ts_size; }
     /// Get the current expand factor in simulation.
     float GetExpandFactor() const;
     /// Set the number of dT steps before it waits for a contact-pair info update from kT.
@@ -107,9 +128,22 @@ class DEMSolver {
     double GetSimTime() const;
     /// Set the simulation time manually.
     void SetSimTime(double time);
-    /// @brief Set the strategy for auto-adapting time step size (NOT implemented, no effect yet).
-    /// @param type "none" or "max_vel" or "int_diff".
+    /// @brief Set the strategy for auto-adapting time step size. The step size is re-decided each time dT sends a
+    /// contact detection work order to kT, and an increase in step size only takes effect after kT delivers contact
+    /// pairs derived with a margin that accounts for it.
+    /// @param type "none", "max_vel" (the fastest entity moves at most a given distance per step) or "int_diff" (the
+    /// difference between a first- and a second-order position update, 0.5*a*h^2, stays under a given distance).
     void SetAdaptiveTimeStepType(const std::string& type);
+    /// @brief Set the range the adaptive time step size is allowed to vary in. By default it is 0.1 to 10 times the
+    /// initial time step size. The upper bound should respect the stability limit of your contact stiffness.
+    /// @param min_ts Smallest time step size allowed.
+    /// @param max_ts Largest time step size allowed.
+    void SetAdaptiveTimeStepBounds(double min_ts, double max_ts);
+    /// @brief Set the tolerance of the adaptive time step size strategy, as a fraction of the smallest sphere radius.
+    /// For "max_vel" it is the distance the fastest entity may travel in one step (default 1e-2); for "int_diff" it is
+    /// the allowed integration difference (default 1e-5).
+    /// @param frac Tolerance as a fraction of the smallest sphere radius.
+    void SetAdaptiveTimeStepTolerance(float frac) { adapt_ts_tol = frac; }
 
     /// @brief Set the time integrator for this simulator.
     /// @param intg "forward_euler" or "extended_taylor" or "centered_difference".
@@ -144,9 +178,17 @@ class DEMSolver {
     /// Explicitly instruct the sizes for the arrays at initialization time. This is useful when the number of owners
     /// tends to change (especially gradually increase) frequently in the simulation, by reducing the need for
     /// reallocation. Note however, whatever instruction the user gives here it won't affect the correctness of the
-    /// simulation, since if the arrays are not long enough they will always be auto-resized. This is not implemented
-    /// yet :/
+    /// simulation, since if the arrays are not long enough they will always be auto-resized.
     void InstructNumOwners(size_t numOwners) { m_instructed_num_owners = numOwners; }
+    /// Explicitly instruct the capacity of the sphere and triangle arrays at initialization time. See
+    /// InstructNumOwners.
+    void InstructNumGeometries(size_t numSpheres, size_t numTriangles = 0) {
+        m_instructed_num_spheres = numSpheres;
+        m_instructed_num_triangles = numTriangles;
+    }
+    /// Explicitly instruct the capacity of the contact arrays. They are then never shorter than this, so no
+    /// reallocation is needed unless the number of contacts exceeds it. See InstructNumOwners.
+    void InstructNumContacts(size_t numContacts) { m_instructed_num_contacts = numContacts; }
 
     /// Instruct the solver to use frictonal (history-based) Hertzian contact force model.
     std::shared_ptr<DEMForceModel> UseFrictionalHertzianModel();
@@ -234,6 +276,17 @@ class DEMSolver {
     /// @param num_cnts Error-out contact number.
     void SetErrorOutAvgContacts(float num_cnts) { threshold_error_out_num_cnts = num_cnts; }
 
+    /// @brief Let clumps that stay quiet for a number of consecutive time steps fall asleep. A sleeping clump is not
+    /// integrated, but its contact pairs (also those with other sleeping clumps) are still registered and keep their
+    /// contact history. A sleeping clump wakes up when it is touched by an awake neighbour (clump, mesh or analytical
+    /// object) moving faster than vel_thres. Must be called before initialization.
+    /// @param vel_thres A clump is quiet in a step if its linear velocity magnitude is smaller than this.
+    /// @param acc_thres ...and its linear acceleration magnitude (gravity included) is smaller than this.
+    /// @param n_steps Number of consecutive quiet steps before a clump falls asleep.
+    void EnableSleeping(float vel_thres, float acc_thres, unsigned int n_steps);
+    /// @brief Disable automatic sleeping of quiet clumps (default).
+    void DisableSleeping() { use_sleeping = false; }
+
     /// @brief Get the current number of contacts each sphere has.
     /// @return Number of contacts.
     float GetAvgSphContacts() const { return kT->stateParams.avgCntsPerSphere; }
@@ -243,6 +296,14 @@ class DEMSolver {
     void UseAdaptiveBinSize(bool use = true) { auto_adjust_bin_size = use; }
     /// @brief Disable the use of adaptive bin size (always use initial size).
     void DisableAdaptiveBinSize() { auto_adjust_bin_size = false; }
+    /// @brief Enable or disable hierarchical (multi-level) binning in contact detection (by default it is off).
+    /// @details Each sphere is binned on the level matching its size, where level k has bins 2^k times as large as the
+    /// (initial, or adapted) bin size, and meets smaller spheres when they visit its level. This keeps the number of
+    /// bins a large sphere touches bounded in highly polydisperse systems. There are as many levels as needed for the
+    /// largest sphere to fit in a bin of the coarsest level (at most DEME_MAX_BIN_LEVELS), so the bin size is best set
+    /// around the size of the smallest spheres, e.g. via SetInitBinSizeAsMultipleOfSmallestSphere.
+    /// @param use Enable or disable.
+    void UseHierarchicalBinning(bool use = true) { use_hierarchical_binning = use; }
     /// @brief Enable or disable the use of adaptive max update step count (by default it is on).
     /// @param use Enable or disable.
     void UseAdaptiveUpdateFreq(bool use = true) { auto_adjust_update_freq = use; }
@@ -281,6 +342,10 @@ class DEMSolver {
     /// @brief Get the current number of bins (for contact detection). Must be called from synchronized stance.
     /// @return Number of bins.
     size_t GetBinNum() { return kT->stateParams.numBins; }
+    /// @brief Get the smallest length unit, that is, the resolution positions are stored at. It is decided on
+    /// initialization, by the world size and the precision policy the solver is built with.
+    /// @return The smallest length unit.
+    double GetLengthUnit() const { return l; }
 
     /// @brief Set the upper bound of kT update frequency (when it is adjusted automatically).
     /// @details This only affects when the update freq is updated automatically. To manually control the freq, use
@@ -447,6 +512,72 @@ class DEMSolver {
     /// @param ownerID The ID (offset) of the owner.
     /// @param fam Family number.
     void SetOwnerFamily(bodyID_t ownerID, family_t fam);
+
+    /// @brief Get the IDs of all owners in family N, in ascending order. Can serve as the ID list for the bulk state
+    /// getters/setters below.
+    std::vector<bodyID_t> GetFamilyOwnerIDs(unsigned int N) const;
+    /// @brief Get the positions of a list of owners in one go, which is much cheaper than a per-owner call for each.
+    /// @param IDs The owner IDs.
+    /// @param pos Caller-provided buffer with room for IDs.size() elements, filled in the order of IDs.
+    void GetOwnerPositions(const std::vector<bodyID_t>& IDs, float3* pos) const;
+    std::vector<float3> GetOwnerPositions(const std::vector<bodyID_t>& IDs) const;
+    /// @brief Get the positions of all owners, in owner ID order. A caller-provided buffer needs room for
+    /// GetNumOwners() elements.
+    void GetAllOwnerPositions(float3* pos) const;
+    std::vector<float3> GetAllOwnerPositions() const;
+    /// @brief Get the velocities of a list of owners in one go, which is much cheaper than a per-owner call for each.
+    /// @param IDs The owner IDs.
+    /// @param vel Caller-provided buffer with room for IDs.size() elements, filled in the order of IDs.
+    void GetOwnerVelocities(const std::vector<bodyID_t>& IDs, float3* vel) const;
+    std::vector<float3> GetOwnerVelocities(const std::vector<bodyID_t>& IDs) const;
+    /// @brief Get the velocities of all owners, in owner ID order. A caller-provided buffer needs room for
+    /// GetNumOwners() elements.
+    void GetAllOwnerVelocities(float3* vel) const;
+    std::vector<float3> GetAllOwnerVelocities() const;
+    /// @brief Get the angular velocities (in their local frames) of a list of owners in one go, which is much cheaper
+    /// than a per-owner call for each.
+    /// @param IDs The owner IDs.
+    /// @param angVel Caller-provided buffer with room for IDs.size() elements, filled in the order of IDs.
+    void GetOwnerAngVels(const std::vector<bodyID_t>& IDs, float3* angVel) const;
+    std::vector<float3> GetOwnerAngVels(const std::vector<bodyID_t>& IDs) const;
+    /// @brief Get the angular velocities (in their local frames) of all owners, in owner ID order. A caller-provided
+    /// buffer needs room for GetNumOwners() elements.
+    void GetAllOwnerAngVels(float3* angVel) const;
+    std::vector<float3> GetAllOwnerAngVels() const;
+    /// @brief Get the quaternions of a list of owners in one go, which is much cheaper than a per-owner call for each.
+    /// @param IDs The owner IDs.
+    /// @param oriQ Caller-provided buffer with room for IDs.size() elements, filled in the order of IDs.
+    void GetOwnerOriQs(const std::vector<bodyID_t>& IDs, float4* oriQ) const;
+    std::vector<float4> GetOwnerOriQs(const std::vector<bodyID_t>& IDs) const;
+    /// @brief Get the quaternions of all owners, in owner ID order. A caller-provided buffer needs room for
+    /// GetNumOwners() elements.
+    void GetAllOwnerOriQs(float4* oriQ) const;
+    std::vector<float4> GetAllOwnerOriQs() const;
+    /// @brief Set the positions of a list of owners in one go. pos holds one element per entry in IDs.
+    void SetOwnerPositions(const std::vector<bodyID_t>& IDs, const float3* pos);
+    void SetOwnerPositions(const std::vector<bodyID_t>& IDs, const std::vector<float3>& pos);
+    /// @brief Set the positions of all owners, given in owner ID order.
+    void SetAllOwnerPositions(const float3* pos);
+    void SetAllOwnerPositions(const std::vector<float3>& pos);
+    /// @brief Set the velocities of a list of owners in one go. vel holds one element per entry in IDs.
+    void SetOwnerVelocities(const std::vector<bodyID_t>& IDs, const float3* vel);
+    void SetOwnerVelocities(const std::vector<bodyID_t>& IDs, const std::vector<float3>& vel);
+    /// @brief Set the velocities of all owners, given in owner ID order.
+    void SetAllOwnerVelocities(const float3* vel);
+    void SetAllOwnerVelocities(const std::vector<float3>& vel);
+    /// @brief Set the angular velocities (in their local frames) of a list of owners in one go. angVel holds one
+    /// element per entry in IDs.
+    void SetOwnerAngVels(const std::vector<bodyID_t>& IDs, const float3* angVel);
+    void SetOwnerAngVels(const std::vector<bodyID_t>& IDs, const std::vector<float3>& angVel);
+    /// @brief Set the angular velocities (in their local frames) of all owners, given in owner ID order.
+    void SetAllOwnerAngVels(const float3* angVel);
+    void SetAllOwnerAngVels(const std::vector<float3>& angVel);
+    /// @brief Set the quaternions of a list of owners in one go. oriQ holds one element per entry in IDs.
+    void SetOwnerOriQs(const std::vector<bodyID_t>& IDs, const float4* oriQ);
+    void SetOwnerOriQs(const std::vector<bodyID_t>& IDs, const std::vector<float4>& oriQ);
+    /// @brief Set the quaternions of all owners, given in owner ID order.
+    void SetAllOwnerOriQs(const float4* oriQ);
+    void SetAllOwnerOriQs(const std::vector<float4>& oriQ);
     /// @brief Rewrite the relative positions of the flattened triangle soup.
     void SetTriNodeRelPos(size_t owner, size_t triID, const std::vector<float3>& new_nodes);
     /// @brief Update the relative positions of the flattened triangle soup.
@@ -538,6 +669,9 @@ class DEMSolver {
                                                              bool load_normals = true,
                                                              bool load_uv = false);
     std::shared_ptr<DEMMeshConnected> AddWavefrontMeshObject(DEMMeshConnected& mesh);
+    /// Whether to keep a binary cache (<mesh file>.demecache) of each loaded mesh file next to it, so later runs load
+    /// the mesh without parsing the OBJ file again. It is re-generated whenever the mesh file changes. Default off.
+    void UseMeshLoadCache(bool use = true) { DEMMeshConnected::UseLoadCache(use); }
 
     /// @brief Create a DEMTracker to allow direct control/modification/query to this external object/batch of
     /// clumps/triangle mesh object.
@@ -907,6 +1041,20 @@ class DEMSolver {
     /// of some random number)
     void EnsureKernelErrMsgLineNum(bool flag = true) { ensure_kernel_line_num = flag; }
 
+    /// Whether compiled kernels should be cached on disk, so later runs with identical kernels (same jitified source,
+    /// flags, kernel files and GPU architecture) skip the compilation. On by default. This setting is process-wide.
+    void UseJitDiskCache(bool use = true);
+
+    /// Set the directory of the on-disk kernel cache. Default is $DEME_JIT_CACHE_DIR if set, or deme/jit in
+    /// $XDG_CACHE_HOME (or in $HOME/.cache). The directory is created accessible to the current user only, and a
+    /// directory not owned by the current user, or writable by others, is refused (the cache is then not used). This
+    /// setting is process-wide.
+    void SetJitCacheDir(const std::string& dir);
+
+    /// Set the size limit (in bytes) of the on-disk kernel cache. The least recently used entries are evicted when the
+    /// cache grows beyond it. Default is 256 MB. This setting is process-wide.
+    void SetJitCacheSizeLimit(size_t bytes);
+
     /// Whether the force collection (acceleration calc and reduction) process should be using CUB. If true, the
     /// acceleration array is flattened and reduced using CUB; if false, the acceleration is computed and directly
     /// applied to each body through atomic operations.
@@ -961,6 +1109,8 @@ class DEMSolver {
     void WriteContactFile(const std::string& outfilename, float force_thres = DEME_TINY_FLOAT) const;
     /// Write the current status of all meshes to a file
     void WriteMeshFile(const std::string& outfilename) const;
+    /// Block until all output files submitted so far are written to disk (only needed with async output)
+    void FlushOutput() const;
 
     /// @brief Read 3 columns of your choice from a CSV filem and group them by clump_header.
     /// @param infilename CSV filename.
@@ -975,19 +1125,7 @@ class DEMSolver {
         const std::string& y_header,
         const std::string& z_header,
         const std::string& clump_header) {
-        std::unordered_map<std::string, std::vector<float3>> type_xyz_map;
-        io::CSVReader<4, io::trim_chars<' ', '\t'>, io::no_quote_escape<','>, io::throw_on_overflow,
-                      io::empty_line_comment>
-            in(infilename);
-        in.read_header(io::ignore_extra_column, clump_header, x_header, y_header, z_header);
-        std::string type_name;
-        float3 XYZ;
-        size_t count = 0;
-        while (in.read_row(type_name, XYZ.x, XYZ.y, XYZ.z)) {
-            type_xyz_map[type_name].push_back(XYZ);
-            count++;
-        }
-        return type_xyz_map;
+        return ReadClumpFloat3FromCsvFile(infilename, x_header, y_header, z_header, clump_header);
     }
     /// Read clump coordinates from a CSV file (whose format is consistent with this solver's clump output file).
     /// Returns an unordered_map which maps each unique clump type name to a vector of float3 (XYZ coordinates).
@@ -1012,18 +1150,77 @@ class DEMSolver {
     /// Returns an unordered_map which maps each unique clump type name to a vector of float4 (4 components of the
     /// quaternion, (Qx, Qy, Qz, Qw) = (0, 0, 0, 1) means 0 rotation).
     static std::unordered_map<std::string, std::vector<float4>> ReadClumpQuatFromCsv(const std::string& infilename) {
+        return ReadClumpQuatFromCsvFile(infilename);
+    }
+
+    /// @brief Read clump coordinates and quaternions from a CSV clump output file, in one pass over the file.
+    /// @details Equivalent to calling ReadClumpXyzFromCsv and ReadClumpQuatFromCsv, but the (possibly huge) file is
+    /// parsed only once, by multiple threads.
+    /// @param infilename CSV filename.
+    /// @param clump_xyz Gets a map from each clump type name to the XYZ coordinates of the clumps of this type.
+    /// @param clump_quat Gets a map from each clump type name to the quaternions of the clumps of this type.
+    static void ReadClumpXyzQuatFromCsv(const std::string& infilename,
+                                        std::unordered_map<std::string, std::vector<float3>>& clump_xyz,
+                                        std::unordered_map<std::string, std::vector<float4>>& clump_quat) {
+        ReadClumpXyzQuatFromCsvFile(infilename, clump_xyz, clump_quat);
+    }
+
+    /// @brief Read 3 columns of your choice from a BINARY clump output file and group them by clump_header.
+    /// @param infilename Binary output filename.
+    /// @param x_header Name of the first col.
+    /// @param y_header Name of the second col.
+    /// @param z_header Name of the third col.
+    /// @param clump_header The identifier column to separate types of clumps.
+    /// @return Unordered_map which maps types of clumps to a respective vector of float3s.
+    static std::unordered_map<std::string, std::vector<float3>> ReadClumpFloat3FromBinary(
+        const std::string& infilename,
+        const std::string& x_header,
+        const std::string& y_header,
+        const std::string& z_header,
+        const std::string& clump_header) {
+        BinaryFrame frame(infilename);
+        std::vector<std::string> types = frame.GetStringColumn(clump_header);
+        std::vector<float> X = frame.GetColumn<float>(x_header);
+        std::vector<float> Y = frame.GetColumn<float>(y_header);
+        std::vector<float> Z = frame.GetColumn<float>(z_header);
+        std::unordered_map<std::string, std::vector<float3>> type_xyz_map;
+        for (size_t i = 0; i < frame.GetNumRows(); i++) {
+            type_xyz_map[types[i]].push_back(host_make_float3(X[i], Y[i], Z[i]));
+        }
+        return type_xyz_map;
+    }
+    /// Read clump coordinates from a BINARY clump output file. Returns an unordered_map which maps each unique clump
+    /// type name to a vector of float3 (XYZ coordinates).
+    static std::unordered_map<std::string, std::vector<float3>> ReadClumpXyzFromBinary(const std::string& infilename) {
+        return ReadClumpFloat3FromBinary(infilename, OUTPUT_FILE_X_COL_NAME, OUTPUT_FILE_Y_COL_NAME,
+                                         OUTPUT_FILE_Z_COL_NAME, OUTPUT_FILE_CLUMP_TYPE_NAME);
+    }
+    /// Read clump velocity from a BINARY clump output file. Returns an unordered_map which maps each unique clump type
+    /// name to a vector of float3 (velocity).
+    static std::unordered_map<std::string, std::vector<float3>> ReadClumpVelFromBinary(const std::string& infilename) {
+        return ReadClumpFloat3FromBinary(infilename, OUTPUT_FILE_VEL_X_COL_NAME, OUTPUT_FILE_VEL_Y_COL_NAME,
+                                         OUTPUT_FILE_VEL_Z_COL_NAME, OUTPUT_FILE_CLUMP_TYPE_NAME);
+    }
+    /// Read clump angular velocity from a BINARY clump output file. Returns an unordered_map which maps each unique
+    /// clump type name to a vector of float3 (angular velocity).
+    static std::unordered_map<std::string, std::vector<float3>> ReadClumpAngVelFromBinary(
+        const std::string& infilename) {
+        return ReadClumpFloat3FromBinary(infilename, OUTPUT_FILE_ANGVEL_X_COL_NAME, OUTPUT_FILE_ANGVEL_Y_COL_NAME,
+                                         OUTPUT_FILE_ANGVEL_Z_COL_NAME, OUTPUT_FILE_CLUMP_TYPE_NAME);
+    }
+    /// Read clump quaternions from a BINARY clump output file. Returns an unordered_map which maps each unique clump
+    /// type name to a vector of float4 (4 components of the quaternion, (Qx, Qy, Qz, Qw) = (0, 0, 0, 1) means 0
+    /// rotation).
+    static std::unordered_map<std::string, std::vector<float4>> ReadClumpQuatFromBinary(const std::string& infilename) {
+        BinaryFrame frame(infilename);
+        std::vector<std::string> types = frame.GetStringColumn(OUTPUT_FILE_CLUMP_TYPE_NAME);
+        std::vector<float> Qw = frame.GetColumn<float>(OUTPUT_FILE_QW_COL_NAME);
+        std::vector<float> Qx = frame.GetColumn<float>(OUTPUT_FILE_QX_COL_NAME);
+        std::vector<float> Qy = frame.GetColumn<float>(OUTPUT_FILE_QY_COL_NAME);
+        std::vector<float> Qz = frame.GetColumn<float>(OUTPUT_FILE_QZ_COL_NAME);
         std::unordered_map<std::string, std::vector<float4>> type_Q_map;
-        io::CSVReader<5, io::trim_chars<' ', '\t'>, io::no_quote_escape<','>, io::throw_on_overflow,
-                      io::empty_line_comment>
-            in(infilename);
-        in.read_header(io::ignore_extra_column, OUTPUT_FILE_CLUMP_TYPE_NAME, OUTPUT_FILE_QW_COL_NAME,
-                       OUTPUT_FILE_QX_COL_NAME, OUTPUT_FILE_QY_COL_NAME, OUTPUT_FILE_QZ_COL_NAME);
-        std::string type_name;
-        float4 Q;
-        size_t count = 0;
-        while (in.read_row(type_name, Q.w, Q.x, Q.y, Q.z)) {
-            type_Q_map[type_name].push_back(Q);
-            count++;
+        for (size_t i = 0; i < frame.GetNumRows(); i++) {
+            type_Q_map[types[i]].push_back(host_make_float4(Qx[i], Qy[i], Qz[i], Qw[i]));
         }
         return type_Q_map;
     }
@@ -1035,18 +1232,23 @@ class DEMSolver {
         const std::string& cntColName = OUTPUT_FILE_CNT_TYPE_NAME,
         const std::string& first_name = OUTPUT_FILE_GEO_ID_1_NAME,
         const std::string& second_name = OUTPUT_FILE_GEO_ID_2_NAME) {
-        io::CSVReader<3, io::trim_chars<' ', '\t'>, io::no_quote_escape<','>, io::throw_on_overflow,
-                      io::empty_line_comment>
-            in(infilename);
-        in.read_header(io::ignore_extra_column, cntColName, first_name, second_name);
-        bodyID_t A, B;
-        std::string cnt_type_name;
+        CsvFrame frame(infilename, {{cntColName, FRAME_COL_TYPE::STRING},
+                                    {first_name, FRAME_COL_TYPE::UINT64},
+                                    {second_name, FRAME_COL_TYPE::UINT64}});
+        std::vector<std::string> type_names;
+        std::vector<uint32_t> types;
+        frame.GetStringColumn(cntColName, type_names, types);
+        std::vector<bodyID_t> A = frame.GetColumn<bodyID_t>(first_name);
+        std::vector<bodyID_t> B = frame.GetColumn<bodyID_t>(second_name);
         std::vector<std::pair<bodyID_t, bodyID_t>> pairs;
-        size_t count = 0;
-        while (in.read_row(cnt_type_name, A, B)) {
-            if (cnt_type_name == cntType) {  // only the type of contact we care
-                pairs.push_back(std::pair<bodyID_t, bodyID_t>(A, B));
-                count++;
+        auto wanted = std::find(type_names.begin(), type_names.end(), cntType);
+        if (wanted == type_names.end()) {
+            return pairs;
+        }
+        uint32_t wanted_type = wanted - type_names.begin();
+        for (size_t i = 0; i < frame.GetNumRows(); i++) {
+            if (types[i] == wanted_type) {  // only the type of contact we care
+                pairs.push_back(std::pair<bodyID_t, bodyID_t>(A[i], B[i]));
             }
         }
         return pairs;
@@ -1057,31 +1259,36 @@ class DEMSolver {
         const std::string& infilename,
         const std::string& cntType = OUTPUT_FILE_SPH_SPH_CONTACT_NAME,
         const std::string& cntColName = OUTPUT_FILE_CNT_TYPE_NAME) {
-        io::LineReader in_header(infilename);
-        char* f_header = in_header.next_line();
-        std::vector<std::string> header_names = parse_string_line(std::string(f_header));
+        std::vector<std::string> header_names = CsvFrame::ReadHeader(infilename);
+        std::vector<CsvColumnRequest> requests = {{cntColName, FRAME_COL_TYPE::STRING}};
         std::vector<std::string> wildcard_names;
         // Find those col names that are not contact file standard names: they have to be wildcard names
         for (const auto& col_name : header_names) {
             if (!check_exist(CNT_FILE_KNOWN_COL_NAMES, col_name)) {
                 wildcard_names.push_back(col_name);
+                requests.push_back({col_name, FRAME_COL_TYPE::FLOAT32});
             }
         }
-        // Now parse in the csv file
+        // Now parse in the csv file, all wildcards at once
         std::unordered_map<std::string, std::vector<float>> w_vals;
-        size_t count = 0;
+        if (wildcard_names.empty()) {
+            return w_vals;
+        }
+        CsvFrame frame(infilename, requests);
+        std::vector<std::string> type_names;
+        std::vector<uint32_t> types;
+        frame.GetStringColumn(cntColName, type_names, types);
+        auto wanted = std::find(type_names.begin(), type_names.end(), cntType);
+        if (wanted == type_names.end()) {
+            return w_vals;
+        }
+        uint32_t wanted_type = wanted - type_names.begin();
         for (const auto& wildcard_name : wildcard_names) {
-            io::CSVReader<2, io::trim_chars<' ', '\t'>, io::no_quote_escape<','>, io::throw_on_overflow,
-                          io::empty_line_comment>
-                in(infilename);
-            in.read_header(io::ignore_extra_column, OUTPUT_FILE_CNT_TYPE_NAME, wildcard_name);
-            std::string cnt_type_name;
-            float w_val;
-
-            while (in.read_row(cnt_type_name, w_val)) {
-                if (cnt_type_name == cntType) {  // only the type of contact we care (SS by default)
-                    w_vals[wildcard_name].push_back(w_val);
-                    count++;
+            std::vector<float>& vals = w_vals[wildcard_name];
+            std::vector<float> col = frame.GetColumn<float>(wildcard_name);
+            for (size_t i = 0; i < frame.GetNumRows(); i++) {
+                if (types[i] == wanted_type) {  // only the type of contact we care (SS by default)
+                    vals.push_back(col[i]);
                 }
             }
         }
@@ -1101,7 +1308,7 @@ class DEMSolver {
     void DoDynamics(double thisCallDuration);
 
     /// Equivalent to calling DoDynamics with the time step size as the argument.
-    void DoStepDynamics() { DoDynamics(m_ts_size); }
+    void DoStepDynamics() { DoDynamics(GetTimeStepSize()); }
 
     /// @brief Transferthe cached sim params to the workers. Used for sim environment modification after system
     /// initialization.
@@ -1121,6 +1328,16 @@ class DEMSolver {
     /// Show the wall time and percentages of wall time spend on various solver tasks.
     void ShowTimingStats();
 
+    /// @brief Get the wall time spent on various solver tasks, the same numbers ShowTimingStats prints.
+    /// @param kT_names Gets the names of the kT timers.
+    /// @param kT_vals Gets the time (in seconds) of each kT timer.
+    /// @param dT_names Gets the names of the dT timers.
+    /// @param dT_vals Gets the time (in seconds) of each dT timer.
+    void GetTimingStats(std::vector<std::string>& kT_names,
+                        std::vector<double>& kT_vals,
+                        std::vector<std::string>& dT_names,
+                        std::vector<double>& dT_vals);
+
     /// Show potential anomalies that may have been there in the simulation, then clear the anomaly log.
     void ShowAnomalies();
 
@@ -1132,9 +1349,43 @@ class DEMSolver {
     /// Reset the recordings of the wall time and percentages of wall time spend on various solver tasks.
     void ClearTimingStats();
 
-    /// Removes all entities associated with a family from the arrays (to save memory space).
+    /// @brief Whether to record a timeline of what the main, kT and dT threads are doing, for viewing in Perfetto.
+    /// @details Every timed solver section (those ShowTimingStats reports), every DoDynamics call and sync, and every
+    /// buffer hand-off between kT and dT becomes an event in a per-thread ring buffer; when a buffer is full, its
+    /// oldest events are overwritten. Turning it on again clears the recording. Call it from a synced stance. Default
+    /// off.
+    /// @param use Whether to record the timeline.
+    /// @param events_per_thread Number of events each thread's ring buffer holds.
+    void UseTimelineTrace(bool use = true, size_t events_per_thread = 1 << 18);
+    /// @brief Write the recorded timeline as a Chrome trace JSON file, which Perfetto (or chrome://tracing) opens. Call
+    /// it from a synced stance.
+    /// @param filename Output file name.
+    void WriteTimelineTrace(const std::string& filename) const;
+
+    /// @brief Whether to check the temp arrays kT and dT take from their scratch arenas for misuse. In this mode, an
+    /// error is thrown if two live temp arrays overlap or share a name, and temp arrays are filled with a poison
+    /// pattern when handed out and when released, so code reading stale scratch memory gives itself away. It is slow,
+    /// so use it only for debugging. Call it from a synced stance. Default off.
+    void UseScratchArenaDebug(bool use = true);
+
+    /// @brief Remove all clumps and meshes in a family from the simulation, compacting the data arrays so the memory is
+    /// actually released. Owner and geometry IDs of the remaining entities shift down to fill the gaps, so cached IDs
+    /// should be re-queried; trackers are updated, or marked broken if what they track is gone. Analytical objects are
+    /// jitified and thus never purged. It has a large overhead, so call it only occasionally.
+    /// @param family_num The (user-level) family number to purge.
     void PurgeFamily(unsigned int family_num);
 
+    /// @brief Renumber the clumps (and their sphere components) so they follow the Morton order of their locations,
+    /// making spatial neighbors also close in memory. Contact history, trackers and wildcards are carried over, but
+    /// owner and geometry IDs cached outside of trackers should be re-queried. Meshes and analytical objects keep their
+    /// IDs. Call it from a synced stance, e.g. after DoDynamicsThenSync.
+    void ReorderEntities();
+
+    /// @brief Let the solver call ReorderEntities by itself every so many contact detections. It happens at the end of
+    /// a DoDynamics call (syncing kT and dT first), so the actual interval also depends on how long each call is.
+    /// @param n_kT_updates Number of contact detections between reorderings. 0 (default) means never.
+    void SetEntityReorderFrequency(unsigned int n_kT_updates) { m_reorder_freq = n_kT_updates; }
+
     /// Release the memory for the flattened arrays (which are used for initialization pre-processing and transferring
     /// info the worker threads).
     void ReleaseFlattenedArrays();
@@ -1159,6 +1410,34 @@ class DEMSolver {
     void SetOutputFormat(OUTPUT_FORMAT format) { m_out_format = format; }
     /// Specify the information that needs to go into the clump or sphere output files.
     void SetOutputContent(unsigned int content) { m_out_content = content; }
+    /// Whether BINARY clump and sphere output files should have their columns compressed (needs USE_ZLIB at build
+    /// time). Compressed files are typically several times smaller, at some extra cost per written frame.
+    void UseCompressedOutput(bool use = true);
+    /// @brief Whether to write output files in a background thread.
+    /// @details If enabled, a Write...File call only copies the needed data and returns; formatting and disk I/O then
+    /// overlap with the next DoDynamics. Files are guaranteed complete only after FlushOutput (or solver destruction),
+    /// so do not read an output file back right after writing it without flushing first. Default off.
+    void UseAsyncOutput(bool use = true);
+    /// Set how many output files can wait in the async output queue before a Write...File call blocks (default 2)
+    void SetAsyncOutputQueueSize(unsigned int max_pending);
+    /// @brief Write a StepMetrics record every so many steps: contact pairs, contacts per sphere, the most spheres and
+    /// triangles in a bin, bin number and size, dT's allowed future drift, how often dT and kT were held back, and the
+    /// step wall time.
+    /// @details Records are buffered and written by a background thread, in batches; the file is complete after
+    /// FlushOutput, DisableStepMetrics or solver destruction. Call it from a synced stance.
+    /// @param filename Output file name.
+    /// @param every_n_steps Number of steps between two records.
+    /// @param format "CSV" or "JSONL" (one JSON object per line).
+    void SetStepMetricsOutput(const std::string& filename,
+                              unsigned int every_n_steps,
+                              const std::string& format = "CSV");
+    /// @brief Pass a StepMetrics record to a callback every so many steps. The callback runs on a background thread, so
+    /// it must not call into this solver. Call it from a synced stance.
+    /// @param callback The function that receives the records.
+    /// @param every_n_steps Number of steps between two records.
+    void SetStepMetricsCallback(std::function<void(const StepMetrics&)> callback, unsigned int every_n_steps);
+    /// Stop emitting StepMetrics records, after writing out the ones still buffered.
+    void DisableStepMetrics();
     /// Specify the file format of contact pairs.
     void SetContactOutputFormat(OUTPUT_FORMAT format) { m_cnt_out_format = format; }
     /// Specify the information that needs to go into the contact pair output files.
@@ -1177,7 +1456,8 @@ class DEMSolver {
     /// Recommend "INFO".
     void SetVerbosity(const std::string& verbose);
     /// @brief Choose sphere and clump output file format.
-    /// @param format Choice among "CSV", "BINARY".
+    /// @param format Choice among "CSV", "BINARY". BINARY files can be read back with BinaryFrame (or
+    /// ReadClumpXyzFromBinary and the like).
     void SetOutputFormat(const std::string& format);
     /// @brief Specify the information that needs to go into the clump or sphere output files.
     /// @param content A list of "XYZ", "QUAT", "ABSV", "VEL", "ANG_VEL", "ABS_ACC", "ACC", "ANG_ACC", "FAMILY", "MAT",
@@ -1208,12 +1488,12 @@ class DEMSolver {
     void RemoveKernelInclude() { kernel_includes = " "; }
 
     /// Let dT do this call and return the reduce value of the inspected quantity.
-    float dTInspectReduce(const std::shared_ptr<jitify::Program>& inspection_kernel,
+    float dTInspectReduce(const std::shared_ptr<JitProgram>& inspection_kernel,
                           const std::string& kernel_name,
                           INSPECT_ENTITY_TYPE thing_to_insp,
                           CUB_REDUCE_FLAVOR reduce_flavor,
                           bool all_domain);
-    float* dTInspectNoReduce(const std::shared_ptr<jitify::Program>& inspection_kernel,
+    float* dTInspectNoReduce(const std::shared_ptr<JitProgram>& inspection_kernel,
                              const std::string& kernel_name,
                              INSPECT_ENTITY_TYPE thing_to_insp,
                              CUB_REDUCE_FLAVOR reduce_flavor,
@@ -1243,6 +1523,8 @@ class DEMSolver {
     bool use_user_defined_expand_factor = false;
     // Whether to auto-adjust the bin size and the max update frequency
     bool auto_adjust_bin_size = true;
+    // Whether to bin spheres on the level of their size class
+    bool use_hierarchical_binning = false;
     bool auto_adjust_update_freq = true;
     // User-instructed initial bin size as a multiple of smallest sphere radius
     float m_binSize_as_multiple = 8.0;
@@ -1254,6 +1536,25 @@ class DEMSolver {
     // OUTPUT_MODE m_clump_out_mode = OUTPUT_MODE::SPHERE;
     OUTPUT_FORMAT m_out_format = OUTPUT_FORMAT::CSV;
     unsigned int m_out_content = OUTPUT_CONTENT::QUAT | OUTPUT_CONTENT::ABSV;
+    // If BINARY output files have compressed columns
+    bool m_compress_binary_output = false;
+    // If output files are formatted and written in a background thread
+    bool m_use_async_output = false;
+    unsigned int m_async_output_max_pending = 2;
+    // The background writer; created at the first async output
+    mutable std::unique_ptr<AsyncWriter> m_async_writer;
+    // Timeline of the main, kT and dT threads (null when not recording), and the main thread's lane in it
+    std::unique_ptr<TraceRecorder> m_trace;
+    TraceLane* m_main_trace_lane = nullptr;
+
+    // Number of kT updates between automatic entity reorderings (0 for never), and the kT update count at the last one
+    unsigned int m_reorder_freq = 0;
+    size_t m_reorder_last_kT_update = 0;
+    // If the last DoDynamics call ended with a reordering, which already sync-ed kT and dT
+    bool m_synced_for_reorder = false;
+    // How many reorderings happened and how long they took in total
+    size_t m_num_reorders = 0;
+    double m_reorder_seconds = 0.;
     // The output file format for contact pairs
     OUTPUT_FORMAT m_cnt_out_format = OUTPUT_FORMAT::CSV;
     // The output file content for contact pairs
@@ -1276,6 +1577,8 @@ class DEMSolver {
     // the edge of the world.
     float3 m_target_box_min = make_float3(-DEFAULT_BOX_DOMAIN_SIZE * (1. + DEFAULT_BOX_DOMAIN_ENLARGE_RATIO) / 2.);
     float3 m_target_box_max = make_float3(DEFAULT_BOX_DOMAIN_SIZE * (1. + DEFAULT_BOX_DOMAIN_ENLARGE_RATIO) / 2.);
+    // Directions (PERIODIC_X/Y/Z bits) in which the user box is periodic
+    unsigned int m_periodic_dirs = 0;
 
     // Exact `World' size along X dir (determined at init time)
     float m_boxX = -1.f;
@@ -1303,8 +1606,10 @@ class DEMSolver {
     float l = FLT_MAX;
     // The edge length of a bin (for contact detection)
     double m_binSize;
-    // Total number of bins
+    // Total number of bins (of all bin levels)
     size_t m_num_bins;
+    // Number of bin levels (1 unless hierarchical binning is in use)
+    unsigned int m_num_bin_levels = 1;
     // Number of bins on each direction
     binID_t nbX;
     binID_t nbY;
@@ -1332,11 +1637,17 @@ class DEMSolver {
     // The number of user-estimated (max) number of owners that will be present in the simulation. If 0, then the arrays
     // will just be resized at intialization based on the input size.
     size_t m_instructed_num_owners = 0;
+    // Same for spheres, triangles and contacts
+    size_t m_instructed_num_spheres = 0;
+    size_t m_instructed_num_triangles = 0;
+    size_t m_instructed_num_contacts = 0;
 
     // Whether the GPU-side systems have been initialized
     bool sys_initialized = false;
     // Smallest sphere radius (used to let the user know whether the expand factor is sufficient)
     float m_smallest_radius = FLT_MAX;
+    // Largest sphere radius (used to decide the number of bin levels in hierarchical binning)
+    float m_largest_radius = 0.f;
 
     // The number of dT steps before it waits for a kT update. The default value means every dT step will wait for a
     // newly produced contact-pair info (from kT) before proceeding.
@@ -1369,6 +1680,11 @@ class DEMSolver {
     unsigned int threshold_too_many_tri_in_bin = 32768;
     // The max velocity at which the simulation should error out
     float threshold_error_out_vel = 1e3;
+    // See EnableSleeping
+    bool use_sleeping = false;
+    float sleep_vel_thres = 0.;
+    float sleep_acc_thres = 0.;
+    unsigned int sleep_n_steps = 0;
     // Num of steps that kT takes average before making a conclusion on the performance of this bin size
     unsigned int auto_adjust_observe_steps = 25;
     // See corresponding method for those...
@@ -1398,6 +1714,12 @@ class DEMSolver {
 
     // Strategy for auto-adapting time steps size
     ADAPT_TS_TYPE adapt_ts_type = ADAPT_TS_TYPE::NONE;
+    // Bounds and tolerance of adaptive time step size (negative means using the default)
+    double adapt_ts_min = -1.;
+    double adapt_ts_max = -1.;
+    float adapt_ts_tol = -1.f;
+    // The inspector that will be used for querying system max acceleration (int_diff adaptive time step size only)
+    std::shared_ptr<DEMInspector> m_approx_max_acc_func;
 
     ////////////////////////////////////////////////////////////////////////////////
     // No user method is provided to modify the following key quantities, even if
@@ -1490,6 +1812,10 @@ class DEMSolver {
 
     // A big fat tab for all string replacement that the JIT compiler needs to consider
     std::unordered_map<std::string, std::string> m_subs;
+    // The analytical entity definitions with the owner array left as the _objOwner_ placeholder. Owner IDs are the
+    // only part of them that can change after initialization (when PurgeFamily shifts them), and then they are
+    // regenerated from this.
+    std::string m_anal_defs_template;
 
     // A map that records the numbering for user-defined owner wildcards
     std::unordered_map<std::string, unsigned int> m_owner_wc_num;
@@ -1568,6 +1894,7 @@ class DEMSolver {
     std::vector<float3> m_input_mesh_obj_xyz;
     std::vector<float4> m_input_mesh_obj_rot;
     std::vector<unsigned int> m_input_mesh_obj_family;
+    std::vector<notStupidBool_t> m_input_mesh_obj_use_bvh;
 
     // Processed unique family prescription info
     std::vector<familyPrescription_t> m_unique_family_prescription;
@@ -1676,6 +2003,8 @@ class DEMSolver {
     void updateTotalEntityNum();
     /// Jitify GPU kernels, based on pre-processed user inputs
     void jitifyKernels();
+    /// Parse the periodic directions given to InstructBoxDomainDimension
+    void setPeriodicDirs(const std::string& periodic_dirs);
     /// Figure out the unit length l and numbers of voxels along each direction, based on domain size X, Y, Z
     void figureOutNV();
     /// Set the default bin (for contact detection) size to be the same of the smallest sphere
@@ -1708,6 +2037,11 @@ class DEMSolver {
     void reportInitStats() const;
     /// Based on user input, prepare family_mask_matrix (family contact map matrix)
     void figureOutFamilyMasks();
+    /// Open an output file and run write_func on it, either right away or in the background writer thread (then
+    /// write_func must only use data it owns)
+    void submitOutput(const std::string& outfilename,
+                      bool binary,
+                      std::function<void(std::ofstream&)> write_func) const;
     /// Reset kT and dT back to a status like when the simulation system is constructed. I decided to make this a
     /// private method because it can be dangerous, as if it is called when kT is waiting at the outer loop, it will
     /// stall the siumulation. So perhaps the user should not call it without knowing what they are doing. Also note
@@ -1737,21 +2071,12 @@ class DEMSolver {
                              const objNormal_t normal = ENTITY_NORMAL_INWARD);
     /// Assert that the DEM simulation system is initialized
     void assertSysInit(const std::string& method_name);
+    /// Assert that the system is initialized and all the IDs given to a bulk owner state accessor are valid owners
+    void assertOwnerIDs(const std::vector<bodyID_t>& IDs, const std::string& method_name) const;
     /// Assert that the DEM simulation system is not initialized
     void assertSysNotInit(const std::string& method_name);
     /// Print due information on worker threads reported anomalies
     bool goThroughWorkerAnomalies();
-    /// @brief Get the owner ID of this geometry, depending on the contact type.
-    /// @return Owner ID of this geometry.
-    bodyID_t getGeoOwnerID(const bodyID_t& geoID, const contact_t& cnt_type) const;
-    /// @brief Implementation of getting (unsorted) contact pairs from dT.
-    /// @param type_func Exclude certain contact types from being outputted if this evaluates to false.
-    void getContacts_impl(std::vector<bodyID_t>& idA,
-                          std::vector<bodyID_t>& idB,
-                          std::vector<contact_t>& cnt_type,
-                          std::vector<family_t>& famA,
-                          std::vector<family_t>& famB,
-                          std::function<bool(contact_t)> type_func) const;
 
     // Some JIT packaging helpers
     inline void equipClumpTemplates(std::unordered_map<std::string, std::string>& strMap);
@@ -1764,6 +2089,7 @@ class DEMSolver {
     inline void equipFamilyOnFlyChanges(std::unordered_map<std::string, std::string>& strMap);
     inline void equipForceModel(std::unordered_map<std::string, std::string>& strMap);
     inline void equipIntegrationScheme(std::unordered_map<std::string, std::string>& strMap);
+    inline void equipSleeping(std::unordered_map<std::string, std::string>& strMap);
     inline void equipKernelIncludes(std::unordered_map<std::string, std::string>& strMap);
 };
 
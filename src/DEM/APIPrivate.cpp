@@ -24,6 +24,18 @@ void DEMSolver::assertSysInit(const std::string& method_name) {
     }
 }
 
+void DEMSolver::assertOwnerIDs(const std::vector<bodyID_t>& IDs, const std::string& method_name) const {
+    if (!sys_initialized) {
+        DEME_ERROR("DEMSolver's method %s can only be called after calling Initialize()", method_name.c_str());
+    }
+    for (const auto& ID : IDs) {
+        if (ID >= nOwnerBodies) {
+            DEME_ERROR("%s is given owner ID %zu, but there are only %zu owners in the simulation system.",
+                       method_name.c_str(), (size_t)ID, nOwnerBodies);
+        }
+    }
+}
+
 void DEMSolver::assertSysNotInit(const std::string& method_name) {
     if (sys_initialized) {
         DEME_ERROR("DEMSolver's method %s can only be called before calling Initialize()", method_name.c_str());
@@ -215,6 +227,7 @@ void DEMSolver::jitifyKernels() {
     equipFamilyOnFlyChanges(m_subs);
     equipForceModel(m_subs);
     equipIntegrationScheme(m_subs);
+    equipSleeping(m_subs);
     equipKernelIncludes(m_subs);
     kT->jitifyKernels(m_subs);
     dT->jitifyKernels(m_subs);
@@ -229,50 +242,29 @@ void DEMSolver::jitifyKernels() {
     // init).
     m_approx_max_vel_func->Initialize(m_subs, true);
     dT->approxMaxVelFunc = m_approx_max_vel_func;
-}
-
-bodyID_t DEMSolver::getGeoOwnerID(const bodyID_t& geoID, const contact_t& cnt_type) const {
-    switch (cnt_type) {
-        case NOT_A_CONTACT:
-            return NULL_BODYID;
-        case SPHERE_SPHERE_CONTACT:
-            return dT->ownerClumpBody.at(geoID);
-        case SPHERE_MESH_CONTACT:
-            return dT->ownerMesh.at(geoID);
-        default:
-            return dT->ownerAnalBody.at(geoID);
+    if (m_approx_max_acc_func) {
+        m_approx_max_acc_func->Initialize(m_subs, true);
+        dT->approxMaxAccFunc = m_approx_max_acc_func;
     }
 }
 
-void DEMSolver::getContacts_impl(std::vector<bodyID_t>& idA,
-                                 std::vector<bodyID_t>& idB,
-                                 std::vector<contact_t>& cnt_type,
-                                 std::vector<family_t>& famA,
-                                 std::vector<family_t>& famB,
-                                 std::function<bool(contact_t)> type_func) const {
-    size_t num_contacts = dT->getNumContacts();
-    idA.resize(num_contacts);
-    idB.resize(num_contacts);
-    cnt_type.resize(num_contacts);
-    famA.resize(num_contacts);
-    famB.resize(num_contacts);
-    size_t useful_contacts = 0;
-    for (size_t i = 0; i < num_contacts; i++) {
-        contact_t this_type = dT->contactType.at(i);
-        if (type_func(this_type)) {
-            idA[useful_contacts] = getGeoOwnerID(dT->idGeometryA.at(i), this_type);
-            idB[useful_contacts] = getGeoOwnerID(dT->idGeometryB.at(i), this_type);
-            cnt_type[useful_contacts] = this_type;
-            famA[useful_contacts] = dT->familyID.at(idA[useful_contacts]);
-            famB[useful_contacts] = dT->familyID.at(idB[useful_contacts]);
-            useful_contacts++;
-        }
-    }
-    idA.resize(useful_contacts);
-    idB.resize(useful_contacts);
-    cnt_type.resize(useful_contacts);
-    famA.resize(useful_contacts);
-    famB.resize(useful_contacts);
+void DEMSolver::setPeriodicDirs(const std::string& periodic_dirs) {
+    m_periodic_dirs = 0;
+    const std::string dirs = str_to_upper(periodic_dirs);
+    if (dirs == "NONE") {
+        return;
+    }
+    for (const char dir : dirs) {
+        if (dir == 'X') {
+            m_periodic_dirs |= PERIODIC_X;
+        } else if (dir == 'Y') {
+            m_periodic_dirs |= PERIODIC_Y;
+        } else if (dir == 'Z') {
+            m_periodic_dirs |= PERIODIC_Z;
+        } else {
+            DEME_ERROR("Unknown '%s' periodic directions in InstructBoxDomainDimension call.", periodic_dirs.c_str());
+        }
+    }
 }
 
 void DEMSolver::figureOutNV() {
@@ -398,6 +390,9 @@ void DEMSolver::decideBinSize() {
             if (radius < m_smallest_radius) {
                 m_smallest_radius = radius;
             }
+            if (radius > m_largest_radius) {
+                m_largest_radius = radius;
+            }
         }
     }
 
@@ -421,7 +416,22 @@ void DEMSolver::decideBinSize() {
         }
     }
 
-    m_num_bins = hostCalcBinNum(nbX, nbY, nbZ, m_voxelSize, m_binSize, nvXp2, nvYp2, nvZp2);
+    // With hierarchical binning, there are as many levels as needed for the largest sphere to fit in a coarsest-level
+    // bin, and the bins of all levels count. nbX, nbY, nbZ are for level 0.
+    auto calc_bin_num = [&]() {
+        m_num_bin_levels =
+            use_hierarchical_binning ? hostCalcBinLevelNum(m_binSize, m_largest_radius, DEME_MAX_BIN_LEVELS) : 1;
+        binID_t levelNbX[DEME_MAX_BIN_LEVELS], levelNbY[DEME_MAX_BIN_LEVELS], levelNbZ[DEME_MAX_BIN_LEVELS],
+            levelBinOffset[DEME_MAX_BIN_LEVELS];
+        size_t num_bins = hostCalcBinLevels(levelNbX, levelNbY, levelNbZ, levelBinOffset, m_num_bin_levels,
+                                            m_voxelSize, m_binSize, nvXp2, nvYp2, nvZp2);
+        nbX = levelNbX[0];
+        nbY = levelNbY[0];
+        nbZ = levelNbZ[0];
+        return num_bins;
+    };
+
+    m_num_bins = calc_bin_num();
     // It's better to compute num of bins this way, rather than...
     // (uint64_t)(m_boxX / m_binSize + 1) * (uint64_t)(m_boxY / m_binSize + 1) * (uint64_t)(m_boxZ / m_binSize + 1);
     // because the space bins and voxels can cover may be larger than the user-defined sim domain
@@ -435,7 +445,7 @@ void DEMSolver::decideBinSize() {
             } else {
                 m_binSize *= 1.2;
             }
-            m_num_bins = hostCalcBinNum(nbX, nbY, nbZ, m_voxelSize, m_binSize, nvXp2, nvYp2, nvZp2);
+            m_num_bins = calc_bin_num();
             // If changed size relationship, good enough.
             if ((prev_num < m_target_init_bin_num && m_num_bins >= m_target_init_bin_num) ||
                 (prev_num >= m_target_init_bin_num && m_num_bins < m_target_init_bin_num)) {
@@ -453,7 +463,7 @@ void DEMSolver::decideBinSize() {
                 m_num_bins, m_binSize, (size_t)(std::numeric_limits<binID_t>::max() - 1));
             while (m_num_bins > std::numeric_limits<binID_t>::max() - 1) {
                 m_binSize *= 1.5;
-                m_num_bins = hostCalcBinNum(nbX, nbY, nbZ, m_voxelSize, m_binSize, nvXp2, nvYp2, nvZp2);
+                m_num_bins = calc_bin_num();
             }
             DEME_WARNING(
                 "Bin size auto-adjusted to %.6g, now we have %zu initial bins. Note this number may be large and it "
@@ -468,6 +478,23 @@ void DEMSolver::decideBinSize() {
                 m_num_bins, (size_t)(std::numeric_limits<binID_t>::max() - 1));
         }
     }
+
+    // A sphere must not reach into the bins of its own periodic image, or the pairs it forms would be double-counted
+    if (m_periodic_dirs) {
+        const float3 period = m_user_box_max - m_user_box_min;
+        const double coarsest_bin_size = m_binSize * (double)(1u << (m_num_bin_levels - 1));
+        const double min_period = 2. * (coarsest_bin_size + 2. * m_largest_radius);
+        if (((m_periodic_dirs & PERIODIC_X) && period.x < min_period) ||
+            ((m_periodic_dirs & PERIODIC_Y) && period.y < min_period) ||
+            ((m_periodic_dirs & PERIODIC_Z) && period.z < min_period)) {
+            DEME_ERROR(
+                "Each periodic length of the simulation box needs to be at least %.6g, that is 2 * (%.6g + 2 * %.6g): "
+                "twice the sum of the coarsest-level bin size and twice the largest sphere radius. But the box is "
+                "%.6g by %.6g by %.6g.\nPlease enlarge the box, use smaller bins (SetInitBinSize) or turn off "
+                "UseHierarchicalBinning.",
+                min_period, coarsest_bin_size, m_largest_radius, period.x, period.y, period.z);
+        }
+    }
 }
 
 void DEMSolver::decideCDMarginStrat() {
@@ -480,6 +507,10 @@ void DEMSolver::decideCDMarginStrat() {
             m_max_v_finder_type = MARGIN_FINDER_TYPE::DEM_INSPECTOR;
             break;
     }
+    // The int_diff adaptive step size strategy needs the max acceleration as well
+    if (adapt_ts_type == ADAPT_TS_TYPE::INT_DIFF && !m_approx_max_acc_func) {
+        m_approx_max_acc_func = this->CreateInspector("clump_max_absacc");
+    }
 }
 
 void DEMSolver::reportInitStats() const {
@@ -501,6 +532,9 @@ void DEMSolver::reportInitStats() const {
     DEME_INFO("The initial time step size: %.7g", m_ts_size);
     DEME_INFO("The initial edge length of a bin: %.17g", m_binSize);
     DEME_INFO("The initial number of bins: %zu", m_num_bins);
+    if (m_num_bin_levels > 1) {
+        DEME_INFO("The number of bin levels (hierarchical binning): %u", m_num_bin_levels);
+    }
 
     DEME_INFO("The total number of clumps: %zu", nOwnerClumps);
     DEME_INFO("The combined number of component spheres: %zu", nSpheresGM);
@@ -682,6 +716,7 @@ void DEMSolver::preprocessTriangleObjs() {
         m_input_mesh_obj_xyz.push_back(mesh_obj->init_pos);
         m_input_mesh_obj_rot.push_back(mesh_obj->init_oriQ);
         m_input_mesh_obj_family.push_back(mesh_obj->family_code);
+        m_input_mesh_obj_use_bvh.push_back(mesh_obj->use_bvh);
         m_mesh_facet_owner.insert(m_mesh_facet_owner.end(), mesh_obj->GetNumTriangles(), thisMeshObj);
         for (unsigned int i = 0; i < mesh_obj->GetNumTriangles(); i++) {
             m_mesh_facet_materials.push_back(mesh_obj->materials.at(i)->load_order);
@@ -948,6 +983,32 @@ void DEMSolver::transferSolverParams() {
     // Time step constant-ness and expand factor constant-ness
     dT->solverFlags.isStepConst = ts_size_is_const;
     kT->solverFlags.isExpandFactorFixed = use_user_defined_expand_factor;
+    dT->solverFlags.isExpandFactorFixed = use_user_defined_expand_factor;
+
+    // If kT and dT live on the same device, they hand over transferred arrays by swapping, not copying
+    kT->solverFlags.useBufferSwap = (kT->streamInfo.device == dT->streamInfo.device);
+    dT->solverFlags.useBufferSwap = kT->solverFlags.useBufferSwap;
+
+    // Adaptive time step size strategy, bounds and tolerance
+    switch (adapt_ts_type) {
+        case (ADAPT_TS_TYPE::MAX_VEL):
+            dT->solverFlags.stepSizeStrat = VAR_TS_STRAT::MAX_VEL;
+            break;
+        case (ADAPT_TS_TYPE::INT_DIFF):
+            dT->solverFlags.stepSizeStrat = VAR_TS_STRAT::INT_GAP;
+            break;
+        default:
+            dT->solverFlags.stepSizeStrat = VAR_TS_STRAT::DEME_CONST;
+    }
+    if (!ts_size_is_const) {
+        dT->solverFlags.minStepSize = (adapt_ts_min > 0.) ? adapt_ts_min : 0.1 * m_ts_size;
+        dT->solverFlags.maxStepSize = (adapt_ts_max > 0.) ? adapt_ts_max : 10. * m_ts_size;
+        float tol_frac = adapt_ts_tol;
+        if (tol_frac <= 0.f) {
+            tol_frac = (adapt_ts_type == ADAPT_TS_TYPE::INT_DIFF) ? 1e-5f : 1e-2f;
+        }
+        dT->solverFlags.stepSizeTolerance = tol_frac * m_smallest_radius;
+    }
 
     // Jitify or not
     dT->solverFlags.useClumpJitify = jitify_clump_templates;
@@ -972,6 +1033,12 @@ void DEMSolver::transferSolverParams() {
     dTkT_InteractionManager->dynamicMaxFutureDrift = m_suggestedFutureDrift;
     dTkT_InteractionManager->kinematicMaxFutureDrift = m_suggestedFutureDrift;
 
+    // Sleeping policies
+    dT->solverFlags.useSleeping = use_sleeping;
+    dT->simParams->sleepVelThres = sleep_vel_thres;
+    dT->simParams->sleepAccThres = sleep_acc_thres;
+    dT->simParams->sleepSteps = sleep_n_steps;
+
     // Tell kT and dT whether the user enforeced potential on-the-fly family number changes
     kT->solverFlags.canFamilyChange = famnum_can_change_conditionally;
     dT->solverFlags.canFamilyChange = famnum_can_change_conditionally;
@@ -998,6 +1065,7 @@ void DEMSolver::transferSolverParams() {
 
     // Whether the solver should auto-update bin sizes
     kT->solverFlags.autoBinSize = auto_adjust_bin_size;
+    kT->stateParams.binLevelRadius = use_hierarchical_binning ? m_largest_radius : 0.;
     {
         kT->stateParams.binChangeObserveSteps = auto_adjust_observe_steps;
         kT->stateParams.binTopChangeRate = auto_adjust_max_rate;
@@ -1053,28 +1121,34 @@ void DEMSolver::transferSimParams() {
     DEME_DEBUG_PRINTF("%u contact wildcards are in the force model.", nContactWildcards);
 
     dT->setSimParams(nvXp2, nvYp2, nvZp2, l, m_voxelSize, m_binSize, nbX, nbY, nbZ, m_boxLBF, m_user_box_min,
-                     m_user_box_max, G, m_ts_size, m_expand_factor, m_approx_max_vel, m_expand_safety_multi,
-                     m_expand_base_vel, m_force_model->m_contact_wildcards, m_force_model->m_owner_wildcards,
-                     m_force_model->m_geo_wildcards);
-    kT->setSimParams(nvXp2, nvYp2, nvZp2, l, m_voxelSize, m_binSize, nbX, nbY, nbZ, m_boxLBF, m_user_box_min,
-                     m_user_box_max, G, m_ts_size, m_expand_factor, m_approx_max_vel, m_expand_safety_multi,
-                     m_expand_base_vel, m_force_model->m_contact_wildcards, m_force_model->m_owner_wildcards,
-                     m_force_model->m_geo_wildcards);
+                     m_user_box_max, m_periodic_dirs, G, m_ts_size, m_expand_factor, m_approx_max_vel,
+                     m_expand_safety_multi, m_expand_base_vel, m_force_model->m_contact_wildcards,
+                     m_force_model->m_owner_wildcards, m_force_model->m_geo_wildcards);
+    kT->setSimParams(nvXp2, nvYp2, nvZp2, l, m_voxelSize, m_binSize, nbX, nbY, nbZ, m_num_bin_levels, m_boxLBF,
+                     m_user_box_min, m_user_box_max, m_periodic_dirs, G, m_ts_size, m_expand_factor,
+                     m_approx_max_vel, m_expand_safety_multi, m_expand_base_vel, m_force_model->m_contact_wildcards,
+                     m_force_model->m_owner_wildcards, m_force_model->m_geo_wildcards);
 }
 
 void DEMSolver::allocateGPUArrays() {
+    // The capacities the user instructed
+    ArrayReservation reservation;
+    reservation.nOwners = m_instructed_num_owners;
+    reservation.nSpheres = m_instructed_num_spheres;
+    reservation.nTriangles = m_instructed_num_triangles;
+    reservation.nContacts = m_instructed_num_contacts;
     // Resize managed arrays based on the statistical data we had from the previous step
-    std::thread dThread = std::move(std::thread([this]() {
+    std::thread dThread = std::move(std::thread([this, &reservation]() {
         this->dT->allocateManagedArrays(
             this->nOwnerBodies, this->nOwnerClumps, this->nExtObj, this->nTriMeshes, this->nSpheresGM, this->nTriGM,
             this->nAnalGM, this->nExtraContacts, this->nDistinctMassProperties, this->nDistinctClumpBodyTopologies,
-            this->nDistinctClumpComponents, this->nJitifiableClumpComponents, this->nMatTuples);
+            this->nDistinctClumpComponents, this->nJitifiableClumpComponents, this->nMatTuples, reservation);
     }));
-    std::thread kThread = std::move(std::thread([this]() {
+    std::thread kThread = std::move(std::thread([this, &reservation]() {
         this->kT->allocateManagedArrays(
             this->nOwnerBodies, this->nOwnerClumps, this->nExtObj, this->nTriMeshes, this->nSpheresGM, this->nTriGM,
             this->nAnalGM, this->nExtraContacts, this->nDistinctMassProperties, this->nDistinctClumpBodyTopologies,
-            this->nDistinctClumpComponents, this->nJitifiableClumpComponents, this->nMatTuples);
+            this->nDistinctClumpComponents, this->nJitifiableClumpComponents, this->nMatTuples, reservation);
     }));
     dThread.join();
     kThread.join();
@@ -1115,7 +1189,7 @@ void DEMSolver::initializeGPUArrays() {
         // Analytical objects' initial stats
         m_input_ext_obj_family,
         // Meshed objects' initial stats
-        m_input_mesh_obj_family, m_mesh_facet_owner, m_mesh_facets,
+        m_input_mesh_obj_family, m_input_mesh_obj_use_bvh, m_mesh_facet_owner, m_mesh_facets,
         // Family mask
         m_family_mask_matrix,
         // Templates and misc.
@@ -1164,7 +1238,7 @@ void DEMSolver::updateClumpMeshArrays(size_t nOwners,
         // Analytical objects' initial stats
         m_input_ext_obj_family,
         // Meshed objects' initial stats
-        m_input_mesh_obj_family, m_mesh_facet_owner, m_mesh_facets,
+        m_input_mesh_obj_family, m_input_mesh_obj_use_bvh, m_mesh_facet_owner, m_mesh_facets,
         // Family mask
         m_family_mask_matrix,
         // Templates and misc.
@@ -1289,6 +1363,11 @@ inline void DEMSolver::equipForceModel(std::unordered_map<std::string, std::stri
     // As our numerical method stands now, AOwnerFamily and BOwnerFamily are always needed.
     add_force_model_ingr(added_ingredients, "AOwnerFamily");
     add_force_model_ingr(added_ingredients, "BOwnerFamily");
+    // The wake-up check of sleeping owners needs to know who the owners are
+    if (use_sleeping) {
+        add_force_model_ingr(added_ingredients, "AOwner");
+        add_force_model_ingr(added_ingredients, "BOwner");
+    }
     // If we collect force in force-calc kernel, these are needed...
     if (collect_force_in_force_kernel) {
         add_force_model_ingr(added_ingredients, "AOwner");
@@ -1641,7 +1720,6 @@ inline void DEMSolver::equipAnalGeoTemplates(std::unordered_map<std::string, std
     }
 
     std::unordered_map<std::string, std::string> array_content;
-    array_content["_objOwner_"] = objOwner;
     array_content["_objType_"] = objType;
     array_content["_objMaterial_"] = objMat;
     array_content["_objNormal_"] = objNormal;
@@ -1656,8 +1734,9 @@ inline void DEMSolver::equipAnalGeoTemplates(std::unordered_map<std::string, std
     array_content["_objSize3_"] = objSize3;
     array_content["_objMass_"] = objMass;
 
-    std::string analyticalEntityDefs = ANALYTICAL_COMPONENT_DEFINITIONS_JITIFIED();
-    analyticalEntityDefs = replace_patterns(analyticalEntityDefs, array_content);
+    // Owners are substituted last, so PurgeFamily can redo just that part if they change
+    m_anal_defs_template = replace_patterns(ANALYTICAL_COMPONENT_DEFINITIONS_JITIFIED(), array_content);
+    std::string analyticalEntityDefs = replace_patterns(m_anal_defs_template, {{"_objOwner_", objOwner}});
     if (ensure_kernel_line_num) {
         analyticalEntityDefs = compact_code(analyticalEntityDefs);
     }
@@ -1979,6 +2058,18 @@ inline void DEMSolver::equipIntegrationScheme(std::unordered_map<std::string, st
     strMap["_integrationVelocityPassOnStrategy_"] = strat;
 }
 
+inline void DEMSolver::equipSleeping(std::unordered_map<std::string, std::string>& strMap) {
+    std::string wake_strat = " ";
+    if (use_sleeping) {
+        wake_strat = SLEEPER_WAKE_UP_STRAT();
+        if (ensure_kernel_line_num) {
+            wake_strat = compact_code(wake_strat);
+        }
+    }
+    strMap["_sleepEnabled_"] = use_sleeping ? "true" : "false";
+    strMap["_sleeperWakeUpStrat_"] = wake_strat;
+}
+
 inline void DEMSolver::equipSimParams(std::unordered_map<std::string, std::string>& strMap) {
     strMap["_nvXp2_"] = std::to_string(nvXp2);
     strMap["_nvYp2_"] = std::to_string(nvYp2);
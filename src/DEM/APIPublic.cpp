@@ -38,6 +38,15 @@ DEMSolver::DEMSolver(unsigned int nGPUs) {
 DEMSolver::~DEMSolver() {
     if (sys_initialized)
         DoDynamicsThenSync(0.0);
+    // Finish writing the output files still in the queue. Errors cannot be thrown from here, so they are reported.
+    if (m_async_writer) {
+        try {
+            m_async_writer->Flush();
+        } catch (const std::exception& e) {
+            DEME_WARNING("Writing an output file in the background failed: %s", e.what());
+        }
+    }
+    m_async_writer.reset();
     delete kT;
     delete dT;
     delete kTMain_InteractionManager;
@@ -77,6 +86,15 @@ void DEMSolver::SetVerbosity(const std::string& verbose) {
             DEME_ERROR("Instruction %s is unknown in SetVerbosity call.", verbose.c_str());
     }
 }
+void DEMSolver::UseJitDiskCache(bool use) {
+    JitHelper::SetDiskCacheEnabled(use);
+}
+void DEMSolver::SetJitCacheDir(const std::string& dir) {
+    JitHelper::SetDiskCacheDir(std::filesystem::path(dir));
+}
+void DEMSolver::SetJitCacheSizeLimit(size_t bytes) {
+    JitHelper::SetDiskCacheSizeLimit(bytes);
+}
 void DEMSolver::SetOutputFormat(const std::string& format) {
     std::string u_format = str_to_upper(format);
     switch (hash_charr(u_format.c_str())) {
@@ -97,6 +115,58 @@ void DEMSolver::SetOutputFormat(const std::string& format) {
             DEME_ERROR("Instruction %s is unknown in SetOutputFormat call.", format.c_str());
     }
 }
+void DEMSolver::UseAsyncOutput(bool use) {
+    if (!use && m_async_writer) {
+        m_async_writer->Flush();
+    }
+    m_use_async_output = use;
+}
+void DEMSolver::SetAsyncOutputQueueSize(unsigned int max_pending) {
+    m_async_output_max_pending = max_pending;
+    if (m_async_writer) {
+        m_async_writer->SetMaxPending(max_pending);
+    }
+}
+void DEMSolver::SetStepMetricsOutput(const std::string& filename,
+                                     unsigned int every_n_steps,
+                                     const std::string& format) {
+    StepMetricsSink::FORMAT sink_format = StepMetricsSink::FORMAT::CSV;
+    std::string u_format = str_to_upper(format);
+    switch (hash_charr(u_format.c_str())) {
+        case ("CSV"_):
+            sink_format = StepMetricsSink::FORMAT::CSV;
+            break;
+        case ("JSONL"_):
+            sink_format = StepMetricsSink::FORMAT::JSONL;
+            break;
+        default:
+            DEME_ERROR("Instruction %s is unknown in SetStepMetricsOutput call.", format.c_str());
+    }
+    DisableStepMetrics();
+    dT->stepMetricsSink = std::make_shared<StepMetricsSink>(filename, sink_format, every_n_steps);
+    dT->nMetricsSteps = 0;
+}
+void DEMSolver::SetStepMetricsCallback(std::function<void(const StepMetrics&)> callback, unsigned int every_n_steps) {
+    DisableStepMetrics();
+    dT->stepMetricsSink = std::make_shared<StepMetricsSink>(std::move(callback), every_n_steps);
+    dT->nMetricsSteps = 0;
+}
+void DEMSolver::DisableStepMetrics() {
+    if (dT->stepMetricsSink) {
+        dT->stepMetricsSink->Flush();
+        dT->stepMetricsSink.reset();
+    }
+}
+void DEMSolver::UseCompressedOutput(bool use) {
+#ifdef DEME_USE_ZLIB
+    m_compress_binary_output = use;
+#else
+    if (use) {
+        DEME_ERROR("Compressed output needs zlib, which was not enabled (USE_ZLIB) when the code was compiled.");
+    }
+    m_compress_binary_output = false;
+#endif
+}
 void DEMSolver::SetContactOutputFormat(const std::string& format) {
     std::string u_format = str_to_upper(format);
     switch (hash_charr(u_format.c_str())) {
@@ -225,67 +295,7 @@ void DEMSolver::SetContactOutputContent(const std::vector<std::string>& content)
 }
 
 std::vector<bodyID_t> DEMSolver::GetOwnerContactClumps(bodyID_t ownerID) const {
-    // Is this owner a clump?
-    ownerType_t this_type = dT->ownerTypes.at(ownerID);
-    std::vector<bodyID_t> geo_to_watch;  // geo IDs that need to scan
-    switch (this_type) {
-        case OWNER_T_CLUMP:
-            for (bodyID_t i = 0; i < nSpheresGM; i++) {
-                if (ownerID == dT->ownerClumpBody.at(i))
-                    geo_to_watch.push_back(i);
-            }
-            break;
-        case OWNER_T_ANALYTICAL:
-            for (bodyID_t i = 0; i < nAnalGM; i++) {
-                if (ownerID == dT->ownerAnalBody.at(i))
-                    geo_to_watch.push_back(i);
-            }
-            break;
-        case OWNER_T_MESH:
-            for (bodyID_t i = 0; i < nTriGM; i++) {
-                if (ownerID == dT->ownerMesh.at(i))
-                    geo_to_watch.push_back(i);
-            }
-            break;
-    }
-
-    std::vector<bodyID_t> clumps_in_cnt;
-    // If this is not clump, then checking idB for it is enough
-    if (this_type != OWNER_T_CLUMP) {
-        for (size_t i = 0; i < dT->getNumContacts(); i++) {
-            auto idA = dT->idGeometryA.at(i);
-            auto idB = dT->idGeometryB.at(i);
-            if (!check_exist(geo_to_watch, idB))
-                continue;
-            auto cnt_type = dT->contactType.at(i);
-            // If it is a mesh facet, then contact type needs to match
-            if (this_type == OWNER_T_MESH) {
-                if (cnt_type == SPHERE_MESH_CONTACT) {
-                    clumps_in_cnt.push_back(dT->ownerClumpBody.at(idA));
-                }
-            } else {  // If analytical, then contact type larger than PLANE is fine
-                if (cnt_type >= SPHERE_PLANE_CONTACT) {
-                    clumps_in_cnt.push_back(dT->ownerClumpBody.at(idA));
-                }
-            }
-        }
-    } else {  // If a clump, then both idA and idB need to be checked
-        for (size_t i = 0; i < dT->getNumContacts(); i++) {
-            auto idA = dT->idGeometryA.at(i);
-            auto idB = dT->idGeometryB.at(i);
-            auto cnt_type = dT->contactType.at(i);
-            if (check_exist(geo_to_watch, idA)) {
-                if (cnt_type == SPHERE_SPHERE_CONTACT) {
-                    clumps_in_cnt.push_back(dT->ownerClumpBody.at(idB));
-                }
-            } else if (check_exist(geo_to_watch, idB)) {
-                if (cnt_type == SPHERE_SPHERE_CONTACT) {
-                    clumps_in_cnt.push_back(dT->ownerClumpBody.at(idA));
-                }
-            }
-        }
-    }
-    return clumps_in_cnt;
+    return dT->getOwnerContactClumps(ownerID);
 }
 
 std::shared_ptr<DEMMaterial> DEMSolver::Duplicate(const std::shared_ptr<DEMMaterial>& ptr) {
@@ -306,15 +316,11 @@ std::shared_ptr<DEMClumpBatch> DEMSolver::Duplicate(const std::shared_ptr<DEMClu
 
 std::vector<std::pair<bodyID_t, bodyID_t>> DEMSolver::GetClumpContacts() const {
     std::vector<bodyID_t> idA_tmp, idB_tmp;
-    std::vector<family_t> famA_tmp, famB_tmp;
-    std::vector<contact_t> cnt_type_tmp;
-    // Getting sphere contacts is enough
-    getContacts_impl(idA_tmp, idB_tmp, cnt_type_tmp, famA_tmp, famB_tmp,
-                     [](contact_t type) { return type == SPHERE_SPHERE_CONTACT; });
-    auto idx = hostSortIndices(idA_tmp);
-    std::vector<std::pair<bodyID_t, bodyID_t>> out_pair(idx.size());
-    for (size_t i = 0; i < idx.size(); i++) {
-        out_pair[i] = std::pair<bodyID_t, bodyID_t>(idA_tmp[idx[i]], idB_tmp[idx[i]]);
+    // Getting sphere contacts is enough; they come sorted by idA
+    dT->getClumpContactPairs(idA_tmp, idB_tmp);
+    std::vector<std::pair<bodyID_t, bodyID_t>> out_pair(idA_tmp.size());
+    for (size_t i = 0; i < idA_tmp.size(); i++) {
+        out_pair[i] = std::pair<bodyID_t, bodyID_t>(idA_tmp[i], idB_tmp[i]);
     }
     return out_pair;
 }
@@ -322,46 +328,27 @@ std::vector<std::pair<bodyID_t, bodyID_t>> DEMSolver::GetClumpContacts() const {
 std::vector<std::pair<bodyID_t, bodyID_t>> DEMSolver::GetClumpContacts(
     const std::set<family_t>& family_to_include) const {
     std::vector<bodyID_t> idA_tmp, idB_tmp;
-    std::vector<family_t> famA_tmp, famB_tmp;
-    std::vector<contact_t> cnt_type_tmp;
-    // Getting sphere contacts is enough
-    getContacts_impl(idA_tmp, idB_tmp, cnt_type_tmp, famA_tmp, famB_tmp,
-                     [](contact_t type) { return type == SPHERE_SPHERE_CONTACT; });
+    dT->getClumpContactPairs(idA_tmp, idB_tmp);
     // Exclude the families that are not in the set
-    std::vector<bool> elem_to_remove(idA_tmp.size(), false);
+    std::vector<std::pair<bodyID_t, bodyID_t>> out_pair;
     for (size_t i = 0; i < idA_tmp.size(); i++) {
-        if (!check_exist(family_to_include, famA_tmp.at(i)) || !check_exist(family_to_include, famB_tmp.at(i))) {
-            elem_to_remove[i] = true;
+        if (check_exist(family_to_include, dT->familyID.at(idA_tmp[i])) &&
+            check_exist(family_to_include, dT->familyID.at(idB_tmp[i]))) {
+            out_pair.push_back(std::pair<bodyID_t, bodyID_t>(idA_tmp[i], idB_tmp[i]));
         }
     }
-    idA_tmp = hostRemoveElem(idA_tmp, elem_to_remove);
-    idB_tmp = hostRemoveElem(idB_tmp, elem_to_remove);
-    famA_tmp = hostRemoveElem(famA_tmp, elem_to_remove);
-    famB_tmp = hostRemoveElem(famB_tmp, elem_to_remove);
-    cnt_type_tmp = hostRemoveElem(cnt_type_tmp, elem_to_remove);
-
-    auto idx = hostSortIndices(idA_tmp);
-    std::vector<std::pair<bodyID_t, bodyID_t>> out_pair(idx.size());
-    for (size_t i = 0; i < idx.size(); i++) {
-        out_pair[i] = std::pair<bodyID_t, bodyID_t>(idA_tmp[idx[i]], idB_tmp[idx[i]]);
-    }
     return out_pair;
 }
 
 std::vector<std::pair<bodyID_t, bodyID_t>> DEMSolver::GetClumpContacts(
     std::vector<std::pair<family_t, family_t>>& family_pair) const {
     std::vector<bodyID_t> idA_tmp, idB_tmp;
-    std::vector<family_t> famA_tmp, famB_tmp;
-    std::vector<contact_t> cnt_type_tmp;
-    // Getting sphere contacts is enough
-    getContacts_impl(idA_tmp, idB_tmp, cnt_type_tmp, famA_tmp, famB_tmp,
-                     [](contact_t type) { return type == SPHERE_SPHERE_CONTACT; });
-    auto idx = hostSortIndices(idA_tmp);
-    std::vector<std::pair<bodyID_t, bodyID_t>> out_pair(idx.size());
-    family_pair.resize(idx.size());
-    for (size_t i = 0; i < idx.size(); i++) {
-        out_pair[i] = std::pair<bodyID_t, bodyID_t>(idA_tmp[idx[i]], idB_tmp[idx[i]]);
-        family_pair[i] = std::pair<family_t, family_t>(famA_tmp[idx[i]], famB_tmp[idx[i]]);
+    dT->getClumpContactPairs(idA_tmp, idB_tmp);
+    std::vector<std::pair<bodyID_t, bodyID_t>> out_pair(idA_tmp.size());
+    family_pair.resize(idA_tmp.size());
+    for (size_t i = 0; i < idA_tmp.size(); i++) {
+        out_pair[i] = std::pair<bodyID_t, bodyID_t>(idA_tmp[i], idB_tmp[i]);
+        family_pair[i] = std::pair<family_t, family_t>(dT->familyID.at(idA_tmp[i]), dT->familyID.at(idB_tmp[i]));
     }
     return out_pair;
 }
@@ -388,6 +375,176 @@ unsigned int DEMSolver::GetOwnerFamily(bodyID_t ownerID) const {
     return (unsigned int)(+(dT->familyID.at(ownerID)));
 }
 
+std::vector<bodyID_t> DEMSolver::GetFamilyOwnerIDs(unsigned int N) const {
+    std::vector<bodyID_t> IDs;
+    for (size_t i = 0; i < nOwnerBodies; i++) {
+        if (dT->familyID[i] == N) {
+            IDs.push_back(i);
+        }
+    }
+    return IDs;
+}
+
+void DEMSolver::GetOwnerPositions(const std::vector<bodyID_t>& IDs, float3* pos) const {
+    assertOwnerIDs(IDs, "GetOwnerPositions");
+    dT->getOwnersPos(IDs.data(), 0, IDs.size(), pos);
+}
+std::vector<float3> DEMSolver::GetOwnerPositions(const std::vector<bodyID_t>& IDs) const {
+    std::vector<float3> res(IDs.size());
+    GetOwnerPositions(IDs, res.data());
+    return res;
+}
+void DEMSolver::GetAllOwnerPositions(float3* pos) const {
+    assertOwnerIDs({}, "GetAllOwnerPositions");
+    dT->getOwnersPos(NULL, 0, nOwnerBodies, pos);
+}
+std::vector<float3> DEMSolver::GetAllOwnerPositions() const {
+    std::vector<float3> res(nOwnerBodies);
+    GetAllOwnerPositions(res.data());
+    return res;
+}
+void DEMSolver::SetOwnerPositions(const std::vector<bodyID_t>& IDs, const float3* pos) {
+    assertOwnerIDs(IDs, "SetOwnerPositions");
+    dT->setOwnersPos(IDs.data(), 0, IDs.size(), pos);
+}
+void DEMSolver::SetOwnerPositions(const std::vector<bodyID_t>& IDs, const std::vector<float3>& pos) {
+    if (pos.size() != IDs.size()) {
+        DEME_ERROR("SetOwnerPositions is given %zu owner IDs but %zu values.", IDs.size(), pos.size());
+    }
+    SetOwnerPositions(IDs, pos.data());
+}
+void DEMSolver::SetAllOwnerPositions(const float3* pos) {
+    assertOwnerIDs({}, "SetAllOwnerPositions");
+    dT->setOwnersPos(NULL, 0, nOwnerBodies, pos);
+}
+void DEMSolver::SetAllOwnerPositions(const std::vector<float3>& pos) {
+    if (pos.size() != nOwnerBodies) {
+        DEME_ERROR("SetAllOwnerPositions is given %zu values, but there are %zu owners in the simulation system.",
+                   pos.size(), nOwnerBodies);
+    }
+    SetAllOwnerPositions(pos.data());
+}
+
+void DEMSolver::GetOwnerVelocities(const std::vector<bodyID_t>& IDs, float3* vel) const {
+    assertOwnerIDs(IDs, "GetOwnerVelocities");
+    dT->getOwnersVel(IDs.data(), 0, IDs.size(), vel);
+}
+std::vector<float3> DEMSolver::GetOwnerVelocities(const std::vector<bodyID_t>& IDs) const {
+    std::vector<float3> res(IDs.size());
+    GetOwnerVelocities(IDs, res.data());
+    return res;
+}
+void DEMSolver::GetAllOwnerVelocities(float3* vel) const {
+    assertOwnerIDs({}, "GetAllOwnerVelocities");
+    dT->getOwnersVel(NULL, 0, nOwnerBodies, vel);
+}
+std::vector<float3> DEMSolver::GetAllOwnerVelocities() const {
+    std::vector<float3> res(nOwnerBodies);
+    GetAllOwnerVelocities(res.data());
+    return res;
+}
+void DEMSolver::SetOwnerVelocities(const std::vector<bodyID_t>& IDs, const float3* vel) {
+    assertOwnerIDs(IDs, "SetOwnerVelocities");
+    dT->setOwnersVel(IDs.data(), 0, IDs.size(), vel);
+}
+void DEMSolver::SetOwnerVelocities(const std::vector<bodyID_t>& IDs, const std::vector<float3>& vel) {
+    if (vel.size() != IDs.size()) {
+        DEME_ERROR("SetOwnerVelocities is given %zu owner IDs but %zu values.", IDs.size(), vel.size());
+    }
+    SetOwnerVelocities(IDs, vel.data());
+}
+void DEMSolver::SetAllOwnerVelocities(const float3* vel) {
+    assertOwnerIDs({}, "SetAllOwnerVelocities");
+    dT->setOwnersVel(NULL, 0, nOwnerBodies, vel);
+}
+void DEMSolver::SetAllOwnerVelocities(const std::vector<float3>& vel) {
+    if (vel.size() != nOwnerBodies) {
+        DEME_ERROR("SetAllOwnerVelocities is given %zu values, but there are %zu owners in the simulation system.",
+                   vel.size(), nOwnerBodies);
+    }
+    SetAllOwnerVelocities(vel.data());
+}
+
+void DEMSolver::GetOwnerAngVels(const std::vector<bodyID_t>& IDs, float3* angVel) const {
+    assertOwnerIDs(IDs, "GetOwnerAngVels");
+    dT->getOwnersAngVel(IDs.data(), 0, IDs.size(), angVel);
+}
+std::vector<float3> DEMSolver::GetOwnerAngVels(const std::vector<bodyID_t>& IDs) const {
+    std::vector<float3> res(IDs.size());
+    GetOwnerAngVels(IDs, res.data());
+    return res;
+}
+void DEMSolver::GetAllOwnerAngVels(float3* angVel) const {
+    assertOwnerIDs({}, "GetAllOwnerAngVels");
+    dT->getOwnersAngVel(NULL, 0, nOwnerBodies, angVel);
+}
+std::vector<float3> DEMSolver::GetAllOwnerAngVels() const {
+    std::vector<float3> res(nOwnerBodies);
+    GetAllOwnerAngVels(res.data());
+    return res;
+}
+void DEMSolver::SetOwnerAngVels(const std::vector<bodyID_t>& IDs, const float3* angVel) {
+    assertOwnerIDs(IDs, "SetOwnerAngVels");
+    dT->setOwnersAngVel(IDs.data(), 0, IDs.size(), angVel);
+}
+void DEMSolver::SetOwnerAngVels(const std::vector<bodyID_t>& IDs, const std::vector<float3>& angVel) {
+    if (angVel.size() != IDs.size()) {
+        DEME_ERROR("SetOwnerAngVels is given %zu owner IDs but %zu values.", IDs.size(), angVel.size());
+    }
+    SetOwnerAngVels(IDs, angVel.data());
+}
+void DEMSolver::SetAllOwnerAngVels(const float3* angVel) {
+    assertOwnerIDs({}, "SetAllOwnerAngVels");
+    dT->setOwnersAngVel(NULL, 0, nOwnerBodies, angVel);
+}
+void DEMSolver::SetAllOwnerAngVels(const std::vector<float3>& angVel) {
+    if (angVel.size() != nOwnerBodies) {
+        DEME_ERROR("SetAllOwnerAngVels is given %zu values, but there are %zu owners in the simulation system.",
+                   angVel.size(), nOwnerBodies);
+    }
+    SetAllOwnerAngVels(angVel.data());
+}
+
+void DEMSolver::GetOwnerOriQs(const std::vector<bodyID_t>& IDs, float4* oriQ) const {
+    assertOwnerIDs(IDs, "GetOwnerOriQs");
+    dT->getOwnersOriQ(IDs.data(), 0, IDs.size(), oriQ);
+}
+std::vector<float4> DEMSolver::GetOwnerOriQs(const std::vector<bodyID_t>& IDs) const {
+    std::vector<float4> res(IDs.size());
+    GetOwnerOriQs(IDs, res.data());
+    return res;
+}
+void DEMSolver::GetAllOwnerOriQs(float4* oriQ) const {
+    assertOwnerIDs({}, "GetAllOwnerOriQs");
+    dT->getOwnersOriQ(NULL, 0, nOwnerBodies, oriQ);
+}
+std::vector<float4> DEMSolver::GetAllOwnerOriQs() const {
+    std::vector<float4> res(nOwnerBodies);
+    GetAllOwnerOriQs(res.data());
+    return res;
+}
+void DEMSolver::SetOwnerOriQs(const std::vector<bodyID_t>& IDs, const float4* oriQ) {
+    assertOwnerIDs(IDs, "SetOwnerOriQs");
+    dT->setOwnersOriQ(IDs.data(), 0, IDs.size(), oriQ);
+}
+void DEMSolver::SetOwnerOriQs(const std::vector<bodyID_t>& IDs, const std::vector<float4>& oriQ) {
+    if (oriQ.size() != IDs.size()) {
+        DEME_ERROR("SetOwnerOriQs is given %zu owner IDs but %zu values.", IDs.size(), oriQ.size());
+    }
+    SetOwnerOriQs(IDs, oriQ.data());
+}
+void DEMSolver::SetAllOwnerOriQs(const float4* oriQ) {
+    assertOwnerIDs({}, "SetAllOwnerOriQs");
+    dT->setOwnersOriQ(NULL, 0, nOwnerBodies, oriQ);
+}
+void DEMSolver::SetAllOwnerOriQs(const std::vector<float4>& oriQ) {
+    if (oriQ.size() != nOwnerBodies) {
+        DEME_ERROR("SetAllOwnerOriQs is given %zu values, but there are %zu owners in the simulation system.",
+                   oriQ.size(), nOwnerBodies);
+    }
+    SetAllOwnerOriQs(oriQ.data());
+}
+
 void DEMSolver::AddOwnerNextStepAcc(bodyID_t ownerID, float3 acc) {
     dT->accSpecified[ownerID] = 1;
     dT->aX[ownerID] = acc.x;
@@ -535,8 +692,7 @@ void DEMSolver::SetIntegrator(const std::string& intg) {
 }
 
 void DEMSolver::SetAdaptiveTimeStepType(const std::string& type) {
-    DEME_WARNING(
-        "SetAdaptiveTimeStepType is currently not implemented and has no effect, time step size is still fixed.");
+    assertSysNotInit("SetAdaptiveTimeStepType");
     switch (hash_charr(type.c_str())) {
         case ("none"_):
             adapt_ts_type = ADAPT_TS_TYPE::NONE;
@@ -551,6 +707,15 @@ void DEMSolver::SetAdaptiveTimeStepType(const std::string& type) {
             DEME_ERROR("Adaptive time step type %s is unknown. Please select another via SetAdaptiveTimeStepType.",
                        type.c_str());
     }
+    ts_size_is_const = (adapt_ts_type == ADAPT_TS_TYPE::NONE);
+}
+
+void DEMSolver::SetAdaptiveTimeStepBounds(double min_ts, double max_ts) {
+    if (min_ts <= 0. || max_ts < min_ts) {
+        DEME_ERROR("SetAdaptiveTimeStepBounds needs 0 < min_ts <= max_ts, but got %.6g and %.6g.", min_ts, max_ts);
+    }
+    adapt_ts_min = min_ts;
+    adapt_ts_max = max_ts;
 }
 
 void DEMSolver::SetCDNumStepsMaxDriftHistorySize(unsigned int n) {
@@ -567,6 +732,22 @@ void DEMSolver::SetMaxVelocity(float max_vel) {
     m_approx_max_vel = max_vel;
 }
 
+void DEMSolver::EnableSleeping(float vel_thres, float acc_thres, unsigned int n_steps) {
+    assertSysNotInit("EnableSleeping");
+    if (vel_thres <= 0. || acc_thres <= 0.) {
+        DEME_ERROR("EnableSleeping needs positive velocity and acceleration thresholds, but got %.6g and %.6g.",
+                   vel_thres, acc_thres);
+    }
+    if (n_steps == 0) {
+        DEME_WARNING("EnableSleeping is called with 0 quiet steps, it is treated as 1.");
+        n_steps = 1;
+    }
+    use_sleeping = true;
+    sleep_vel_thres = vel_thres;
+    sleep_acc_thres = acc_thres;
+    sleep_n_steps = n_steps;
+}
+
 void DEMSolver::SetExpandSafetyType(const std::string& insp_type) {
     if (insp_type == "auto") {
         m_max_v_finder_type = MARGIN_FINDER_TYPE::DEFAULT;
@@ -576,7 +757,11 @@ void DEMSolver::SetExpandSafetyType(const std::string& insp_type) {
     }
 }
 
-void DEMSolver::InstructBoxDomainDimension(float x, float y, float z, const std::string& dir_exact) {
+void DEMSolver::InstructBoxDomainDimension(float x,
+                                           float y,
+                                           float z,
+                                           const std::string& dir_exact,
+                                           const std::string& periodic_dirs) {
     m_user_box_min = host_make_float3(-x / 2., -y / 2., -z / 2.);
     m_user_box_max = host_make_float3(x / 2., y / 2., z / 2.);
 
@@ -603,12 +788,14 @@ void DEMSolver::InstructBoxDomainDimension(float x, float y, float z, const std:
     } else {
         DEME_ERROR("Unknown '%s' parameter in InstructBoxDomainDimension call.", dir_exact.c_str());
     }
+    setPeriodicDirs(periodic_dirs);
 }
 
 void DEMSolver::InstructBoxDomainDimension(const std::pair<float, float>& x,
                                            const std::pair<float, float>& y,
                                            const std::pair<float, float>& z,
-                                           const std::string& dir_exact) {
+                                           const std::string& dir_exact,
+                                           const std::string& periodic_dirs) {
     m_user_box_min =
         host_make_float3(DEME_MIN(x.first, x.second), DEME_MIN(y.first, y.second), DEME_MIN(z.first, z.second));
     m_user_box_max =
@@ -637,6 +824,7 @@ void DEMSolver::InstructBoxDomainDimension(const std::pair<float, float>& x,
     } else {
         DEME_ERROR("Unknown '%s' parameter in InstructBoxDomainDimension call.", dir_exact.c_str());
     }
+    setPeriodicDirs(periodic_dirs);
 }
 
 std::shared_ptr<DEMForceModel> DEMSolver::DefineContactForceModel(const std::string& model) {
@@ -1773,6 +1961,32 @@ std::shared_ptr<DEMInspector> DEMSolver::CreateInspector(const std::string& quan
     return m_inspectors.back();
 }
 
+void DEMSolver::submitOutput(const std::string& outfilename,
+                             bool binary,
+                             std::function<void(std::ofstream&)> write_func) const {
+    auto write_file = [outfilename, binary, write_func]() {
+        std::ofstream ptFile(outfilename, binary ? (std::ios::out | std::ios::binary) : std::ios::out);
+        write_func(ptFile);
+    };
+    if (!m_use_async_output) {
+        write_file();
+        return;
+    }
+    if (!m_async_writer) {
+        m_async_writer = std::make_unique<AsyncWriter>(m_async_output_max_pending);
+    }
+    m_async_writer->Submit(write_file);
+}
+
+void DEMSolver::FlushOutput() const {
+    if (m_async_writer) {
+        m_async_writer->Flush();
+    }
+    if (dT->stepMetricsSink) {
+        dT->stepMetricsSink->Flush();
+    }
+}
+
 void DEMSolver::WriteSphereFile(const std::string& outfilename) const {
     switch (m_out_format) {
 #ifdef DEME_USE_CHPF
@@ -1783,16 +1997,16 @@ void DEMSolver::WriteSphereFile(const std::string& outfilename) const {
         }
 #endif
         case (OUTPUT_FORMAT::CSV): {
-            std::ofstream ptFile(outfilename, std::ios::out);
-            dT->writeSpheresAsCsv(ptFile);
+            // Snapshot now; formatting and writing may happen in the background
+            auto frame = std::make_shared<OutputFrame>(dT->collectSpheresFrame());
+            submitOutput(outfilename, false, [frame](std::ofstream& ptFile) { frame->WriteCsv(ptFile); });
             break;
         }
         case (OUTPUT_FORMAT::BINARY): {
-            // std::ofstream ptFile(outfilename, std::ios::out | std::ios::binary);
-            //// TODO: Implement it
-            std::ofstream ptFile(outfilename, std::ios::out);
-            DEME_WARNING("Binary sphere output is not implemented yet, using CSV...");
-            dT->writeSpheresAsCsv(ptFile);
+            auto frame = std::make_shared<OutputFrame>(dT->collectSpheresFrame());
+            bool compress = m_compress_binary_output;
+            submitOutput(outfilename, true,
+                         [frame, compress](std::ofstream& ptFile) { frame->WriteBinary(ptFile, compress); });
             break;
         }
         default:
@@ -1810,16 +2024,16 @@ void DEMSolver::WriteClumpFile(const std::string& outfilename, unsigned int accu
         }
 #endif
         case (OUTPUT_FORMAT::CSV): {
-            std::ofstream ptFile(outfilename, std::ios::out);
-            dT->writeClumpsAsCsv(ptFile, accuracy);
+            auto frame = std::make_shared<OutputFrame>(dT->collectClumpsFrame());
+            submitOutput(outfilename, false,
+                         [frame, accuracy](std::ofstream& ptFile) { frame->WriteCsv(ptFile, accuracy); });
             break;
         }
         case (OUTPUT_FORMAT::BINARY): {
-            // std::ofstream ptFile(outfilename, std::ios::out | std::ios::binary);
-            //// TODO: Implement it
-            std::ofstream ptFile(outfilename, std::ios::out);
-            DEME_WARNING("Binary clump output is not implemented yet, using CSV...");
-            dT->writeClumpsAsCsv(ptFile, accuracy);
+            auto frame = std::make_shared<OutputFrame>(dT->collectClumpsFrame());
+            bool compress = m_compress_binary_output;
+            submitOutput(outfilename, true,
+                         [frame, compress](std::ofstream& ptFile) { frame->WriteBinary(ptFile, compress); });
             break;
         }
         default:
@@ -1836,16 +2050,15 @@ void DEMSolver::WriteContactFile(const std::string& outfilename, float force_thr
     }
     switch (m_cnt_out_format) {
         case (OUTPUT_FORMAT::CSV): {
-            std::ofstream ptFile(outfilename, std::ios::out);
-            dT->writeContactsAsCsv(ptFile, force_thres);
+            auto frame = std::make_shared<OutputFrame>(dT->collectContactsFrame(force_thres));
+            submitOutput(outfilename, false, [frame](std::ofstream& ptFile) { frame->WriteCsv(ptFile); });
             break;
         }
         case (OUTPUT_FORMAT::BINARY): {
-            // std::ofstream ptFile(outfilename, std::ios::out | std::ios::binary);
-            //// TODO: Implement it
-            DEME_WARNING("Binary contact pair output is not implemented yet, using CSV...");
-            std::ofstream ptFile(outfilename, std::ios::out);
-            dT->writeContactsAsCsv(ptFile, force_thres);
+            auto frame = std::make_shared<OutputFrame>(dT->collectContactsFrame(force_thres));
+            bool compress = m_compress_binary_output;
+            submitOutput(outfilename, true,
+                         [frame, compress](std::ofstream& ptFile) { frame->WriteBinary(ptFile, compress); });
             break;
         }
         default:
@@ -1857,8 +2070,10 @@ void DEMSolver::WriteContactFile(const std::string& outfilename, float force_thr
 void DEMSolver::WriteMeshFile(const std::string& outfilename) const {
     switch (m_mesh_out_format) {
         case (MESH_FORMAT::VTK): {
-            std::ofstream ptFile(outfilename, std::ios::out);
-            dT->writeMeshesAsVtk(ptFile);
+            auto frame = std::make_shared<MeshOutputFrame>(dT->collectMeshesFrame());
+            submitOutput(outfilename, false, [frame](std::ofstream& ptFile) {
+                DEMDynamicThread::writeMeshFrameAsVtk(ptFile, *frame);
+            });
             break;
         }
         default:
@@ -1935,6 +2150,7 @@ void DEMSolver::Initialize() {
     packDataPointers();
 
     // Compile some of the kernels
+    JitHelper::DiskCacheStats jit_stats_before = JitHelper::GetDiskCacheStats();
     jitifyKernels();
 
     // Notify the user how jitification goes
@@ -1958,6 +2174,16 @@ void DEMSolver::Initialize() {
     // contact pairs), and if the user needs to modify the contact wildcards before simulation starts, this step is
     // meaningful. Dry-run is automatically done if advancing the simulation by 0 or a negative amount of time.
     DoDynamicsThenSync(-1.0);
+
+    // Most kernels are instantiated (and loaded from the disk cache if possible) in the dry-run, so report after it
+    if (JitHelper::IsDiskCacheEnabled()) {
+        JitHelper::DiskCacheStats jit_stats = JitHelper::GetDiskCacheStats();
+        DEME_INFO("Kernel disk cache (%s): %llu hits, %llu misses, saving %.2f seconds of compilation.",
+                  JitHelper::GetDiskCacheDir().string().c_str(),
+                  (unsigned long long)(jit_stats.nHits - jit_stats_before.nHits),
+                  (unsigned long long)(jit_stats.nMisses - jit_stats_before.nMisses),
+                  jit_stats.secondsSaved - jit_stats_before.secondsSaved);
+    }
 }
 
 void DEMSolver::ShowTimingStats() {
@@ -1984,12 +2210,100 @@ void DEMSolver::ShowTimingStats() {
         DEME_PRINTF("%s: %.9g seconds, %.6g%% of dT total runtime\n", dT_timer_names.at(i).c_str(), dT_timer_vals.at(i),
                     dT_timer_vals.at(i) / dT_total_time * 100.);
     }
+    if (use_sleeping) {
+        double sleep_frac;
+        size_t n_sleep_samples;
+        dT->getSleepStats(sleep_frac, n_sleep_samples);
+        DEME_PRINTF("\n~~ SLEEPING STATISTICS ~~\n");
+        DEME_PRINTF("Average fraction of sleeping owners: %.6g%% (sampled at %zu kT updates)\n", sleep_frac * 100.,
+                    n_sleep_samples);
+    }
+    if (m_num_reorders > 0) {
+        DEME_PRINTF("\n~~ ENTITY REORDERING STATISTICS ~~\n");
+        DEME_PRINTF("Number of reorderings: %zu, total time: %.9g seconds\n", m_num_reorders, m_reorder_seconds);
+    }
+    if (m_async_writer) {
+        DEME_PRINTF("\n~~ ASYNC OUTPUT STATISTICS ~~\n");
+        DEME_PRINTF("Time spent waiting for the output queue: %.9g seconds\n", m_async_writer->GetSecondsBlocked());
+    }
+    // Allocation cost is not part of any worker timer above, so report it separately
+    const AllocatorStats& alloc_stats = GetAllocatorStats();
+    DEME_PRINTF("\n~~ WORKER ARRAY ALLOCATION STATISTICS (%s) ~~\n", DEMEMemPolicy::Name());
+    DEME_PRINTF("Number of allocations: %zu, number of deallocations: %zu\n",
+                (size_t)(alloc_stats.nAllocations).load(), (size_t)(alloc_stats.nDeallocations).load());
+    DEME_PRINTF("Total bytes allocated: %s\n", pretty_format_bytes((alloc_stats.bytesAllocated).load()).c_str());
+    DEME_PRINTF("Time spent in (de)allocation: %.9g seconds\n", (double)(alloc_stats.nanosecondsSpent).load() / 1e9);
+    DEME_PRINTF("Contact array reallocations: %zu (kT), %zu (dT)\n", kT->getNumCntArrReallocs(),
+                dT->getNumCntArrReallocs());
+    DEME_PRINTF("Approximate memory held by worker arrays: %s\n", pretty_format_bytes(GetDeviceMemUsage()).c_str());
+    // Peak temp array usage of each phase, which is what the scratch arenas have to hold
+    DEME_PRINTF("\n~~ SCRATCH MEMORY STATISTICS ~~\n");
+    DEME_PRINTF("Scratch arena capacity: %s (kT), %s (dT)\n",
+                pretty_format_bytes(kT->stateOfSolver_resources.getTempCapacity()).c_str(),
+                pretty_format_bytes(dT->stateOfSolver_resources.getTempCapacity()).c_str());
+    for (const auto& phase : kT->stateOfSolver_resources.getTempPhaseStats()) {
+        DEME_PRINTF("kT %s: peak %s, over %zu runs\n", phase.first.c_str(),
+                    pretty_format_bytes(phase.second.peakBytes).c_str(), phase.second.nScopes);
+    }
+    for (const auto& phase : dT->stateOfSolver_resources.getTempPhaseStats()) {
+        DEME_PRINTF("dT %s: peak %s, over %zu runs\n", phase.first.c_str(),
+                    pretty_format_bytes(phase.second.peakBytes).c_str(), phase.second.nScopes);
+    }
     DEME_PRINTF("--------------------------\n");
 }
 
+void DEMSolver::GetTimingStats(std::vector<std::string>& kT_names,
+                               std::vector<double>& kT_vals,
+                               std::vector<std::string>& dT_names,
+                               std::vector<double>& dT_vals) {
+    kT_vals.clear();
+    dT_vals.clear();
+    kT->getTiming(kT_names, kT_vals);
+    dT->getTiming(dT_names, dT_vals);
+}
+
 void DEMSolver::ClearTimingStats() {
     kT->resetTimers();
     dT->resetTimers();
+    GetAllocatorStats().Clear();
+    kT->stateOfSolver_resources.clearTempPhaseStats();
+    dT->stateOfSolver_resources.clearTempPhaseStats();
+    m_num_reorders = 0;
+    m_reorder_seconds = 0.;
+}
+
+void DEMSolver::UseTimelineTrace(bool use, size_t events_per_thread) {
+    if (use) {
+        m_trace = std::make_unique<TraceRecorder>(events_per_thread);
+        m_main_trace_lane = m_trace->AddLane("main");
+        kT->timers.AttachTraceLane(m_trace->AddLane("kT"));
+        dT->timers.AttachTraceLane(m_trace->AddLane("dT"));
+    } else {
+        kT->timers.AttachTraceLane(nullptr);
+        dT->timers.AttachTraceLane(nullptr);
+        m_main_trace_lane = nullptr;
+        m_trace.reset();
+    }
+}
+
+void DEMSolver::UseScratchArenaDebug(bool use) {
+    kT->stateOfSolver_resources.setTempDebug(use);
+    dT->stateOfSolver_resources.setTempDebug(use);
+}
+
+void DEMSolver::WriteTimelineTrace(const std::string& filename) const {
+    if (!m_trace) {
+        DEME_WARNING("WriteTimelineTrace is called but no timeline is recorded. Call UseTimelineTrace first.");
+        return;
+    }
+    std::ofstream traceFile(filename, std::ios::out);
+    m_trace->WriteChromeTrace(traceFile);
+    if (m_trace->GetNumDropped() > 0) {
+        DEME_WARNING(
+            "%zu of the oldest timeline events were overwritten before being written to %s. Use a larger "
+            "events_per_thread in UseTimelineTrace to keep them.",
+            m_trace->GetNumDropped(), filename.c_str());
+    }
 }
 
 void DEMSolver::ReleaseFlattenedArrays() {
@@ -2004,6 +2318,7 @@ void DEMSolver::ReleaseFlattenedArrays() {
     deallocate_array(m_input_mesh_obj_xyz);
     deallocate_array(m_input_mesh_obj_rot);
     deallocate_array(m_input_mesh_obj_family);
+    deallocate_array(m_input_mesh_obj_use_bvh);
 
     deallocate_array(m_unique_family_prescription);
     deallocate_array(m_input_clump_family);
@@ -2039,6 +2354,7 @@ void DEMSolver::ReleaseFlattenedArrays() {
 }
 
 void DEMSolver::resetWorkerThreads() {
+    auto sync_start = std::chrono::high_resolution_clock::now();
     // The user won't be calling this when dT is working, so our only problem is that kT may be spinning in the inner
     // loop. So let's release kT.
     {
@@ -2050,6 +2366,9 @@ void DEMSolver::resetWorkerThreads() {
         // Reset to make ready for next user call, don't forget it
         kTMain_InteractionManager->userCallDone = false;
     }
+    if (m_main_trace_lane) {
+        m_main_trace_lane->RecordSpan("Sync with kT", sync_start, std::chrono::high_resolution_clock::now());
+    }
 
     // Finally, reset the thread stats and wait for potential new user calls
     kT->resetUserCallStat();
@@ -2059,6 +2378,10 @@ void DEMSolver::resetWorkerThreads() {
 /// When simulation parameters are updated by the user, they can call this method to transfer them to the GPU-side in
 /// mid-simulation. This is a relatively deep reset. If you just need to update step size, don't use this.
 void DEMSolver::UpdateSimParams() {
+    // With adaptive step size, continue from the current step size rather than the initial one
+    if (!ts_size_is_const) {
+        m_ts_size = dT->getStepSize();
+    }
     // Bin size will be re-calculated (in case you wish to switch to manual).
     decideBinSize();
     decideCDMarginStrat();
@@ -2069,6 +2392,10 @@ void DEMSolver::UpdateSimParams() {
     // Jitify max vel finder, in case the policy there changed
     m_approx_max_vel_func->Initialize(m_subs, true);
     dT->approxMaxVelFunc = m_approx_max_vel_func;
+    if (m_approx_max_acc_func) {
+        m_approx_max_acc_func->Initialize(m_subs, true);
+        dT->approxMaxAccFunc = m_approx_max_acc_func;
+    }
 
     // Updating sim environment is critical
     dT->announceCritical();
@@ -2077,7 +2404,7 @@ void DEMSolver::UpdateSimParams() {
 void DEMSolver::UpdateStepSize(double ts) {
     m_ts_size = ts;
     kT->simParams->h = ts;
-    dT->simParams->h = ts;
+    dT->setStepSize(ts);
 }
 
 void DEMSolver::UpdateClumps() {
@@ -2167,8 +2494,213 @@ void DEMSolver::ChangeClumpSizes(const std::vector<bodyID_t>& IDs, const std::ve
 /// Removes all entities associated with a family from the arrays (to save memory space). This method should only be
 /// called periodically because it gives a large overhead. This is only used in long simulations where if the
 /// `phased-out' entities do not get cleared, we won't have enough memory space.
-/// TODO: Implement it.
-void DEMSolver::PurgeFamily(unsigned int family_num) {}
+void DEMSolver::PurgeFamily(unsigned int family_num) {
+    assertSysInit("PurgeFamily");
+    if (family_num > std::numeric_limits<family_t>::max()) {
+        DEME_ERROR("You instructed to purge family %u, but family number should not be larger than %u.", family_num,
+                   std::numeric_limits<family_t>::max());
+    }
+    const family_t family_impl = family_num;
+
+    // Figure out which owners go away. Analytical objects are jitified into the kernels, so they stay.
+    EntityPurgeMap purge;
+    purge.ownerMap.resize(nOwnerBodies);
+    unsigned int nAnalKept = 0;
+    for (size_t i = 0; i < nOwnerBodies; i++) {
+        const ownerType_t this_type = dT->ownerTypes.at(i);
+        if (dT->familyID.at(i) == family_impl && this_type != OWNER_T_ANALYTICAL) {
+            purge.ownerMap[i] = NULL_BODYID;
+            continue;
+        }
+        if (dT->familyID.at(i) == family_impl) {
+            nAnalKept++;
+        }
+        purge.ownerMap[i] = purge.nOwnerBodies++;
+        if (this_type == OWNER_T_CLUMP) {
+            purge.nOwnerClumps++;
+        } else if (this_type == OWNER_T_MESH) {
+            purge.nTriMeshes++;
+        }
+    }
+    if (nAnalKept > 0) {
+        DEME_WARNING(
+            "Family %u has %u analytical object(s) in it. Analytical objects are jitified into the kernels, so they "
+            "cannot be purged and will stay in the simulation.\nIf they should no longer have an effect, consider "
+            "disabling their contacts via DisableContactBetweenFamilies.",
+            family_num, nAnalKept);
+    }
+    if (purge.nOwnerBodies == nOwnerBodies) {
+        DEME_INFO("No entity is in family %u, so PurgeFamily did nothing.", family_num);
+        return;
+    }
+    purge.sphereMap.resize(nSpheresGM);
+    for (size_t i = 0; i < nSpheresGM; i++) {
+        purge.sphereMap[i] =
+            (purge.ownerMap.at(dT->ownerClumpBody.at(i)) == NULL_BODYID) ? NULL_BODYID : purge.nSpheresGM++;
+    }
+    purge.triMap.resize(nTriGM);
+    for (size_t i = 0; i < nTriGM; i++) {
+        purge.triMap[i] = (purge.ownerMap.at(dT->ownerMesh.at(i)) == NULL_BODYID) ? NULL_BODYID : purge.nTriGM++;
+    }
+
+    // If an owner before an analytical object is gone, then this analytical object has a new owner ID, and that ID is
+    // jitified
+    bool anal_owner_changed = false;
+    for (const auto& owner : dT->ownerAnalBody) {
+        if (purge.ownerMap.at(owner) != owner) {
+            anal_owner_changed = true;
+            break;
+        }
+    }
+
+    std::thread dThread = std::move(std::thread([this, &purge]() { this->dT->purgeEntities(purge); }));
+    std::thread kThread = std::move(std::thread([this, &purge]() { this->kT->purgeEntities(purge); }));
+    dThread.join();
+    kThread.join();
+
+    DEME_INFO("PurgeFamily removed %zu owners, %zu spheres and %zu triangles in family %u.",
+              nOwnerBodies - purge.nOwnerBodies, nSpheresGM - purge.nSpheresGM, nTriGM - purge.nTriGM, family_num);
+    nOwnerBodies = purge.nOwnerBodies;
+    nOwnerClumps = purge.nOwnerClumps;
+    nTriMeshes = purge.nTriMeshes;
+    nSpheresGM = purge.nSpheresGM;
+    nTriGM = purge.nTriGM;
+
+    // Trackers that still have all their owners just shift; those that lost any owner can no longer be used
+    unsigned int nBrokenTrackers = 0;
+    for (auto& tracked_obj : m_tracked_objs) {
+        // Not loaded into the system yet
+        if (tracked_obj->ownerID == NULL_BODYID || tracked_obj->isBroken) {
+            continue;
+        }
+        bool all_kept = true;
+        for (size_t i = 0; i < tracked_obj->nSpanOwners; i++) {
+            if (purge.ownerMap.at(tracked_obj->OwnerAt(i)) == NULL_BODYID) {
+                all_kept = false;
+                break;
+            }
+        }
+        if (!all_kept) {
+            tracked_obj->isBroken = true;
+            nBrokenTrackers++;
+            continue;
+        }
+        tracked_obj->ownerID = purge.ownerMap.at(tracked_obj->ownerID);
+        // Trackers of reordered clumps hold lists of IDs; a purge keeps the order of the survivors, so just map them
+        for (auto& ID : tracked_obj->ownerIDs) {
+            ID = purge.ownerMap.at(ID);
+        }
+        for (auto& ID : tracked_obj->geoIDs) {
+            ID = purge.sphereMap.at(ID);
+        }
+        if (tracked_obj->nGeos > 0) {
+            switch (tracked_obj->obj_type) {
+                case (OWNER_TYPE::CLUMP):
+                    tracked_obj->geoID = purge.sphereMap.at(tracked_obj->geoID);
+                    break;
+                case (OWNER_TYPE::MESH):
+                    tracked_obj->geoID = purge.triMap.at(tracked_obj->geoID);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    if (nBrokenTrackers > 0) {
+        DEME_WARNING("%u tracker(s) tracked entities removed by PurgeFamily, and they should no longer be used.",
+                     nBrokenTrackers);
+    }
+
+    // dT already dropped the purged meshes from its cache and renumbered the rest; the API's cache follows suit
+    m_meshes = dT->m_meshes;
+    m_owner_mesh_map.clear();
+
+    if (anal_owner_changed) {
+        // The rest of the analytical object info has been released after initialization, so the definitions are
+        // regenerated from the template that still has the owner array as a placeholder, then re-jitified
+        if (m_anal_defs_template.find("_objOwner_") == std::string::npos) {
+            DEME_ERROR(
+                "PurgeFamily needs to update the owner IDs of analytical objects, but the analytical entity "
+                "definitions do not have an owner array to update.");
+        }
+        std::string objOwner;
+        for (const auto& owner : dT->ownerAnalBody) {
+            objOwner += std::to_string(owner) + ",";
+        }
+        std::string analyticalEntityDefs = replace_patterns(m_anal_defs_template, {{"_objOwner_", objOwner}});
+        if (ensure_kernel_line_num) {
+            analyticalEntityDefs = compact_code(analyticalEntityDefs);
+        }
+        m_subs["_analyticalEntityDefs_"] = analyticalEntityDefs;
+        m_subs["_objOwner_"] = objOwner;
+        kT->jitifyKernels(m_subs);
+        dT->jitifyKernels(m_subs);
+        m_approx_max_vel_func->Initialize(m_subs, true);
+        dT->approxMaxVelFunc = m_approx_max_vel_func;
+        if (m_approx_max_acc_func) {
+            m_approx_max_acc_func->Initialize(m_subs, true);
+            dT->approxMaxAccFunc = m_approx_max_acc_func;
+        }
+    }
+
+    packDataPointers();
+    // Purging is very critical
+    dT->announceCritical();
+}
+
+/// Renumbers the clumps and their spheres along the Morton curve of their voxels, so that neighbors in space are also
+/// neighbors in memory. Like PurgeFamily, it should only be called periodically, from a synced stance.
+void DEMSolver::ReorderEntities() {
+    assertSysInit("ReorderEntities");
+    auto start = std::chrono::steady_clock::now();
+
+    EntityReorderMap reorder;
+    size_t nMoved = dT->calcReorderMap(reorder);
+    if (nMoved > 0) {
+        std::thread dThread = std::move(std::thread([this, &reorder]() { this->dT->reorderEntities(reorder); }));
+        std::thread kThread = std::move(std::thread([this, &reorder]() { this->kT->reorderEntities(reorder); }));
+        dThread.join();
+        kThread.join();
+
+        // Clump trackers now point to owners and spheres scattered in the arrays, so they switch to holding a list of
+        // IDs, unless these happen to be consecutive again
+        for (auto& tracked_obj : m_tracked_objs) {
+            if (tracked_obj->ownerID == NULL_BODYID || tracked_obj->isBroken ||
+                tracked_obj->obj_type != OWNER_TYPE::CLUMP) {
+                continue;
+            }
+            std::vector<bodyID_t> owner_IDs(tracked_obj->nSpanOwners), geo_IDs(tracked_obj->nGeos);
+            bool consecutive = true;
+            for (size_t i = 0; i < owner_IDs.size(); i++) {
+                owner_IDs[i] = reorder.ownerMap.at(tracked_obj->OwnerAt(i));
+                consecutive = consecutive && (owner_IDs[i] == owner_IDs[0] + i);
+            }
+            for (size_t i = 0; i < geo_IDs.size(); i++) {
+                geo_IDs[i] = reorder.sphereMap.at(tracked_obj->GeoAt(i));
+                consecutive = consecutive && (geo_IDs[i] == geo_IDs[0] + i);
+            }
+            tracked_obj->ownerID = owner_IDs.empty() ? tracked_obj->ownerID : owner_IDs[0];
+            tracked_obj->geoID = geo_IDs.empty() ? tracked_obj->geoID : geo_IDs[0];
+            tracked_obj->ownerIDs.clear();
+            tracked_obj->geoIDs.clear();
+            if (!consecutive) {
+                tracked_obj->ownerIDs = std::move(owner_IDs);
+                tracked_obj->geoIDs = std::move(geo_IDs);
+            }
+        }
+
+        packDataPointers();
+        // Reordering is as critical as purging
+        dT->announceCritical();
+    }
+
+    double seconds =
+        (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() *
+        1e-9;
+    m_num_reorders++;
+    m_reorder_seconds += seconds;
+    DEME_INFO("ReorderEntities moved %zu of %zu clumps in %.6g seconds.", nMoved, nOwnerClumps, seconds);
+}
 
 void DEMSolver::DoDynamics(double thisCallDuration) {
     // Is it needed here??
@@ -2177,6 +2709,7 @@ void DEMSolver::DoDynamics(double thisCallDuration) {
     // TODO: Return if nSphere == 0
     // TODO: Check if initialized
 
+    auto call_start = std::chrono::high_resolution_clock::now();
     // Tell dT how long this call is
     dT->setCycleDuration(thisCallDuration);
 
@@ -2193,6 +2726,29 @@ void DEMSolver::DoDynamics(double thisCallDuration) {
         // since that's only used when kT and dT sync.
         dTMain_InteractionManager->userCallDone = false;
     }
+    // dT is idle now, so hand its partial batch of step metrics to the writer
+    if (dT->stepMetricsSink) {
+        dT->stepMetricsSink->Submit();
+    }
+    if (m_main_trace_lane) {
+        m_main_trace_lane->RecordSpan("DoDynamics", call_start, std::chrono::high_resolution_clock::now());
+    }
+
+    // Reorder entities if it is time to. The kT update count can be reset by the user, and then we count anew.
+    m_synced_for_reorder = false;
+    if (m_reorder_freq > 0) {
+        size_t nKTUpdates = (dTkT_InteractionManager->schedulingStats.nKinematicUpdates).load();
+        if (nKTUpdates < m_reorder_last_kT_update) {
+            m_reorder_last_kT_update = nKTUpdates;
+        }
+        if (nKTUpdates - m_reorder_last_kT_update >= m_reorder_freq) {
+            // Reordering requires kT and dT are sync-ed
+            resetWorkerThreads();
+            m_synced_for_reorder = true;
+            ReorderEntities();
+            m_reorder_last_kT_update = (dTkT_InteractionManager->schedulingStats.nKinematicUpdates).load();
+        }
+    }
 }
 
 void DEMSolver::DoDynamicsThenSync(double thisCallDuration) {
@@ -2200,8 +2756,10 @@ void DEMSolver::DoDynamicsThenSync(double thisCallDuration) {
     DoDynamics(thisCallDuration);
 
     // dT is finished, but the user asks us to sync, so we have to make kT sync with dT. This can be done by calling
-    // resetWorkerThreads.
-    resetWorkerThreads();
+    // resetWorkerThreads, unless an entity reordering just did that.
+    if (!m_synced_for_reorder) {
+        resetWorkerThreads();
+    }
 }
 
 void DEMSolver::ShowThreadCollaborationStats() {
@@ -2225,11 +2783,17 @@ void DEMSolver::ShowThreadCollaborationStats() {
     //                 (dTkT_InteractionManager->schedulingStats.nKinematicReceives).load());
     DEME_PRINTF("Number of times dynamic held back: %zu\n",
                 (dTkT_InteractionManager->schedulingStats.nTimesDynamicHeldBack).load());
+    DEME_PRINTF("Bytes not copied thanks to buffer swapping: %s\n",
+                pretty_format_bytes((dTkT_InteractionManager->schedulingStats.nBytesSavedBySwap).load()).c_str());
     // DEME_PRINTF("Number of times kinematic held back: %zu\n",
     //             (dTkT_InteractionManager->schedulingStats.nTimesKinematicHeldBack).load());
     DEME_PRINTF("-----------------------------\n");
 }
 
+size_t DEMSolver::GetNumKinematicUpdates() const {
+    return (dTkT_InteractionManager->schedulingStats.nKinematicUpdates).load();
+}
+
 void DEMSolver::ShowAnomalies() {
     DEME_PRINTF("\n~~ Simulation anomaly report ~~\n");
     bool there_is_anomaly = goThroughWorkerAnomalies();
@@ -2249,10 +2813,11 @@ void DEMSolver::ClearThreadCollaborationStats() {
     dTkT_InteractionManager->schedulingStats.nTimesDynamicHeldBack = 0;
     dTkT_InteractionManager->schedulingStats.nTimesKinematicHeldBack = 0;
     dTkT_InteractionManager->schedulingStats.accumKinematicLagSteps = 0;
+    dTkT_InteractionManager->schedulingStats.nBytesSavedBySwap = 0;
     dT->nTotalSteps = 0;
 }
 
-float DEMSolver::dTInspectReduce(const std::shared_ptr<jitify::Program>& inspection_kernel,
+float DEMSolver::dTInspectReduce(const std::shared_ptr<JitProgram>& inspection_kernel,
                                  const std::string& kernel_name,
                                  INSPECT_ENTITY_TYPE thing_to_insp,
                                  CUB_REDUCE_FLAVOR reduce_flavor,
@@ -2261,7 +2826,7 @@ float DEMSolver::dTInspectReduce(const std::shared_ptr<jitify::Program>& inspect
     return (float)(*pRes);
 }
 
-float* DEMSolver::dTInspectNoReduce(const std::shared_ptr<jitify::Program>& inspection_kernel,
+float* DEMSolver::dTInspectNoReduce(const std::shared_ptr<JitProgram>& inspection_kernel,
                                     const std::string& kernel_name,
                                     INSPECT_ENTITY_TYPE thing_to_insp,
                                     CUB_REDUCE_FLAVOR reduce_flavor,
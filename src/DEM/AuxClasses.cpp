@@ -58,6 +58,15 @@ const std::string INSP_CODE_EVERYTHING_ABSV = R"V0G0N(
     quantity[myOwner] = myABSV;
 )V0G0N";
 
+const std::string INSP_CODE_CLUMP_ABSACC = R"V0G0N(
+    double myAX = granData->aX[myOwner] + simParams->Gx;
+    double myAY = granData->aY[myOwner] + simParams->Gy;
+    double myAZ = granData->aZ[myOwner] + simParams->Gz;
+    double myABSACC = sqrt(myAX * myAX + myAY * myAY + myAZ * myAZ);
+
+    quantity[myOwner] = myABSACC;
+)V0G0N";
+
 const std::string INSP_CODE_CLUMP_KE = R"V0G0N(
     // First lin energy
     double myVX = granData->vX[myOwner];
@@ -146,6 +155,14 @@ void DEMInspector::switch_quantity_type(const std::string& quantity) {
             thing_to_insp = INSPECT_ENTITY_TYPE::EVERYTHING;
             index_name = "myOwner";
             break;
+        case ("clump_max_absacc"_):
+            inspection_code = INSP_CODE_CLUMP_ABSACC;
+            reduce_flavor = CUB_REDUCE_FLAVOR::MAX;
+            kernel_name = "inspectOwnerProperty";
+            thing_to_insp = INSPECT_ENTITY_TYPE::CLUMP;
+            index_name = "myOwner";
+            all_domain = false;  // Only clumps, so not all domain owners
+            break;
         case ("clump_kinetic_energy"_):
             inspection_code = INSP_CODE_CLUMP_KE;
             reduce_flavor = CUB_REDUCE_FLAVOR::SUM;
@@ -217,11 +234,11 @@ void DEMInspector::Initialize(const std::unordered_map<std::string, std::string>
     my_subs["_inRegionPolicy_"] = in_region_specifier;
     my_subs["_quantityQueryProcess_"] = inspection_code;
     if (thing_to_insp == INSPECT_ENTITY_TYPE::SPHERE) {
-        inspection_kernel = std::make_shared<jitify::Program>(std::move(
+        inspection_kernel = std::make_shared<JitProgram>(std::move(
             JitHelper::buildProgram("DEMSphereQueryKernels", JitHelper::KERNEL_DIR / "DEMSphereQueryKernels.cu",
                                     my_subs, DEME_JITIFY_OPTIONS)));
     } else if (thing_to_insp == INSPECT_ENTITY_TYPE::CLUMP || thing_to_insp == INSPECT_ENTITY_TYPE::EVERYTHING) {
-        inspection_kernel = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        inspection_kernel = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMOwnerQueryKernels", JitHelper::KERNEL_DIR / "DEMOwnerQueryKernels.cu", my_subs, DEME_JITIFY_OPTIONS)));
     } else {
         std::stringstream ss;
@@ -274,15 +291,15 @@ void DEMTracker::assertOwnerSize(size_t input_length, const std::string& name) {
 }
 
 std::vector<bodyID_t> DEMTracker::GetContactClumps(size_t offset) {
-    return sys->GetOwnerContactClumps(obj->ownerID + offset);
+    return sys->GetOwnerContactClumps(obj->OwnerAt(offset));
 }
 
 bodyID_t DEMTracker::GetOwnerID(size_t offset) {
-    return obj->ownerID + offset;
+    return obj->OwnerAt(offset);
 }
 
 float3 DEMTracker::Pos(size_t offset) {
-    return sys->GetOwnerPosition(obj->ownerID + offset);
+    return sys->GetOwnerPosition(obj->OwnerAt(offset));
 }
 std::vector<float> DEMTracker::GetPos(size_t offset) {
     float3 res = Pos(offset);
@@ -290,7 +307,7 @@ std::vector<float> DEMTracker::GetPos(size_t offset) {
 }
 
 float3 DEMTracker::AngVelLocal(size_t offset) {
-    return sys->GetOwnerAngVel(obj->ownerID + offset);
+    return sys->GetOwnerAngVel(obj->OwnerAt(offset));
 }
 std::vector<float> DEMTracker::GetAngVelLocal(size_t offset) {
     float3 res = AngVelLocal(offset);
@@ -298,8 +315,8 @@ std::vector<float> DEMTracker::GetAngVelLocal(size_t offset) {
 }
 
 float3 DEMTracker::AngVelGlobal(size_t offset) {
-    float3 ang_v = sys->GetOwnerAngVel(obj->ownerID + offset);
-    float4 oriQ = sys->GetOwnerOriQ(obj->ownerID + offset);
+    float3 ang_v = sys->GetOwnerAngVel(obj->OwnerAt(offset));
+    float4 oriQ = sys->GetOwnerOriQ(obj->OwnerAt(offset));
     hostApplyOriQToVector3(ang_v.x, ang_v.y, ang_v.z, oriQ.w, oriQ.x, oriQ.y, oriQ.z);
     return ang_v;
 }
@@ -309,7 +326,7 @@ std::vector<float> DEMTracker::GetAngVelGlobal(size_t offset) {
 }
 
 float3 DEMTracker::Vel(size_t offset) {
-    return sys->GetOwnerVelocity(obj->ownerID + offset);
+    return sys->GetOwnerVelocity(obj->OwnerAt(offset));
 }
 std::vector<float> DEMTracker::GetVel(size_t offset) {
     float3 res = Vel(offset);
@@ -317,7 +334,7 @@ std::vector<float> DEMTracker::GetVel(size_t offset) {
 }
 
 float4 DEMTracker::OriQ(size_t offset) {
-    return sys->GetOwnerOriQ(obj->ownerID + offset);
+    return sys->GetOwnerOriQ(obj->OwnerAt(offset));
 }
 std::vector<float> DEMTracker::GetOriQ(size_t offset) {
     float4 res = OriQ(offset);
@@ -325,15 +342,36 @@ std::vector<float> DEMTracker::GetOriQ(size_t offset) {
 }
 
 unsigned int DEMTracker::GetFamily(size_t offset) {
-    return sys->GetOwnerFamily(obj->ownerID + offset);
+    return sys->GetOwnerFamily(obj->OwnerAt(offset));
+}
+
+std::vector<bodyID_t> DEMTracker::trackedOwnerIDs() {
+    std::vector<bodyID_t> IDs(obj->nSpanOwners);
+    for (size_t i = 0; i < IDs.size(); i++) {
+        IDs[i] = obj->OwnerAt(i);
+    }
+    return IDs;
+}
+
+std::vector<float3> DEMTracker::Positions() {
+    return sys->GetOwnerPositions(trackedOwnerIDs());
+}
+std::vector<float3> DEMTracker::Velocities() {
+    return sys->GetOwnerVelocities(trackedOwnerIDs());
+}
+std::vector<float3> DEMTracker::AngVelsLocal() {
+    return sys->GetOwnerAngVels(trackedOwnerIDs());
+}
+std::vector<float4> DEMTracker::OriQs() {
+    return sys->GetOwnerOriQs(trackedOwnerIDs());
 }
 
 float DEMTracker::Mass(size_t offset) {
-    return sys->GetOwnerMass(obj->ownerID + offset);
+    return sys->GetOwnerMass(obj->OwnerAt(offset));
 }
 
 float3 DEMTracker::MOI(size_t offset) {
-    return sys->GetOwnerMOI(obj->ownerID + offset);
+    return sys->GetOwnerMOI(obj->OwnerAt(offset));
 }
 std::vector<float> DEMTracker::GetMOI(size_t offset) {
     float3 res = MOI(offset);
@@ -341,18 +379,18 @@ std::vector<float> DEMTracker::GetMOI(size_t offset) {
 }
 
 // float3 DEMTracker::Acc(size_t offset) {
-//     float3 contact_acc = sys->GetOwnerAcc(obj->ownerID + offset);
+//     float3 contact_acc = sys->GetOwnerAcc(obj->OwnerAt(offset));
 //     // Contact acceleration is not total acc, we need to add gravity and manually added forces
 //     //// TODO: How to do that?
 // }
 // float3 DEMTracker::AngAcc(size_t offset) {
-//     float3 contact_angAcc = sys->GetOwnerAngAcc(obj->ownerID + offset);
+//     float3 contact_angAcc = sys->GetOwnerAngAcc(obj->OwnerAt(offset));
 //     // Contact angAcc is not total angAcc, we need to add manually added angular acc
 //     //// TODO: How to do that?
 // }
 
 float3 DEMTracker::ContactAcc(size_t offset) {
-    return sys->GetOwnerAcc(obj->ownerID + offset);
+    return sys->GetOwnerAcc(obj->OwnerAt(offset));
 }
 std::vector<float> DEMTracker::GetContactAcc(size_t offset) {
     float3 res = ContactAcc(offset);
@@ -360,7 +398,7 @@ std::vector<float> DEMTracker::GetContactAcc(size_t offset) {
 }
 
 float3 DEMTracker::ContactAngAccLocal(size_t offset) {
-    return sys->GetOwnerAngAcc(obj->ownerID + offset);
+    return sys->GetOwnerAngAcc(obj->OwnerAt(offset));
 }
 std::vector<float> DEMTracker::GetContactAngAccLocal(size_t offset) {
     float3 res = ContactAngAccLocal(offset);
@@ -368,8 +406,8 @@ std::vector<float> DEMTracker::GetContactAngAccLocal(size_t offset) {
 }
 
 float3 DEMTracker::ContactAngAccGlobal(size_t offset) {
-    float3 ang_acc = sys->GetOwnerAngAcc(obj->ownerID + offset);
-    float4 oriQ = sys->GetOwnerOriQ(obj->ownerID + offset);
+    float3 ang_acc = sys->GetOwnerAngAcc(obj->OwnerAt(offset));
+    float4 oriQ = sys->GetOwnerOriQ(obj->OwnerAt(offset));
     hostApplyOriQToVector3(ang_acc.x, ang_acc.y, ang_acc.z, oriQ.w, oriQ.x, oriQ.y, oriQ.z);
     return ang_acc;
 }
@@ -379,20 +417,20 @@ std::vector<float> DEMTracker::GetContactAngAccGlobal(size_t offset) {
 }
 
 float DEMTracker::GetOwnerWildcardValue(const std::string& name, size_t offset) {
-    return sys->GetOwnerWildcardValue(obj->ownerID + offset, name);
+    return sys->GetOwnerWildcardValue(obj->OwnerAt(offset), name);
 }
 
 float DEMTracker::GetGeometryWildcardValue(const std::string& name, size_t offset) {
     std::vector<float> res;
     switch (obj->obj_type) {
         case (OWNER_TYPE::CLUMP):
-            res = sys->GetSphereWildcardValue(obj->geoID + offset, name, 1);
+            res = sys->GetSphereWildcardValue(obj->GeoAt(offset), name, 1);
             break;
         case (OWNER_TYPE::ANALYTICAL):
-            res = sys->GetAnalWildcardValue(obj->geoID + offset, name, 1);
+            res = sys->GetAnalWildcardValue(obj->GeoAt(offset), name, 1);
             break;
         case (OWNER_TYPE::MESH):
-            res = sys->GetTriWildcardValue(obj->geoID + offset, name, 1);
+            res = sys->GetTriWildcardValue(obj->GeoAt(offset), name, 1);
             break;
     }
     return res[0];
@@ -402,6 +440,14 @@ std::vector<float> DEMTracker::GetGeometryWildcardValues(const std::string& name
     std::vector<float> res;
     switch (obj->obj_type) {
         case (OWNER_TYPE::CLUMP):
+            // Spheres of reordered clumps are not consecutive
+            if (!obj->geoIDs.empty()) {
+                res.resize(obj->nGeos);
+                for (size_t i = 0; i < obj->nGeos; i++) {
+                    res[i] = sys->GetSphereWildcardValue(obj->GeoAt(i), name, 1)[0];
+                }
+                break;
+            }
             res = sys->GetSphereWildcardValue(obj->geoID, name, obj->nGeos);
             break;
         case (OWNER_TYPE::ANALYTICAL):
@@ -418,7 +464,7 @@ size_t DEMTracker::GetContactForces(std::vector<float3>& points, std::vector<flo
     assertThereIsForcePairs("GetContactForces");
     points.clear();
     forces.clear();
-    return sys->GetOwnerContactForces(obj->ownerID + offset, points, forces);
+    return sys->GetOwnerContactForces(obj->OwnerAt(offset), points, forces);
 }
 size_t DEMTracker::GetContactForces(std::vector<std::vector<float>>& points,
                                     std::vector<std::vector<float>>& forces,
@@ -445,7 +491,7 @@ size_t DEMTracker::GetContactForcesAndLocalTorque(std::vector<float3>& points,
     points.clear();
     forces.clear();
     torques.clear();
-    return sys->GetOwnerContactForces(obj->ownerID + offset, points, forces, torques, true);
+    return sys->GetOwnerContactForces(obj->OwnerAt(offset), points, forces, torques, true);
 }
 size_t DEMTracker::GetContactForcesAndLocalTorque(std::vector<std::vector<float>>& points,
                                                   std::vector<std::vector<float>>& forces,
@@ -476,7 +522,7 @@ size_t DEMTracker::GetContactForcesAndGlobalTorque(std::vector<float3>& points,
     points.clear();
     forces.clear();
     torques.clear();
-    return sys->GetOwnerContactForces(obj->ownerID + offset, points, forces, torques, false);
+    return sys->GetOwnerContactForces(obj->OwnerAt(offset), points, forces, torques, false);
 }
 size_t DEMTracker::GetContactForcesAndGlobalTorque(std::vector<std::vector<float>>& points,
                                                    std::vector<std::vector<float>>& forces,
@@ -500,7 +546,7 @@ size_t DEMTracker::GetContactForcesAndGlobalTorque(std::vector<std::vector<float
 }
 
 void DEMTracker::AddAcc(float3 acc, size_t offset) {
-    sys->AddOwnerNextStepAcc(obj->ownerID + offset, acc);
+    sys->AddOwnerNextStepAcc(obj->OwnerAt(offset), acc);
 }
 void DEMTracker::AddAcc(const std::vector<float>& acc, size_t offset) {
     assertThreeElements(acc, "AddAcc", "acc");
@@ -508,7 +554,7 @@ void DEMTracker::AddAcc(const std::vector<float>& acc, size_t offset) {
 }
 
 void DEMTracker::AddAngAcc(float3 angAcc, size_t offset) {
-    sys->AddOwnerNextStepAngAcc(obj->ownerID + offset, angAcc);
+    sys->AddOwnerNextStepAngAcc(obj->OwnerAt(offset), angAcc);
 }
 void DEMTracker::AddAngAcc(const std::vector<float>& angAcc, size_t offset) {
     assertThreeElements(angAcc, "AddAngAcc", "angAcc");
@@ -516,7 +562,7 @@ void DEMTracker::AddAngAcc(const std::vector<float>& angAcc, size_t offset) {
 }
 
 void DEMTracker::SetPos(float3 pos, size_t offset) {
-    sys->SetOwnerPosition(obj->ownerID + offset, pos);
+    sys->SetOwnerPosition(obj->OwnerAt(offset), pos);
 }
 void DEMTracker::SetPos(const std::vector<float>& pos, size_t offset) {
     assertThreeElements(pos, "SetPos", "pos");
@@ -524,7 +570,7 @@ void DEMTracker::SetPos(const std::vector<float>& pos, size_t offset) {
 }
 
 void DEMTracker::SetAngVel(float3 angVel, size_t offset) {
-    sys->SetOwnerAngVel(obj->ownerID + offset, angVel);
+    sys->SetOwnerAngVel(obj->OwnerAt(offset), angVel);
 }
 void DEMTracker::SetAngVel(const std::vector<float>& angVel, size_t offset) {
     assertThreeElements(angVel, "SetAngVel", "angVel");
@@ -532,7 +578,7 @@ void DEMTracker::SetAngVel(const std::vector<float>& angVel, size_t offset) {
 }
 
 void DEMTracker::SetVel(float3 vel, size_t offset) {
-    sys->SetOwnerVelocity(obj->ownerID + offset, vel);
+    sys->SetOwnerVelocity(obj->OwnerAt(offset), vel);
 }
 void DEMTracker::SetVel(const std::vector<float>& vel, size_t offset) {
     assertThreeElements(vel, "SetVel", "vel");
@@ -540,31 +586,47 @@ void DEMTracker::SetVel(const std::vector<float>& vel, size_t offset) {
 }
 
 void DEMTracker::SetOriQ(float4 oriQ, size_t offset) {
-    sys->SetOwnerOriQ(obj->ownerID + offset, oriQ);
+    sys->SetOwnerOriQ(obj->OwnerAt(offset), oriQ);
 }
 void DEMTracker::SetOriQ(const std::vector<float>& oriQ, size_t offset) {
     assertFourElements(oriQ, "SetOriQ", "oriQ");
     SetOriQ(host_make_float4(oriQ[0], oriQ[1], oriQ[2], oriQ[3]), offset);
 }
 
+void DEMTracker::SetPositions(const std::vector<float3>& pos) {
+    assertOwnerSize(pos.size(), "SetPositions");
+    sys->SetOwnerPositions(trackedOwnerIDs(), pos);
+}
+void DEMTracker::SetVelocities(const std::vector<float3>& vel) {
+    assertOwnerSize(vel.size(), "SetVelocities");
+    sys->SetOwnerVelocities(trackedOwnerIDs(), vel);
+}
+void DEMTracker::SetAngVels(const std::vector<float3>& angVel) {
+    assertOwnerSize(angVel.size(), "SetAngVels");
+    sys->SetOwnerAngVels(trackedOwnerIDs(), angVel);
+}
+void DEMTracker::SetOriQs(const std::vector<float4>& oriQ) {
+    assertOwnerSize(oriQ.size(), "SetOriQs");
+    sys->SetOwnerOriQs(trackedOwnerIDs(), oriQ);
+}
+
 void DEMTracker::SetFamily(const std::vector<unsigned int>& fam_nums) {
     assertOwnerSize(fam_nums.size(), "SetFamily");
     for (size_t i = 0; i < fam_nums.size(); i++) {
-        sys->SetOwnerFamily(obj->ownerID + i, fam_nums[i]);
+        sys->SetOwnerFamily(obj->OwnerAt(i), fam_nums[i]);
     }
 }
 void DEMTracker::SetFamily(unsigned int fam_num) {
     for (size_t i = 0; i < obj->nSpanOwners; i++) {
-        sys->SetOwnerFamily(obj->ownerID + i, fam_num);
+        sys->SetOwnerFamily(obj->OwnerAt(i), fam_num);
     }
 }
 void DEMTracker::SetFamily(unsigned int fam_num, size_t offset) {
-    sys->SetOwnerFamily(obj->ownerID + offset, fam_num);
+    sys->SetOwnerFamily(obj->OwnerAt(offset), fam_num);
 }
 void DEMTracker::ChangeClumpSizes(const std::vector<bodyID_t>& IDs, const std::vector<float>& factors) {
     std::vector<bodyID_t> offsetted_IDs(IDs);
-    size_t offset = obj->ownerID;
-    std::for_each(offsetted_IDs.begin(), offsetted_IDs.end(), [offset](bodyID_t& x) { x += offset; });
+    std::for_each(offsetted_IDs.begin(), offsetted_IDs.end(), [this](bodyID_t& x) { x = obj->OwnerAt(x); });
     sys->ChangeClumpSizes(offsetted_IDs, factors);
 }
 
@@ -618,24 +680,31 @@ std::vector<std::vector<float>> DEMTracker::GetMeshNodesGlobalAsVectorOfVector()
 }
 
 void DEMTracker::SetOwnerWildcardValue(const std::string& name, float wc, size_t offset) {
-    sys->SetOwnerWildcardValue(obj->ownerID + offset, name, wc, 1);
+    sys->SetOwnerWildcardValue(obj->OwnerAt(offset), name, wc, 1);
 }
 
 void DEMTracker::SetOwnerWildcardValues(const std::string& name, const std::vector<float>& wc) {
     assertOwnerSize(wc.size(), "SetOwnerWildcardValues");
+    // Reordered clumps are not consecutive
+    if (!obj->ownerIDs.empty()) {
+        for (size_t i = 0; i < wc.size(); i++) {
+            sys->SetOwnerWildcardValue(obj->OwnerAt(i), name, wc[i], 1);
+        }
+        return;
+    }
     sys->SetOwnerWildcardValue(obj->ownerID, name, wc);
 }
 
 void DEMTracker::SetGeometryWildcardValue(const std::string& name, float wc, size_t offset) {
     switch (obj->obj_type) {
         case (OWNER_TYPE::CLUMP):
-            sys->SetSphereWildcardValue(obj->geoID + offset, name, std::vector<float>(1, wc));
+            sys->SetSphereWildcardValue(obj->GeoAt(offset), name, std::vector<float>(1, wc));
             break;
         case (OWNER_TYPE::ANALYTICAL):
-            sys->SetAnalWildcardValue(obj->geoID + offset, name, std::vector<float>(1, wc));
+            sys->SetAnalWildcardValue(obj->GeoAt(offset), name, std::vector<float>(1, wc));
             break;
         case (OWNER_TYPE::MESH):
-            sys->SetTriWildcardValue(obj->geoID + offset, name, std::vector<float>(1, wc));
+            sys->SetTriWildcardValue(obj->GeoAt(offset), name, std::vector<float>(1, wc));
             break;
     }
 }
@@ -644,6 +713,13 @@ void DEMTracker::SetGeometryWildcardValues(const std::string& name, const std::v
     switch (obj->obj_type) {
         case (OWNER_TYPE::CLUMP):
             assertGeoSize(wc.size(), "SetGeometryWildcardValues", "spheres");
+            // Spheres of reordered clumps are not consecutive
+            if (!obj->geoIDs.empty()) {
+                for (size_t i = 0; i < wc.size(); i++) {
+                    sys->SetSphereWildcardValue(obj->GeoAt(i), name, std::vector<float>(1, wc[i]));
+                }
+                break;
+            }
             sys->SetSphereWildcardValue(obj->geoID, name, wc);
             break;
         case (OWNER_TYPE::ANALYTICAL):
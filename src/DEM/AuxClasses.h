@@ -10,10 +10,8 @@
 #include <core/utils/JitHelper.h>
 #include <DEM/Defines.h>
 
-// Forward declare jitify::Program to avoid downstream dependency
-namespace jitify {
-class Program;
-}
+// Forward declare JitProgram to avoid downstream dependency on jitify
+class JitProgram;
 
 namespace deme {
 
@@ -24,7 +22,7 @@ class DEMDynamicThread;
 /// their simulation entites, in a given region.
 class DEMInspector {
   private:
-    std::shared_ptr<jitify::Program> inspection_kernel;
+    std::shared_ptr<JitProgram> inspection_kernel;
 
     std::string inspection_code;
     std::string in_region_code;
@@ -90,6 +88,8 @@ class DEMTracker {
     void assertGeoSize(size_t input_length, const std::string& func_name, const std::string& geo_type);
     void assertOwnerSize(size_t input_length, const std::string& name);
     void assertThereIsForcePairs(const std::string& name);
+    // The IDs of all the owners this tracker tracks
+    std::vector<bodyID_t> trackedOwnerIDs();
     // Its parent DEMSolver system
     DEMSolver* sys;
 
@@ -127,6 +127,15 @@ class DEMTracker {
     /// @return The family number.
     unsigned int GetFamily(size_t offset = 0);
 
+    /// @brief Get the positions of all the owners this tracker tracks, in one go.
+    std::vector<float3> Positions();
+    /// @brief Get the velocities (global frame) of all the owners this tracker tracks, in one go.
+    std::vector<float3> Velocities();
+    /// @brief Get the angular velocities (in their own local frames) of all the owners this tracker tracks, in one go.
+    std::vector<float3> AngVelsLocal();
+    /// @brief Get the quaternions of all the owners this tracker tracks, in one go.
+    std::vector<float4> OriQs();
+
     /// @brief Get the clumps that are in contact with this tracked owner as a vector.
     /// @param offset Offset to the first item this tracker is tracking. Default is 0.
     /// @return Clump owner IDs in contact with this owner.
@@ -170,6 +179,14 @@ class DEMTracker {
     /// @brief Set the quaternion which represents the orientation of this tracked object's coordinate system.
     void SetOriQ(float4 oriQ, size_t offset = 0);
     void SetOriQ(const std::vector<float>& oriQ, size_t offset = 0);
+    /// @brief Set the positions of all the owners this tracker tracks, in one go.
+    void SetPositions(const std::vector<float3>& pos);
+    /// @brief Set the velocities (global frame) of all the owners this tracker tracks, in one go.
+    void SetVelocities(const std::vector<float3>& vel);
+    /// @brief Set the angular velocities (in their own local frames) of all the owners this tracker tracks, in one go.
+    void SetAngVels(const std::vector<float3>& angVel);
+    /// @brief Set the quaternions of all the owners this tracker tracks, in one go.
+    void SetOriQs(const std::vector<float4>& oriQ);
     /// Add an extra acc to the tracked body, for the next time step. Note if the user intends to add a persistent
     /// external force, then using family prescription is the better method.
     void AddAcc(float3 acc, size_t offset = 0);
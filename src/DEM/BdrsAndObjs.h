@@ -13,6 +13,7 @@
 #include <sstream>
 #include <array>
 #include <cmath>
+#include <cstdint>
 
 #include <nvmath/helper_math.cuh>
 #include <DEM/Defines.h>
@@ -246,6 +247,13 @@ class DEMMeshConnected : public DEMInitializer {
         }
     }
 
+    // If LoadWavefrontMesh keeps a binary sidecar cache of the parsed meshes
+    static bool useLoadCache;
+    void clearLoadedGeometry();
+    // Fill the geometry from a sidecar cache; false if it does not exist or is not for this content of the mesh file
+    bool loadMeshCache(const std::string& cache_file, uint64_t content_hash, uint64_t content_size);
+    void writeMeshCache(const std::string& cache_file, uint64_t content_hash, uint64_t content_size);
+
   public:
     // Number of triangle facets in the mesh
     size_t nTri = 0;
@@ -317,6 +325,9 @@ class DEMMeshConnected : public DEMInitializer {
     // normals derived from right-hand-rule are the same as the normals in the mesh file
     bool use_mesh_normals = false;
 
+    // If true, the contacts between spheres and this mesh are found by querying a BVH of the mesh, not by binning
+    bool use_bvh = false;
+
     DEMMeshConnected() { obj_type = OWNER_TYPE::MESH; }
     DEMMeshConnected(std::string input_file) {
         LoadWavefrontMesh(input_file);
@@ -332,6 +343,12 @@ class DEMMeshConnected : public DEMInitializer {
     /// Load a triangle mesh saved as a Wavefront .obj file
     bool LoadWavefrontMesh(std::string input_file, bool load_normals = true, bool load_uv = false);
 
+    /// @brief Whether LoadWavefrontMesh should keep a binary cache of each mesh it parses (default off).
+    /// @details The cache is a <mesh file>.demecache file next to the mesh file. It is only used while the content of
+    /// the mesh file stays the same, and spares re-parsing large meshes at every job start. If the mesh directory is
+    /// not writable, no cache is kept.
+    static void UseLoadCache(bool use = true) { useLoadCache = use; }
+
     /// Write the specified meshes in a Wavefront .obj file
     static void WriteWavefront(const std::string& filename, std::vector<DEMMeshConnected>& meshes);
 
@@ -348,6 +365,12 @@ class DEMMeshConnected : public DEMInitializer {
     /// the normals derived from right-hand-rule are the same as the normals in the mesh file
     void UseNormals(bool use = true) { use_mesh_normals = use; }
 
+    /// @brief Instruct that the contacts between spheres and this mesh are found by querying a bounding volume
+    /// hierarchy of the mesh, rather than by binning its facets at each contact detection.
+    /// @details The BVH is built once in the mesh's own frame (and only refit if the mesh deforms), so this pays off
+    /// for large meshes that move rigidly or barely deform. Default is off.
+    void UseBVH(bool use = true) { use_bvh = use; }
+
     /// Access the n-th triangle in mesh
     DEMTriangle GetTriangle(size_t index) const {  // No need to wrap (for Shlok)
         return DEMTriangle(m_vertices[m_face_v_indices[index].x], m_vertices[m_face_v_indices[index].y],
@@ -33,6 +33,11 @@ namespace deme {
 // In bin--triangle intersection scan, all bins are enlarged by a factor of this following constant, so that no triangle
 // lies in between bins and not picked up by any bins.
 #define DEME_BIN_ENLARGE_RATIO_FOR_FACETS 0.001
+// Max number of bin levels (size classes) in hierarchical binning. Level k has bins 2^k times as large as level 0.
+#define DEME_MAX_BIN_LEVELS 8
+// Max number of triangles in a leaf of a mesh BVH, and the max depth of a mesh BVH (the traversal stack size)
+#define DEME_MESH_BVH_LEAF_SIZE 4
+#define DEME_MESH_BVH_MAX_DEPTH 64
 
 // A few pre-computed constants
 constexpr double TWO_OVER_THREE = 0.666666666666667;
@@ -52,6 +57,10 @@ constexpr int64_t MAX_SUBVOXEL = (int64_t)1 << VOXEL_RES_POWER2;
 #define DEME_NUM_TRIANGLE_PER_BLOCK 512
 #define DEME_MAX_THREADS_PER_BLOCK 1024
 #define DEME_INIT_CNT_MULTIPLIER 2
+// When a contact array is too short, it grows to at least this many times its current length; when it is longer than
+// DEME_CNT_ARR_SHRINK_THRESHOLD times what is needed, it is cut back to DEME_CNT_ARR_GROWTH_FACTOR times what is needed
+#define DEME_CNT_ARR_GROWTH_FACTOR 1.5
+#define DEME_CNT_ARR_SHRINK_THRESHOLD 4
 // If there are more than this number of analytical geometry, we may have difficulty jitify them all
 #define DEME_THRESHOLD_TOO_MANY_ANAL_GEO 64
 // If a clump has more than this number of sphere components, it is automatically considered a non-jitifiable big clump
@@ -88,6 +97,11 @@ const ownerType_t OWNER_T_CLUMP = 1;
 const ownerType_t OWNER_T_ANALYTICAL = 2;
 const ownerType_t OWNER_T_MESH = 4;
 
+// Bit flags of the periodic directions of the simulation world
+const unsigned int PERIODIC_X = 1;
+const unsigned int PERIODIC_Y = 2;
+const unsigned int PERIODIC_Z = 4;
+
 // This ID marks that this is a new contact, not present when we did contact detection last time
 // TODO: half max add half max... so stupid... Better way?? numeric_limit won't work...
 constexpr contactPairs_t NULL_MAPPING_PARTNER = ((size_t)1 << (sizeof(contactPairs_t) * DEME_BITS_PER_BYTE - 1)) +
@@ -191,6 +205,13 @@ struct DEMSimParams {
     binID_t nbY;
     // Number of bins in the Z direction (actual number)
     binID_t nbZ;
+    // Number of bin levels in hierarchical binning (1 means uniform binning). Level 0 is the grid given by nbX, nbY,
+    // nbZ; level k has bins of size binSize * 2^k, and its bin IDs start from levelBinOffset[k].
+    unsigned int nBinLevels = 1;
+    binID_t levelNbX[DEME_MAX_BIN_LEVELS];
+    binID_t levelNbY[DEME_MAX_BIN_LEVELS];
+    binID_t levelNbZ[DEME_MAX_BIN_LEVELS];
+    binID_t levelBinOffset[DEME_MAX_BIN_LEVELS];
     // Smallest length unit
     double l;
     // Double-precision single voxel size
@@ -205,6 +226,8 @@ struct DEMSimParams {
     bodyID_t nOwnerClumps;
     objID_t nExtObj;
     bodyID_t nTriMeshes;
+    // Number of meshes whose contacts with spheres are found by querying their BVHs, rather than by binning
+    unsigned int nMeshBVHs = 0;
 
     // Number of the templates (or say the ``types'') of clumps and spheres
     unsigned int nDistinctClumpBodyTopologies;
@@ -223,6 +246,11 @@ struct DEMSimParams {
     // User's box size
     float3 userBoxMin;
     float3 userBoxMax;
+    // Periodic directions (PERIODIC_X/Y/Z bits). Along them, the period is the user's box, whose min corner is stored
+    // relative to the LBF point so it compares directly with positions derived from voxel IDs.
+    unsigned int periodicDirs = 0;
+    float3 periodicBoxMin;
+    float3 periodicBoxSize;
     // Time step size
     float h;
     // Time elappsed since start of simulation
@@ -249,6 +277,11 @@ struct DEMSimParams {
     unsigned int errOutBinSphNum = 32768;
     // The max num of triangles per bin before solver errors out
     unsigned int errOutBinTriNum = 32768;
+
+    // A clump falls asleep if its vel and acc stay below these thresholds for sleepSteps consecutive steps
+    float sleepVelThres = 0;
+    float sleepAccThres = 0;
+    unsigned int sleepSteps = 0;
 };
 
 // A struct that holds pointers to data arrays that dT uses
@@ -290,6 +323,10 @@ struct DEMDataDT {
     notStupidBool_t* accSpecified;
     notStupidBool_t* angAccSpecified;
 
+    // Sleep state of owners, and how many consecutive steps they have been quiet
+    notStupidBool_t* ownerSleeping;
+    unsigned int* ownerQuietSteps;
+
     bodyID_t* idGeometryA;
     bodyID_t* idGeometryB;
     contact_t* contactType;
@@ -366,10 +403,24 @@ struct DEMDataDT {
 
     // dT believes this amount of future drift is ideal
     unsigned int perhapsIdealFutureDrift = 0;
+    // The step size kT should use for deriving the contact margin. With variable step size, it can be larger than h.
+    float stepSizeForKT = 0;
 };
 
 // A struct that holds pointers to data arrays that kT uses
 // For more details just look at PhysicsSystem.h
+// A node of a mesh BVH. Boxes are in the mesh's own frame. A leaf holds nTri triangles starting from triStart in the
+// BVH triangle ID array; an internal node (nTri == 0) has its left child right after it, and its right child at right.
+struct DEMMeshBVHNode {
+    float3 lo;
+    float3 hi;
+    // How far the sandwich triangles of this subtree may reach out of the box, in units of the mesh's margin size
+    float marginRatio;
+    unsigned int right;
+    unsigned int triStart;
+    unsigned int nTri;
+};
+
 struct DEMDataKT {
     family_t* familyID;
     voxelID_t* voxelID;
@@ -418,6 +469,13 @@ struct DEMDataKT {
     float3* relPosNode1_buffer;
     float3* relPosNode2_buffer;
     float3* relPosNode3_buffer;
+    // Mesh BVHs: whether a facet is in one (so it is not binned), BVH nodes, the triangles they index into, and each
+    // BVH's owner and root node
+    notStupidBool_t* triInMeshBVH;
+    DEMMeshBVHNode* meshBVHNodes;
+    bodyID_t* meshBVHTriIDs;
+    bodyID_t* meshBVHOwner;
+    unsigned int* meshBVHRoot;
 
     // kT's own work arrays. Now these array pointers get assigned in contactDetection() which point to shared scratch
     // spaces. No need to do forward declaration anymore. They are left here for reference, should contactDetection()
@@ -469,6 +527,8 @@ const float AN_EXAMPLE_MAX_VEL_FOR_SHOWING_MARGIN_SIZE = 1.f;
 const unsigned int NUM_STEPS_RESERVED_AFTER_CHANGING_BIN_SIZE = 5;
 // Drift tweak step size
 const unsigned int FUTURE_DRIFT_TWEAK_STEP_SIZE = 1;
+// With variable step size, the step size can at most be multiplied by this much in one kT update cycle
+const float MAX_STEP_SIZE_GROWTH_RATE = 1.1;
 // After purging update freq history, this many dT steps are not included in the performance gauging.
 const unsigned int NUM_STEPS_RESERVED_AFTER_RENEWING_FREQ_TUNER = 10;
 // Default target simulation `world' size.
@@ -18,6 +18,7 @@
 #include <fstream>
 #include <filesystem>
 #include <random>
+#include <limits>
 #include <nvmath/helper_math.cuh>
 #include <DEM/VariableTypes.h>
 // #include <DEM/Defines.h>
@@ -172,6 +173,163 @@ inline size_t hostCalcBinNum(binID_t& nbX,
     return (size_t)nbX * (size_t)nbY * (size_t)nbZ;
 }
 
+// Number of bin levels needed for hierarchical binning, such that a sphere of max_radius fits in a bin of the coarsest
+// level (bin size m_binSize * 2^(n - 1)). Capped at max_levels.
+inline unsigned int hostCalcBinLevelNum(double m_binSize, double max_radius, unsigned int max_levels) {
+    unsigned int n_levels = 1;
+    double level_bin_size = m_binSize;
+    while (n_levels < max_levels && 2.0 * max_radius > level_bin_size) {
+        level_bin_size *= 2.0;
+        n_levels++;
+    }
+    return n_levels;
+}
+
+// Bin numbers on each level of hierarchical binning (level k has bin size m_binSize * 2^k), and the ID of the first bin
+// of each level. Returns the total number of bins of all levels.
+inline size_t hostCalcBinLevels(binID_t* levelNbX,
+                                binID_t* levelNbY,
+                                binID_t* levelNbZ,
+                                binID_t* levelBinOffset,
+                                unsigned int n_levels,
+                                double m_voxelSize,
+                                double m_binSize,
+                                unsigned char nvXp2,
+                                unsigned char nvYp2,
+                                unsigned char nvZp2) {
+    size_t num_bins = 0;
+    for (unsigned int level = 0; level < n_levels; level++) {
+        levelBinOffset[level] = (binID_t)num_bins;
+        num_bins += hostCalcBinNum(levelNbX[level], levelNbY[level], levelNbZ[level], m_voxelSize,
+                                   m_binSize * (double)((size_t)1 << level), nvXp2, nvYp2, nvZp2);
+    }
+    return num_bins;
+}
+
+// How far the sandwich vertices of a triangle (see makeTriangleSandwich) may move away from the triangle, in units of
+// the margin size. A vertex moves off the plane by the margin, and out along the angle bisector by margin / sin(half
+// angle), where 1 / sin^2(half angle) = 2 / (1 - cos(angle)).
+inline float hostSandwichMarginRatio(const float3& p1, const float3& p2, const float3& p3) {
+    const float3 nodes[3] = {p1, p2, p3};
+    float ratio = 1.f;
+    for (int i = 0; i < 3; i++) {
+        const float3 side1 = nodes[(i + 1) % 3] - nodes[i];
+        const float3 side2 = nodes[(i + 2) % 3] - nodes[i];
+        const float cos_angle = dot(side1, side2) / (length(side1) * length(side2));
+        float this_ratio = std::sqrt(1.f + 2.f / (1.f - cos_angle));
+        // Degenerate facets get a huge, but finite, ratio
+        if (!(this_ratio < 1e6f))
+            this_ratio = 1e6f;
+        ratio = std::max(ratio, this_ratio);
+    }
+    // Some slack for the rounding in the kernel
+    return ratio * 1.01f;
+}
+
+// Re-compute the boxes of mesh BVH nodes [first_node, end_node) from the current triangle nodes. Children are always
+// stored after their parents, so a reverse sweep goes bottom-up.
+template <typename T1, typename T2>
+inline void hostRefitMeshBVH(T1* nodes,
+                             const T2* triIDs,
+                             const float3* node1,
+                             const float3* node2,
+                             const float3* node3,
+                             size_t first_node,
+                             size_t end_node) {
+    for (size_t n = end_node; n-- > first_node;) {
+        T1& node = nodes[n];
+        if (node.nTri > 0) {
+            node.lo = node1[triIDs[node.triStart]];
+            node.hi = node.lo;
+            node.marginRatio = 1.f;
+            for (size_t i = node.triStart; i < node.triStart + node.nTri; i++) {
+                const T2 tri = triIDs[i];
+                node.lo = fminf(node.lo, fminf(node1[tri], fminf(node2[tri], node3[tri])));
+                node.hi = fmaxf(node.hi, fmaxf(node1[tri], fmaxf(node2[tri], node3[tri])));
+                node.marginRatio =
+                    std::max(node.marginRatio, hostSandwichMarginRatio(node1[tri], node2[tri], node3[tri]));
+            }
+        } else {
+            const T1& left = nodes[n + 1];
+            const T1& right = nodes[node.right];
+            node.lo = fminf(left.lo, right.lo);
+            node.hi = fmaxf(left.hi, right.hi);
+            node.marginRatio = std::max(left.marginRatio, right.marginRatio);
+        }
+    }
+}
+
+// Build the BVH of the triangles [tri_start, tri_end) of a mesh, appending its nodes to nodes and its leaves' triangle
+// IDs to triIDs. Nodes are split at the median triangle centroid along the longest axis, so the depth is about
+// log2(number of triangles / leaf_size). Returns the index of the root node.
+template <typename T1, typename T2>
+inline size_t hostBuildMeshBVH(T1& nodes,
+                               T2& triIDs,
+                               const float3* node1,
+                               const float3* node2,
+                               const float3* node3,
+                               size_t tri_start,
+                               size_t tri_end,
+                               unsigned int leaf_size) {
+    using node_t = typename T1::value_type;
+    using id_t = typename T2::value_type;
+    const size_t root = nodes.size();
+    const size_t first_id = triIDs.size();
+    std::vector<float3> centroids(tri_end - tri_start);
+    for (size_t i = tri_start; i < tri_end; i++) {
+        triIDs.push_back((id_t)i);
+        centroids[i - tri_start] = (node1[i] + node2[i] + node3[i]) / 3.f;
+    }
+
+    // Ranges of triIDs yet to become nodes, and which node (if any) takes it as its right child. The left range is
+    // always processed first, so a left child lands right after its parent.
+    struct PendingRange {
+        size_t first;
+        size_t last;
+        size_t parent;
+    };
+    const size_t no_parent = std::numeric_limits<size_t>::max();
+    std::vector<PendingRange> pending = {{first_id, triIDs.size(), no_parent}};
+    while (!pending.empty()) {
+        const PendingRange range = pending.back();
+        pending.pop_back();
+        const size_t this_node = nodes.size();
+        if (range.parent != no_parent) {
+            nodes[range.parent].right = (unsigned int)this_node;
+        }
+        node_t node{};
+        if (range.last - range.first <= leaf_size) {
+            node.triStart = (unsigned int)range.first;
+            node.nTri = (unsigned int)(range.last - range.first);
+            nodes.push_back(node);
+            continue;
+        }
+
+        float3 lo = centroids[triIDs[range.first] - tri_start];
+        float3 hi = lo;
+        for (size_t i = range.first; i < range.last; i++) {
+            lo = fminf(lo, centroids[triIDs[i] - tri_start]);
+            hi = fmaxf(hi, centroids[triIDs[i] - tri_start]);
+        }
+        const float3 extent = hi - lo;
+        const int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : ((extent.y >= extent.z) ? 1 : 2);
+        auto centroid_coord = [&](const id_t& id) {
+            const float3& c = centroids[id - tri_start];
+            return (axis == 0) ? c.x : ((axis == 1) ? c.y : c.z);
+        };
+        const size_t mid = range.first + (range.last - range.first) / 2;
+        std::nth_element(triIDs.begin() + range.first, triIDs.begin() + mid, triIDs.begin() + range.last,
+                         [&](const id_t& a, const id_t& b) { return centroid_coord(a) < centroid_coord(b); });
+
+        nodes.push_back(node);
+        pending.push_back({mid, range.last, this_node});
+        pending.push_back({range.first, mid, no_parent});
+    }
+
+    hostRefitMeshBVH(nodes.data(), triIDs.data(), node1, node2, node3, root, nodes.size());
+    return root;
+}
+
 /// @brief  Check if the string has only spaces.
 inline bool is_all_spaces(const std::string& str) {
     return str.find_first_not_of(' ') == str.npos;
@@ -326,6 +484,60 @@ inline std::vector<T1> hostRemoveElem(const std::vector<T1>& vec, const std::vec
     return v;
 }
 
+// Compact the first flags.size() elements of a vector in place, keeping those whose flag is non-zero (relative order is
+// preserved) and discarding everything else, then resize it to at least min_size and release the spare capacity
+template <typename T1, typename T2>
+inline void hostCompactByFlags(T1& vec, const std::vector<T2>& flags, size_t min_size = 0) {
+    size_t n = 0;
+    for (size_t i = 0; i < flags.size(); i++) {
+        if (flags[i]) {
+            vec[n++] = vec[i];
+        }
+    }
+    vec.resize((n > min_size) ? n : min_size);
+    vec.shrink_to_fit();
+}
+
+// Resize a vector so that its capacity is exactly the new length, unless it already has the room (a plain resize may
+// over-allocate when it grows, and never releases memory when it shrinks). Returns the change in bytes held, which
+// wraps around like the tracked-resize macros when memory is released.
+template <typename T1, typename T2>
+inline size_t hostResizeExact(T1& vec, size_t n, const T2& val) {
+    size_t old_capacity = vec.capacity();
+    if (n < vec.size()) {
+        vec.resize(n);
+        vec.shrink_to_fit();
+    } else {
+        if (n > old_capacity) {
+            vec.reserve(n);
+        }
+        vec.resize(n, val);
+    }
+    return sizeof(typename T1::value_type) * (vec.capacity() - old_capacity);
+}
+
+// Make sure each vector can hold n elements without being reallocated. Returns the increase in bytes held.
+template <typename... Ts>
+inline size_t hostReserveAll(size_t n, Ts&... vecs) {
+    size_t byte_delta = 0;
+    auto reserve_one = [&](auto& vec) {
+        size_t old_capacity = vec.capacity();
+        vec.reserve(n);
+        byte_delta += sizeof(vec[0]) * (vec.capacity() - old_capacity);
+    };
+    (reserve_one(vecs), ...);
+    return byte_delta;
+}
+
+// Permute the first order.size() elements of a vector in place, so that element i becomes what was element order[i]
+template <typename T1, typename T2>
+inline void hostApplyOrder(T1& vec, const std::vector<T2>& order) {
+    std::vector<typename T1::value_type> tmp(vec.begin(), vec.begin() + order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        vec[i] = tmp[order[i]];
+    }
+}
+
 // Contribution from https://stackoverflow.com/questions/1577475/c-sorting-and-keeping-track-of-indexes
 template <typename T1>
 inline std::vector<size_t> hostSortIndices(const std::vector<T1>& v) {
@@ -424,6 +636,38 @@ inline void hostIDPacker(T1& ID,
     ID += Z << (nvXp2 + nvYp2);
 }
 
+// Spread the lower 21 bits of an integer so there are 2 zero bits between each of them
+inline uint64_t hostMortonSpread3(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | (v << 32)) & 0x1f00000000ffffULL;
+    v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+    v = (v | (v << 8)) & 0x100f00f00f00f00fULL;
+    v = (v | (v << 4)) & 0x10c30c30c30c30c3ULL;
+    v = (v | (v << 2)) & 0x1249249249249249ULL;
+    return v;
+}
+
+// From a voxelID to its key on the Morton (Z-order) curve, which keeps voxels that are close in space mostly close in
+// key. If a voxel index has more than 21 bits, only its 21 most significant bits are used.
+template <typename T1>
+inline uint64_t hostVoxelIDToMortonKey(const T1& ID,
+                                       const unsigned char& nvXp2,
+                                       const unsigned char& nvYp2,
+                                       const unsigned char& nvZp2) {
+    T1 voxelIDX, voxelIDY, voxelIDZ;
+    hostIDChopper<T1, T1>(voxelIDX, voxelIDY, voxelIDZ, ID, nvXp2, nvYp2);
+    uint64_t X = (uint64_t)voxelIDX >> (nvXp2 > 21 ? nvXp2 - 21 : 0);
+    uint64_t Y = (uint64_t)voxelIDY >> (nvYp2 > 21 ? nvYp2 - 21 : 0);
+    uint64_t Z = (uint64_t)voxelIDZ >> (nvZp2 > 21 ? nvZp2 - 21 : 0);
+    return hostMortonSpread3(X) | (hostMortonSpread3(Y) << 1) | (hostMortonSpread3(Z) << 2);
+}
+
+// Wrap a coordinate into the period [lo, lo + period)
+template <typename T1>
+inline T1 hostWrapIntoPeriod(const T1& x, const T1& lo, const T1& period) {
+    return x - period * std::floor((x - lo) / period);
+}
+
 // From a voxelID to (usually double-precision) xyz coordinate
 template <typename T1, typename T2, typename T3>
 inline void hostVoxelIDToPosition(T1& X,
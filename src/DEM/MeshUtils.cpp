@@ -28,19 +28,24 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <algorithm>
+#include <cctype>
 #include <cstdio>
+#include <cstring>
+#include <exception>
+#include <filesystem>
 #include <fstream>
+#include <functional>
 #include <map>
+#include <thread>
 #include <unordered_map>
 
 #include <nvmath/helper_math.cuh>
 #include <DEM/BdrsAndObjs.h>
-#include <core/utils/WavefrontMeshLoader.hpp>
+#include <core/utils/MappedFile.hpp>
+#include <DEM/utils/WavefrontObj.hpp>
 
 namespace deme {
 
-using namespace WAVEFRONT;
-
 std::vector<std::vector<float>> DEMMeshConnected::GetCoordsVerticesAsVectorOfVectors() {
     auto vec = GetCoordsVertices();
     std::vector<std::vector<float>> res(vec.size());
@@ -59,64 +64,157 @@ std::vector<std::vector<int>> DEMMeshConnected::GetIndicesVertexesAsVectorOfVect
     return res;
 }
 
-bool DEMMeshConnected::LoadWavefrontMesh(std::string input_file, bool load_normals, bool load_uv) {
+bool DEMMeshConnected::useLoadCache = false;
+
+namespace {
+
+const char MESH_CACHE_MAGIC[8] = {'D', 'E', 'M', 'E', 'M', 'S', 'H', '\0'};
+const uint32_t MESH_CACHE_VERSION = 1;
+
+uint64_t hashMeshFileContent(const char* data, size_t size) {
+    // FNV-1a, over 8-byte words for speed
+    uint64_t h = 14695981039346656037ULL;
+    size_t n_words = size / 8;
+    for (size_t i = 0; i < n_words; i++) {
+        uint64_t word;
+        std::memcpy(&word, data + i * 8, 8);
+        h ^= word;
+        h *= 1099511628211ULL;
+    }
+    for (size_t i = n_words * 8; i < size; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+template <typename T>
+void appendToCache(std::string& buf, const std::vector<T>& vec) {
+    buf.append(reinterpret_cast<const char*>(vec.data()), vec.size() * sizeof(T));
+}
+
+template <typename T>
+bool readFromCache(const std::string& buf, size_t& pos, size_t n, std::vector<T>& vec) {
+    if (pos + n * sizeof(T) > buf.size()) {
+        return false;
+    }
+    vec.resize(n);
+    std::memcpy(vec.data(), buf.data() + pos, n * sizeof(T));
+    pos += n * sizeof(T);
+    return true;
+}
+
+}  // namespace
+
+bool DEMMeshConnected::loadMeshCache(const std::string& cache_file, uint64_t content_hash, uint64_t content_size) {
+    std::error_code ec;
+    size_t size = std::filesystem::file_size(cache_file, ec);
+    if (ec) {
+        return false;
+    }
+    std::string buf(size, '\0');
+    {
+        std::ifstream input(cache_file, std::ios::binary);
+        if (!input.read(&buf[0], size)) {
+            return false;
+        }
+    }
+    size_t header_size = sizeof(MESH_CACHE_MAGIC) + sizeof(uint32_t) + 8 * sizeof(uint64_t);
+    if (size < header_size || std::memcmp(buf.data(), MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0) {
+        return false;
+    }
+    size_t pos = sizeof(MESH_CACHE_MAGIC);
+    uint32_t version;
+    std::memcpy(&version, buf.data() + pos, sizeof(version));
+    pos += sizeof(version);
+    uint64_t header[8];
+    std::memcpy(header, buf.data() + pos, sizeof(header));
+    pos += sizeof(header);
+    if (version != MESH_CACHE_VERSION || header[0] != content_hash || header[1] != content_size) {
+        return false;
+    }
+    return readFromCache(buf, pos, header[2], m_vertices) && readFromCache(buf, pos, header[3], m_normals) &&
+           readFromCache(buf, pos, header[4], m_UV) && readFromCache(buf, pos, header[5], m_face_v_indices) &&
+           readFromCache(buf, pos, header[6], m_face_n_indices) &&
+           readFromCache(buf, pos, header[7], m_face_uv_indices);
+}
+
+void DEMMeshConnected::writeMeshCache(const std::string& cache_file, uint64_t content_hash, uint64_t content_size) {
+    std::string buf(MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    buf.append(reinterpret_cast<const char*>(&MESH_CACHE_VERSION), sizeof(MESH_CACHE_VERSION));
+    uint64_t header[8] = {content_hash,           content_size,           m_vertices.size(),
+                          m_normals.size(),       m_UV.size(),            m_face_v_indices.size(),
+                          m_face_n_indices.size(), m_face_uv_indices.size()};
+    buf.append(reinterpret_cast<const char*>(header), sizeof(header));
+    appendToCache(buf, m_vertices);
+    appendToCache(buf, m_normals);
+    appendToCache(buf, m_UV);
+    appendToCache(buf, m_face_v_indices);
+    appendToCache(buf, m_face_n_indices);
+    appendToCache(buf, m_face_uv_indices);
+    // Write then rename, so a concurrent run never sees a half-written cache. Failing to write is not an error: the
+    // mesh directory may simply be read-only.
+    std::string tmp_file =
+        cache_file + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream output(tmp_file, std::ios::binary);
+        if (!output.write(buf.data(), buf.size())) {
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_file, cache_file, ec);
+    if (ec) {
+        std::filesystem::remove(tmp_file, ec);
+    }
+}
+
+void DEMMeshConnected::clearLoadedGeometry() {
     this->m_vertices.clear();
     this->m_normals.clear();
     this->m_UV.clear();
     this->m_face_v_indices.clear();
     this->m_face_n_indices.clear();
     this->m_face_uv_indices.clear();
+}
 
-    GeometryInterface emptybm;  // BuildMesh bm;
-
+bool DEMMeshConnected::LoadWavefrontMesh(std::string input_file, bool load_normals, bool load_uv) {
+    clearLoadedGeometry();
     filename = input_file;
 
-    OBJ obj;
+    try {
+        MappedFile file(filename);
+        const char* begin = file.data();
+        const char* end = begin + file.size();
 
-    int ret = obj.LoadMesh(filename.c_str(), &emptybm, true);
-    if (ret == -1) {
-        std::cerr << "Error loading OBJ file " << filename << std::endl;
-        return false;
-    }
+        uint64_t content_hash = 0;
+        std::string cache_file = filename + ".demecache";
+        bool loaded = false;
+        if (useLoadCache) {
+            content_hash = hashMeshFileContent(begin, file.size());
+            loaded = loadMeshCache(cache_file, content_hash, file.size());
+            if (!loaded) {
+                clearLoadedGeometry();
+            }
+        }
 
-    float3 tmp_f3;
-    int3 tmp_i3;
-    for (unsigned int iv = 0; iv < obj.mVerts.size(); iv += 3) {
-        tmp_f3.x = obj.mVerts[iv];
-        tmp_f3.y = obj.mVerts[iv + 1];
-        tmp_f3.z = obj.mVerts[iv + 2];
-        this->m_vertices.push_back(tmp_f3);
-    }
-    for (unsigned int in = 0; in < obj.mNormals.size(); in += 3) {
-        tmp_f3.x = obj.mNormals[in];
-        tmp_f3.y = obj.mNormals[in + 1];
-        tmp_f3.z = obj.mNormals[in + 2];
-        this->m_normals.push_back(tmp_f3);
-    }
-    for (unsigned int it = 0; it < obj.mTexels.size(); it += 2)  // +2 because only u,v each texel
-    {
-        tmp_f3.x = obj.mTexels[it];
-        tmp_f3.y = obj.mTexels[it + 1];
-        tmp_f3.z = 0;
-        this->m_UV.push_back(tmp_f3);
-    }
-    for (unsigned int iiv = 0; iiv < obj.mIndexesVerts.size(); iiv += 3) {
-        tmp_i3.x = obj.mIndexesVerts[iiv];
-        tmp_i3.y = obj.mIndexesVerts[iiv + 1];
-        tmp_i3.z = obj.mIndexesVerts[iiv + 2];
-        this->m_face_v_indices.push_back(tmp_i3);
-    }
-    for (unsigned int iin = 0; iin < obj.mIndexesNormals.size(); iin += 3) {
-        tmp_i3.x = obj.mIndexesNormals[iin];
-        tmp_i3.y = obj.mIndexesNormals[iin + 1];
-        tmp_i3.z = obj.mIndexesNormals[iin + 2];
-        this->m_face_n_indices.push_back(tmp_i3);
-    }
-    for (unsigned int iit = 0; iit < obj.mIndexesTexels.size(); iit += 3) {
-        tmp_i3.x = obj.mIndexesTexels[iit];
-        tmp_i3.y = obj.mIndexesTexels[iit + 1];
-        tmp_i3.z = obj.mIndexesTexels[iit + 2];
-        this->m_face_uv_indices.push_back(tmp_i3);
+        if (!loaded) {
+            ObjGeometry geo = ParseWavefrontObj(begin, end);
+            m_vertices = std::move(geo.vertices);
+            m_normals = std::move(geo.normals);
+            m_UV = std::move(geo.uv);
+            m_face_v_indices = std::move(geo.face_v_indices);
+            m_face_n_indices = std::move(geo.face_n_indices);
+            m_face_uv_indices = std::move(geo.face_uv_indices);
+
+            if (useLoadCache) {
+                writeMeshCache(cache_file, content_hash, file.size());
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error loading OBJ file " << filename << ": " << e.what() << std::endl;
+        clearLoadedGeometry();
+        return false;
     }
 
     if (!load_normals) {
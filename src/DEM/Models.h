@@ -209,6 +209,19 @@ inline std::string VEL_TO_PASS_ON_CENTERED_DIFF() {
     return read_file_to_string(sourcefile);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Sleeping policies
+////////////////////////////////////////////////////////////////////////////////
+
+inline std::string SLEEPER_WAKE_UP_STRAT() {
+    std::filesystem::path sourcefile =
+        RuntimeDataHelper::data_path / "kernel" / "DEMCustomizablePolicies" / "SleeperWakeUpStrat.cu";
+    if (!std::filesystem::exists(sourcefile)) {
+        DEME_ERROR("A strategy file %s is not found.", sourcefile.string().c_str());
+    }
+    return read_file_to_string(sourcefile);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Ingredient definition and acquisition module in DEM force models
 ////////////////////////////////////////////////////////////////////////////////
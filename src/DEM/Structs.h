@@ -8,11 +8,14 @@
 
 #include <DEM/Defines.h>
 #include <core/utils/ManagedAllocator.hpp>
+#include <core/utils/AllocatorPolicy.hpp>
 #include <core/utils/ManagedMemory.hpp>
 #include <core/utils/csv.hpp>
 #include <core/utils/GpuError.h>
 #include <core/utils/Timer.hpp>
 #include <core/utils/RuntimeData.h>
+#include <core/utils/ScratchArena.hpp>
+#include <DEM/utils/ClumpCsv.hpp>
 
 #include <sstream>
 #include <exception>
@@ -33,21 +36,6 @@ namespace deme {
 // =============================================================================
 
 const std::string DEME_NUM_CLUMP_NAME = std::string("NULL");
-const std::string OUTPUT_FILE_X_COL_NAME = std::string("X");
-const std::string OUTPUT_FILE_Y_COL_NAME = std::string("Y");
-const std::string OUTPUT_FILE_Z_COL_NAME = std::string("Z");
-const std::string OUTPUT_FILE_R_COL_NAME = std::string("r");
-const std::string OUTPUT_FILE_QW_COL_NAME = std::string("Qw");
-const std::string OUTPUT_FILE_QX_COL_NAME = std::string("Qx");
-const std::string OUTPUT_FILE_QY_COL_NAME = std::string("Qy");
-const std::string OUTPUT_FILE_QZ_COL_NAME = std::string("Qz");
-const std::string OUTPUT_FILE_VEL_X_COL_NAME = std::string("v_x");
-const std::string OUTPUT_FILE_VEL_Y_COL_NAME = std::string("v_y");
-const std::string OUTPUT_FILE_VEL_Z_COL_NAME = std::string("v_z");
-const std::string OUTPUT_FILE_ANGVEL_X_COL_NAME = std::string("w_x");
-const std::string OUTPUT_FILE_ANGVEL_Y_COL_NAME = std::string("w_y");
-const std::string OUTPUT_FILE_ANGVEL_Z_COL_NAME = std::string("w_z");
-const std::string OUTPUT_FILE_CLUMP_TYPE_NAME = std::string("clump_type");
 const std::filesystem::path USER_SCRIPT_PATH = RuntimeDataHelper::data_path / "kernel" / "DEMUserScripts";
 // Column names for contact pair output file
 const std::string OUTPUT_FILE_OWNER_1_NAME = std::string("A");
@@ -105,24 +93,26 @@ const std::unordered_map<std::string, bool> force_kernel_ingredient_stats = {
 /// also contains space allocated as system scratch pad and as thread temporary arrays.
 /// </summary>
 class DEMSolverStateData {
+  public:
+    using TempArena = ScratchArena<DEMEAllocator<scratch_t>>;
+
   private:
-    const unsigned int numTempArrays;
     // The vector used by CUB or by anybody else that needs scratch space.
     // Please pay attention to the type the vector stores.
-    std::vector<scratch_t, ManagedAllocator<scratch_t>> cubScratchSpace;
+    std::vector<scratch_t, DEMEAllocator<scratch_t>> cubScratchSpace;
 
-    // The vectors used by threads when they need temporary arrays (very typically, for storing arrays outputted by cub
-    // scan or reduce operations).
-    std::vector<std::vector<scratch_t, ManagedAllocator<scratch_t>>,
-                ManagedAllocator<std::vector<scratch_t, ManagedAllocator<scratch_t>>>>
-        threadTempVectors;
-    // You can keep more temp arrays if you construct this class with a different initializer
+    // The arena threads take their temporary arrays from (very typically, for storing arrays outputted by cub scan or
+    // reduce operations). Temp arrays only live within the scope of the phase that asked for them.
+    TempArena tempArena;
+    // Arrays whose content has to survive from one call to the next (such as cached owner IDs of contacts), by name
+    std::unordered_map<std::string, std::vector<scratch_t, DEMEAllocator<scratch_t>>> retainedVectors;
 
   public:
     // Temp size_t variables that can be reused
     size_t* pTempSizeVar1;
     size_t* pTempSizeVar2;
     size_t* pTempSizeVar3;
+    size_t* pTempSizeVar4;
 
     // Number of contacts in this CD step
     size_t* pNumContacts;
@@ -131,31 +121,29 @@ class DEMSolverStateData {
     // Number of spheres in the previous CD step (in case user added/removed clumps from the system)
     size_t* pNumPrevSpheres;
 
-    DEMSolverStateData(unsigned int nArrays) : numTempArrays(nArrays) {
+    DEMSolverStateData() {
         DEME_GPU_CALL(cudaMallocManaged(&pNumContacts, sizeof(size_t)));
         DEME_GPU_CALL(cudaMallocManaged(&pTempSizeVar1, sizeof(size_t)));
         DEME_GPU_CALL(cudaMallocManaged(&pTempSizeVar2, sizeof(size_t)));
         DEME_GPU_CALL(cudaMallocManaged(&pTempSizeVar3, sizeof(size_t)));
+        DEME_GPU_CALL(cudaMallocManaged(&pTempSizeVar4, sizeof(size_t)));
         DEME_GPU_CALL(cudaMallocManaged(&pNumPrevContacts, sizeof(size_t)));
         DEME_GPU_CALL(cudaMallocManaged(&pNumPrevSpheres, sizeof(size_t)));
         *pNumContacts = 0;
         *pNumPrevContacts = 0;
         *pNumPrevSpheres = 0;
-        threadTempVectors.resize(numTempArrays);
     }
     ~DEMSolverStateData() {
         DEME_GPU_CALL(cudaFree(pNumContacts));
         DEME_GPU_CALL(cudaFree(pTempSizeVar1));
         DEME_GPU_CALL(cudaFree(pTempSizeVar2));
         DEME_GPU_CALL(cudaFree(pTempSizeVar3));
+        DEME_GPU_CALL(cudaFree(pTempSizeVar4));
         DEME_GPU_CALL(cudaFree(pNumPrevContacts));
         DEME_GPU_CALL(cudaFree(pNumPrevSpheres));
 
         cubScratchSpace.clear();
-        for (unsigned int i = 0; i < numTempArrays; i++) {
-            threadTempVectors.at(i).clear();
-        }
-        threadTempVectors.clear();
+        retainedVectors.clear();
     }
 
     // Return raw pointer to swath of device memory that is at least "sizeNeeded" large
@@ -166,12 +154,29 @@ class DEMSolverStateData {
         return cubScratchSpace.data();
     }
 
-    inline scratch_t* allocateTempVector(unsigned int i, size_t sizeNeeded) {
-        if (threadTempVectors.at(i).size() < sizeNeeded) {
-            threadTempVectors.at(i).resize(sizeNeeded);
+    // Open a scope for temp arrays: those allocated in it are released when it ends. Peak usage is reported by phase.
+    inline TempArena::Scope tempScope(const std::string& phase) { return TempArena::Scope(tempArena, phase); }
+
+    // Return a temp array of at least "sizeNeeded" bytes, which lives until releaseTemp or the end of the scope
+    inline scratch_t* allocateTemp(const std::string& name, size_t sizeNeeded) {
+        return tempArena.Allocate(name, sizeNeeded);
+    }
+    inline void releaseTemp(const void* ptr) { tempArena.Release(ptr); }
+
+    // Return an array of at least "sizeNeeded" bytes whose content is kept between calls (unless it has to grow)
+    inline scratch_t* allocateRetained(const std::string& name, size_t sizeNeeded) {
+        auto& vec = retainedVectors[name];
+        if (vec.size() < sizeNeeded) {
+            vec.resize(sizeNeeded);
         }
-        return threadTempVectors.at(i).data();
+        return vec.data();
     }
+
+    // Check temp arrays for overlaps and reuse of released memory (slow, for debugging)
+    void setTempDebug(bool debug) { tempArena.SetDebug(debug); }
+    const std::map<std::string, TempArena::PhaseStats>& getTempPhaseStats() const { return tempArena.GetPhaseStats(); }
+    void clearTempPhaseStats() { tempArena.ClearPhaseStats(); }
+    size_t getTempCapacity() const { return tempArena.GetCapacity(); }
 };
 
 struct kTStateParams {
@@ -194,11 +199,28 @@ struct kTStateParams {
     size_t maxSphFoundInBin;
     size_t maxTriFoundInBin;
 
-    // Num of bins, currently
+    // Num of bins (of all bin levels), currently
     size_t numBins = 0;
+    // With hierarchical binning, the largest sphere radius that the number of bin levels caters to; 0 if not in use
+    double binLevelRadius = 0.;
+    // Num of mesh facets whose contacts are found via mesh BVHs rather than binning
+    size_t nTriInMeshBVHs = 0;
 
     // Current average num of contacts per sphere has.
     float avgCntsPerSphere = 0.;
+
+    // Contact arrays are never cut back to shorter than this (the user-instructed number of contacts, or the estimate
+    // made at initialization)
+    size_t cntArrMinLength = 0;
+};
+
+// The capacities the user instructed the solver to reserve up front (see DEMSolver::InstructNumOwners and friends), so
+// that worker arrays are not reallocated as the simulation grows into them. 0 means no reservation.
+struct ArrayReservation {
+    size_t nOwners = 0;
+    size_t nSpheres = 0;
+    size_t nTriangles = 0;
+    size_t nContacts = 0;
 };
 
 inline std::string pretty_format_bytes(size_t bytes) {
@@ -330,46 +352,80 @@ enum class ADAPT_TS_TYPE { NONE, MAX_VEL, INT_DIFF };
         }                                         \
     }
 
-// Jitify options include suppressing variable-not-used warnings. We could use CUDA lib functions too.
-#define DEME_JITIFY_OPTIONS                                                                           \
-    {                                                                                                 \
-        "-I" + (JitHelper::KERNEL_INCLUDE_DIR).string(), "-I" + (JitHelper::KERNEL_DIR).string(),     \
-            "-I" + std::string(DEME_CUDA_TOOLKIT_HEADERS), "-diag-suppress=550", "-diag-suppress=177" \
+// Jitify options include suppressing variable-not-used warnings. We could use CUDA lib functions too. The kernels also
+// need to agree with the host on the precision policy.
+#define DEME_JITIFY_OPTIONS                                                                            \
+    {                                                                                                  \
+        "-I" + (JitHelper::KERNEL_INCLUDE_DIR).string(), "-I" + (JitHelper::KERNEL_DIR).string(),      \
+            "-I" + std::string(DEME_CUDA_TOOLKIT_HEADERS), "-diag-suppress=550", "-diag-suppress=177", \
+            std::string("-DDEME_PRECISION_" DEME_PRECISION_POLICY_NAME)                                \
     }
 
+// The tracked-resize macros below add to m_approx_bytes_used the change in the memory a vector holds (its capacity), so
+// reserved but unused room is counted too.
 // I wasn't able to resolve a decltype problem with vector of vectors, so I have to create another macro for this kind
 // of tracked resize... not ideal.
-#define DEME_TRACKED_RESIZE_FLOAT(vec, newsize, val)               \
-    {                                                              \
-        size_t old_size = vec.size();                              \
-        vec.resize(newsize, val);                                  \
-        size_t new_size = vec.size();                              \
-        size_t byte_delta = sizeof(float) * (new_size - old_size); \
-        m_approx_bytes_used += byte_delta;                         \
+#define DEME_TRACKED_RESIZE_FLOAT(vec, newsize, val)                         \
+    {                                                                        \
+        size_t old_capacity = vec.capacity();                                \
+        vec.resize(newsize, val);                                            \
+        size_t byte_delta = sizeof(float) * (vec.capacity() - old_capacity); \
+        m_approx_bytes_used += byte_delta;                                   \
     }
 
-#define DEME_TRACKED_RESIZE(vec, newsize, val)                 \
-    {                                                          \
-        size_t item_size = sizeof(decltype(vec)::value_type);  \
-        size_t old_size = vec.size();                          \
-        vec.resize(newsize, val);                              \
-        size_t new_size = vec.size();                          \
-        size_t byte_delta = item_size * (new_size - old_size); \
-        m_approx_bytes_used += byte_delta;                     \
+#define DEME_TRACKED_RESIZE(vec, newsize, val)                           \
+    {                                                                    \
+        size_t item_size = sizeof(decltype(vec)::value_type);            \
+        size_t old_capacity = vec.capacity();                            \
+        vec.resize(newsize, val);                                        \
+        size_t byte_delta = item_size * (vec.capacity() - old_capacity); \
+        m_approx_bytes_used += byte_delta;                               \
     }
 
 #define DEME_TRACKED_RESIZE_DEBUGPRINT(vec, newsize, name, val)                                                      \
     {                                                                                                                \
         size_t item_size = sizeof(decltype(vec)::value_type);                                                        \
         size_t old_size = vec.size();                                                                                \
+        size_t old_capacity = vec.capacity();                                                                        \
         vec.resize(newsize, val);                                                                                    \
         size_t new_size = vec.size();                                                                                \
-        size_t byte_delta = item_size * (new_size - old_size);                                                       \
+        size_t byte_delta = item_size * (vec.capacity() - old_capacity);                                             \
         m_approx_bytes_used += byte_delta;                                                                           \
         DEME_DEBUG_PRINTF("Resizing vector %s, old size %zu, new size %zu, byte delta %s", name, old_size, new_size, \
                           pretty_format_bytes(byte_delta).c_str());                                                  \
     }
 
+// Compact a vector according to a keep-flag array (see hostCompactByFlags) and track the memory it frees
+#define DEME_TRACKED_COMPACT(vec, flags, min_size)                       \
+    {                                                                    \
+        size_t item_size = sizeof(vec[0]);                               \
+        size_t old_capacity = vec.capacity();                            \
+        hostCompactByFlags(vec, flags, min_size);                        \
+        size_t byte_delta = item_size * (vec.capacity() - old_capacity); \
+        m_approx_bytes_used += byte_delta;                               \
+    }
+
+// Resize a vector to exactly the new length, capacity included (see hostResizeExact), and track the memory change
+#define DEME_TRACKED_RESIZE_EXACT(vec, newsize, val) \
+    { m_approx_bytes_used += hostResizeExact(vec, newsize, val); }
+
+// Decide the new length of a contact-event array that needs to hold n_needed elements and is n_current long now. It
+// grows geometrically, so a slowly rising contact number does not reallocate it over and over; and if can_shrink, it is
+// cut back once it is more than DEME_CNT_ARR_SHRINK_THRESHOLD times longer than needed. It is never made shorter than
+// n_min. If the returned length equals n_current, nothing needs to be done.
+inline size_t decideCntArrLength(size_t n_needed, size_t n_current, size_t n_min, bool can_shrink) {
+    size_t n_floor = DEME_MAX(n_needed, n_min);
+    if (n_needed > n_current) {
+        size_t n_grown = (size_t)((double)n_current * DEME_CNT_ARR_GROWTH_FACTOR);
+        return DEME_MAX(n_grown, n_floor);
+    }
+    if (can_shrink && n_current > DEME_CNT_ARR_SHRINK_THRESHOLD * n_floor) {
+        size_t n_target = (size_t)((double)n_needed * DEME_CNT_ARR_GROWTH_FACTOR);
+        return DEME_MAX(n_target, n_min);
+    }
+    return n_current;
+}
+
 //// TODO: this is currently not tracked...
 // ptr being a reference to a pointer is crucial
 template <typename T>
@@ -430,6 +486,38 @@ class SolverTimers {
         }
     }
     Timer<double>& GetTimer(const std::string& name) { return m_timers.at(name); }
+
+    // Timeline tracing: timer spans and marked events go to this lane, if one is attached
+    TraceLane* traceLane = nullptr;
+    void AttachTraceLane(TraceLane* lane) {
+        traceLane = lane;
+        for (auto& timer : m_timers) {
+            timer.second.SetTraceLane(lane, timer.first.c_str());
+        }
+    }
+    // Record an instant event, such as a buffer hand-off between threads
+    void MarkEvent(const char* name) {
+        if (traceLane) {
+            traceLane->RecordInstant(name);
+        }
+    }
+
+    // Sleeping owner statistics, sampled each time dT sends an update to kT
+    size_t nSleepSamples = 0;
+    double sleepingOwnerSum = 0;
+    double ownerSum = 0;
+    void AddSleepSample(size_t nSleeping, size_t nOwners) {
+        nSleepSamples++;
+        sleepingOwnerSum += (double)nSleeping;
+        ownerSum += (double)nOwners;
+    }
+    // Average fraction of owners that were sleeping over all samples
+    double GetAvgSleepingFraction() const { return (ownerSum > 0.) ? sleepingOwnerSum / ownerSum : 0.; }
+    void ResetSleepStats() {
+        nSleepSamples = 0;
+        sleepingOwnerSum = 0;
+        ownerSum = 0;
+    }
 };
 
 // Manager of the collabortation between the main thread and worker threads
@@ -492,6 +580,30 @@ struct familyPair_t {
     unsigned int ID2;
 };
 
+// Outcome of deciding which entities a PurgeFamily call removes. Each map translates an old ID into the ID it has after
+// compaction, or NULL_BODYID if that entity is removed. The maps are monotonic, so the survivors keep their order.
+struct EntityPurgeMap {
+    std::vector<bodyID_t> ownerMap;
+    std::vector<bodyID_t> sphereMap;
+    std::vector<bodyID_t> triMap;
+    // Entity numbers after the purge
+    size_t nOwnerBodies = 0;
+    size_t nOwnerClumps = 0;
+    size_t nTriMeshes = 0;
+    size_t nSpheresGM = 0;
+    size_t nTriGM = 0;
+};
+
+// Outcome of deciding how a ReorderEntities call permutes clumps and their sphere components. The orders list, for each
+// new ID, the old ID that moves there; the maps are their inverses. Only clumps move, and only among the owner slots
+// clumps already occupy, so mesh and analytical owners (and triangles) keep their IDs.
+struct EntityReorderMap {
+    std::vector<bodyID_t> ownerOrder;
+    std::vector<bodyID_t> ownerMap;
+    std::vector<bodyID_t> sphereOrder;
+    std::vector<bodyID_t> sphereMap;
+};
+
 enum class VAR_TS_STRAT { DEME_CONST, MAX_VEL, INT_GAP };
 
 class ClumpTemplateFlatten {
@@ -527,8 +639,13 @@ struct SolverFlags {
     bool isAsync = true;
     // If family number can potentially change (at each time step) during the simulation, because of user intervention
     bool canFamilyChange = false;
+    // If quiet clumps can fall asleep (skipping their integration)
+    bool useSleeping = false;
     // If mesh will deform in the next kT-update cycle
     std::atomic<bool> willMeshDeform = false;
+    // If the receiving thread takes in transferred arrays by swapping them with its working arrays, rather than
+    // copying (only when kT and dT share a device)
+    bool useBufferSwap = false;
     // Some output-related flags
     unsigned int outputFlags = OUTPUT_CONTENT::QUAT | OUTPUT_CONTENT::ABSV;
     unsigned int cntOutFlags;
@@ -537,6 +654,10 @@ struct SolverFlags {
     bool isExpandFactorFixed = false;
     // The strategy for selecting the variable time step size
     VAR_TS_STRAT stepSizeStrat = VAR_TS_STRAT::DEME_CONST;
+    // Variable step size bounds, and the per-step position change (or integration difference) that it allows
+    float minStepSize = 0.;
+    float maxStepSize = DEME_HUGE_FLOAT;
+    float stepSizeTolerance = 0.;
     // Whether instructed to use jitification for mass properties and clump components (default to no and it is
     // recommended)
     bool useClumpJitify = false;
@@ -987,6 +1108,14 @@ class DEMTrackedObj : public DEMInitializer {
     // The number of geometric entities (sphere components, triangles or analytical components) the tracked objects
     // have.
     size_t nGeos;
+    // After the solver reorders clumps for memory locality, the owners (and sphere components) tracked by this object
+    // are no longer consecutive. Then these hold their current IDs, by offset; if empty, the IDs are still ownerID +
+    // offset and geoID + offset.
+    std::vector<bodyID_t> ownerIDs;
+    std::vector<bodyID_t> geoIDs;
+
+    bodyID_t OwnerAt(size_t offset) const { return ownerIDs.empty() ? ownerID + offset : ownerIDs.at(offset); }
+    size_t GeoAt(size_t offset) const { return geoIDs.empty() ? geoID + offset : geoIDs.at(offset); }
 };
 
 }  // namespace deme
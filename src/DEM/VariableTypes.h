@@ -8,7 +8,32 @@
 
 namespace deme {
 
-typedef uint16_t subVoxelPos_t;  ///< uint16 or uint32
+// Precision policy, chosen at configure time via the DEME_PRECISION_POLICY CMake cache variable (jitified kernels get
+// the same choice through the jitify options). It sets the sub-voxel resolution that positions are stored at, and the
+// coordinate type contact detection works in, which also sizes the shared-memory sphere batches of the CD kernels.
+//   FAST: single precision in contact detection, 16-bit sub-voxel positions
+//   MIXED (default): double-precision coordinates and single-precision normals in contact detection, 16-bit sub-voxel
+//   positions
+//   ACCURATE: double precision in contact detection, 32-bit sub-voxel positions
+#if defined(DEME_PRECISION_FAST)
+#define DEME_PRECISION_POLICY_NAME "FAST"
+typedef uint16_t subVoxelPos_t;
+typedef float cdPos_t;     ///< Coordinate type in contact detection
+typedef float3 cdPos3_t;   ///< Coordinate vector type in contact detection
+typedef float cdNormal_t;  ///< Contact normal type in contact detection
+#elif defined(DEME_PRECISION_ACCURATE)
+#define DEME_PRECISION_POLICY_NAME "ACCURATE"
+typedef uint32_t subVoxelPos_t;
+typedef double cdPos_t;
+typedef double3 cdPos3_t;
+typedef double cdNormal_t;
+#else
+#define DEME_PRECISION_POLICY_NAME "MIXED"
+typedef uint16_t subVoxelPos_t;
+typedef double cdPos_t;
+typedef double3 cdPos3_t;
+typedef float cdNormal_t;
+#endif
 
 typedef uint64_t voxelID_t;
 typedef float oriQ_t;
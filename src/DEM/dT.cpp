@@ -7,6 +7,9 @@
 #include <iostream>
 #include <thread>
 #include <algorithm>
+#include <numeric>
+#include <queue>
+#include <functional>
 
 #ifdef DEME_USE_CHPF
     #include <chpf.hpp>
@@ -50,16 +53,18 @@ void DEMDynamicThread::packDataPointers() {
     granData->alphaZ = alphaZ.data();
     granData->accSpecified = accSpecified.data();
     granData->angAccSpecified = angAccSpecified.data();
+    granData->ownerSleeping = ownerSleeping.data();
+    granData->ownerQuietSteps = ownerQuietSteps.data();
     granData->idGeometryA = idGeometryA.data();
     granData->idGeometryB = idGeometryB.data();
     granData->contactType = contactType.data();
     granData->familyMasks = familyMaskMatrix.data();
     granData->familyExtraMarginSize = familyExtraMarginSize.data();
 
-    // granData->idGeometryA_buffer = idGeometryA_buffer.data();
-    // granData->idGeometryB_buffer = idGeometryB_buffer.data();
-    // granData->contactType_buffer = contactType_buffer.data();
-    // granData->contactMapping_buffer = contactMapping_buffer.data();
+    granData->idGeometryA_buffer = idGeometryA_buffer.data();
+    granData->idGeometryB_buffer = idGeometryB_buffer.data();
+    granData->contactType_buffer = contactType_buffer.data();
+    granData->contactMapping_buffer = contactMapping_buffer.data();
 
     granData->contactForces = contactForces.data();
     granData->contactTorque_convToForce = contactTorque_convToForce.data();
@@ -130,6 +135,414 @@ void DEMDynamicThread::changeFamily(unsigned int ID_from, unsigned int ID_to) {
         familyID.begin(), familyID.end(), [ID_from_impl](family_t& i) { return i == ID_from_impl; }, ID_to_impl);
 }
 
+void DEMDynamicThread::purgeEntities(const EntityPurgeMap& purge) {
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    // If kT left a produce that dT has not consumed, take it now, so the contact arrays we compact are the newest
+    ifProduceFreshThenUseIt();
+    ownerContactIndexStale = true;
+
+    std::vector<notStupidBool_t> ownerKeep(purge.ownerMap.size()), sphereKeep(purge.sphereMap.size()),
+        triKeep(purge.triMap.size());
+    for (size_t i = 0; i < ownerKeep.size(); i++)
+        ownerKeep[i] = (purge.ownerMap[i] != NULL_BODYID);
+    for (size_t i = 0; i < sphereKeep.size(); i++)
+        sphereKeep[i] = (purge.sphereMap[i] != NULL_BODYID);
+    for (size_t i = 0; i < triKeep.size(); i++)
+        triKeep[i] = (purge.triMap[i] != NULL_BODYID);
+
+    // A contact survives if both of its geometries survive; idA is always a sphere, and analytical components are never
+    // purged. Surviving contacts get their geometry IDs translated right away.
+    size_t nContacts = *stateOfSolver_resources.pNumContacts;
+    std::vector<notStupidBool_t> contactKeep(nContacts);
+    size_t nContactsLeft = 0;
+    for (size_t i = 0; i < nContacts; i++) {
+        bodyID_t newA = purge.sphereMap.at(idGeometryA[i]);
+        bodyID_t newB;
+        switch (contactType[i]) {
+            case SPHERE_SPHERE_CONTACT:
+                newB = purge.sphereMap.at(idGeometryB[i]);
+                break;
+            case SPHERE_MESH_CONTACT:
+                newB = purge.triMap.at(idGeometryB[i]);
+                break;
+            default:
+                newB = idGeometryB[i];
+        }
+        contactKeep[i] = (newA != NULL_BODYID && newB != NULL_BODYID);
+        if (contactKeep[i]) {
+            idGeometryA[i] = newA;
+            idGeometryB[i] = newB;
+            nContactsLeft++;
+        }
+    }
+
+    // Geometries need to know their new owners before being compacted
+    for (size_t i = 0; i < sphereKeep.size(); i++) {
+        if (sphereKeep[i])
+            ownerClumpBody[i] = purge.ownerMap[ownerClumpBody[i]];
+    }
+    for (size_t i = 0; i < triKeep.size(); i++) {
+        if (triKeep[i])
+            ownerMesh[i] = purge.ownerMap[ownerMesh[i]];
+    }
+    for (auto& owner : ownerAnalBody) {
+        owner = purge.ownerMap.at(owner);
+    }
+
+    // Per-owner arrays
+    DEME_TRACKED_COMPACT(familyID, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(voxelID, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(locX, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(locY, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(locZ, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(oriQw, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(oriQx, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(oriQy, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(oriQz, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(vX, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(vY, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(vZ, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(omgBarX, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(omgBarY, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(omgBarZ, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(aX, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(aY, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(aZ, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(alphaX, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(alphaY, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(alphaZ, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(accSpecified, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(angAccSpecified, ownerKeep, 0);
+    if (solverFlags.useSleeping) {
+        DEME_TRACKED_COMPACT(ownerSleeping, ownerKeep, 0);
+        DEME_TRACKED_COMPACT(ownerQuietSteps, ownerKeep, 0);
+    }
+    DEME_TRACKED_COMPACT(ownerTypes, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(inertiaPropOffsets, ownerKeep, 0);
+    if (!solverFlags.useMassJitify) {
+        DEME_TRACKED_COMPACT(massOwnerBody, ownerKeep, 0);
+        DEME_TRACKED_COMPACT(mmiXX, ownerKeep, 0);
+        DEME_TRACKED_COMPACT(mmiYY, ownerKeep, 0);
+        DEME_TRACKED_COMPACT(mmiZZ, ownerKeep, 0);
+    }
+
+    // Per-sphere arrays
+    DEME_TRACKED_COMPACT(ownerClumpBody, sphereKeep, 0);
+    DEME_TRACKED_COMPACT(sphereMaterialOffset, sphereKeep, 0);
+    if (solverFlags.useClumpJitify) {
+        DEME_TRACKED_COMPACT(clumpComponentOffset, sphereKeep, 0);
+        DEME_TRACKED_COMPACT(clumpComponentOffsetExt, sphereKeep, 0);
+    } else {
+        DEME_TRACKED_COMPACT(radiiSphere, sphereKeep, 0);
+        DEME_TRACKED_COMPACT(relPosSphereX, sphereKeep, 0);
+        DEME_TRACKED_COMPACT(relPosSphereY, sphereKeep, 0);
+        DEME_TRACKED_COMPACT(relPosSphereZ, sphereKeep, 0);
+    }
+
+    // Per-triangle arrays
+    DEME_TRACKED_COMPACT(ownerMesh, triKeep, 0);
+    DEME_TRACKED_COMPACT(relPosNode1, triKeep, 0);
+    DEME_TRACKED_COMPACT(relPosNode2, triKeep, 0);
+    DEME_TRACKED_COMPACT(relPosNode3, triKeep, 0);
+    DEME_TRACKED_COMPACT(triMaterialOffset, triKeep, 0);
+
+    // Wildcards
+    for (unsigned int i = 0; i < simParams->nOwnerWildcards; i++) {
+        DEME_TRACKED_COMPACT(ownerWildcards[i], ownerKeep, 0);
+    }
+    for (unsigned int i = 0; i < simParams->nGeoWildcards; i++) {
+        DEME_TRACKED_COMPACT(sphereWildcards[i], sphereKeep, 0);
+        DEME_TRACKED_COMPACT(triWildcards[i], triKeep, 0);
+    }
+
+    // Contact arrays. Like at initialization, they are kept at least nSpheresGM * DEME_INIT_CNT_MULTIPLIER long (or as
+    // long as the number of contacts the user instructed).
+    {
+        cntArrMinLength = DEME_MAX(arrayReservation.nContacts, purge.nSpheresGM * DEME_INIT_CNT_MULTIPLIER);
+        size_t cnt_arr_size = cntArrMinLength;
+        DEME_TRACKED_COMPACT(idGeometryA, contactKeep, cnt_arr_size);
+        DEME_TRACKED_COMPACT(idGeometryB, contactKeep, cnt_arr_size);
+        DEME_TRACKED_COMPACT(contactType, contactKeep, cnt_arr_size);
+        if (!solverFlags.useNoContactRecord) {
+            DEME_TRACKED_COMPACT(contactForces, contactKeep, cnt_arr_size);
+            DEME_TRACKED_COMPACT(contactTorque_convToForce, contactKeep, cnt_arr_size);
+            DEME_TRACKED_COMPACT(contactPointGeometryA, contactKeep, cnt_arr_size);
+            DEME_TRACKED_COMPACT(contactPointGeometryB, contactKeep, cnt_arr_size);
+        }
+        for (unsigned int i = 0; i < simParams->nContactWildcards; i++) {
+            DEME_TRACKED_COMPACT(contactWildcards[i], contactKeep, cnt_arr_size);
+        }
+    }
+    *stateOfSolver_resources.pNumContacts = nContactsLeft;
+    // The compacted contact array is now the reference kT should map its next contact detection results against. This
+    // is the same situation as the user manually loading contacts, so we can use the same mechanism.
+    new_contacts_loaded = true;
+    contactPairArr_isFresh = true;
+
+    // The meshes that survived need their new owner numbers and positions in the mesh cache
+    {
+        std::vector<std::shared_ptr<DEMMeshConnected>> meshes_left;
+        for (auto& mmesh : m_meshes) {
+            bodyID_t new_owner = purge.ownerMap.at(mmesh->owner);
+            if (new_owner != NULL_BODYID) {
+                mmesh->owner = new_owner;
+                mmesh->cache_offset = meshes_left.size();
+                meshes_left.push_back(mmesh);
+            }
+        }
+        m_meshes = std::move(meshes_left);
+    }
+
+    simParams->nOwnerBodies = purge.nOwnerBodies;
+    simParams->nOwnerClumps = purge.nOwnerClumps;
+    simParams->nTriMeshes = purge.nTriMeshes;
+    simParams->nSpheresGM = purge.nSpheresGM;
+    simParams->nTriGM = purge.nTriGM;
+    DEME_DEBUG_PRINTF("After a purge, dT has %zu owners, %zu spheres, %zu triangles and %zu contacts",
+                      (size_t)simParams->nOwnerBodies, (size_t)simParams->nSpheresGM, (size_t)simParams->nTriGM,
+                      nContactsLeft);
+}
+
+size_t DEMDynamicThread::calcReorderMap(EntityReorderMap& reorder) {
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    // The newest contact pairs decide which sphere orders must be kept, so take kT's produce if there is one
+    ifProduceFreshThenUseIt();
+
+    const size_t nOwners = simParams->nOwnerBodies;
+    const size_t nSpheres = simParams->nSpheresGM;
+    // Clumps are permuted among the slots they already occupy. Each gets the Morton key of its voxel.
+    std::vector<bodyID_t> slots;
+    std::vector<uint64_t> keys;
+    std::vector<bodyID_t> clumpIndex(nOwners, NULL_BODYID);
+    for (size_t i = 0; i < nOwners; i++) {
+        if (ownerTypes[i] == OWNER_T_CLUMP) {
+            clumpIndex[i] = slots.size();
+            slots.push_back(i);
+            keys.push_back(hostVoxelIDToMortonKey(voxelID[i], simParams->nvXp2, simParams->nvYp2, simParams->nvZp2));
+        }
+    }
+    const size_t nClumps = slots.size();
+    // byRank[r] is the clump with the r-th smallest key; ties keep the current order
+    std::vector<size_t> byRank = hostSortIndices(keys);
+    std::vector<size_t> rank(nClumps);
+    for (size_t r = 0; r < nClumps; r++) {
+        rank[byRank[r]] = r;
+    }
+
+    // kT matches a new contact to its history by (idA, idB), and it always reports a sphere--sphere pair with the
+    // smaller sphere ID as idA. So if two clumps are in contact, the one holding the smaller sphere must stay in front,
+    // or the contact history is lost. These requirements are the edges of a graph; a topological order of it that
+    // picks the clump with the smallest key whenever there is a choice stays as close to the Morton order as allowed.
+    size_t nContacts = *stateOfSolver_resources.pNumContacts;
+    std::vector<size_t> edgeOffsets(nClumps + 1, 0);
+    std::vector<bodyID_t> edgeFrom, edgeTo;
+    for (size_t i = 0; i < nContacts; i++) {
+        if (contactType[i] != SPHERE_SPHERE_CONTACT) {
+            continue;
+        }
+        bodyID_t u = clumpIndex[ownerClumpBody[idGeometryA[i]]];
+        bodyID_t v = clumpIndex[ownerClumpBody[idGeometryB[i]]];
+        if (u == v) {
+            continue;
+        }
+        if (idGeometryA[i] > idGeometryB[i]) {
+            std::swap(u, v);
+        }
+        edgeFrom.push_back(u);
+        edgeTo.push_back(v);
+        edgeOffsets[u + 1]++;
+    }
+    std::partial_sum(edgeOffsets.begin(), edgeOffsets.end(), edgeOffsets.begin());
+    std::vector<bodyID_t> edges(edgeFrom.size());
+    std::vector<size_t> inDegree(nClumps, 0);
+    {
+        std::vector<size_t> fillPos(edgeOffsets.begin(), edgeOffsets.end() - 1);
+        for (size_t e = 0; e < edgeFrom.size(); e++) {
+            edges[fillPos[edgeFrom[e]]++] = edgeTo[e];
+            inDegree[edgeTo[e]]++;
+        }
+    }
+
+    std::vector<size_t> newSeq;
+    newSeq.reserve(nClumps);
+    std::vector<notStupidBool_t> placed(nClumps, 0);
+    std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+    for (size_t c = 0; c < nClumps; c++) {
+        if (inDegree[c] == 0) {
+            ready.push(rank[c]);
+        }
+    }
+    size_t nextRank = 0;
+    while (newSeq.size() < nClumps) {
+        size_t c;
+        if (!ready.empty()) {
+            c = byRank[ready.top()];
+            ready.pop();
+            if (placed[c]) {
+                continue;
+            }
+        } else {
+            // Only possible if the requirements form a cycle, which means the spheres were not grouped by clump. Then
+            // just take the next clump in key order; the contacts it breaks start their history afresh.
+            while (placed[byRank[nextRank]]) {
+                nextRank++;
+            }
+            c = byRank[nextRank];
+        }
+        placed[c] = 1;
+        newSeq.push_back(c);
+        for (size_t e = edgeOffsets[c]; e < edgeOffsets[c + 1]; e++) {
+            if (--inDegree[edges[e]] == 0 && !placed[edges[e]]) {
+                ready.push(rank[edges[e]]);
+            }
+        }
+    }
+
+    size_t nMoved = 0;
+    reorder.ownerOrder.resize(nOwners);
+    std::iota(reorder.ownerOrder.begin(), reorder.ownerOrder.end(), 0);
+    for (size_t k = 0; k < nClumps; k++) {
+        reorder.ownerOrder[slots[k]] = slots[newSeq[k]];
+        if (newSeq[k] != k) {
+            nMoved++;
+        }
+    }
+    if (nMoved == 0) {
+        return 0;
+    }
+    reorder.ownerMap.resize(nOwners);
+    for (size_t i = 0; i < nOwners; i++) {
+        reorder.ownerMap[reorder.ownerOrder[i]] = i;
+    }
+
+    // Spheres are regrouped following their owners' new order, and each clump keeps the order of its components
+    std::vector<size_t> sphereOffsets(nOwners + 1, 0);
+    for (size_t i = 0; i < nSpheres; i++) {
+        sphereOffsets[ownerClumpBody[i] + 1]++;
+    }
+    std::partial_sum(sphereOffsets.begin(), sphereOffsets.end(), sphereOffsets.begin());
+    std::vector<bodyID_t> spheresByOwner(nSpheres);
+    {
+        std::vector<size_t> fillPos(sphereOffsets.begin(), sphereOffsets.end() - 1);
+        for (size_t i = 0; i < nSpheres; i++) {
+            spheresByOwner[fillPos[ownerClumpBody[i]]++] = i;
+        }
+    }
+    reorder.sphereOrder.clear();
+    reorder.sphereOrder.reserve(nSpheres);
+    for (size_t i = 0; i < nOwners; i++) {
+        const bodyID_t old_owner = reorder.ownerOrder[i];
+        reorder.sphereOrder.insert(reorder.sphereOrder.end(), spheresByOwner.begin() + sphereOffsets[old_owner],
+                                   spheresByOwner.begin() + sphereOffsets[old_owner + 1]);
+    }
+    reorder.sphereMap.resize(nSpheres);
+    for (size_t i = 0; i < nSpheres; i++) {
+        reorder.sphereMap[reorder.sphereOrder[i]] = i;
+    }
+    return nMoved;
+}
+
+void DEMDynamicThread::reorderEntities(const EntityReorderMap& reorder) {
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    ownerContactIndexStale = true;
+
+    // Translate the contact pairs; triangles and analytical components keep their IDs. The map keeps the sphere order
+    // in (almost) every pair, so kT will still recognize these contacts.
+    size_t nContacts = *stateOfSolver_resources.pNumContacts;
+    for (size_t i = 0; i < nContacts; i++) {
+        idGeometryA[i] = reorder.sphereMap[idGeometryA[i]];
+        if (contactType[i] == SPHERE_SPHERE_CONTACT) {
+            idGeometryB[i] = reorder.sphereMap[idGeometryB[i]];
+        }
+    }
+    // kT expects the contact array it maps history against to be sorted by idA, and stably sorting it again keeps each
+    // contact next to its history
+    {
+        std::vector<size_t> cntOrder(nContacts);
+        std::iota(cntOrder.begin(), cntOrder.end(), 0);
+        std::stable_sort(cntOrder.begin(), cntOrder.end(),
+                         [this](size_t i1, size_t i2) { return idGeometryA[i1] < idGeometryA[i2]; });
+        hostApplyOrder(idGeometryA, cntOrder);
+        hostApplyOrder(idGeometryB, cntOrder);
+        hostApplyOrder(contactType, cntOrder);
+        if (!solverFlags.useNoContactRecord) {
+            hostApplyOrder(contactForces, cntOrder);
+            hostApplyOrder(contactTorque_convToForce, cntOrder);
+            hostApplyOrder(contactPointGeometryA, cntOrder);
+            hostApplyOrder(contactPointGeometryB, cntOrder);
+        }
+        for (unsigned int i = 0; i < simParams->nContactWildcards; i++) {
+            hostApplyOrder(contactWildcards[i], cntOrder);
+        }
+    }
+
+    for (auto& owner : ownerClumpBody) {
+        owner = reorder.ownerMap[owner];
+    }
+
+    // Per-owner arrays
+    hostApplyOrder(familyID, reorder.ownerOrder);
+    hostApplyOrder(voxelID, reorder.ownerOrder);
+    hostApplyOrder(locX, reorder.ownerOrder);
+    hostApplyOrder(locY, reorder.ownerOrder);
+    hostApplyOrder(locZ, reorder.ownerOrder);
+    hostApplyOrder(oriQw, reorder.ownerOrder);
+    hostApplyOrder(oriQx, reorder.ownerOrder);
+    hostApplyOrder(oriQy, reorder.ownerOrder);
+    hostApplyOrder(oriQz, reorder.ownerOrder);
+    hostApplyOrder(vX, reorder.ownerOrder);
+    hostApplyOrder(vY, reorder.ownerOrder);
+    hostApplyOrder(vZ, reorder.ownerOrder);
+    hostApplyOrder(omgBarX, reorder.ownerOrder);
+    hostApplyOrder(omgBarY, reorder.ownerOrder);
+    hostApplyOrder(omgBarZ, reorder.ownerOrder);
+    hostApplyOrder(aX, reorder.ownerOrder);
+    hostApplyOrder(aY, reorder.ownerOrder);
+    hostApplyOrder(aZ, reorder.ownerOrder);
+    hostApplyOrder(alphaX, reorder.ownerOrder);
+    hostApplyOrder(alphaY, reorder.ownerOrder);
+    hostApplyOrder(alphaZ, reorder.ownerOrder);
+    hostApplyOrder(accSpecified, reorder.ownerOrder);
+    hostApplyOrder(angAccSpecified, reorder.ownerOrder);
+    if (solverFlags.useSleeping) {
+        hostApplyOrder(ownerSleeping, reorder.ownerOrder);
+        hostApplyOrder(ownerQuietSteps, reorder.ownerOrder);
+    }
+    hostApplyOrder(ownerTypes, reorder.ownerOrder);
+    hostApplyOrder(inertiaPropOffsets, reorder.ownerOrder);
+    if (!solverFlags.useMassJitify) {
+        hostApplyOrder(massOwnerBody, reorder.ownerOrder);
+        hostApplyOrder(mmiXX, reorder.ownerOrder);
+        hostApplyOrder(mmiYY, reorder.ownerOrder);
+        hostApplyOrder(mmiZZ, reorder.ownerOrder);
+    }
+
+    // Per-sphere arrays
+    hostApplyOrder(ownerClumpBody, reorder.sphereOrder);
+    hostApplyOrder(sphereMaterialOffset, reorder.sphereOrder);
+    if (solverFlags.useClumpJitify) {
+        hostApplyOrder(clumpComponentOffset, reorder.sphereOrder);
+        hostApplyOrder(clumpComponentOffsetExt, reorder.sphereOrder);
+    } else {
+        hostApplyOrder(radiiSphere, reorder.sphereOrder);
+        hostApplyOrder(relPosSphereX, reorder.sphereOrder);
+        hostApplyOrder(relPosSphereY, reorder.sphereOrder);
+        hostApplyOrder(relPosSphereZ, reorder.sphereOrder);
+    }
+
+    // Wildcards
+    for (unsigned int i = 0; i < simParams->nOwnerWildcards; i++) {
+        hostApplyOrder(ownerWildcards[i], reorder.ownerOrder);
+    }
+    for (unsigned int i = 0; i < simParams->nGeoWildcards; i++) {
+        hostApplyOrder(sphereWildcards[i], reorder.sphereOrder);
+    }
+
+    // Same as after a purge: kT needs to map its next contact detection results against this contact array
+    new_contacts_loaded = true;
+    contactPairArr_isFresh = true;
+}
+
 void DEMDynamicThread::setSimParams(unsigned char nvXp2,
                                     unsigned char nvYp2,
                                     unsigned char nvZp2,
@@ -142,6 +555,7 @@ void DEMDynamicThread::setSimParams(unsigned char nvXp2,
                                     float3 LBFPoint,
                                     float3 user_box_min,
                                     float3 user_box_max,
+                                    unsigned int periodic_dirs,
                                     float3 G,
                                     double ts_size,
                                     float expand_factor,
@@ -164,6 +578,8 @@ void DEMDynamicThread::setSimParams(unsigned char nvXp2,
     simParams->Gy = G.y;
     simParams->Gz = G.z;
     simParams->h = ts_size;
+    granData->stepSizeForKT = ts_size;
+    pendingStepSize = 0.f;
     simParams->beta = expand_factor;  // If beta is auto-adapting, this assignment has no effect
     simParams->approxMaxVel = approx_max_vel;
     simParams->expSafetyMulti = expand_safety_param;
@@ -173,6 +589,9 @@ void DEMDynamicThread::setSimParams(unsigned char nvXp2,
     simParams->nbZ = nbZ;
     simParams->userBoxMin = user_box_min;
     simParams->userBoxMax = user_box_max;
+    simParams->periodicDirs = periodic_dirs;
+    simParams->periodicBoxMin = user_box_min - LBFPoint;
+    simParams->periodicBoxSize = user_box_max - user_box_min;
 
     simParams->nContactWildcards = contact_wildcards.size();
     simParams->nOwnerWildcards = owner_wildcards.size();
@@ -189,20 +608,21 @@ void DEMDynamicThread::changeOwnerSizes(const std::vector<bodyID_t>& IDs, const
     // cudaStream_t new_stream;
     // cudaStreamCreate(&new_stream);
 
+    auto scratch_scope = stateOfSolver_resources.tempScope("Owner size change");
     // First get IDs and factors to device side
     size_t IDSize = IDs.size() * sizeof(bodyID_t);
-    bodyID_t* dIDs = (bodyID_t*)stateOfSolver_resources.allocateTempVector(1, IDSize);
+    bodyID_t* dIDs = (bodyID_t*)stateOfSolver_resources.allocateTemp("dIDs", IDSize);
     DEME_GPU_CALL(cudaMemcpy(dIDs, IDs.data(), IDSize, cudaMemcpyHostToDevice));
     size_t factorSize = factors.size() * sizeof(float);
-    float* dFactors = (float*)stateOfSolver_resources.allocateTempVector(2, factorSize);
+    float* dFactors = (float*)stateOfSolver_resources.allocateTemp("dFactors", factorSize);
     DEME_GPU_CALL(cudaMemcpy(dFactors, factors.data(), factorSize, cudaMemcpyHostToDevice));
 
     size_t idBoolSize = (size_t)simParams->nOwnerBodies * sizeof(notStupidBool_t);
     size_t ownerFactorSize = (size_t)simParams->nOwnerBodies * sizeof(float);
     // Bool table for whether this owner should change
-    notStupidBool_t* idBool = (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(3, idBoolSize);
+    notStupidBool_t* idBool = (notStupidBool_t*)stateOfSolver_resources.allocateTemp("idBool", idBoolSize);
     DEME_GPU_CALL(cudaMemset(idBool, 0, idBoolSize));
-    float* ownerFactors = (float*)stateOfSolver_resources.allocateTempVector(4, ownerFactorSize);
+    float* ownerFactors = (float*)stateOfSolver_resources.allocateTemp("ownerFactors", ownerFactorSize);
     size_t blocks_needed_for_marking = (IDs.size() + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
 
     // Mark on the bool array those owners that need a change
@@ -236,9 +656,11 @@ void DEMDynamicThread::allocateManagedArrays(size_t nOwnerBodies,
                                              unsigned int nClumpTopo,
                                              unsigned int nClumpComponents,
                                              unsigned int nJitifiableClumpComponents,
-                                             unsigned int nMatTuples) {
+                                             unsigned int nMatTuples,
+                                             const ArrayReservation& reservation) {
     // dT buffer arrays should be on dT and this is to ensure that
     DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    arrayReservation = reservation;
 
     // Sizes of these arrays
     simParams->nSpheresGM = nSpheresGM;
@@ -278,6 +700,10 @@ void DEMDynamicThread::allocateManagedArrays(size_t nOwnerBodies,
     DEME_TRACKED_RESIZE_DEBUGPRINT(alphaZ, nOwnerBodies, "alphaZ", 0);
     DEME_TRACKED_RESIZE_DEBUGPRINT(accSpecified, nOwnerBodies, "accSpecified", 0);
     DEME_TRACKED_RESIZE_DEBUGPRINT(angAccSpecified, nOwnerBodies, "angAccSpecified", 0);
+    if (solverFlags.useSleeping) {
+        DEME_TRACKED_RESIZE_DEBUGPRINT(ownerSleeping, nOwnerBodies, "ownerSleeping", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(ownerQuietSteps, nOwnerBodies, "ownerQuietSteps", 0);
+    }
 
     // Resize the family mask `matrix' (in fact it is flattened)
     DEME_TRACKED_RESIZE_DEBUGPRINT(familyMaskMatrix, (NUM_AVAL_FAMILIES + 1) * NUM_AVAL_FAMILIES / 2,
@@ -332,6 +758,33 @@ void DEMDynamicThread::allocateManagedArrays(size_t nOwnerBodies,
     // Volume info is jitified
     DEME_TRACKED_RESIZE_DEBUGPRINT(volumeOwnerBody, nMassProperties, "volumeOwnerBody", 0);
 
+    // Reserve the room the user instructed, so that owners and geometries added later need no reallocation
+    if (reservation.nOwners > nOwnerBodies) {
+        m_approx_bytes_used += hostReserveAll(reservation.nOwners, familyID, voxelID, locX, locY, locZ, oriQw, oriQx,
+                                              oriQy, oriQz, vX, vY, vZ, omgBarX, omgBarY, omgBarZ, aX, aY, aZ, alphaX,
+                                              alphaY, alphaZ, accSpecified, angAccSpecified, ownerTypes,
+                                              inertiaPropOffsets);
+        if (solverFlags.useSleeping) {
+            m_approx_bytes_used += hostReserveAll(reservation.nOwners, ownerSleeping, ownerQuietSteps);
+        }
+        if (!solverFlags.useMassJitify) {
+            m_approx_bytes_used += hostReserveAll(reservation.nOwners, massOwnerBody, mmiXX, mmiYY, mmiZZ);
+        }
+    }
+    if (reservation.nSpheres > nSpheresGM) {
+        m_approx_bytes_used += hostReserveAll(reservation.nSpheres, ownerClumpBody, sphereMaterialOffset);
+        if (solverFlags.useClumpJitify) {
+            m_approx_bytes_used += hostReserveAll(reservation.nSpheres, clumpComponentOffset, clumpComponentOffsetExt);
+        } else {
+            m_approx_bytes_used +=
+                hostReserveAll(reservation.nSpheres, radiiSphere, relPosSphereX, relPosSphereY, relPosSphereZ);
+        }
+    }
+    if (reservation.nTriangles > nTriGM) {
+        m_approx_bytes_used += hostReserveAll(reservation.nTriangles, ownerMesh, relPosNode1, relPosNode2, relPosNode3,
+                                              triMaterialOffset);
+    }
+
     // Arrays for contact info
     // The lengths of contact event-based arrays are just estimates. My estimate of total contact pairs is ~ 2n, and I
     // think the max is 6n (although I can't prove it). Note the estimate should be large enough to decrease the number
@@ -339,9 +792,9 @@ void DEMDynamicThread::allocateManagedArrays(size_t nOwnerBodies,
     {
         // In any case, in this initialization process we should not make contact arrays smaller than it used to be, or
         // we may lose data. Also, if this is a new-boot, we allocate this array for at least
-        // nSpheresGM*DEME_INIT_CNT_MULTIPLIER elements.
-        size_t cnt_arr_size =
-            DEME_MAX(*stateOfSolver_resources.pNumContacts + nExtraContacts, nSpheresGM * DEME_INIT_CNT_MULTIPLIER);
+        // nSpheresGM*DEME_INIT_CNT_MULTIPLIER elements, or the number of contacts the user instructed.
+        cntArrMinLength = DEME_MAX(reservation.nContacts, nSpheresGM * DEME_INIT_CNT_MULTIPLIER);
+        size_t cnt_arr_size = DEME_MAX(*stateOfSolver_resources.pNumContacts + nExtraContacts, cntArrMinLength);
         DEME_TRACKED_RESIZE_DEBUGPRINT(idGeometryA, cnt_arr_size, "idGeometryA", 0);
         DEME_TRACKED_RESIZE_DEBUGPRINT(idGeometryB, cnt_arr_size, "idGeometryB", 0);
         DEME_TRACKED_RESIZE_DEBUGPRINT(contactType, cnt_arr_size, "contactType", NOT_A_CONTACT);
@@ -366,6 +819,9 @@ void DEMDynamicThread::allocateManagedArrays(size_t nOwnerBodies,
         }
         for (unsigned int i = 0; i < simParams->nOwnerWildcards; i++) {
             DEME_TRACKED_RESIZE_FLOAT(ownerWildcards[i], nOwnerBodies, 0);
+            if (reservation.nOwners > nOwnerBodies) {
+                m_approx_bytes_used += hostReserveAll(reservation.nOwners, ownerWildcards[i]);
+            }
         }
         for (unsigned int i = 0; i < simParams->nGeoWildcards; i++) {
             DEME_TRACKED_RESIZE_FLOAT(sphereWildcards[i], nSpheresGM, 0);
@@ -492,6 +948,7 @@ void DEMDynamicThread::populateEntityArrays(const std::vector<std::shared_ptr<DE
                                             size_t nExistOwners,
                                             size_t nExistSpheres,
                                             size_t nExistingFacets) {
+    ownerContactIndexStale = true;
     // Load in clump components info (but only if instructed to use jitified clump templates). This step will be
     // repeated even if we are just adding some more clumps to system, not a complete re-initialization.
     size_t k = 0;
@@ -1084,150 +1541,163 @@ void DEMDynamicThread::writeSpheresAsChpf(std::ofstream& ptFile) const {
 }
 #endif
 
-void DEMDynamicThread::writeSpheresAsCsv(std::ofstream& ptFile) const {
-    std::ostringstream outstrstream;
-
-    outstrstream << OUTPUT_FILE_X_COL_NAME + "," + OUTPUT_FILE_Y_COL_NAME + "," + OUTPUT_FILE_Z_COL_NAME + "," +
-                        OUTPUT_FILE_R_COL_NAME;
-
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
-        outstrstream << ",absv";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
-        outstrstream << "," + OUTPUT_FILE_VEL_X_COL_NAME + "," + OUTPUT_FILE_VEL_Y_COL_NAME + "," +
-                            OUTPUT_FILE_VEL_Z_COL_NAME;
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
-        outstrstream << "," + OUTPUT_FILE_ANGVEL_X_COL_NAME + "," + OUTPUT_FILE_ANGVEL_Y_COL_NAME + "," +
-                            OUTPUT_FILE_ANGVEL_Z_COL_NAME;
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
-        outstrstream << ",abs_acc";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
-        outstrstream << ",a_x,a_y,a_z";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
-        outstrstream << ",alpha_x,alpha_y,alpha_z";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
-        outstrstream << ",family";
-    }
-    // if (solverFlags.outputFlags & OUTPUT_CONTENT::MAT) {
-    //     outstrstream << ",material";
-    // }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
-        for (const auto& name : m_owner_wildcard_names) {
-            outstrstream << "," + name;
-        }
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::GEO_WILDCARD) {
-        for (const auto& name : m_geo_wildcard_names) {
-            outstrstream << "," + name;
-        }
-    }
-
-    outstrstream << "\n";
+OutputFrame DEMDynamicThread::collectSpheresFrame() const {
+    const bool out_absv = solverFlags.outputFlags & OUTPUT_CONTENT::ABSV;
+    const bool out_vel = solverFlags.outputFlags & OUTPUT_CONTENT::VEL;
+    const bool out_ang_vel = solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL;
+    const bool out_abs_acc = solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC;
+    const bool out_acc = solverFlags.outputFlags & OUTPUT_CONTENT::ACC;
+    const bool out_ang_acc = solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC;
+    const bool out_family = solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY;
+    const bool out_owner_wildcard = solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD;
+    const bool out_geo_wildcard = solverFlags.outputFlags & OUTPUT_CONTENT::GEO_WILDCARD;
+
+    // One array per column. Columns not requested stay empty and are not written.
+    const size_t n = simParams->nSpheresGM;
+    std::vector<float> posX(n), posY(n), posZ(n), radii(n);
+    std::vector<float> absv, velX, velY, velZ, angVelX, angVelY, angVelZ, absAcc, accX, accY, accZ, angAccX,
+        angAccY, angAccZ;
+    std::vector<family_t> families;
+    std::vector<std::vector<float>> owner_wildcards, geo_wildcards;
+    if (out_absv)
+        absv.resize(n);
+    if (out_vel) {
+        velX.resize(n);
+        velY.resize(n);
+        velZ.resize(n);
+    }
+    if (out_ang_vel) {
+        angVelX.resize(n);
+        angVelY.resize(n);
+        angVelZ.resize(n);
+    }
+    if (out_abs_acc)
+        absAcc.resize(n);
+    if (out_acc) {
+        accX.resize(n);
+        accY.resize(n);
+        accZ.resize(n);
+    }
+    if (out_ang_acc) {
+        angAccX.resize(n);
+        angAccY.resize(n);
+        angAccZ.resize(n);
+    }
+    if (out_family)
+        families.resize(n);
+    if (out_owner_wildcard)
+        owner_wildcards.assign(m_owner_wildcard_names.size(), std::vector<float>(n));
+    if (out_geo_wildcard)
+        geo_wildcards.assign(m_geo_wildcard_names.size(), std::vector<float>(n));
 
-    for (size_t i = 0; i < simParams->nSpheresGM; i++) {
+    size_t num_output_spheres = 0;
+    for (size_t i = 0; i < n; i++) {
         auto this_owner = ownerClumpBody.at(i);
         family_t this_family = familyID.at(this_owner);
         // If this (impl-level) family is in the no-output list, skip it
         if (std::binary_search(familiesNoOutput.begin(), familiesNoOutput.end(), this_family)) {
             continue;
         }
+        const size_t row = num_output_spheres++;
 
-        float3 CoM;
-        float3 pos;
-        float radius;
         float X, Y, Z;
-        voxelID_t voxel = voxelID.at(this_owner);
-        subVoxelPos_t subVoxX = locX.at(this_owner);
-        subVoxelPos_t subVoxY = locY.at(this_owner);
-        subVoxelPos_t subVoxZ = locZ.at(this_owner);
-        hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(X, Y, Z, voxel, subVoxX, subVoxY, subVoxZ,
-                                                               simParams->nvXp2, simParams->nvYp2, simParams->voxelSize,
-                                                               simParams->l);
-        CoM.x = X + simParams->LBFX;
-        CoM.y = Y + simParams->LBFY;
-        CoM.z = Z + simParams->LBFZ;
+        hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(
+            X, Y, Z, voxelID.at(this_owner), locX.at(this_owner), locY.at(this_owner), locZ.at(this_owner),
+            simParams->nvXp2, simParams->nvYp2, simParams->voxelSize, simParams->l);
 
         size_t compOffset = (solverFlags.useClumpJitify) ? clumpComponentOffsetExt.at(i) : i;
         float3 this_sp_deviation;
         this_sp_deviation.x = relPosSphereX.at(compOffset);
         this_sp_deviation.y = relPosSphereY.at(compOffset);
         this_sp_deviation.z = relPosSphereZ.at(compOffset);
-        float this_sp_rot_0 = oriQw.at(this_owner);
-        float this_sp_rot_1 = oriQx.at(this_owner);
-        float this_sp_rot_2 = oriQy.at(this_owner);
-        float this_sp_rot_3 = oriQz.at(this_owner);
         hostApplyOriQToVector3<float, float>(this_sp_deviation.x, this_sp_deviation.y, this_sp_deviation.z,
-                                             this_sp_rot_0, this_sp_rot_1, this_sp_rot_2, this_sp_rot_3);
-        pos = CoM + this_sp_deviation;
-        outstrstream << pos.x << "," << pos.y << "," << pos.z;
-
-        radius = radiiSphere.at(compOffset);
-        outstrstream << "," << radius;
-
-        // Only linear velocity
-        float3 vxyz, acc;
-        vxyz.x = vX.at(this_owner);
-        vxyz.y = vY.at(this_owner);
-        vxyz.z = vZ.at(this_owner);
-        acc.x = aX.at(this_owner);
-        acc.y = aY.at(this_owner);
-        acc.z = aZ.at(this_owner);
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
-            outstrstream << "," << length(vxyz);
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
-            outstrstream << "," << vxyz.x << "," << vxyz.y << "," << vxyz.z;
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
-            float3 ang_v;
-            ang_v.x = omgBarX.at(this_owner);
-            ang_v.y = omgBarY.at(this_owner);
-            ang_v.z = omgBarZ.at(this_owner);
-            outstrstream << "," << ang_v.x << "," << ang_v.y << "," << ang_v.z;
-        }
-
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
-            outstrstream << "," << length(acc);
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
-            outstrstream << "," << acc.x << "," << acc.y << "," << acc.z;
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
-            float3 ang_acc;
-            ang_acc.x = alphaX.at(this_owner);
-            ang_acc.y = alphaY.at(this_owner);
-            ang_acc.z = alphaZ.at(this_owner);
-            outstrstream << "," << ang_acc.x << "," << ang_acc.y << "," << ang_acc.z;
-        }
-
-        // Family number needs to be user number
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
-            outstrstream << "," << +(this_family);
-        }
-
-        // Wildcards
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
-            // The order shouldn't be an issue... the same set is being processed here and in equip_owner_wildcards, see
-            // Model.h
-            for (unsigned int j = 0; j < m_owner_wildcard_names.size(); j++) {
-                outstrstream << "," << ownerWildcards[j][i];
-            }
+                                             oriQw.at(this_owner), oriQx.at(this_owner), oriQy.at(this_owner),
+                                             oriQz.at(this_owner));
+        posX[row] = X + simParams->LBFX + this_sp_deviation.x;
+        posY[row] = Y + simParams->LBFY + this_sp_deviation.y;
+        posZ[row] = Z + simParams->LBFZ + this_sp_deviation.z;
+        radii[row] = radiiSphere.at(compOffset);
+
+        float3 vxyz = host_make_float3(vX.at(this_owner), vY.at(this_owner), vZ.at(this_owner));
+        float3 acc = host_make_float3(aX.at(this_owner), aY.at(this_owner), aZ.at(this_owner));
+        if (out_absv)
+            absv[row] = length(vxyz);
+        if (out_vel) {
+            velX[row] = vxyz.x;
+            velY[row] = vxyz.y;
+            velZ[row] = vxyz.z;
+        }
+        if (out_ang_vel) {
+            angVelX[row] = omgBarX.at(this_owner);
+            angVelY[row] = omgBarY.at(this_owner);
+            angVelZ[row] = omgBarZ.at(this_owner);
+        }
+        if (out_abs_acc)
+            absAcc[row] = length(acc);
+        if (out_acc) {
+            accX[row] = acc.x;
+            accY[row] = acc.y;
+            accZ[row] = acc.z;
+        }
+        if (out_ang_acc) {
+            angAccX[row] = alphaX.at(this_owner);
+            angAccY[row] = alphaY.at(this_owner);
+            angAccZ[row] = alphaZ.at(this_owner);
+        }
+        if (out_family)
+            families[row] = this_family;
+        for (unsigned int j = 0; j < owner_wildcards.size(); j++) {
+            owner_wildcards[j][row] = ownerWildcards[j][this_owner];
+        }
+        for (unsigned int j = 0; j < geo_wildcards.size(); j++) {
+            geo_wildcards[j][row] = sphereWildcards[j][i];
+        }
+    }
+
+    OutputFrame frame(num_output_spheres);
+    frame.AddColumn(OUTPUT_FILE_X_COL_NAME, posX);
+    frame.AddColumn(OUTPUT_FILE_Y_COL_NAME, posY);
+    frame.AddColumn(OUTPUT_FILE_Z_COL_NAME, posZ);
+    frame.AddColumn(OUTPUT_FILE_R_COL_NAME, radii);
+    if (out_absv)
+        frame.AddColumn("absv", absv);
+    if (out_vel) {
+        frame.AddColumn(OUTPUT_FILE_VEL_X_COL_NAME, velX);
+        frame.AddColumn(OUTPUT_FILE_VEL_Y_COL_NAME, velY);
+        frame.AddColumn(OUTPUT_FILE_VEL_Z_COL_NAME, velZ);
+    }
+    if (out_ang_vel) {
+        frame.AddColumn(OUTPUT_FILE_ANGVEL_X_COL_NAME, angVelX);
+        frame.AddColumn(OUTPUT_FILE_ANGVEL_Y_COL_NAME, angVelY);
+        frame.AddColumn(OUTPUT_FILE_ANGVEL_Z_COL_NAME, angVelZ);
+    }
+    if (out_abs_acc)
+        frame.AddColumn("abs_acc", absAcc);
+    if (out_acc) {
+        frame.AddColumn("a_x", accX);
+        frame.AddColumn("a_y", accY);
+        frame.AddColumn("a_z", accZ);
+    }
+    if (out_ang_acc) {
+        frame.AddColumn("alpha_x", angAccX);
+        frame.AddColumn("alpha_y", angAccY);
+        frame.AddColumn("alpha_z", angAccZ);
+    }
+    if (out_family)
+        frame.AddColumn("family", families);
+    if (out_owner_wildcard) {
+        unsigned int j = 0;
+        for (const auto& name : m_owner_wildcard_names) {
+            frame.AddColumn(name, owner_wildcards[j++]);
         }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::GEO_WILDCARD) {
-            for (unsigned int j = 0; j < m_geo_wildcard_names.size(); j++) {
-                outstrstream << "," << sphereWildcards[j][i];
-            }
+    }
+    if (out_geo_wildcard) {
+        unsigned int j = 0;
+        for (const auto& name : m_geo_wildcard_names) {
+            frame.AddColumn(name, geo_wildcards[j++]);
         }
-
-        outstrstream << "\n";
     }
-
-    ptFile << outstrstream.str();
+    return frame;
 }
 
 #ifdef DEME_USE_CHPF
@@ -1311,44 +1781,62 @@ void DEMDynamicThread::writeClumpsAsChpf(std::ofstream& ptFile, unsigned int acc
 }
 #endif
 
-void DEMDynamicThread::writeClumpsAsCsv(std::ofstream& ptFile, unsigned int accuracy) const {
-    std::ostringstream outstrstream;
-    outstrstream.precision(accuracy);
-
-    // xyz and quaternion are always there
-    outstrstream << OUTPUT_FILE_X_COL_NAME + "," + OUTPUT_FILE_Y_COL_NAME + "," + OUTPUT_FILE_Z_COL_NAME +
-                        ",Qw,Qx,Qy,Qz," + OUTPUT_FILE_CLUMP_TYPE_NAME;
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
-        outstrstream << ",absv";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
-        outstrstream << "," + OUTPUT_FILE_VEL_X_COL_NAME + "," + OUTPUT_FILE_VEL_Y_COL_NAME + "," +
-                            OUTPUT_FILE_VEL_Z_COL_NAME;
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
-        outstrstream << "," + OUTPUT_FILE_ANGVEL_X_COL_NAME + "," + OUTPUT_FILE_ANGVEL_Y_COL_NAME + "," +
-                            OUTPUT_FILE_ANGVEL_Z_COL_NAME;
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
-        outstrstream << ",abs_acc";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
-        outstrstream << ",a_x,a_y,a_z";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
-        outstrstream << ",alpha_x,alpha_y,alpha_z";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
-        outstrstream << ",family";
-    }
-    if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
-        for (const auto& name : m_owner_wildcard_names) {
-            outstrstream << "," + name;
-        }
-    }
-    outstrstream << "\n";
+OutputFrame DEMDynamicThread::collectClumpsFrame() const {
+    const bool out_absv = solverFlags.outputFlags & OUTPUT_CONTENT::ABSV;
+    const bool out_vel = solverFlags.outputFlags & OUTPUT_CONTENT::VEL;
+    const bool out_ang_vel = solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL;
+    const bool out_abs_acc = solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC;
+    const bool out_acc = solverFlags.outputFlags & OUTPUT_CONTENT::ACC;
+    const bool out_ang_acc = solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC;
+    const bool out_family = solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY;
+    const bool out_owner_wildcard = solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD;
+
+    // Clump type names are stored once, in a dictionary; each row then only stores an index into it
+    std::vector<std::string> type_names;
+    std::unordered_map<unsigned int, uint32_t> type_name_index;
+    for (const auto& mark_name : templateNumNameMap) {
+        type_name_index[mark_name.first] = type_names.size();
+        type_names.push_back(mark_name.second);
+    }
+
+    const size_t n = simParams->nOwnerBodies;
+    std::vector<float> posX(n), posY(n), posZ(n), Qw(n), Qx(n), Qy(n), Qz(n);
+    std::vector<uint32_t> types(n);
+    std::vector<float> absv, velX, velY, velZ, angVelX, angVelY, angVelZ, absAcc, accX, accY, accZ, angAccX,
+        angAccY, angAccZ;
+    std::vector<family_t> families;
+    std::vector<std::vector<float>> owner_wildcards;
+    if (out_absv)
+        absv.resize(n);
+    if (out_vel) {
+        velX.resize(n);
+        velY.resize(n);
+        velZ.resize(n);
+    }
+    if (out_ang_vel) {
+        angVelX.resize(n);
+        angVelY.resize(n);
+        angVelZ.resize(n);
+    }
+    if (out_abs_acc)
+        absAcc.resize(n);
+    if (out_acc) {
+        accX.resize(n);
+        accY.resize(n);
+        accZ.resize(n);
+    }
+    if (out_ang_acc) {
+        angAccX.resize(n);
+        angAccY.resize(n);
+        angAccZ.resize(n);
+    }
+    if (out_family)
+        families.resize(n);
+    if (out_owner_wildcard)
+        owner_wildcards.assign(m_owner_wildcard_names.size(), std::vector<float>(n));
 
-    for (size_t i = 0; i < simParams->nOwnerBodies; i++) {
+    size_t num_output_clumps = 0;
+    for (size_t i = 0; i < n; i++) {
         // i is this owner's number. And if it is not a clump, we can move on.
         if (ownerTypes.at(i) != OWNER_T_CLUMP)
             continue;
@@ -1358,80 +1846,96 @@ void DEMDynamicThread::writeClumpsAsCsv(std::ofstream& ptFile, unsigned int accu
         if (std::binary_search(familiesNoOutput.begin(), familiesNoOutput.end(), this_family)) {
             continue;
         }
+        const size_t row = num_output_clumps++;
 
-        float3 CoM;
         float X, Y, Z;
-        voxelID_t voxel = voxelID.at(i);
-        subVoxelPos_t subVoxX = locX.at(i);
-        subVoxelPos_t subVoxY = locY.at(i);
-        subVoxelPos_t subVoxZ = locZ.at(i);
-        hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(X, Y, Z, voxel, subVoxX, subVoxY, subVoxZ,
-                                                               simParams->nvXp2, simParams->nvYp2, simParams->voxelSize,
-                                                               simParams->l);
-        CoM.x = X + simParams->LBFX;
-        CoM.y = Y + simParams->LBFY;
-        CoM.z = Z + simParams->LBFZ;
-        // Output position
-        outstrstream << CoM.x << "," << CoM.y << "," << CoM.z;
-
-        // Then quaternions
-        outstrstream << "," << oriQw.at(i) << "," << oriQx.at(i) << "," << oriQy.at(i) << "," << oriQz.at(i);
-
-        // Then type of clump
-        unsigned int clump_mark = inertiaPropOffsets.at(i);
-        outstrstream << "," << templateNumNameMap.at(clump_mark);
-
-        // Only linear velocity
-        float3 vxyz, ang_v, acc, ang_acc;
-        vxyz.x = vX.at(i);
-        vxyz.y = vY.at(i);
-        vxyz.z = vZ.at(i);
-        acc.x = aX.at(i);
-        acc.y = aY.at(i);
-        acc.z = aZ.at(i);
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABSV) {
-            outstrstream << "," << length(vxyz);
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::VEL) {
-            outstrstream << "," << vxyz.x << "," << vxyz.y << "," << vxyz.z;
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_VEL) {
-            ang_v.x = omgBarX.at(i);
-            ang_v.y = omgBarY.at(i);
-            ang_v.z = omgBarZ.at(i);
-            outstrstream << "," << ang_v.x << "," << ang_v.y << "," << ang_v.z;
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ABS_ACC) {
-            outstrstream << "," << length(acc);
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ACC) {
-            outstrstream << "," << acc.x << "," << acc.y << "," << acc.z;
-        }
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::ANG_ACC) {
-            ang_acc.x = alphaX.at(i);
-            ang_acc.y = alphaY.at(i);
-            ang_acc.z = alphaZ.at(i);
-            outstrstream << "," << ang_acc.x << "," << ang_acc.y << "," << ang_acc.z;
-        }
-
-        // Family number needs to be user number
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::FAMILY) {
-            outstrstream << "," << +(this_family);
-        }
-
-        // Wildcards
-        if (solverFlags.outputFlags & OUTPUT_CONTENT::OWNER_WILDCARD) {
-            // The order shouldn't be an issue... the same set is being processed here and in equip_owner_wildcards, see
-            // Model.h
-            for (unsigned int j = 0; j < m_owner_wildcard_names.size(); j++) {
-                outstrstream << "," << ownerWildcards[j][i];
-            }
+        hostVoxelIDToPosition<float, voxelID_t, subVoxelPos_t>(X, Y, Z, voxelID.at(i), locX.at(i), locY.at(i),
+                                                               locZ.at(i), simParams->nvXp2, simParams->nvYp2,
+                                                               simParams->voxelSize, simParams->l);
+        posX[row] = X + simParams->LBFX;
+        posY[row] = Y + simParams->LBFY;
+        posZ[row] = Z + simParams->LBFZ;
+        Qw[row] = oriQw.at(i);
+        Qx[row] = oriQx.at(i);
+        Qy[row] = oriQy.at(i);
+        Qz[row] = oriQz.at(i);
+        types[row] = type_name_index.at(inertiaPropOffsets.at(i));
+
+        float3 vxyz = host_make_float3(vX.at(i), vY.at(i), vZ.at(i));
+        float3 acc = host_make_float3(aX.at(i), aY.at(i), aZ.at(i));
+        if (out_absv)
+            absv[row] = length(vxyz);
+        if (out_vel) {
+            velX[row] = vxyz.x;
+            velY[row] = vxyz.y;
+            velZ[row] = vxyz.z;
+        }
+        if (out_ang_vel) {
+            angVelX[row] = omgBarX.at(i);
+            angVelY[row] = omgBarY.at(i);
+            angVelZ[row] = omgBarZ.at(i);
+        }
+        if (out_abs_acc)
+            absAcc[row] = length(acc);
+        if (out_acc) {
+            accX[row] = acc.x;
+            accY[row] = acc.y;
+            accZ[row] = acc.z;
+        }
+        if (out_ang_acc) {
+            angAccX[row] = alphaX.at(i);
+            angAccY[row] = alphaY.at(i);
+            angAccZ[row] = alphaZ.at(i);
+        }
+        if (out_family)
+            families[row] = this_family;
+        for (unsigned int j = 0; j < owner_wildcards.size(); j++) {
+            owner_wildcards[j][row] = ownerWildcards[j][i];
+        }
+    }
+
+    OutputFrame frame(num_output_clumps);
+    frame.AddColumn(OUTPUT_FILE_X_COL_NAME, posX);
+    frame.AddColumn(OUTPUT_FILE_Y_COL_NAME, posY);
+    frame.AddColumn(OUTPUT_FILE_Z_COL_NAME, posZ);
+    frame.AddColumn(OUTPUT_FILE_QW_COL_NAME, Qw);
+    frame.AddColumn(OUTPUT_FILE_QX_COL_NAME, Qx);
+    frame.AddColumn(OUTPUT_FILE_QY_COL_NAME, Qy);
+    frame.AddColumn(OUTPUT_FILE_QZ_COL_NAME, Qz);
+    frame.AddStringColumn(OUTPUT_FILE_CLUMP_TYPE_NAME, type_names, types);
+    if (out_absv)
+        frame.AddColumn("absv", absv);
+    if (out_vel) {
+        frame.AddColumn(OUTPUT_FILE_VEL_X_COL_NAME, velX);
+        frame.AddColumn(OUTPUT_FILE_VEL_Y_COL_NAME, velY);
+        frame.AddColumn(OUTPUT_FILE_VEL_Z_COL_NAME, velZ);
+    }
+    if (out_ang_vel) {
+        frame.AddColumn(OUTPUT_FILE_ANGVEL_X_COL_NAME, angVelX);
+        frame.AddColumn(OUTPUT_FILE_ANGVEL_Y_COL_NAME, angVelY);
+        frame.AddColumn(OUTPUT_FILE_ANGVEL_Z_COL_NAME, angVelZ);
+    }
+    if (out_abs_acc)
+        frame.AddColumn("abs_acc", absAcc);
+    if (out_acc) {
+        frame.AddColumn("a_x", accX);
+        frame.AddColumn("a_y", accY);
+        frame.AddColumn("a_z", accZ);
+    }
+    if (out_ang_acc) {
+        frame.AddColumn("alpha_x", angAccX);
+        frame.AddColumn("alpha_y", angAccY);
+        frame.AddColumn("alpha_z", angAccZ);
+    }
+    if (out_family)
+        frame.AddColumn("family", families);
+    if (out_owner_wildcard) {
+        unsigned int j = 0;
+        for (const auto& name : m_owner_wildcard_names) {
+            frame.AddColumn(name, owner_wildcards[j++]);
         }
-
-        outstrstream << "\n";
     }
-
-    ptFile << outstrstream.str();
+    return frame;
 }
 
 inline bodyID_t DEMDynamicThread::getOwnerForContactB(const bodyID_t& geoB, const contact_t& type) const {
@@ -1445,46 +1949,62 @@ inline bodyID_t DEMDynamicThread::getOwnerForContactB(const bodyID_t& geoB, cons
     }
 }
 
-void DEMDynamicThread::writeContactsAsCsv(std::ofstream& ptFile, float force_thres) const {
-    std::ostringstream outstrstream;
-
-    outstrstream << OUTPUT_FILE_CNT_TYPE_NAME;
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::OWNER) {
-        outstrstream << "," + OUTPUT_FILE_OWNER_1_NAME + "," + OUTPUT_FILE_OWNER_2_NAME;
-    }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::GEO_ID) {
-        outstrstream << "," + OUTPUT_FILE_GEO_ID_1_NAME + "," + OUTPUT_FILE_GEO_ID_2_NAME;
-    }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::FORCE) {
-        outstrstream << "," + OUTPUT_FILE_FORCE_X_NAME + "," + OUTPUT_FILE_FORCE_Y_NAME + "," +
-                            OUTPUT_FILE_FORCE_Z_NAME;
-    }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::DEME_POINT) {
-        outstrstream << "," + OUTPUT_FILE_X_COL_NAME + "," + OUTPUT_FILE_Y_COL_NAME + "," + OUTPUT_FILE_Z_COL_NAME;
-    }
-    // if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::COMPONENT) {
-    //     outstrstream << ","+OUTPUT_FILE_COMP_1_NAME+","+OUTPUT_FILE_COMP_2_NAME;
-    // }
-    // if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NICKNAME) {
-    //     outstrstream << ","+OUTPUT_FILE_OWNER_NICKNAME_1_NAME+","+OUTPUT_FILE_OWNER_NICKNAME_2_NAME;
-    // }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NORMAL) {
-        outstrstream << "," + OUTPUT_FILE_NORMAL_X_NAME + "," + OUTPUT_FILE_NORMAL_Y_NAME + "," +
-                            OUTPUT_FILE_NORMAL_Z_NAME;
-    }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::TORQUE) {
-        outstrstream << "," + OUTPUT_FILE_TORQUE_X_NAME + "," + OUTPUT_FILE_TORQUE_Y_NAME + "," +
-                            OUTPUT_FILE_TORQUE_Z_NAME;
-    }
-    if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::CNT_WILDCARD) {
-        // Write all wildcard names as header
-        for (const auto& w_name : m_contact_wildcard_names) {
-            outstrstream << "," + w_name;
-        }
-    }
-    outstrstream << "\n";
-
-    for (size_t i = 0; i < *(stateOfSolver_resources.pNumContacts); i++) {
+OutputFrame DEMDynamicThread::collectContactsFrame(float force_thres) const {
+    const bool out_owner = solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::OWNER;
+    const bool out_geo_id = solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::GEO_ID;
+    const bool out_force = solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::FORCE;
+    const bool out_point = solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::DEME_POINT;
+    const bool out_normal = solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NORMAL;
+    const bool out_torque = solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::TORQUE;
+    const bool out_cnt_wildcard = solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::CNT_WILDCARD;
+
+    // Contact types are mapped to SS, SM and such... those names go into a dictionary
+    std::vector<std::string> type_names;
+    std::unordered_map<contact_t, uint32_t> type_name_index;
+    for (const auto& type_name : contact_type_out_name_map) {
+        type_name_index[type_name.first] = type_names.size();
+        type_names.push_back(type_name.second);
+    }
+
+    const size_t n = *(stateOfSolver_resources.pNumContacts);
+    std::vector<uint32_t> types(n);
+    std::vector<bodyID_t> ownersA, ownersB, geosA, geosB;
+    std::vector<float> forceX, forceY, forceZ, pointX, pointY, pointZ, normalX, normalY, normalZ, torqueX, torqueY,
+        torqueZ;
+    std::vector<std::vector<float>> cnt_wildcards;
+    if (out_owner) {
+        ownersA.resize(n);
+        ownersB.resize(n);
+    }
+    if (out_geo_id) {
+        geosA.resize(n);
+        geosB.resize(n);
+    }
+    if (out_force) {
+        forceX.resize(n);
+        forceY.resize(n);
+        forceZ.resize(n);
+    }
+    if (out_point) {
+        pointX.resize(n);
+        pointY.resize(n);
+        pointZ.resize(n);
+    }
+    if (out_normal) {
+        normalX.resize(n);
+        normalY.resize(n);
+        normalZ.resize(n);
+    }
+    if (out_torque) {
+        torqueX.resize(n);
+        torqueY.resize(n);
+        torqueZ.resize(n);
+    }
+    if (out_cnt_wildcard)
+        cnt_wildcards.assign(m_contact_wildcard_names.size(), std::vector<float>(n));
+
+    size_t num_output_contacts = 0;
+    for (size_t i = 0; i < n; i++) {
         // Geos that are involved in this contact
         auto geoA = idGeometryA.at(i);
         auto geoB = idGeometryB.at(i);
@@ -1499,27 +2019,28 @@ void DEMDynamicThread::writeContactsAsCsv(std::ofstream& ptFile, float force_thr
         if (length(forcexyz + torque) < force_thres) {
             continue;
         }
+        const size_t row = num_output_contacts++;
 
         // geoA's owner must be a sphere
         auto ownerA = ownerClumpBody.at(geoA);
-        bodyID_t ownerB;
-        // geoB's owner depends...
-        ownerB = getOwnerForContactB(geoB, type);
-
-        // Type is mapped to SS, SM and such....
-        outstrstream << contact_type_out_name_map.at(type);
+        types[row] = type_name_index.at(type);
 
         // (Internal) ownerID and/or geometry ID
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::OWNER) {
-            outstrstream << "," << ownerA << "," << ownerB;
+        if (out_owner) {
+            ownersA[row] = ownerA;
+            // geoB's owner depends...
+            ownersB[row] = getOwnerForContactB(geoB, type);
         }
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::GEO_ID) {
-            outstrstream << "," << geoA << "," << geoB;
+        if (out_geo_id) {
+            geosA[row] = geoA;
+            geosB[row] = geoB;
         }
 
         // Force is already in global...
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::FORCE) {
-            outstrstream << "," << forcexyz.x << "," << forcexyz.y << "," << forcexyz.z;
+        if (out_force) {
+            forceX[row] = forcexyz.x;
+            forceY[row] = forcexyz.y;
+            forceZ[row] = forcexyz.z;
         }
 
         // Contact point is in local frame. To make it global, first map that vector to axis-aligned global frame, then
@@ -1546,14 +2067,26 @@ void DEMDynamicThread::writeContactsAsCsv(std::ofstream& ptFile, float force_thr
             hostApplyOriQToVector3(cntPntA.x, cntPntA.y, cntPntA.z, oriQA.w, oriQA.x, oriQA.y, oriQA.z);
             cntPntA += CoM;
         }
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::DEME_POINT) {
+        if (out_point) {
             // oriQ is updated already... whereas the contact point is effectively last step's... That's unfortunate.
             // Should we do somthing ahout it?
-            outstrstream << "," << cntPntA.x << "," << cntPntA.y << "," << cntPntA.z;
+            pointX[row] = cntPntA.x;
+            pointY[row] = cntPntA.y;
+            pointZ[row] = cntPntA.z;
+            // A contact across a periodic face is reported at its location inside the periodic box
+            if (simParams->periodicDirs & PERIODIC_X) {
+                pointX[row] = hostWrapIntoPeriod(cntPntA.x, simParams->userBoxMin.x, simParams->periodicBoxSize.x);
+            }
+            if (simParams->periodicDirs & PERIODIC_Y) {
+                pointY[row] = hostWrapIntoPeriod(cntPntA.y, simParams->userBoxMin.y, simParams->periodicBoxSize.y);
+            }
+            if (simParams->periodicDirs & PERIODIC_Z) {
+                pointZ[row] = hostWrapIntoPeriod(cntPntA.z, simParams->userBoxMin.z, simParams->periodicBoxSize.z);
+            }
         }
 
         // To get contact normal: it's just contact point - sphereA center, that gives you the outward normal for body A
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NORMAL) {
+        if (out_normal) {
             size_t compOffset = (solverFlags.useClumpJitify) ? clumpComponentOffsetExt.at(geoA) : geoA;
             float3 this_sp_deviation;
             this_sp_deviation.x = relPosSphereX.at(compOffset);
@@ -1563,11 +2096,13 @@ void DEMDynamicThread::writeContactsAsCsv(std::ofstream& ptFile, float force_thr
                                                  oriQA.x, oriQA.y, oriQA.z);
             float3 pos = CoM + this_sp_deviation;
             float3 normal = normalize(cntPntA - pos);
-            outstrstream << "," << normal.x << "," << normal.y << "," << normal.z;
+            normalX[row] = normal.x;
+            normalY[row] = normal.y;
+            normalZ[row] = normal.z;
         }
 
         // Torque is in global already...
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::TORQUE) {
+        if (out_torque) {
             // Must derive torque in local...
             {
                 hostApplyOriQToVector3(torque.x, torque.y, torque.z, oriQA.w, -oriQA.x, -oriQA.y, -oriQA.z);
@@ -1576,27 +2111,65 @@ void DEMDynamicThread::writeContactsAsCsv(std::ofstream& ptFile, float force_thr
                 // back to global
                 hostApplyOriQToVector3(torque.x, torque.y, torque.z, oriQA.w, oriQA.x, oriQA.y, oriQA.z);
             }
-            outstrstream << "," << torque.x << "," << torque.y << "," << torque.z;
+            torqueX[row] = torque.x;
+            torqueY[row] = torque.y;
+            torqueZ[row] = torque.z;
         }
 
-        // Contact wildcards
-        if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::CNT_WILDCARD) {
-            // The order shouldn't be an issue... the same set is being processed here and in equip_contact_wildcards,
-            // see Model.h
-            for (unsigned int j = 0; j < m_contact_wildcard_names.size(); j++) {
-                outstrstream << "," << contactWildcards[j][i];
-            }
+        // Contact wildcards. The order shouldn't be an issue... the same set is being processed here and in
+        // equip_contact_wildcards, see Model.h
+        for (unsigned int j = 0; j < cnt_wildcards.size(); j++) {
+            cnt_wildcards[j][row] = contactWildcards[j][i];
         }
-
-        outstrstream << "\n";
     }
 
-    ptFile << outstrstream.str();
+    OutputFrame frame(num_output_contacts);
+    frame.AddStringColumn(OUTPUT_FILE_CNT_TYPE_NAME, type_names, types);
+    if (out_owner) {
+        frame.AddColumn(OUTPUT_FILE_OWNER_1_NAME, ownersA);
+        frame.AddColumn(OUTPUT_FILE_OWNER_2_NAME, ownersB);
+    }
+    if (out_geo_id) {
+        frame.AddColumn(OUTPUT_FILE_GEO_ID_1_NAME, geosA);
+        frame.AddColumn(OUTPUT_FILE_GEO_ID_2_NAME, geosB);
+    }
+    if (out_force) {
+        frame.AddColumn(OUTPUT_FILE_FORCE_X_NAME, forceX);
+        frame.AddColumn(OUTPUT_FILE_FORCE_Y_NAME, forceY);
+        frame.AddColumn(OUTPUT_FILE_FORCE_Z_NAME, forceZ);
+    }
+    if (out_point) {
+        frame.AddColumn(OUTPUT_FILE_X_COL_NAME, pointX);
+        frame.AddColumn(OUTPUT_FILE_Y_COL_NAME, pointY);
+        frame.AddColumn(OUTPUT_FILE_Z_COL_NAME, pointZ);
+    }
+    // if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::COMPONENT) {
+    //     outstrstream << ","+OUTPUT_FILE_COMP_1_NAME+","+OUTPUT_FILE_COMP_2_NAME;
+    // }
+    // if (solverFlags.cntOutFlags & CNT_OUTPUT_CONTENT::NICKNAME) {
+    //     outstrstream << ","+OUTPUT_FILE_OWNER_NICKNAME_1_NAME+","+OUTPUT_FILE_OWNER_NICKNAME_2_NAME;
+    // }
+    if (out_normal) {
+        frame.AddColumn(OUTPUT_FILE_NORMAL_X_NAME, normalX);
+        frame.AddColumn(OUTPUT_FILE_NORMAL_Y_NAME, normalY);
+        frame.AddColumn(OUTPUT_FILE_NORMAL_Z_NAME, normalZ);
+    }
+    if (out_torque) {
+        frame.AddColumn(OUTPUT_FILE_TORQUE_X_NAME, torqueX);
+        frame.AddColumn(OUTPUT_FILE_TORQUE_Y_NAME, torqueY);
+        frame.AddColumn(OUTPUT_FILE_TORQUE_Z_NAME, torqueZ);
+    }
+    if (out_cnt_wildcard) {
+        unsigned int j = 0;
+        for (const auto& name : m_contact_wildcard_names) {
+            frame.AddColumn(name, cnt_wildcards[j++]);
+        }
+    }
+    return frame;
 }
 
-void DEMDynamicThread::writeMeshesAsVtk(std::ofstream& ptFile) {
-    std::ostringstream ostream;
-
+MeshOutputFrame DEMDynamicThread::collectMeshesFrame() const {
+    MeshOutputFrame frame;
     std::vector<size_t> vertexOffset(m_meshes.size() + 1, 0);
     size_t total_f = 0;
     size_t total_v = 0;
@@ -1614,13 +2187,6 @@ void DEMDynamicThread::writeMeshesAsVtk(std::ofstream& ptFile) {
         mesh_num++;
     }
 
-    ostream << "# vtk DataFile Version 2.0\n";
-    ostream << "VTK from DEM simulation\n";
-    ostream << "ASCII\n";
-    ostream << "\n\n";
-
-    ostream << "DATASET UNSTRUCTURED_GRID\n";
-
     // Prescan the V and F: to write all meshes to one file, we need vertex number offset info
     mesh_num = 0;
     for (const auto& mmesh : m_meshes) {
@@ -1634,8 +2200,8 @@ void DEMDynamicThread::writeMeshesAsVtk(std::ofstream& ptFile) {
     for (unsigned int i = 1; i < m_meshes.size(); i++)
         vertexOffset[i] = vertexOffset[i] + vertexOffset[i - 1];
 
-    // Writing m_vertices
-    ostream << "POINTS " << total_v << " float" << std::endl;
+    // Vertices, in global frame
+    frame.vertices.reserve(total_v);
     mesh_num = 0;
     for (const auto& mmesh : m_meshes) {
         if (!thisMeshSkip[mesh_num]) {
@@ -1645,53 +2211,76 @@ void DEMDynamicThread::writeMeshesAsVtk(std::ofstream& ptFile) {
             for (const auto& v : mmesh->GetCoordsVertices()) {
                 float3 point = v;
                 applyFrameTransformLocalToGlobal(point, ownerPos, ownerOriQ);
-                ostream << point.x << " " << point.y << " " << point.z << std::endl;
+                frame.vertices.push_back(point);
             }
         }
         mesh_num++;
     }
 
-    // Writing faces
-    ostream << "\n\n";
-    ostream << "CELLS " << total_f << " " << 4 * total_f << std::endl;
+    // Faces, with vertex numbers offset to index into all the vertices
+    frame.faces.reserve(3 * total_f);
     mesh_num = 0;
     for (const auto& mmesh : m_meshes) {
         if (!thisMeshSkip[mesh_num]) {
             for (const auto& f : mmesh->GetIndicesVertexes()) {
-                ostream << "3 " << (size_t)f.x + vertexOffset[mesh_num] << " " << (size_t)f.y + vertexOffset[mesh_num]
-                        << " " << (size_t)f.z + vertexOffset[mesh_num] << std::endl;
+                frame.faces.push_back((size_t)f.x + vertexOffset[mesh_num]);
+                frame.faces.push_back((size_t)f.y + vertexOffset[mesh_num]);
+                frame.faces.push_back((size_t)f.z + vertexOffset[mesh_num]);
             }
         }
         mesh_num++;
     }
 
+    return frame;
+}
+
+void DEMDynamicThread::writeMeshFrameAsVtk(std::ostream& ptFile, const MeshOutputFrame& frame) {
+    std::ostringstream ostream;
+    const size_t total_v = frame.vertices.size();
+    const size_t total_f = frame.faces.size() / 3;
+
+    ostream << "# vtk DataFile Version 2.0\n";
+    ostream << "VTK from DEM simulation\n";
+    ostream << "ASCII\n";
+    ostream << "\n\n";
+
+    ostream << "DATASET UNSTRUCTURED_GRID\n";
+
+    // Writing m_vertices
+    ostream << "POINTS " << total_v << " float" << std::endl;
+    for (const auto& point : frame.vertices) {
+        ostream << point.x << " " << point.y << " " << point.z << std::endl;
+    }
+
+    // Writing faces
+    ostream << "\n\n";
+    ostream << "CELLS " << total_f << " " << 4 * total_f << std::endl;
+    for (size_t i = 0; i < total_f; i++) {
+        ostream << "3 " << frame.faces[3 * i] << " " << frame.faces[3 * i + 1] << " " << frame.faces[3 * i + 2]
+                << std::endl;
+    }
+
     // Writing face types. Type 5 is generally triangles
     ostream << "\n\n";
     ostream << "CELL_TYPES " << total_f << std::endl;
-    mesh_num = 0;
-    for (const auto& mmesh : m_meshes) {
-        if (!thisMeshSkip[mesh_num]) {
-            auto nfaces = mmesh->GetIndicesVertexes().size();
-            for (size_t j = 0; j < nfaces; j++)
-                ostream << "5 " << std::endl;
-        }
-        mesh_num++;
-    }
+    for (size_t i = 0; i < total_f; i++)
+        ostream << "5 " << std::endl;
 
     ptFile << ostream.str();
 }
 
 inline void DEMDynamicThread::contactEventArraysResize(size_t nContactPairs) {
-    DEME_TRACKED_RESIZE(idGeometryA, nContactPairs, 0);
-    DEME_TRACKED_RESIZE(idGeometryB, nContactPairs, 0);
-    DEME_TRACKED_RESIZE(contactType, nContactPairs, NOT_A_CONTACT);
+    DEME_TRACKED_RESIZE_EXACT(idGeometryA, nContactPairs, 0);
+    DEME_TRACKED_RESIZE_EXACT(idGeometryB, nContactPairs, 0);
+    DEME_TRACKED_RESIZE_EXACT(contactType, nContactPairs, NOT_A_CONTACT);
 
     if (!solverFlags.useNoContactRecord) {
-        DEME_TRACKED_RESIZE(contactForces, nContactPairs, make_float3(0));
-        DEME_TRACKED_RESIZE(contactTorque_convToForce, nContactPairs, make_float3(0));
-        DEME_TRACKED_RESIZE(contactPointGeometryA, nContactPairs, make_float3(0));
-        DEME_TRACKED_RESIZE(contactPointGeometryB, nContactPairs, make_float3(0));
+        DEME_TRACKED_RESIZE_EXACT(contactForces, nContactPairs, make_float3(0));
+        DEME_TRACKED_RESIZE_EXACT(contactTorque_convToForce, nContactPairs, make_float3(0));
+        DEME_TRACKED_RESIZE_EXACT(contactPointGeometryA, nContactPairs, make_float3(0));
+        DEME_TRACKED_RESIZE_EXACT(contactPointGeometryB, nContactPairs, make_float3(0));
     }
+    m_num_cnt_arr_reallocs++;
 
     // Re-pack pointers in case the arrays got reallocated
     granData->idGeometryA = idGeometryA.data();
@@ -1705,7 +2294,24 @@ inline void DEMDynamicThread::contactEventArraysResize(size_t nContactPairs) {
     // DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
 }
 
+inline void DEMDynamicThread::packBufferPointers() {
+    granData->idGeometryA = idGeometryA.data();
+    granData->idGeometryB = idGeometryB.data();
+    granData->contactType = contactType.data();
+    granData->contactMapping = contactMapping.data();
+    granData->idGeometryA_buffer = idGeometryA_buffer.data();
+    granData->idGeometryB_buffer = idGeometryB_buffer.data();
+    granData->contactType_buffer = contactType_buffer.data();
+    granData->contactMapping_buffer = contactMapping_buffer.data();
+
+    // kT should send its next produce to wherever the buffers are now
+    DEMDynamicThread* self = this;
+    kT->packTransferPointers(self);
+}
+
 inline void DEMDynamicThread::unpackMyBuffer() {
+    // New contact arrays are coming in; the per-owner contact index is rebuilt when it is next needed
+    ownerContactIndexStale = true;
     // Make a note on the contact number of the previous time step
     *stateOfSolver_resources.pNumPrevContacts = *stateOfSolver_resources.pNumContacts;
     // kT's batch of produce is made with this max drift in mind
@@ -1714,11 +2320,39 @@ inline void DEMDynamicThread::unpackMyBuffer() {
 
     DEME_GPU_CALL(cudaMemcpy(stateOfSolver_resources.pNumContacts, &(granData->nContactPairs_buffer), sizeof(size_t),
                              cudaMemcpyDeviceToDevice));
+    cdMetrics = cdMetrics_buffer;
+
+    if (solverFlags.useBufferSwap) {
+        // kT made sure the buffers are long enough for its produce. If they have grown longer than our contact arrays,
+        // then grow our arrays first, so that after the swap, no buffer is shorter than it used to be, and the contact
+        // arrays that do not take part in the swap are never shorter than the ones that do.
+        if (idGeometryA_buffer.size() > idGeometryA.size()) {
+            contactEventArraysResize(idGeometryA_buffer.size());
+        }
+        idGeometryA.swap(idGeometryA_buffer);
+        idGeometryB.swap(idGeometryB_buffer);
+        contactType.swap(contactType_buffer);
+        size_t swapped_bytes = (*stateOfSolver_resources.pNumContacts) * (2 * sizeof(bodyID_t) + sizeof(contact_t));
+        if (!solverFlags.isHistoryless) {
+            if (contactMapping_buffer.size() > contactMapping.size()) {
+                DEME_TRACKED_RESIZE(contactMapping, contactMapping_buffer.size(), NULL_MAPPING_PARTNER);
+            }
+            contactMapping.swap(contactMapping_buffer);
+            swapped_bytes += (*stateOfSolver_resources.pNumContacts) * sizeof(contactPairs_t);
+        }
+        packBufferPointers();
+        pSchedSupport->schedulingStats.nBytesSavedBySwap += swapped_bytes;
+        return;
+    }
 
-    // Need to resize those contact event-based arrays before usage
-    if (*stateOfSolver_resources.pNumContacts > idGeometryA.size() ||
-        *stateOfSolver_resources.pNumContacts > buffer_size) {
-        contactEventArraysResize(*stateOfSolver_resources.pNumContacts);
+    // Need to resize those contact event-based arrays before usage. They grow geometrically, and are cut back if the
+    // contact number has dropped far below their length.
+    {
+        size_t cnt_arr_len =
+            decideCntArrLength(*stateOfSolver_resources.pNumContacts, idGeometryA.size(), cntArrMinLength, true);
+        if (cnt_arr_len != idGeometryA.size()) {
+            contactEventArraysResize(cnt_arr_len);
+        }
     }
 
     DEME_GPU_CALL(cudaMemcpy(granData->idGeometryA, granData->idGeometryA_buffer,
@@ -1729,10 +2363,11 @@ inline void DEMDynamicThread::unpackMyBuffer() {
                              *stateOfSolver_resources.pNumContacts * sizeof(contact_t), cudaMemcpyDeviceToDevice));
     if (!solverFlags.isHistoryless) {
         // Note we don't have to use dedicated memory space for unpacking contactMapping_buffer contents, because we
-        // only use it once per kT update, at the time of unpacking. So let us just use a temp vector to store it. Note
-        // we cannot use vector 0 since it may hold critical flattened owner ID info.
+        // only use it once per kT update, at the time of unpacking. So let us just use a temp array to store it. It
+        // lives in the scratch scope of unpack_impl, until the contact history is migrated.
         size_t mapping_bytes = (*stateOfSolver_resources.pNumContacts) * sizeof(contactPairs_t);
-        granData->contactMapping = (contactPairs_t*)stateOfSolver_resources.allocateTempVector(1, mapping_bytes);
+        granData->contactMapping =
+            (contactPairs_t*)stateOfSolver_resources.allocateTemp("contactMapping", mapping_bytes);
         DEME_GPU_CALL(cudaMemcpy(granData->contactMapping, granData->contactMapping_buffer, mapping_bytes,
                                  cudaMemcpyDeviceToDevice));
     }
@@ -1759,7 +2394,8 @@ inline void DEMDynamicThread::sendToTheirBuffer() {
                              cudaMemcpyDeviceToDevice));
 
     // Send simulation metrics for kT's reference.
-    DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_ts, &(simParams->h), sizeof(float), cudaMemcpyDeviceToDevice));
+    DEME_GPU_CALL(
+        cudaMemcpy(granData->pKTOwnedBuffer_ts, &(granData->stepSizeForKT), sizeof(float), cudaMemcpyDeviceToDevice));
     // Note that perhapsIdealFutureDrift is non-negative, and it will be used to determine the margin size; however, if
     // scheduleHelper is instructed to have negative future drift then perhapsIdealFutureDrift no longer affects them.
     DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_maxDrift, &(granData->perhapsIdealFutureDrift),
@@ -1772,6 +2408,16 @@ inline void DEMDynamicThread::sendToTheirBuffer() {
                                  simParams->nOwnerBodies * sizeof(family_t), cudaMemcpyDeviceToDevice));
     }
 
+    // Take this chance to record how many owners are sleeping, for the statistics. kT does not need the sleep states:
+    // it keeps registering sleeper--sleeper pairs, so their contact history survives and woken owners find them.
+    if (solverFlags.useSleeping) {
+        auto scratch_scope = stateOfSolver_resources.tempScope("Sleep statistics");
+        size_t* nSleeping = (size_t*)stateOfSolver_resources.allocateTemp("nSleeping", sizeof(size_t));
+        boolSumReduce(granData->ownerSleeping, nSleeping, simParams->nOwnerBodies, streamInfo.stream,
+                      stateOfSolver_resources);
+        timers.AddSleepSample(*nSleeping, simParams->nOwnerBodies);
+    }
+
     // May need to send updated mesh
     if (solverFlags.willMeshDeform) {
         DEME_GPU_CALL(cudaMemcpy(granData->pKTOwnedBuffer_relPosNode1, granData->relPosNode1,
@@ -1790,13 +2436,13 @@ inline void DEMDynamicThread::sendToTheirBuffer() {
 }
 
 inline void DEMDynamicThread::migratePersistentContacts() {
-    // Use this newHistory and newDuration to store temporarily the rearranged contact history.  Note we cannot use
-    // vector 0 or 1 since they may be in use (1 is used by granData->contactMapping).
+    // Use this newHistory and newDuration to store temporarily the rearranged contact history. They are allocated in
+    // the scratch scope of unpack_impl, next to granData->contactMapping.
 
     // All contact wildcards are the same type, so we can just allocate one temp array for all of them
     float* newWildcards[DEME_MAX_WILDCARD_NUM];
     size_t wildcard_arr_bytes = (*stateOfSolver_resources.pNumContacts) * sizeof(float) * simParams->nContactWildcards;
-    newWildcards[0] = (float*)stateOfSolver_resources.allocateTempVector(2, wildcard_arr_bytes);
+    newWildcards[0] = (float*)stateOfSolver_resources.allocateTemp("newWildcards", wildcard_arr_bytes);
     for (unsigned int i = 1; i < simParams->nContactWildcards; i++) {
         newWildcards[i] = newWildcards[i - 1] + (*stateOfSolver_resources.pNumContacts);
     }
@@ -1804,7 +2450,8 @@ inline void DEMDynamicThread::migratePersistentContacts() {
     // This is used for checking if there are contact history got lost in the transition by surprise. But no need to
     // check if the user did not ask for it.
     size_t sentry_bytes = (*stateOfSolver_resources.pNumPrevContacts) * sizeof(notStupidBool_t);
-    notStupidBool_t* contactSentry = (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(3, sentry_bytes);
+    notStupidBool_t* contactSentry =
+        (notStupidBool_t*)stateOfSolver_resources.allocateTemp("contactSentry", sentry_bytes);
 
     // A sentry array is here to see if there exist a contact that dT thinks it's alive but kT doesn't map it to the new
     // history array. This is just a quick and rough check: we only look at the last contact wildcard to see if it is
@@ -1842,7 +2489,7 @@ inline void DEMDynamicThread::migratePersistentContacts() {
     // Take a look, does the sentry indicate that there is an `alive' contact got lost?
     if (verbosity >= VERBOSITY::STEP_METRIC) {
         if (*stateOfSolver_resources.pNumPrevContacts > 0 && simParams->nContactWildcards > 0) {
-            size_t* lostContact = (size_t*)stateOfSolver_resources.allocateTempVector(4, sizeof(size_t));
+            size_t* lostContact = (size_t*)stateOfSolver_resources.allocateTemp("lostContact", sizeof(size_t));
             boolSumReduce(contactSentry, lostContact, *stateOfSolver_resources.pNumPrevContacts, streamInfo.stream,
                           stateOfSolver_resources);
             if (*lostContact && solverFlags.isAsync) {
@@ -1871,10 +2518,13 @@ inline void DEMDynamicThread::migratePersistentContacts() {
         }
     }
 
-    // Copy new history back to history array (after resizing the `main' history array)
-    if (*stateOfSolver_resources.pNumContacts > contactWildcards[0].size()) {
+    // Copy new history back to history array (after resizing the `main' history array, following the same growth and
+    // shrink policy as the other contact arrays; its old content is not needed any more)
+    size_t wildcard_arr_len =
+        decideCntArrLength(*stateOfSolver_resources.pNumContacts, contactWildcards[0].size(), cntArrMinLength, true);
+    if (wildcard_arr_len != contactWildcards[0].size()) {
         for (unsigned int i = 0; i < simParams->nContactWildcards; i++) {
-            DEME_TRACKED_RESIZE_FLOAT(contactWildcards[i], *stateOfSolver_resources.pNumContacts, 0);
+            DEME_TRACKED_RESIZE_EXACT(contactWildcards[i], wildcard_arr_len, 0.f);
             granData->contactWildcards[i] = contactWildcards[i].data();
         }
     }
@@ -1995,6 +2645,8 @@ inline float* DEMDynamicThread::determineSysVel() {
 }
 
 inline void DEMDynamicThread::unpack_impl() {
+    // The temp arrays holding the contact mapping and the migrated history live until the end of this call
+    auto scratch_scope = stateOfSolver_resources.tempScope("History mapping");
     {
         // Acquire lock and use the content of the dynamic-owned transfer buffer
         std::lock_guard<std::mutex> lock(pSchedSupport->dynamicOwnedBuffer_AccessCoordination);
@@ -2019,16 +2671,96 @@ inline void DEMDynamicThread::unpack_impl() {
     }
 }
 
+inline void DEMDynamicThread::recordStepMetrics() {
+    nMetricsSteps++;
+    nStepsSinceMetricsStamp++;
+    if (nMetricsSteps % stepMetricsSink->GetStepInterval() != 0) {
+        return;
+    }
+    auto now = std::chrono::high_resolution_clock::now();
+    StepMetrics record = cdMetrics;
+    record.step = nMetricsSteps;
+    record.simTime = simParams->timeElapsed;
+    record.nContactPairs = *stateOfSolver_resources.pNumContacts;
+    record.perhapsIdealFutureDrift = granData->perhapsIdealFutureDrift;
+    record.nTimesDynamicHeldBack = (pSchedSupport->schedulingStats.nTimesDynamicHeldBack).load();
+    record.nTimesKinematicHeldBack = (pSchedSupport->schedulingStats.nTimesKinematicHeldBack).load();
+    record.stepWallTime = std::chrono::duration<double>(now - metricsStamp).count() / nStepsSinceMetricsStamp;
+    metricsStamp = now;
+    nStepsSinceMetricsStamp = 0;
+    stepMetricsSink->Add(record);
+}
+
 inline void DEMDynamicThread::ifProduceFreshThenUseIt() {
     if (pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh) {
         unpack_impl();
     }
 }
 
+inline void DEMDynamicThread::adaptStepSize(float maxAcc) {
+    // The contact pairs just unpacked were derived by kT with a margin that accounts for the pending (larger) step
+    // size, so it is now safe to switch to it
+    if (pendingStepSize > 0.f) {
+        simParams->h = pendingStepSize;
+        pendingStepSize = 0.f;
+    }
+    const float h = simParams->h;
+
+    // Max vel of this cycle (pCycleMaxVel holds the per-owner values at this point)
+    auto scratch_scope = stateOfSolver_resources.tempScope("Step size adaptation");
+    float* pMaxVel = (float*)stateOfSolver_resources.allocateTemp("pMaxVel", sizeof(float));
+    floatMaxReduce(pCycleMaxVel, pMaxVel, simParams->nOwnerBodies, streamInfo.stream, stateOfSolver_resources);
+    const float maxVel = *pMaxVel;
+
+    float target_h;
+    switch (solverFlags.stepSizeStrat) {
+        case (VAR_TS_STRAT::MAX_VEL):
+            // The fastest entity should move at most stepSizeTolerance in one step
+            target_h = (maxVel > DEME_TINY_FLOAT) ? solverFlags.stepSizeTolerance / maxVel : solverFlags.maxStepSize;
+            break;
+        case (VAR_TS_STRAT::INT_GAP):
+            // The position difference between a first-order and a second-order update, 0.5 * a * h^2, should be at
+            // most stepSizeTolerance
+            target_h = (maxAcc > DEME_TINY_FLOAT) ? std::sqrt(2.f * solverFlags.stepSizeTolerance / maxAcc)
+                                                  : solverFlags.maxStepSize;
+            break;
+        default:
+            return;
+    }
+    // Growing too fast is not good for the stability, and shrinking is never a safety concern
+    target_h = DEME_MIN(target_h, h * MAX_STEP_SIZE_GROWTH_RATE);
+    // If the margin is user-fixed, kT will not enlarge it for us, so the step size has to fit in it
+    if (solverFlags.isExpandFactorFixed && maxVel > DEME_TINY_FLOAT) {
+        const float drift = (float)DEME_MAX(granData->perhapsIdealFutureDrift, 1u);
+        target_h = DEME_MIN(target_h, simParams->beta / (maxVel * drift));
+    }
+    target_h = hostClampBetween<float, float>(target_h, solverFlags.minStepSize, solverFlags.maxStepSize);
+
+    if (target_h <= h) {
+        simParams->h = target_h;
+    } else {
+        // A larger step size is only used after kT produces contact pairs with a margin that is thick enough for it
+        pendingStepSize = target_h;
+    }
+    granData->stepSizeForKT = DEME_MAX(simParams->h, pendingStepSize);
+    DEME_DEBUG_PRINTF("Step size is %.7g, pending step size is %.7g", simParams->h, pendingStepSize);
+}
+
 inline void DEMDynamicThread::calibrateParams() {
+    // The int_diff step size strategy needs max acc. It is queried first because the max vel inspector returns a temp
+    // array that any inspector call would overwrite.
+    float maxAcc = 0.f;
+    if (solverFlags.stepSizeStrat == VAR_TS_STRAT::INT_GAP) {
+        maxAcc = *(approxMaxAccFunc->dT_GetValue());
+    }
+
     // Unpacking is done; now we can use temp arrays again to derive max velocity and send to kT
     pCycleMaxVel = determineSysVel();
 
+    if (!solverFlags.isStepConst) {
+        adaptStepSize(maxAcc);
+    }
+
     if (solverFlags.autoUpdateFreq) {
         unsigned int comfortable_drift;
         if (accumStepUpdater.Query(comfortable_drift)) {
@@ -2065,6 +2797,7 @@ inline void DEMDynamicThread::ifProduceFreshThenUseItAndSendNewOrder() {
         pSchedSupport->kinematicOwned_Cons2ProdBuffer_isFresh = true;
         pSchedSupport->schedulingStats.nKinematicUpdates++;
         accumStepUpdater.AddUpdate();
+        timers.MarkEvent("Work order handed to kT");
 
         timers.GetTimer("Send to kT buffer").stop();
         // Signal the kinematic that it has data for a new work order
@@ -2125,6 +2858,7 @@ void DEMDynamicThread::workerThread() {
             contactPairArr_isFresh = true;
             pSchedSupport->schedulingStats.nKinematicUpdates++;
             accumStepUpdater.AddUpdate();
+            timers.MarkEvent("Work order handed to kT");
             // Signal the kinematic that it has data for a new work order.
             pSchedSupport->cv_KinematicCanProceed.notify_all();
             // Then dT will wait for kT to finish one initial run
@@ -2144,6 +2878,9 @@ void DEMDynamicThread::workerThread() {
             }
         }
 
+        // Time between user calls does not count toward the step wall time
+        metricsStamp = std::chrono::high_resolution_clock::now();
+        nStepsSinceMetricsStamp = 0;
         for (double cycle = 0.0; cycle < cycleDuration; cycle += (double)(simParams->h)) {
             // If the produce is fresh, use it, and then send kT a new work order.
             // We used to send work order to kT whenever kT unpacks its buffer. This can lead to a situation where dT
@@ -2177,7 +2914,8 @@ void DEMDynamicThread::workerThread() {
             // dynamicOwned_Prod2ConsBuffer_isFresh is false so ifProduceFreshThenUseItAndSendNewOrder didn't run, then
             // kT has to be in the process of doing a CD, we still will not be locked here.
 
-            // If using variable ts size, only when a step is accepted can we move on
+            // Variable step size is decided once per kT update cycle (see adaptStepSize), so every step is accepted
+            // here. This loop is a placeholder for step-rejecting strategies.
             bool step_accepted = false;
             do {
                 calculateForces();
@@ -2189,7 +2927,7 @@ void DEMDynamicThread::workerThread() {
                 timers.GetTimer("Integration").stop();
 
                 step_accepted = true;
-            } while ((!solverFlags.isStepConst) || (!step_accepted));
+            } while (!step_accepted);
 
             // CalculateForces is done, set contactPairArr_isFresh to false
             // This will be set to true next time it receives an update from kT
@@ -2205,8 +2943,11 @@ void DEMDynamicThread::workerThread() {
             nTotalSteps++;
             accumStepUpdater.AddStep();
 
-            //// TODO: make changes for variable time step size cases
             simParams->timeElapsed += (double)simParams->h;
+
+            if (stepMetricsSink) {
+                recordStepMetrics();
+            }
         }
 
         // Unless the user did something critical, must we wait for a kT update before next step
@@ -2257,41 +2998,41 @@ size_t DEMDynamicThread::estimateMemUsage() const {
 void DEMDynamicThread::jitifyKernels(const std::unordered_map<std::string, std::string>& Subs) {
     // First one is force array preparation kernels
     {
-        prep_force_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        prep_force_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMPrepForceKernels", JitHelper::KERNEL_DIR / "DEMPrepForceKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
     }
     // Then force calculation kernels
     {
-        cal_force_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        cal_force_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMCalcForceKernels", JitHelper::KERNEL_DIR / "DEMCalcForceKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
     }
     // Then force accumulation kernels
     if (solverFlags.useCubForceCollect) {
-        collect_force_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        collect_force_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMCollectForceKernels", JitHelper::KERNEL_DIR / "DEMCollectForceKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
     } else {
-        collect_force_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        collect_force_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMCollectForceKernels_Compact", JitHelper::KERNEL_DIR / "DEMCollectForceKernels_Compact.cu", Subs,
             DEME_JITIFY_OPTIONS)));
     }
     // Then integration kernels
     {
-        integrator_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        integrator_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMIntegrationKernels", JitHelper::KERNEL_DIR / "DEMIntegrationKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
     }
     // Then kernels that are... wildcards, which make on-the-fly changes to solver data
     if (solverFlags.canFamilyChange) {
-        mod_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        mod_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMModeratorKernels", JitHelper::KERNEL_DIR / "DEMModeratorKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
     }
     // Then misc kernels
     {
-        misc_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        misc_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMMiscKernels", JitHelper::KERNEL_DIR / "DEMMiscKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
     }
 }
 
-float* DEMDynamicThread::inspectCall(const std::shared_ptr<jitify::Program>& inspection_kernel,
+float* DEMDynamicThread::inspectCall(const std::shared_ptr<JitProgram>& inspection_kernel,
                                      const std::string& kernel_name,
                                      INSPECT_ENTITY_TYPE thing_to_insp,
                                      CUB_REDUCE_FLAVOR reduce_flavor,
@@ -2311,17 +3052,20 @@ float* DEMDynamicThread::inspectCall(const std::shared_ptr<jitify::Program>& ins
             owner_type = OWNER_T_CLUMP | OWNER_T_MESH | OWNER_T_ANALYTICAL;
             break;
     }
-    // We can use temp vectors as we please
+    // The arrays we return are read by the caller after this call ends, so they cannot be temp arrays
     size_t quarryTempSize = n * sizeof(float);
-    float* resArr = (float*)stateOfSolver_resources.allocateTempVector(1, quarryTempSize);
+    float* resArr = (float*)stateOfSolver_resources.allocateRetained("inspectionValues", quarryTempSize);
+    // For the rest, we can use temp arrays as we please
+    auto scratch_scope = stateOfSolver_resources.tempScope("Inspection");
     size_t regionTempSize = n * sizeof(notStupidBool_t);
     // If this boolArrExclude is 1 at an element, that means this element is exluded in the reduction
-    notStupidBool_t* boolArrExclude = (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(2, regionTempSize);
+    notStupidBool_t* boolArrExclude =
+        (notStupidBool_t*)stateOfSolver_resources.allocateTemp("boolArrExclude", regionTempSize);
     DEME_GPU_CALL(cudaMemset(boolArrExclude, 0, regionTempSize));
 
     // We may actually have 2 reduced returns: in regional reduction, key 0 and 1 give one return each.
     size_t returnSize = sizeof(float) * 2;
-    float* res = (float*)stateOfSolver_resources.allocateTempVector(3, returnSize);
+    float* res = (float*)stateOfSolver_resources.allocateRetained("inspectionResult", returnSize);
     size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
     inspection_kernel->kernel(kernel_name)
         .instantiate()
@@ -2348,9 +3092,9 @@ float* DEMDynamicThread::inspectCall(const std::shared_ptr<jitify::Program>& ins
     } else {
         // Extra arrays are needed for sort and reduce by key
         notStupidBool_t* boolArrExclude_sorted =
-            (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(4, regionTempSize);
-        float* resArr_sorted = (float*)stateOfSolver_resources.allocateTempVector(5, quarryTempSize);
-        size_t* num_unique_out = (size_t*)stateOfSolver_resources.allocateTempVector(6, sizeof(size_t));
+            (notStupidBool_t*)stateOfSolver_resources.allocateTemp("boolArrExclude_sorted", regionTempSize);
+        float* resArr_sorted = (float*)stateOfSolver_resources.allocateTemp("resArr_sorted", quarryTempSize);
+        size_t* num_unique_out = (size_t*)stateOfSolver_resources.allocateTemp("num_unique_out", sizeof(size_t));
         switch (reduce_flavor) {
             case (CUB_REDUCE_FLAVOR::SUM):
                 // Sort first
@@ -2406,6 +3150,12 @@ void DEMDynamicThread::setSimTime(double time) {
     simParams->timeElapsed = time;
 }
 
+void DEMDynamicThread::setStepSize(double ts) {
+    simParams->h = ts;
+    granData->stepSizeForKT = ts;
+    pendingStepSize = 0.f;
+}
+
 float DEMDynamicThread::getUpdateFreq() const {
     return (float)((pSchedSupport->dynamicMaxFutureDrift).load()) / 2.;
 }
@@ -2430,18 +3180,12 @@ void DEMDynamicThread::setFamilyMeshMaterial(unsigned int N, unsigned int mat_id
 size_t DEMDynamicThread::getOwnerContactForces(bodyID_t ownerID,
                                                std::vector<float3>& points,
                                                std::vector<float3>& forces) {
-    size_t numCnt = *stateOfSolver_resources.pNumContacts;
+    ensureOwnerContactIndex();
     size_t numUsefulCnt = 0;
-    for (size_t i = 0; i < numCnt; i++) {
+    for (size_t j = ownerContactOffsets.at(ownerID); j < ownerContactOffsets.at(ownerID + 1); j++) {
+        size_t i = ownerContactIDs[j];
         bodyID_t geoA = idGeometryA.at(i);
         bodyID_t ownerA = ownerClumpBody.at(geoA);
-        bodyID_t geoB = idGeometryB.at(i);
-        contact_t typeB = contactType.at(i);
-        bodyID_t ownerB = getOwnerForContactB(geoB, typeB);
-
-        if ((ownerID != ownerA) && (ownerID != ownerB)) {
-            continue;
-        }
         float3 force = contactForces[i];
         if (length(force) < DEME_TINY_FLOAT) {
             continue;
@@ -2484,18 +3228,12 @@ size_t DEMDynamicThread::getOwnerContactForces(bodyID_t ownerID,
                                                std::vector<float3>& forces,
                                                std::vector<float3>& torques,
                                                bool torque_in_local) {
-    size_t numCnt = *stateOfSolver_resources.pNumContacts;
+    ensureOwnerContactIndex();
     size_t numUsefulCnt = 0;
-    for (size_t i = 0; i < numCnt; i++) {
+    for (size_t j = ownerContactOffsets.at(ownerID); j < ownerContactOffsets.at(ownerID + 1); j++) {
+        size_t i = ownerContactIDs[j];
         bodyID_t geoA = idGeometryA.at(i);
         bodyID_t ownerA = ownerClumpBody.at(geoA);
-        bodyID_t geoB = idGeometryB.at(i);
-        contact_t typeB = contactType.at(i);
-        bodyID_t ownerB = getOwnerForContactB(geoB, typeB);
-
-        if ((ownerID != ownerA) && (ownerID != ownerB)) {
-            continue;
-        }
         float3 force = contactForces[i];
         // Note torque, like force, is in global
         float3 torque = contactTorque_convToForce[i];
@@ -2548,6 +3286,82 @@ size_t DEMDynamicThread::getOwnerContactForces(bodyID_t ownerID,
     return numUsefulCnt;
 }
 
+void DEMDynamicThread::buildOwnerContactIndex() {
+    size_t numCnt = *stateOfSolver_resources.pNumContacts;
+    size_t nOwners = simParams->nOwnerBodies;
+    // A counting sort of the contacts by owner. A contact is listed under both of its owners; the pass that scatters
+    // them goes in contact order, so each owner's list is in contact array order too.
+    ownerContactOffsets.assign(nOwners + 1, 0);
+    for (size_t i = 0; i < numCnt; i++) {
+        bodyID_t ownerA = ownerClumpBody.at(idGeometryA.at(i));
+        bodyID_t ownerB = getOwnerForContactB(idGeometryB.at(i), contactType.at(i));
+        ownerContactOffsets.at(ownerA + 1)++;
+        if (ownerB != ownerA) {
+            ownerContactOffsets.at(ownerB + 1)++;
+        }
+    }
+    std::partial_sum(ownerContactOffsets.begin(), ownerContactOffsets.end(), ownerContactOffsets.begin());
+    ownerContactIDs.resize(ownerContactOffsets[nOwners]);
+    std::vector<size_t> fill_pos(ownerContactOffsets.begin(), ownerContactOffsets.end() - 1);
+    for (size_t i = 0; i < numCnt; i++) {
+        bodyID_t ownerA = ownerClumpBody[idGeometryA[i]];
+        bodyID_t ownerB = getOwnerForContactB(idGeometryB[i], contactType[i]);
+        ownerContactIDs[fill_pos[ownerA]++] = i;
+        if (ownerB != ownerA) {
+            ownerContactIDs[fill_pos[ownerB]++] = i;
+        }
+    }
+    ownerContactIndexStale = false;
+}
+
+std::vector<bodyID_t> DEMDynamicThread::getOwnerContactClumps(bodyID_t ownerID) {
+    ensureOwnerContactIndex();
+    ownerType_t this_type = ownerTypes.at(ownerID);
+    std::vector<bodyID_t> clumps_in_cnt;
+    for (size_t j = ownerContactOffsets.at(ownerID); j < ownerContactOffsets.at(ownerID + 1); j++) {
+        size_t i = ownerContactIDs[j];
+        contact_t cnt_type = contactType[i];
+        bodyID_t ownerA = ownerClumpBody[idGeometryA[i]];
+        switch (this_type) {
+            case OWNER_T_CLUMP:
+                if (cnt_type == SPHERE_SPHERE_CONTACT) {
+                    clumps_in_cnt.push_back((ownerA == ownerID) ? ownerClumpBody[idGeometryB[i]] : ownerA);
+                }
+                break;
+            // A mesh or an analytical object can only be geometry B, and the contact type needs to match
+            case OWNER_T_MESH:
+                if (cnt_type == SPHERE_MESH_CONTACT) {
+                    clumps_in_cnt.push_back(ownerA);
+                }
+                break;
+            case OWNER_T_ANALYTICAL:
+                if (cnt_type >= SPHERE_PLANE_CONTACT) {
+                    clumps_in_cnt.push_back(ownerA);
+                }
+                break;
+        }
+    }
+    return clumps_in_cnt;
+}
+
+void DEMDynamicThread::getClumpContactPairs(std::vector<bodyID_t>& idA, std::vector<bodyID_t>& idB) {
+    ensureOwnerContactIndex();
+    idA.clear();
+    idB.clear();
+    // Going through owners in order, and only picking up contacts under their owner A, gives the pairs already sorted
+    // by owner A (ties in contact array order)
+    for (size_t ownerID = 0; ownerID < simParams->nOwnerBodies; ownerID++) {
+        for (size_t j = ownerContactOffsets[ownerID]; j < ownerContactOffsets[ownerID + 1]; j++) {
+            size_t i = ownerContactIDs[j];
+            if (contactType[i] != SPHERE_SPHERE_CONTACT || ownerClumpBody[idGeometryA[i]] != ownerID) {
+                continue;
+            }
+            idA.push_back(ownerID);
+            idB.push_back(ownerClumpBody[idGeometryB[i]]);
+        }
+    }
+}
+
 void DEMDynamicThread::setFamilyContactWildcardValueAny(unsigned int N, unsigned int wc_num, float val) {
     size_t numCnt = *stateOfSolver_resources.pNumContacts;
     for (size_t i = 0; i < numCnt; i++) {
@@ -2779,6 +3593,131 @@ void DEMDynamicThread::setOwnerVel(bodyID_t ownerID, float3 vel) {
     vZ.at(ownerID) = vel.z;
 }
 
+bodyID_t* DEMDynamicThread::prepBulkOwnerAccess(const bodyID_t* IDs, size_t n, size_t buffer_bytes, void*& dBuffer) {
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    // The caller uses these arrays after this call returns, so they are retained arrays rather than temp ones
+    dBuffer = stateOfSolver_resources.allocateRetained("bulkAccessBuffer", buffer_bytes);
+    if (IDs == NULL) {
+        return NULL;
+    }
+    size_t IDSize = n * sizeof(bodyID_t);
+    bodyID_t* dIDs = (bodyID_t*)stateOfSolver_resources.allocateRetained("bulkAccessIDs", IDSize);
+    DEME_GPU_CALL(cudaMemcpy(dIDs, IDs, IDSize, cudaMemcpyHostToDevice));
+    return dIDs;
+}
+
+void DEMDynamicThread::getOwnersFloat3(const float* arrX,
+                                       const float* arrY,
+                                       const float* arrZ,
+                                       const bodyID_t* IDs,
+                                       bodyID_t start,
+                                       size_t n,
+                                       float3* res) {
+    if (n == 0)
+        return;
+    void* dRes;
+    bodyID_t* dIDs = prepBulkOwnerAccess(IDs, n, n * sizeof(float3), dRes);
+    size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("getOwnerFloat3")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(arrX, arrY, arrZ, dIDs, start, (float3*)dRes, n);
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpy(res, dRes, n * sizeof(float3), cudaMemcpyDeviceToHost));
+}
+
+void DEMDynamicThread::setOwnersFloat3(float* arrX,
+                                       float* arrY,
+                                       float* arrZ,
+                                       const bodyID_t* IDs,
+                                       bodyID_t start,
+                                       size_t n,
+                                       const float3* vals) {
+    if (n == 0)
+        return;
+    void* dVals;
+    bodyID_t* dIDs = prepBulkOwnerAccess(IDs, n, n * sizeof(float3), dVals);
+    DEME_GPU_CALL(cudaMemcpy(dVals, vals, n * sizeof(float3), cudaMemcpyHostToDevice));
+    size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("setOwnerFloat3")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(arrX, arrY, arrZ, dIDs, start, (const float3*)dVals, n);
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+}
+
+void DEMDynamicThread::getOwnersPos(const bodyID_t* IDs, bodyID_t start, size_t n, float3* pos) {
+    if (n == 0)
+        return;
+    void* dPos;
+    bodyID_t* dIDs = prepBulkOwnerAccess(IDs, n, n * sizeof(float3), dPos);
+    size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("getOwnerPositions")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(simParams, granData, dIDs, start, (float3*)dPos, n);
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpy(pos, dPos, n * sizeof(float3), cudaMemcpyDeviceToHost));
+}
+
+void DEMDynamicThread::setOwnersPos(const bodyID_t* IDs, bodyID_t start, size_t n, const float3* pos) {
+    if (n == 0)
+        return;
+    void* dPos;
+    bodyID_t* dIDs = prepBulkOwnerAccess(IDs, n, n * sizeof(float3), dPos);
+    DEME_GPU_CALL(cudaMemcpy(dPos, pos, n * sizeof(float3), cudaMemcpyHostToDevice));
+    size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("setOwnerPositions")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(simParams, granData, dIDs, start, (const float3*)dPos, n);
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+}
+
+void DEMDynamicThread::getOwnersOriQ(const bodyID_t* IDs, bodyID_t start, size_t n, float4* oriQ) {
+    if (n == 0)
+        return;
+    void* dOriQ;
+    bodyID_t* dIDs = prepBulkOwnerAccess(IDs, n, n * sizeof(float4), dOriQ);
+    size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("getOwnerOriQs")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(granData, dIDs, start, (float4*)dOriQ, n);
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+    DEME_GPU_CALL(cudaMemcpy(oriQ, dOriQ, n * sizeof(float4), cudaMemcpyDeviceToHost));
+}
+
+void DEMDynamicThread::setOwnersOriQ(const bodyID_t* IDs, bodyID_t start, size_t n, const float4* oriQ) {
+    if (n == 0)
+        return;
+    void* dOriQ;
+    bodyID_t* dIDs = prepBulkOwnerAccess(IDs, n, n * sizeof(float4), dOriQ);
+    DEME_GPU_CALL(cudaMemcpy(dOriQ, oriQ, n * sizeof(float4), cudaMemcpyHostToDevice));
+    size_t blocks_needed = (n + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
+    misc_kernels->kernel("setOwnerOriQs")
+        .instantiate()
+        .configure(dim3(blocks_needed), dim3(DEME_MAX_THREADS_PER_BLOCK), 0, streamInfo.stream)
+        .launch(granData, dIDs, start, (const float4*)dOriQ, n);
+    DEME_GPU_CALL(cudaStreamSynchronize(streamInfo.stream));
+}
+
+void DEMDynamicThread::getOwnersVel(const bodyID_t* IDs, bodyID_t start, size_t n, float3* vel) {
+    getOwnersFloat3(vX.data(), vY.data(), vZ.data(), IDs, start, n, vel);
+}
+
+void DEMDynamicThread::getOwnersAngVel(const bodyID_t* IDs, bodyID_t start, size_t n, float3* angVel) {
+    getOwnersFloat3(omgBarX.data(), omgBarY.data(), omgBarZ.data(), IDs, start, n, angVel);
+}
+
+void DEMDynamicThread::setOwnersVel(const bodyID_t* IDs, bodyID_t start, size_t n, const float3* vel) {
+    setOwnersFloat3(vX.data(), vY.data(), vZ.data(), IDs, start, n, vel);
+}
+
+void DEMDynamicThread::setOwnersAngVel(const bodyID_t* IDs, bodyID_t start, size_t n, const float3* angVel) {
+    setOwnersFloat3(omgBarX.data(), omgBarY.data(), omgBarZ.data(), IDs, start, n, angVel);
+}
+
 void DEMDynamicThread::setTriNodeRelPos(size_t start, const std::vector<DEMTriangle>& triangles) {
     for (size_t i = 0; i < triangles.size(); i++) {
         relPosNode1[start + i] = triangles[i].p1;
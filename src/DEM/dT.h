@@ -13,7 +13,7 @@
 #include <set>
 
 #include <core/ApiVersion.h>
-#include <core/utils/ManagedAllocator.hpp>
+#include <core/utils/AllocatorPolicy.hpp>
 #include <core/utils/ThreadManager.h>
 #include <core/utils/GpuManager.h>
 #include <nvmath/helper_math.cuh>
@@ -23,13 +23,13 @@
 #include <DEM/Defines.h>
 #include <DEM/Structs.h>
 #include <DEM/AuxClasses.h>
+#include <DEM/utils/BinaryFrame.hpp>
+#include <DEM/utils/StepMetrics.hpp>
 
 // #include <core/utils/JitHelper.h>
 
-// Forward declare jitify::Program to avoid downstream dependency
-namespace jitify {
-class Program;
-}
+// Forward declare JitProgram to avoid downstream dependency on jitify
+class JitProgram;
 
 namespace deme {
 
@@ -38,6 +38,12 @@ class DEMKinematicThread;
 class DEMDynamicThread;
 class DEMSolverStateData;
 
+// Snapshot of all (output-enabled) meshes: vertices in the global frame, and 3 vertex numbers per face
+struct MeshOutputFrame {
+    std::vector<float3> vertices;
+    std::vector<size_t> faces;
+};
+
 /// DynamicThread class
 class DEMDynamicThread {
   protected:
@@ -57,27 +63,24 @@ class DEMDynamicThread {
     // Friend system DEMKinematicThread
     DEMKinematicThread* kT;
 
-    // Number of items in the buffer array (which is not a managed vector, due to our need to explicitly control where
-    // it is allocated)
-    size_t buffer_size = 0;
-
     // Object which stores the device and stream IDs for this thread
     GpuManager::StreamInfo streamInfo;
 
-    // A class that contains scratch pad and system status data (constructed with the number of temp arrays we need)
-    DEMSolverStateData stateOfSolver_resources = DEMSolverStateData(7);
+    // A class that contains scratch pad and system status data (including the arena the temp arrays come from)
+    DEMSolverStateData stateOfSolver_resources;
 
     // The number of for iterations dT does for a specific user "run simulation" call
     double cycleDuration;
 
-    // Buffer arrays for storing info from the dT side.
-    // kT modifies these arrays; dT uses them only.
+    // Buffer arrays for storing info from the kT side.
+    // kT modifies these arrays; dT uses them only. When kT and dT share a device, dT takes in kT's produce by swapping
+    // these with its working arrays (ping-pong), rather than copying them over.
 
     // dT gets contact pair/location/history map info from kT
-    // std::vector<bodyID_t, ManagedAllocator<bodyID_t>> idGeometryA_buffer;
-    // std::vector<bodyID_t, ManagedAllocator<bodyID_t>> idGeometryB_buffer;
-    // std::vector<contact_t, ManagedAllocator<contact_t>> contactType_buffer;
-    // std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>> contactMapping_buffer;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> idGeometryA_buffer;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> idGeometryB_buffer;
+    std::vector<contact_t, DEMEAllocator<contact_t>> contactType_buffer;
+    std::vector<contactPairs_t, DEMEAllocator<contactPairs_t>> contactMapping_buffer;
 
     // Pointers to simulation params-related arrays
     DEMSimParams* simParams;
@@ -92,138 +95,144 @@ class DEMDynamicThread {
 
     // Those are the smaller ones, the unique, template ones
     // The mass values
-    std::vector<float, ManagedAllocator<float>> massOwnerBody;
+    std::vector<float, DEMEAllocator<float>> massOwnerBody;
 
     // The components of MOI values
-    std::vector<float, ManagedAllocator<float>> mmiXX;
-    std::vector<float, ManagedAllocator<float>> mmiYY;
-    std::vector<float, ManagedAllocator<float>> mmiZZ;
+    std::vector<float, DEMEAllocator<float>> mmiXX;
+    std::vector<float, DEMEAllocator<float>> mmiYY;
+    std::vector<float, DEMEAllocator<float>> mmiZZ;
 
     // Volume values
-    std::vector<float, ManagedAllocator<float>> volumeOwnerBody;
+    std::vector<float, DEMEAllocator<float>> volumeOwnerBody;
 
     // The distinct sphere radii values
-    std::vector<float, ManagedAllocator<float>> radiiSphere;
+    std::vector<float, DEMEAllocator<float>> radiiSphere;
 
     // The distinct sphere local position (wrt CoM) values
-    std::vector<float, ManagedAllocator<float>> relPosSphereX;
-    std::vector<float, ManagedAllocator<float>> relPosSphereY;
-    std::vector<float, ManagedAllocator<float>> relPosSphereZ;
+    std::vector<float, DEMEAllocator<float>> relPosSphereX;
+    std::vector<float, DEMEAllocator<float>> relPosSphereY;
+    std::vector<float, DEMEAllocator<float>> relPosSphereZ;
 
     // Triangles (templates) are given a special place (unlike other analytical shapes), b/c we expect them to appear
     // frequently as meshes.
-    std::vector<float3, ManagedAllocator<float3>> relPosNode1;
-    std::vector<float3, ManagedAllocator<float3>> relPosNode2;
-    std::vector<float3, ManagedAllocator<float3>> relPosNode3;
+    std::vector<float3, DEMEAllocator<float3>> relPosNode1;
+    std::vector<float3, DEMEAllocator<float3>> relPosNode2;
+    std::vector<float3, DEMEAllocator<float3>> relPosNode3;
 
     // External object's components may need the following arrays to store some extra defining features of them. We
     // assume there are usually not too many of them in a simulation.
     // Relative position w.r.t. the owner. For example, the following 3 arrays may hold center points for plates, or tip
     // positions for cones.
-    std::vector<float, ManagedAllocator<float>> relPosEntityX;
-    std::vector<float, ManagedAllocator<float>> relPosEntityY;
-    std::vector<float, ManagedAllocator<float>> relPosEntityZ;
+    std::vector<float, DEMEAllocator<float>> relPosEntityX;
+    std::vector<float, DEMEAllocator<float>> relPosEntityY;
+    std::vector<float, DEMEAllocator<float>> relPosEntityZ;
     // Some orientation specifiers. For example, the following 3 arrays may hold normal vectors for planes, or center
     // axis vectors for cylinders.
-    std::vector<float, ManagedAllocator<float>> oriEntityX;
-    std::vector<float, ManagedAllocator<float>> oriEntityY;
-    std::vector<float, ManagedAllocator<float>> oriEntityZ;
+    std::vector<float, DEMEAllocator<float>> oriEntityX;
+    std::vector<float, DEMEAllocator<float>> oriEntityY;
+    std::vector<float, DEMEAllocator<float>> oriEntityZ;
     // Some size specifiers. For example, the following 3 arrays may hold top, bottom and length information for finite
     // cylinders.
-    std::vector<float, ManagedAllocator<float>> sizeEntity1;
-    std::vector<float, ManagedAllocator<float>> sizeEntity2;
-    std::vector<float, ManagedAllocator<float>> sizeEntity3;
+    std::vector<float, DEMEAllocator<float>> sizeEntity1;
+    std::vector<float, DEMEAllocator<float>> sizeEntity2;
+    std::vector<float, DEMEAllocator<float>> sizeEntity3;
 
     // What type is this owner? Clump? Analytical object? Meshed object?
-    std::vector<ownerType_t, ManagedAllocator<ownerType_t>> ownerTypes;
+    std::vector<ownerType_t, DEMEAllocator<ownerType_t>> ownerTypes;
 
     // Those are the large ones, ones that have the same length as the number of clumps
     // The mass/MOI offsets
-    std::vector<inertiaOffset_t, ManagedAllocator<inertiaOffset_t>> inertiaPropOffsets;
+    std::vector<inertiaOffset_t, DEMEAllocator<inertiaOffset_t>> inertiaPropOffsets;
 
     // Clump's family identification code. Used in determining whether they can be contacts between two families, and
     // whether a family has prescribed motions.
-    std::vector<family_t, ManagedAllocator<family_t>> familyID;
+    std::vector<family_t, DEMEAllocator<family_t>> familyID;
 
     // The (impl-level) family IDs whose entities should not be outputted to files
-    std::vector<family_t, ManagedAllocator<family_t>> familiesNoOutput;
+    std::vector<family_t, DEMEAllocator<family_t>> familiesNoOutput;
 
     // The voxel ID (split into 3 parts, representing XYZ location)
-    std::vector<voxelID_t, ManagedAllocator<voxelID_t>> voxelID;
+    std::vector<voxelID_t, DEMEAllocator<voxelID_t>> voxelID;
 
     // The XYZ local location inside a voxel
-    std::vector<subVoxelPos_t, ManagedAllocator<subVoxelPos_t>> locX;
-    std::vector<subVoxelPos_t, ManagedAllocator<subVoxelPos_t>> locY;
-    std::vector<subVoxelPos_t, ManagedAllocator<subVoxelPos_t>> locZ;
+    std::vector<subVoxelPos_t, DEMEAllocator<subVoxelPos_t>> locX;
+    std::vector<subVoxelPos_t, DEMEAllocator<subVoxelPos_t>> locY;
+    std::vector<subVoxelPos_t, DEMEAllocator<subVoxelPos_t>> locZ;
 
     // The clump quaternion
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQw;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQx;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQy;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQz;
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQw;
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQx;
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQy;
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQz;
 
     // Linear velocity
-    std::vector<float, ManagedAllocator<float>> vX;
-    std::vector<float, ManagedAllocator<float>> vY;
-    std::vector<float, ManagedAllocator<float>> vZ;
+    std::vector<float, DEMEAllocator<float>> vX;
+    std::vector<float, DEMEAllocator<float>> vY;
+    std::vector<float, DEMEAllocator<float>> vZ;
 
     // Local angular velocity
-    std::vector<float, ManagedAllocator<float>> omgBarX;
-    std::vector<float, ManagedAllocator<float>> omgBarY;
-    std::vector<float, ManagedAllocator<float>> omgBarZ;
+    std::vector<float, DEMEAllocator<float>> omgBarX;
+    std::vector<float, DEMEAllocator<float>> omgBarY;
+    std::vector<float, DEMEAllocator<float>> omgBarZ;
 
     // Linear acceleration
-    std::vector<float, ManagedAllocator<float>> aX;
-    std::vector<float, ManagedAllocator<float>> aY;
-    std::vector<float, ManagedAllocator<float>> aZ;
+    std::vector<float, DEMEAllocator<float>> aX;
+    std::vector<float, DEMEAllocator<float>> aY;
+    std::vector<float, DEMEAllocator<float>> aZ;
 
     // Local angular acceleration
-    std::vector<float, ManagedAllocator<float>> alphaX;
-    std::vector<float, ManagedAllocator<float>> alphaY;
-    std::vector<float, ManagedAllocator<float>> alphaZ;
+    std::vector<float, DEMEAllocator<float>> alphaX;
+    std::vector<float, DEMEAllocator<float>> alphaY;
+    std::vector<float, DEMEAllocator<float>> alphaZ;
 
     // If true, the acceleration is specified for this owner and the prep force kernel should not clear its value in the
     // next time step.
-    std::vector<notStupidBool_t, ManagedAllocator<notStupidBool_t>> accSpecified;
-    std::vector<notStupidBool_t, ManagedAllocator<notStupidBool_t>> angAccSpecified;
+    std::vector<notStupidBool_t, DEMEAllocator<notStupidBool_t>> accSpecified;
+    std::vector<notStupidBool_t, DEMEAllocator<notStupidBool_t>> angAccSpecified;
+
+    // Whether an owner is sleeping, and the number of consecutive quiet steps it has had (only used if sleeping is
+    // enabled)
+    std::vector<notStupidBool_t, DEMEAllocator<notStupidBool_t>> ownerSleeping;
+    std::vector<unsigned int, DEMEAllocator<unsigned int>> ownerQuietSteps;
 
     // Contact pair/location, for dT's personal use!!
-    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> idGeometryA;
-    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> idGeometryB;
-    std::vector<contact_t, ManagedAllocator<contact_t>> contactType;
-    // std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>> contactMapping;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> idGeometryA;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> idGeometryB;
+    std::vector<contact_t, DEMEAllocator<contact_t>> contactType;
+    // The map from the previous contact array to the current one (only used when buffers are swapped)
+    std::vector<contactPairs_t, DEMEAllocator<contactPairs_t>> contactMapping;
 
     // Some of dT's own work arrays
     // Force of each contact event. It is the force that bodyA feels. They are in global.
-    std::vector<float3, ManagedAllocator<float3>> contactForces;
+    std::vector<float3, DEMEAllocator<float3>> contactForces;
     // An imaginary `force' in each contact event that produces torque only, and does not affect the linear motion. It
     // will rise in our default rolling resistance model, which is just a torque model; yet, our contact registration is
     // contact pair-based, meaning we do not know the specs of each contact body, so we can register force only, not
     // torque. Therefore, this vector arises. This force-like torque is in global.
-    std::vector<float3, ManagedAllocator<float3>> contactTorque_convToForce;
+    std::vector<float3, DEMEAllocator<float3>> contactTorque_convToForce;
     // Local position of contact point of contact w.r.t. the reference frame of body A and B
-    std::vector<float3, ManagedAllocator<float3>> contactPointGeometryA;
-    std::vector<float3, ManagedAllocator<float3>> contactPointGeometryB;
+    std::vector<float3, DEMEAllocator<float3>> contactPointGeometryA;
+    std::vector<float3, DEMEAllocator<float3>> contactPointGeometryB;
     // Wildcard (extra property) arrays associated with contacts and owners
-    std::vector<std::vector<float, ManagedAllocator<float>>,
-                ManagedAllocator<std::vector<float, ManagedAllocator<float>>>>
+    std::vector<std::vector<float, DEMEAllocator<float>>,
+                DEMEAllocator<std::vector<float, DEMEAllocator<float>>>>
         contactWildcards;
-    std::vector<std::vector<float, ManagedAllocator<float>>,
-                ManagedAllocator<std::vector<float, ManagedAllocator<float>>>>
+    std::vector<std::vector<float, DEMEAllocator<float>>,
+                DEMEAllocator<std::vector<float, DEMEAllocator<float>>>>
         ownerWildcards;
-    // std::vector<float, ManagedAllocator<float>> contactWildcards[DEME_MAX_WILDCARD_NUM];
-    // std::vector<float, ManagedAllocator<float>> ownerWildcards[DEME_MAX_WILDCARD_NUM];
+    // std::vector<float, DEMEAllocator<float>> contactWildcards[DEME_MAX_WILDCARD_NUM];
+    // std::vector<float, DEMEAllocator<float>> ownerWildcards[DEME_MAX_WILDCARD_NUM];
     // An example of such wildcard arrays is contact history: how much did the contact point move on the geometry
     // surface compared to when the contact first emerged?
     // Geometric entities' wildcards
-    std::vector<std::vector<float, ManagedAllocator<float>>,
-                ManagedAllocator<std::vector<float, ManagedAllocator<float>>>>
+    std::vector<std::vector<float, DEMEAllocator<float>>,
+                DEMEAllocator<std::vector<float, DEMEAllocator<float>>>>
         sphereWildcards;
-    std::vector<std::vector<float, ManagedAllocator<float>>,
-                ManagedAllocator<std::vector<float, ManagedAllocator<float>>>>
+    std::vector<std::vector<float, DEMEAllocator<float>>,
+                DEMEAllocator<std::vector<float, DEMEAllocator<float>>>>
         analWildcards;
-    std::vector<std::vector<float, ManagedAllocator<float>>,
-                ManagedAllocator<std::vector<float, ManagedAllocator<float>>>>
+    std::vector<std::vector<float, DEMEAllocator<float>>,
+                DEMEAllocator<std::vector<float, DEMEAllocator<float>>>>
         triWildcards;
 
     // Storage for the names of the contact wildcards (whose order agrees with the impl-level wildcard numbering, from 1
@@ -232,17 +241,32 @@ class DEMDynamicThread {
     std::set<std::string> m_owner_wildcard_names;
     std::set<std::string> m_geo_wildcard_names;
 
-    // std::vector<float3, ManagedAllocator<float3>> contactHistory;
+    // std::vector<float3, DEMEAllocator<float3>> contactHistory;
     // // Durations in time of persistent contact pairs
-    // std::vector<float, ManagedAllocator<float>> contactDuration;
+    // std::vector<float, DEMEAllocator<float>> contactDuration;
     // The velocity of the contact points in the global frame: can be useful in determining the time step size
-    // std::vector<float3, ManagedAllocator<float3>> contactPointVel;
+    // std::vector<float3, DEMEAllocator<float3>> contactPointVel;
 
     size_t m_approx_bytes_used = 0;
+    // Number of times the contact arrays were reallocated, and the capacities the user instructed to reserve
+    size_t m_num_cnt_arr_reallocs = 0;
+    ArrayReservation arrayReservation;
+    // Contact arrays are never cut back to shorter than this
+    size_t cntArrMinLength = 0;
 
     // dT's total steps run (since last time the collaboration stats cache is cleared)
     uint64_t nTotalSteps = 0;
 
+    // Step metrics output (null if not in use). kT leaves its contact detection counters in cdMetrics_buffer along with
+    // its produce, and dT picks them up when unpacking.
+    std::shared_ptr<StepMetricsSink> stepMetricsSink;
+    StepMetrics cdMetrics_buffer;
+    StepMetrics cdMetrics;
+    uint64_t nMetricsSteps = 0;
+    // Wall clock stamp of the last record (or of the start of this user call), and steps taken since
+    std::chrono::high_resolution_clock::time_point metricsStamp;
+    unsigned int nStepsSinceMetricsStamp = 0;
+
     // If true, dT needs to re-process idA- and idB-related data arrays before collecting forces, as those arrays are
     // freshly obtained from kT.
     bool contactPairArr_isFresh = true;
@@ -256,32 +280,32 @@ class DEMDynamicThread {
 
     // Template-related arrays in managed memory
     // Belonged-body ID
-    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> ownerClumpBody;
-    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> ownerMesh;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> ownerClumpBody;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> ownerMesh;
     std::vector<bodyID_t> ownerAnalBody;  // Not managed since all analytical bodies are jitified
 
     // The ID that maps this sphere component's geometry-defining parameters, when this component is jitified
-    std::vector<clumpComponentOffset_t, ManagedAllocator<clumpComponentOffset_t>> clumpComponentOffset;
+    std::vector<clumpComponentOffset_t, DEMEAllocator<clumpComponentOffset_t>> clumpComponentOffset;
     // The ID that maps this sphere component's geometry-defining parameters, when this component is not jitified (too
     // many templates)
-    std::vector<clumpComponentOffsetExt_t, ManagedAllocator<clumpComponentOffsetExt_t>> clumpComponentOffsetExt;
+    std::vector<clumpComponentOffsetExt_t, DEMEAllocator<clumpComponentOffsetExt_t>> clumpComponentOffsetExt;
     // The ID that maps this analytical entity component's geometry-defining parameters, when this component is jitified
-    // std::vector<clumpComponentOffset_t, ManagedAllocator<clumpComponentOffset_t>> analComponentOffset;
+    // std::vector<clumpComponentOffset_t, DEMEAllocator<clumpComponentOffset_t>> analComponentOffset;
 
     // The ID that maps this entity's material
-    std::vector<materialsOffset_t, ManagedAllocator<materialsOffset_t>> sphereMaterialOffset;
-    std::vector<materialsOffset_t, ManagedAllocator<materialsOffset_t>> triMaterialOffset;
+    std::vector<materialsOffset_t, DEMEAllocator<materialsOffset_t>> sphereMaterialOffset;
+    std::vector<materialsOffset_t, DEMEAllocator<materialsOffset_t>> triMaterialOffset;
 
     // dT's copy of family map
     // std::unordered_map<unsigned int, family_t> familyUserImplMap;
     // std::unordered_map<family_t, unsigned int> familyImplUserMap;
 
     // A long array (usually 32640 elements) registering whether between 2 families there should be contacts
-    std::vector<notStupidBool_t, ManagedAllocator<notStupidBool_t>> familyMaskMatrix;
+    std::vector<notStupidBool_t, DEMEAllocator<notStupidBool_t>> familyMaskMatrix;
 
     // The amount of contact margin that each family should add to its associated contact geometries. Default is 0, and
     // that means geometries should be considered in contact when they are physically in contact.
-    std::vector<float, ManagedAllocator<float>> familyExtraMarginSize;
+    std::vector<float, DEMEAllocator<float>> familyExtraMarginSize;
 
     // dT's copy of "clump template and their names" map
     std::unordered_map<unsigned int, std::string> templateNumNameMap;
@@ -347,6 +371,7 @@ class DEMDynamicThread {
                       float3 LBFPoint,
                       float3 user_box_min,
                       float3 user_box_max,
+                      unsigned int periodic_dirs,
                       float3 G,
                       double ts_size,
                       float expand_factor,
@@ -383,6 +408,18 @@ class DEMDynamicThread {
     void setOwnerOriQ(bodyID_t ownerID, float4 oriQ);
     /// Set this owner's velocity
     void setOwnerVel(bodyID_t ownerID, float3 vel);
+
+    /// @brief Bulk owner state access. The owners involved are IDs[0] to IDs[n - 1], or start to start + n - 1 if IDs
+    /// is NULL, and the host-side buffer holds one entry per owner in that order. The data is gathered/scattered on the
+    /// device and moved in one copy, rather than being faulted over owner by owner. Positions are in user unit.
+    void getOwnersPos(const bodyID_t* IDs, bodyID_t start, size_t n, float3* pos);
+    void getOwnersVel(const bodyID_t* IDs, bodyID_t start, size_t n, float3* vel);
+    void getOwnersAngVel(const bodyID_t* IDs, bodyID_t start, size_t n, float3* angVel);
+    void getOwnersOriQ(const bodyID_t* IDs, bodyID_t start, size_t n, float4* oriQ);
+    void setOwnersPos(const bodyID_t* IDs, bodyID_t start, size_t n, const float3* pos);
+    void setOwnersVel(const bodyID_t* IDs, bodyID_t start, size_t n, const float3* vel);
+    void setOwnersAngVel(const bodyID_t* IDs, bodyID_t start, size_t n, const float3* angVel);
+    void setOwnersOriQ(const bodyID_t* IDs, bodyID_t start, size_t n, const float4* oriQ);
     /// Rewrite the relative positions of the flattened triangle soup, starting from `start', using triangle nodal
     /// positions in `triangles'.
     void setTriNodeRelPos(size_t start, const std::vector<DEMTriangle>& triangles);
@@ -440,6 +477,11 @@ class DEMDynamicThread {
                                  std::vector<float3>& forces,
                                  std::vector<float3>& torques,
                                  bool torque_in_local = false);
+    /// @brief Get the clumps that are in contact with this owner (sphere--sphere contacts if it is a clump, otherwise
+    /// the contacts with its mesh facets or analytical components).
+    std::vector<bodyID_t> getOwnerContactClumps(bodyID_t ownerID);
+    /// @brief Get the owner pairs of all sphere--sphere contacts, sorted by the owner of geometry A.
+    void getClumpContactPairs(std::vector<bodyID_t>& idA, std::vector<bodyID_t>& idB);
 
     /// Let dT know that it needs a kT update, as something important may have changed, and old contact pair info is no
     /// longer valid.
@@ -448,6 +490,17 @@ class DEMDynamicThread {
     /// @brief Change all entities with (user-level) family number ID_from to have a new number ID_to.
     void changeFamily(unsigned int ID_from, unsigned int ID_to);
 
+    /// @brief Remove the entities marked in purge from all dT arrays, translate the IDs of the survivors (including those
+    /// in the contact arrays) and release the freed memory.
+    void purgeEntities(const EntityPurgeMap& purge);
+
+    /// @brief Figure out how to permute the clumps so they are ordered by the Morton key of their voxels, subject to
+    /// keeping the sphere order of each existing contact pair. Returns the number of clumps that would move.
+    size_t calcReorderMap(EntityReorderMap& reorder);
+    /// @brief Permute the clumps and spheres in all dT arrays as reorder says, translating the IDs in the contact
+    /// arrays while keeping the contact history.
+    void reorderEntities(const EntityReorderMap& reorder);
+
     /// Resize managed arrays (and perhaps Instruct/Suggest their preferred residence location as well?)
     void allocateManagedArrays(size_t nOwnerBodies,
                                size_t nOwnerClumps,
@@ -461,7 +514,8 @@ class DEMDynamicThread {
                                unsigned int nClumpTopo,
                                unsigned int nClumpComponents,
                                unsigned int nJitifiableClumpComponents,
-                               unsigned int nMatTuples);
+                               unsigned int nMatTuples,
+                               const ArrayReservation& reservation);
 
     // Components of initManagedArrays
     void buildTrackedObjs(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
@@ -568,10 +622,13 @@ class DEMDynamicThread {
     void writeSpheresAsChpf(std::ofstream& ptFile) const;
     void writeClumpsAsChpf(std::ofstream& ptFile, unsigned int accuracy = 10) const;
 #endif
-    void writeSpheresAsCsv(std::ofstream& ptFile) const;
-    void writeClumpsAsCsv(std::ofstream& ptFile, unsigned int accuracy = 10) const;
-    void writeContactsAsCsv(std::ofstream& ptFile, float force_thres = DEME_TINY_FLOAT) const;
-    void writeMeshesAsVtk(std::ofstream& ptFile);
+    // Snapshots of the current state for output. Taking them is cheap; formatting and writing them (which can be done
+    // in the background) is not.
+    OutputFrame collectSpheresFrame() const;
+    OutputFrame collectClumpsFrame() const;
+    OutputFrame collectContactsFrame(float force_thres = DEME_TINY_FLOAT) const;
+    MeshOutputFrame collectMeshesFrame() const;
+    static void writeMeshFrameAsVtk(std::ostream& ptFile, const MeshOutputFrame& frame);
 
     /// Called each time when the user calls DoDynamicsThenSync.
     void startThread();
@@ -584,6 +641,8 @@ class DEMDynamicThread {
     void resetUserCallStat();
     // Return the approximate RAM usage
     size_t estimateMemUsage() const;
+    // Return the number of times the contact arrays were reallocated
+    size_t getNumCntArrReallocs() const { return m_num_cnt_arr_reallocs; }
 
     /// Return timing inforation for this current run
     void getTiming(std::vector<std::string>& names, std::vector<double>& vals);
@@ -593,18 +652,28 @@ class DEMDynamicThread {
         for (const auto& name : timer_names) {
             timers.GetTimer(name).reset();
         }
+        timers.ResetSleepStats();
+    }
+    /// Return the average fraction of owners that were sleeping, and the number of samples it is based on
+    void getSleepStats(double& avg_frac, size_t& n_samples) const {
+        avg_frac = timers.GetAvgSleepingFraction();
+        n_samples = timers.nSleepSamples;
     }
 
     /// Get the simulation time passed since the start of simulation
     double getSimTime() const;
     /// Set the simulation time manually
     void setSimTime(double time);
+    /// Get the current step size
+    double getStepSize() const { return simParams->h; }
+    /// Set the step size manually (discards any pending step size change)
+    void setStepSize(double ts);
 
     // Jitify dT kernels (at initialization) based on existing knowledge of this run
     void jitifyKernels(const std::unordered_map<std::string, std::string>& Subs);
 
     // Execute this kernel, then return the reduced value
-    float* inspectCall(const std::shared_ptr<jitify::Program>& inspection_kernel,
+    float* inspectCall(const std::shared_ptr<JitProgram>& inspection_kernel,
                        const std::string& kernel_name,
                        INSPECT_ENTITY_TYPE thing_to_insp,
                        CUB_REDUCE_FLAVOR reduce_flavor,
@@ -631,6 +700,12 @@ class DEMDynamicThread {
 
     // The inspector for calculating max vel for this cycle
     std::shared_ptr<DEMInspector> approxMaxVelFunc;
+    // The inspector for calculating max clump acc, used by the int_diff variable step size strategy
+    std::shared_ptr<DEMInspector> approxMaxAccFunc;
+
+    // A larger step size dT will switch to once kT's contact pairs are derived with a margin that accounts for it (0
+    // means there is no pending change)
+    float pendingStepSize = 0.f;
 
     // Migrate contact history to fit the structure of the newly received contact array
     inline void migratePersistentContacts();
@@ -645,6 +720,8 @@ class DEMDynamicThread {
     inline void ifProduceFreshThenUseItAndSendNewOrder();
     inline void ifProduceFreshThenUseIt();
     inline void unpack_impl();
+    // Count a step and, every so many steps, hand a StepMetrics record to the sink
+    inline void recordStepMetrics();
 
     // Change sim params based on dT's experience, if needed
     inline void calibrateParams();
@@ -652,6 +729,9 @@ class DEMDynamicThread {
     // Determine the max vel for this cycle, kT needs it
     inline float* determineSysVel();
 
+    // Decide the step size for the following steps, if variable step size is in use
+    inline void adaptStepSize(float maxAcc);
+
     // Some per-step checks/modification, done before integration, but after force calculation (thus sort of in the
     // mid-step stage)
     inline void routineChecks();
@@ -660,8 +740,10 @@ class DEMDynamicThread {
     inline void unpackMyBuffer();
     // Send produced data to kT-owned biffers
     void sendToTheirBuffer();
-    // Resize some work arrays based on the number of contact pairs provided by kT
+    // Resize some work arrays to the given length (capacity included), which should come from decideCntArrLength
     void contactEventArraysResize(size_t nContactPairs);
+    // Re-point granData (and kT's send targets) to dT's contact and buffer arrays, after they are swapped
+    inline void packBufferPointers();
 
     // Deallocate everything
     void deallocateEverything();
@@ -671,14 +753,46 @@ class DEMDynamicThread {
     // Get owner of contact geo B.
     inline bodyID_t getOwnerForContactB(const bodyID_t& geoB, const contact_t& type) const;
 
+    // Bulk owner state access helpers. The first one moves the owner ID list (if any) to the device and returns it, and
+    // gets a device buffer of buffer_bytes for the data.
+    bodyID_t* prepBulkOwnerAccess(const bodyID_t* IDs, size_t n, size_t buffer_bytes, void*& dBuffer);
+    void getOwnersFloat3(const float* arrX,
+                         const float* arrY,
+                         const float* arrZ,
+                         const bodyID_t* IDs,
+                         bodyID_t start,
+                         size_t n,
+                         float3* res);
+    void setOwnersFloat3(float* arrX,
+                         float* arrY,
+                         float* arrZ,
+                         const bodyID_t* IDs,
+                         bodyID_t start,
+                         size_t n,
+                         const float3* vals);
+
+    // Owner-to-contact adjacency in CSR form: the contacts involving owner i are
+    // ownerContactIDs[ownerContactOffsets[i]] to ownerContactIDs[ownerContactOffsets[i + 1] - 1], in contact array
+    // order. It is built on the first per-owner query after the contact arrays (or the geometry-to-owner map) change,
+    // so such queries cost O(owner's contact count) rather than a scan of all contacts.
+    std::vector<size_t> ownerContactOffsets;
+    std::vector<size_t> ownerContactIDs;
+    bool ownerContactIndexStale = true;
+    void buildOwnerContactIndex();
+    // Make sure the owner-to-contact index reflects the current contact arrays
+    inline void ensureOwnerContactIndex() {
+        if (ownerContactIndexStale)
+            buildOwnerContactIndex();
+    }
+
     // Just-in-time compiled kernels
-    std::shared_ptr<jitify::Program> prep_force_kernels;
-    std::shared_ptr<jitify::Program> cal_force_kernels;
-    std::shared_ptr<jitify::Program> collect_force_kernels;
-    std::shared_ptr<jitify::Program> integrator_kernels;
-    // std::shared_ptr<jitify::Program> quarry_stats_kernels;
-    std::shared_ptr<jitify::Program> mod_kernels;
-    std::shared_ptr<jitify::Program> misc_kernels;
+    std::shared_ptr<JitProgram> prep_force_kernels;
+    std::shared_ptr<JitProgram> cal_force_kernels;
+    std::shared_ptr<JitProgram> collect_force_kernels;
+    std::shared_ptr<JitProgram> integrator_kernels;
+    // std::shared_ptr<JitProgram> quarry_stats_kernels;
+    std::shared_ptr<JitProgram> mod_kernels;
+    std::shared_ptr<JitProgram> misc_kernels;
 
     // Adjuster for update freq
     class AccumStepUpdater {
@@ -19,32 +19,21 @@
 namespace deme {
 
 inline void DEMKinematicThread::transferArraysResize(size_t nContactPairs) {
-    // TODO: This memory usage is not tracked... How can I track the size changes on my friend's end??
-    // dT->idGeometryA_buffer.resize(nContactPairs);
-    // dT->idGeometryB_buffer.resize(nContactPairs);
-    // dT->contactType_buffer.resize(nContactPairs);
-    // DEME_ADVISE_DEVICE(dT->idGeometryA_buffer, dT->streamInfo.device);
-    // DEME_ADVISE_DEVICE(dT->idGeometryB_buffer, dT->streamInfo.device);
-    // DEME_ADVISE_DEVICE(dT->contactType_buffer, dT->streamInfo.device);
-
-    // These buffers are on dT
-    DEME_GPU_CALL(cudaSetDevice(dT->streamInfo.device));
-    dT->buffer_size = nContactPairs;
-    DEME_DEVICE_PTR_ALLOC(dT->granData->idGeometryA_buffer, nContactPairs);
-    DEME_DEVICE_PTR_ALLOC(dT->granData->idGeometryB_buffer, nContactPairs);
-    DEME_DEVICE_PTR_ALLOC(dT->granData->contactType_buffer, nContactPairs);
-    granData->pDTOwnedBuffer_idGeometryA = dT->granData->idGeometryA_buffer;
-    granData->pDTOwnedBuffer_idGeometryB = dT->granData->idGeometryB_buffer;
-    granData->pDTOwnedBuffer_contactType = dT->granData->contactType_buffer;
+    // These buffers are dT's, but dT cannot be unpacking while kT is sending, so it is safe to resize them here. Since
+    // kT is the one deciding their size, their memory is tracked on kT's tally.
+    DEME_TRACKED_RESIZE_EXACT(dT->idGeometryA_buffer, nContactPairs, 0);
+    DEME_TRACKED_RESIZE_EXACT(dT->idGeometryB_buffer, nContactPairs, 0);
+    DEME_TRACKED_RESIZE_EXACT(dT->contactType_buffer, nContactPairs, NOT_A_CONTACT);
+    dT->granData->idGeometryA_buffer = dT->idGeometryA_buffer.data();
+    dT->granData->idGeometryB_buffer = dT->idGeometryB_buffer.data();
+    dT->granData->contactType_buffer = dT->contactType_buffer.data();
 
     if (!solverFlags.isHistoryless) {
-        // dT->contactMapping_buffer.resize(nContactPairs);
-        // DEME_ADVISE_DEVICE(dT->contactMapping_buffer, dT->streamInfo.device);
-        DEME_DEVICE_PTR_ALLOC(dT->granData->contactMapping_buffer, nContactPairs);
-        granData->pDTOwnedBuffer_contactMapping = dT->granData->contactMapping_buffer;
+        DEME_TRACKED_RESIZE_EXACT(dT->contactMapping_buffer, nContactPairs, NULL_MAPPING_PARTNER);
+        dT->granData->contactMapping_buffer = dT->contactMapping_buffer.data();
     }
-    // Unset the device change we just made
-    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    m_num_cnt_arr_reallocs++;
+    packTransferPointers(dT);
 }
 
 void DEMKinematicThread::calibrateParams() {
@@ -90,37 +79,145 @@ void DEMKinematicThread::calibrateParams() {
             } else {
                 simParams->binSize /= (1. - stateParams.binCurrentChangeRate);
             }
-            // Register the new bin size
-            stateParams.numBins =
-                hostCalcBinNum(simParams->nbX, simParams->nbY, simParams->nbZ, simParams->voxelSize, simParams->binSize,
-                               simParams->nvXp2, simParams->nvYp2, simParams->nvZp2);
+            // Register the new bin size. With hierarchical binning, the coarsest level has to stay large enough for the
+            // largest sphere.
+            if (stateParams.binLevelRadius > 0.) {
+                simParams->nBinLevels =
+                    hostCalcBinLevelNum(simParams->binSize, stateParams.binLevelRadius, DEME_MAX_BIN_LEVELS);
+            }
+            stateParams.numBins = hostCalcBinLevels(simParams->levelNbX, simParams->levelNbY, simParams->levelNbZ,
+                                                    simParams->levelBinOffset, simParams->nBinLevels,
+                                                    simParams->voxelSize, simParams->binSize, simParams->nvXp2,
+                                                    simParams->nvYp2, simParams->nvZp2);
+            simParams->nbX = simParams->levelNbX[0];
+            simParams->nbY = simParams->levelNbY[0];
+            simParams->nbZ = simParams->levelNbZ[0];
 
             DEME_DEBUG_PRINTF("Bin size is now: %.7g", simParams->binSize);
-            DEME_DEBUG_PRINTF("Total num of bins is now: %zu", stateParams.numBins);
+            DEME_DEBUG_PRINTF("Total num of bins is now: %zu (in %u levels)", stateParams.numBins,
+                              simParams->nBinLevels);
         }
         DEME_DEBUG_PRINTF("kT runtime per step: %.7gs", CDAccumTimer.GetPrevTime());
     }
 }
 
+inline void DEMKinematicThread::packBufferPointers() {
+    granData->voxelID = voxelID.data();
+    granData->locX = locX.data();
+    granData->locY = locY.data();
+    granData->locZ = locZ.data();
+    granData->oriQw = oriQw.data();
+    granData->oriQx = oriQx.data();
+    granData->oriQy = oriQy.data();
+    granData->oriQz = oriQz.data();
+    granData->marginSize = marginSize.data();
+    granData->familyID = familyID.data();
+
+    granData->voxelID_buffer = voxelID_buffer.data();
+    granData->locX_buffer = locX_buffer.data();
+    granData->locY_buffer = locY_buffer.data();
+    granData->locZ_buffer = locZ_buffer.data();
+    granData->oriQ0_buffer = oriQ0_buffer.data();
+    granData->oriQ1_buffer = oriQ1_buffer.data();
+    granData->oriQ2_buffer = oriQ2_buffer.data();
+    granData->oriQ3_buffer = oriQ3_buffer.data();
+    granData->absVel_buffer = absVel_buffer.data();
+    granData->familyID_buffer = familyID_buffer.data();
+
+    // dT should send the next work order to wherever the buffers are now
+    DEMKinematicThread* self = this;
+    dT->packTransferPointers(self);
+}
+
+inline void DEMKinematicThread::allocateTransferBuffers(size_t nOwnerBodies, size_t nTriGM) {
+    if (solverFlags.useBufferSwap) {
+        // Same type as kT's working arrays, so that they can be swapped in. dT fully re-fills them before kT uses them.
+        DEME_TRACKED_RESIZE_DEBUGPRINT(voxelID_buffer, nOwnerBodies, "voxelID_buffer", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(locX_buffer, nOwnerBodies, "locX_buffer", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(locY_buffer, nOwnerBodies, "locY_buffer", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(locZ_buffer, nOwnerBodies, "locZ_buffer", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(oriQ0_buffer, nOwnerBodies, "oriQ0_buffer", 1);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(oriQ1_buffer, nOwnerBodies, "oriQ1_buffer", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(oriQ2_buffer, nOwnerBodies, "oriQ2_buffer", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(oriQ3_buffer, nOwnerBodies, "oriQ3_buffer", 0);
+        DEME_TRACKED_RESIZE_DEBUGPRINT(absVel_buffer, nOwnerBodies, "absVel_buffer", 0);
+        if (solverFlags.canFamilyChange) {
+            DEME_TRACKED_RESIZE_DEBUGPRINT(familyID_buffer, nOwnerBodies, "familyID_buffer", 0);
+        }
+    }
+
+    // The rest is cudaMalloc-ed memory, not managed, because we want explicit locality control of buffers: they should
+    // be on dT, to save dT access time
+    DEME_GPU_CALL(cudaSetDevice(dT->streamInfo.device));
+    if (!solverFlags.useBufferSwap) {
+        DEME_DEVICE_PTR_ALLOC(granData->voxelID_buffer, nOwnerBodies);
+        DEME_DEVICE_PTR_ALLOC(granData->locX_buffer, nOwnerBodies);
+        DEME_DEVICE_PTR_ALLOC(granData->locY_buffer, nOwnerBodies);
+        DEME_DEVICE_PTR_ALLOC(granData->locZ_buffer, nOwnerBodies);
+        DEME_DEVICE_PTR_ALLOC(granData->oriQ0_buffer, nOwnerBodies);
+        DEME_DEVICE_PTR_ALLOC(granData->oriQ1_buffer, nOwnerBodies);
+        DEME_DEVICE_PTR_ALLOC(granData->oriQ2_buffer, nOwnerBodies);
+        DEME_DEVICE_PTR_ALLOC(granData->oriQ3_buffer, nOwnerBodies);
+        DEME_DEVICE_PTR_ALLOC(granData->absVel_buffer, nOwnerBodies);
+        if (solverFlags.canFamilyChange) {
+            DEME_DEVICE_PTR_ALLOC(granData->familyID_buffer, nOwnerBodies);
+        }
+    }
+    // Mesh buffers are rarely used, so they are never swapped
+    DEME_DEVICE_PTR_ALLOC(granData->relPosNode1_buffer, nTriGM);
+    DEME_DEVICE_PTR_ALLOC(granData->relPosNode2_buffer, nTriGM);
+    DEME_DEVICE_PTR_ALLOC(granData->relPosNode3_buffer, nTriGM);
+    // Unset the device change we just did
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+}
+
 inline void DEMKinematicThread::unpackMyBuffer() {
-    DEME_GPU_CALL(cudaMemcpy(granData->voxelID, granData->voxelID_buffer, simParams->nOwnerBodies * sizeof(voxelID_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->locX, granData->locX_buffer, simParams->nOwnerBodies * sizeof(subVoxelPos_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->locY, granData->locY_buffer, simParams->nOwnerBodies * sizeof(subVoxelPos_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->locZ, granData->locZ_buffer, simParams->nOwnerBodies * sizeof(subVoxelPos_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->oriQw, granData->oriQ0_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->oriQx, granData->oriQ1_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->oriQy, granData->oriQ2_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->oriQz, granData->oriQ3_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
-                             cudaMemcpyDeviceToDevice));
-    DEME_GPU_CALL(cudaMemcpy(granData->marginSize, granData->absVel_buffer, simParams->nOwnerBodies * sizeof(float),
-                             cudaMemcpyDeviceToDevice));
+    if (solverFlags.useBufferSwap) {
+        // dT fills every element of these arrays each time it sends, so rather than copying, just swap them with the
+        // working arrays. What used to be the working arrays are then filled by dT next time.
+        voxelID.swap(voxelID_buffer);
+        locX.swap(locX_buffer);
+        locY.swap(locY_buffer);
+        locZ.swap(locZ_buffer);
+        oriQw.swap(oriQ0_buffer);
+        oriQx.swap(oriQ1_buffer);
+        oriQy.swap(oriQ2_buffer);
+        oriQz.swap(oriQ3_buffer);
+        // marginSize holds absv for now, and it will be turned into the margin size in place
+        marginSize.swap(absVel_buffer);
+        size_t swapped_bytes = simParams->nOwnerBodies *
+                               (sizeof(voxelID_t) + 3 * sizeof(subVoxelPos_t) + 4 * sizeof(oriQ_t) + sizeof(float));
+        if (solverFlags.canFamilyChange) {
+            familyID.swap(familyID_buffer);
+            swapped_bytes += simParams->nOwnerBodies * sizeof(family_t);
+        }
+        packBufferPointers();
+        pSchedSupport->schedulingStats.nBytesSavedBySwap += swapped_bytes;
+    } else {
+        DEME_GPU_CALL(cudaMemcpy(granData->voxelID, granData->voxelID_buffer,
+                                 simParams->nOwnerBodies * sizeof(voxelID_t), cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(cudaMemcpy(granData->locX, granData->locX_buffer, simParams->nOwnerBodies * sizeof(subVoxelPos_t),
+                                 cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(cudaMemcpy(granData->locY, granData->locY_buffer, simParams->nOwnerBodies * sizeof(subVoxelPos_t),
+                                 cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(cudaMemcpy(granData->locZ, granData->locZ_buffer, simParams->nOwnerBodies * sizeof(subVoxelPos_t),
+                                 cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(cudaMemcpy(granData->oriQw, granData->oriQ0_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
+                                 cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(cudaMemcpy(granData->oriQx, granData->oriQ1_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
+                                 cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(cudaMemcpy(granData->oriQy, granData->oriQ2_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
+                                 cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(cudaMemcpy(granData->oriQz, granData->oriQ3_buffer, simParams->nOwnerBodies * sizeof(oriQ_t),
+                                 cudaMemcpyDeviceToDevice));
+        DEME_GPU_CALL(cudaMemcpy(granData->marginSize, granData->absVel_buffer,
+                                 simParams->nOwnerBodies * sizeof(float), cudaMemcpyDeviceToDevice));
+        // Family number is a typical changable quantity on-the-fly. If this flag is on, kT received changes from dT.
+        if (solverFlags.canFamilyChange) {
+            DEME_GPU_CALL(cudaMemcpy(granData->familyID, granData->familyID_buffer,
+                                     simParams->nOwnerBodies * sizeof(family_t), cudaMemcpyDeviceToDevice));
+        }
+    }
 
     DEME_GPU_CALL(cudaMemcpy(&(granData->ts), &(granData->ts_buffer), sizeof(float), cudaMemcpyDeviceToDevice));
     DEME_GPU_CALL(cudaMemcpy(&(granData->maxDrift), &(granData->maxDrift_buffer), sizeof(unsigned int),
@@ -172,12 +269,6 @@ inline void DEMKinematicThread::unpackMyBuffer() {
     DEME_DEBUG_PRINTF("kT received a velocity update: %.6g", granData->maxVel);
     // DEME_DEBUG_PRINTF("A margin of thickness %.6g is added", simParams->beta);
 
-    // Family number is a typical changable quantity on-the-fly. If this flag is on, kT received changes from dT.
-    if (solverFlags.canFamilyChange) {
-        DEME_GPU_CALL(cudaMemcpy(granData->familyID, granData->familyID_buffer,
-                                 simParams->nOwnerBodies * sizeof(family_t), cudaMemcpyDeviceToDevice));
-    }
-
     // If dT received a mesh deformation request from user, then it is now passed to kT
     if (solverFlags.willMeshDeform) {
         DEME_GPU_CALL(cudaMemcpy(granData->relPosNode1, granData->relPosNode1_buffer,
@@ -186,6 +277,7 @@ inline void DEMKinematicThread::unpackMyBuffer() {
                                  simParams->nTriGM * sizeof(float3), cudaMemcpyDeviceToDevice));
         DEME_GPU_CALL(cudaMemcpy(granData->relPosNode3, granData->relPosNode3_buffer,
                                  simParams->nTriGM * sizeof(float3), cudaMemcpyDeviceToDevice));
+        refitMeshBVHs();
         // dT won't be sending if kT is loading, so it is safe
         solverFlags.willMeshDeform = false;
     }
@@ -194,9 +286,14 @@ inline void DEMKinematicThread::unpackMyBuffer() {
 inline void DEMKinematicThread::sendToTheirBuffer() {
     DEME_GPU_CALL(cudaMemcpy(granData->pDTOwnedBuffer_nContactPairs, stateOfSolver_resources.pNumContacts,
                              sizeof(size_t), cudaMemcpyDeviceToDevice));
-    // Resize dT owned buffers before usage
-    if (*stateOfSolver_resources.pNumContacts > dT->buffer_size) {
-        transferArraysResize(*stateOfSolver_resources.pNumContacts);
+    // Resize dT owned buffers before usage. They grow geometrically, and are cut back if the contact number has dropped
+    // far below their length.
+    {
+        size_t buffer_len = decideCntArrLength(*stateOfSolver_resources.pNumContacts, dT->idGeometryA_buffer.size(),
+                                               stateParams.cntArrMinLength, true);
+        if (buffer_len != dT->idGeometryA_buffer.size()) {
+            transferArraysResize(buffer_len);
+        }
     }
 
     DEME_GPU_CALL(cudaMemcpy(granData->pDTOwnedBuffer_idGeometryA, granData->idGeometryA,
@@ -283,7 +380,8 @@ void DEMKinematicThread::workerThread() {
             contactDetection(bin_sphere_kernels, bin_triangle_kernels, sphere_contact_kernels, sphTri_contact_kernels,
                              history_kernels, granData, simParams, solverFlags, verbosity, idGeometryA, idGeometryB,
                              contactType, previous_idGeometryA, previous_idGeometryB, previous_contactType,
-                             contactMapping, streamInfo.stream, stateOfSolver_resources, timers, stateParams);
+                             contactMapping, streamInfo.stream, stateOfSolver_resources, timers, stateParams,
+                             m_approx_bytes_used, m_num_cnt_arr_reallocs);
             CDAccumTimer.End();
 
             timers.GetTimer("Send to dT buffer").start();
@@ -293,9 +391,17 @@ void DEMKinematicThread::workerThread() {
                 // Acquire lock and supply the dynamic with fresh produce
                 std::lock_guard<std::mutex> lock(pSchedSupport->dynamicOwnedBuffer_AccessCoordination);
                 sendToTheirBuffer();
+                if (dT->stepMetricsSink) {
+                    dT->cdMetrics_buffer.avgCntsPerSphere = stateParams.avgCntsPerSphere;
+                    dT->cdMetrics_buffer.maxSphFoundInBin = stateParams.maxSphFoundInBin;
+                    dT->cdMetrics_buffer.maxTriFoundInBin = stateParams.maxTriFoundInBin;
+                    dT->cdMetrics_buffer.numBins = stateParams.numBins;
+                    dT->cdMetrics_buffer.binSize = simParams->binSize;
+                }
             }
             pSchedSupport->dynamicOwned_Prod2ConsBuffer_isFresh = true;
             pSchedSupport->schedulingStats.nDynamicUpdates++;
+            timers.MarkEvent("Contact pairs handed to dT");
             timers.GetTimer("Send to dT buffer").stop();
 
             // Signal the dynamic that it has fresh produce
@@ -328,26 +434,148 @@ void DEMKinematicThread::changeFamily(unsigned int ID_from, unsigned int ID_to)
         familyID.begin(), familyID.end(), [ID_from_impl](family_t& i) { return i == ID_from_impl; }, ID_to_impl);
 }
 
+void DEMKinematicThread::purgeEntities(const EntityPurgeMap& purge) {
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+
+    std::vector<notStupidBool_t> ownerKeep(purge.ownerMap.size()), sphereKeep(purge.sphereMap.size()),
+        triKeep(purge.triMap.size());
+    for (size_t i = 0; i < ownerKeep.size(); i++)
+        ownerKeep[i] = (purge.ownerMap[i] != NULL_BODYID);
+    for (size_t i = 0; i < sphereKeep.size(); i++)
+        sphereKeep[i] = (purge.sphereMap[i] != NULL_BODYID);
+    for (size_t i = 0; i < triKeep.size(); i++)
+        triKeep[i] = (purge.triMap[i] != NULL_BODYID);
+
+    for (size_t i = 0; i < sphereKeep.size(); i++) {
+        if (sphereKeep[i])
+            ownerClumpBody[i] = purge.ownerMap[ownerClumpBody[i]];
+    }
+    for (size_t i = 0; i < triKeep.size(); i++) {
+        if (triKeep[i])
+            ownerMesh[i] = purge.ownerMap[ownerMesh[i]];
+    }
+
+    // Per-owner arrays
+    DEME_TRACKED_COMPACT(familyID, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(voxelID, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(locX, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(locY, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(locZ, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(oriQw, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(oriQx, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(oriQy, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(oriQz, ownerKeep, 0);
+    DEME_TRACKED_COMPACT(marginSize, ownerKeep, 0);
+
+    // Per-sphere arrays
+    DEME_TRACKED_COMPACT(ownerClumpBody, sphereKeep, 0);
+    if (solverFlags.useClumpJitify) {
+        DEME_TRACKED_COMPACT(clumpComponentOffset, sphereKeep, 0);
+        DEME_TRACKED_COMPACT(clumpComponentOffsetExt, sphereKeep, 0);
+    } else {
+        DEME_TRACKED_COMPACT(radiiSphere, sphereKeep, 0);
+        DEME_TRACKED_COMPACT(relPosSphereX, sphereKeep, 0);
+        DEME_TRACKED_COMPACT(relPosSphereY, sphereKeep, 0);
+        DEME_TRACKED_COMPACT(relPosSphereZ, sphereKeep, 0);
+    }
+
+    // Per-triangle arrays
+    DEME_TRACKED_COMPACT(ownerMesh, triKeep, 0);
+    DEME_TRACKED_COMPACT(relPosNode1, triKeep, 0);
+    DEME_TRACKED_COMPACT(relPosNode2, triKeep, 0);
+    DEME_TRACKED_COMPACT(relPosNode3, triKeep, 0);
+    DEME_TRACKED_COMPACT(triInMeshBVH, triKeep, 0);
+
+    // kT's own contact arrays are overwritten at the next contact detection, and the previous-contact arrays get
+    // re-filled from dT's compacted contact list before then, so their content is not worth keeping. Just shrink them.
+    {
+        stateParams.cntArrMinLength = DEME_MAX(arrayReservation.nContacts, purge.nSpheresGM * DEME_INIT_CNT_MULTIPLIER);
+        size_t cnt_arr_size = stateParams.cntArrMinLength;
+        std::vector<notStupidBool_t> noKeep;
+        DEME_TRACKED_COMPACT(idGeometryA, noKeep, cnt_arr_size);
+        DEME_TRACKED_COMPACT(idGeometryB, noKeep, cnt_arr_size);
+        DEME_TRACKED_COMPACT(contactType, noKeep, cnt_arr_size);
+        if (!solverFlags.isHistoryless) {
+            DEME_TRACKED_COMPACT(previous_idGeometryA, noKeep, cnt_arr_size);
+            DEME_TRACKED_COMPACT(previous_idGeometryB, noKeep, cnt_arr_size);
+            DEME_TRACKED_COMPACT(previous_contactType, noKeep, cnt_arr_size);
+            DEME_TRACKED_COMPACT(contactMapping, noKeep, cnt_arr_size);
+        }
+        *stateOfSolver_resources.pNumContacts = 0;
+        *stateOfSolver_resources.pNumPrevContacts = 0;
+    }
+
+    // Transfer buffers are fully re-filled by dT before kT uses them, so just reallocate them for the new sizes
+    allocateTransferBuffers(purge.nOwnerBodies, purge.nTriGM);
+
+    simParams->nOwnerBodies = purge.nOwnerBodies;
+    simParams->nOwnerClumps = purge.nOwnerClumps;
+    simParams->nTriMeshes = purge.nTriMeshes;
+    simParams->nSpheresGM = purge.nSpheresGM;
+    simParams->nTriGM = purge.nTriGM;
+
+    // Mesh BVHs index into the per-triangle arrays, so they are built anew
+    buildMeshBVHs();
+}
+
+void DEMKinematicThread::reorderEntities(const EntityReorderMap& reorder) {
+    DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+
+    for (auto& owner : ownerClumpBody) {
+        owner = reorder.ownerMap[owner];
+    }
+
+    // Per-owner arrays
+    hostApplyOrder(familyID, reorder.ownerOrder);
+    hostApplyOrder(voxelID, reorder.ownerOrder);
+    hostApplyOrder(locX, reorder.ownerOrder);
+    hostApplyOrder(locY, reorder.ownerOrder);
+    hostApplyOrder(locZ, reorder.ownerOrder);
+    hostApplyOrder(oriQw, reorder.ownerOrder);
+    hostApplyOrder(oriQx, reorder.ownerOrder);
+    hostApplyOrder(oriQy, reorder.ownerOrder);
+    hostApplyOrder(oriQz, reorder.ownerOrder);
+    hostApplyOrder(marginSize, reorder.ownerOrder);
+
+    // Per-sphere arrays
+    hostApplyOrder(ownerClumpBody, reorder.sphereOrder);
+    if (solverFlags.useClumpJitify) {
+        hostApplyOrder(clumpComponentOffset, reorder.sphereOrder);
+        hostApplyOrder(clumpComponentOffsetExt, reorder.sphereOrder);
+    } else {
+        hostApplyOrder(radiiSphere, reorder.sphereOrder);
+        hostApplyOrder(relPosSphereX, reorder.sphereOrder);
+        hostApplyOrder(relPosSphereY, reorder.sphereOrder);
+        hostApplyOrder(relPosSphereZ, reorder.sphereOrder);
+    }
+
+    // As after a purge, the contact arrays are overwritten at the next contact detection and the previous-contact
+    // arrays are re-filled from dT's contact list before then
+    *stateOfSolver_resources.pNumContacts = 0;
+    *stateOfSolver_resources.pNumPrevContacts = 0;
+}
+
 void DEMKinematicThread::changeOwnerSizes(const std::vector<bodyID_t>& IDs, const std::vector<float>& factors) {
     // Set the gpu for this thread
     // cudaSetDevice(streamInfo.device);
     // cudaStream_t new_stream;
     // cudaStreamCreate(&new_stream);
 
+    auto scratch_scope = stateOfSolver_resources.tempScope("Owner size change");
     // First get IDs and factors to device side
     size_t IDSize = IDs.size() * sizeof(bodyID_t);
-    bodyID_t* dIDs = (bodyID_t*)stateOfSolver_resources.allocateTempVector(1, IDSize);
+    bodyID_t* dIDs = (bodyID_t*)stateOfSolver_resources.allocateTemp("dIDs", IDSize);
     DEME_GPU_CALL(cudaMemcpy(dIDs, IDs.data(), IDSize, cudaMemcpyHostToDevice));
     size_t factorSize = factors.size() * sizeof(float);
-    float* dFactors = (float*)stateOfSolver_resources.allocateTempVector(2, factorSize);
+    float* dFactors = (float*)stateOfSolver_resources.allocateTemp("dFactors", factorSize);
     DEME_GPU_CALL(cudaMemcpy(dFactors, factors.data(), factorSize, cudaMemcpyHostToDevice));
 
     size_t idBoolSize = (size_t)simParams->nOwnerBodies * sizeof(notStupidBool_t);
     size_t ownerFactorSize = (size_t)simParams->nOwnerBodies * sizeof(float);
     // Bool table for whether this owner should change
-    notStupidBool_t* idBool = (notStupidBool_t*)stateOfSolver_resources.allocateTempVector(3, idBoolSize);
+    notStupidBool_t* idBool = (notStupidBool_t*)stateOfSolver_resources.allocateTemp("idBool", idBoolSize);
     DEME_GPU_CALL(cudaMemset(idBool, 0, idBoolSize));
-    float* ownerFactors = (float*)stateOfSolver_resources.allocateTempVector(4, ownerFactorSize);
+    float* ownerFactors = (float*)stateOfSolver_resources.allocateTemp("ownerFactors", ownerFactorSize);
     size_t blocks_needed_for_marking = (IDs.size() + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
 
     // Mark on the bool array those owners that need a change
@@ -426,16 +654,20 @@ void DEMKinematicThread::packDataPointers() {
     granData->familyMasks = familyMaskMatrix.data();
     granData->familyExtraMarginSize = familyExtraMarginSize.data();
 
-    // for kT, those state vectors are fed by dT, so each has a buffer
-    // granData->voxelID_buffer = voxelID_buffer.data();
-    // granData->locX_buffer = locX_buffer.data();
-    // granData->locY_buffer = locY_buffer.data();
-    // granData->locZ_buffer = locZ_buffer.data();
-    // granData->oriQ0_buffer = oriQ0_buffer.data();
-    // granData->oriQ1_buffer = oriQ1_buffer.data();
-    // granData->oriQ2_buffer = oriQ2_buffer.data();
-    // granData->oriQ3_buffer = oriQ3_buffer.data();
-    // granData->familyID_buffer = familyID_buffer.data();
+    // for kT, those state vectors are fed by dT, so each has a buffer (if not swapped in, they are cudaMalloc-ed and
+    // granData already points to them)
+    if (solverFlags.useBufferSwap) {
+        granData->voxelID_buffer = voxelID_buffer.data();
+        granData->locX_buffer = locX_buffer.data();
+        granData->locY_buffer = locY_buffer.data();
+        granData->locZ_buffer = locZ_buffer.data();
+        granData->oriQ0_buffer = oriQ0_buffer.data();
+        granData->oriQ1_buffer = oriQ1_buffer.data();
+        granData->oriQ2_buffer = oriQ2_buffer.data();
+        granData->oriQ3_buffer = oriQ3_buffer.data();
+        granData->absVel_buffer = absVel_buffer.data();
+        granData->familyID_buffer = familyID_buffer.data();
+    }
 
     // The offset info that indexes into the template arrays
     granData->ownerClumpBody = ownerClumpBody.data();
@@ -447,6 +679,11 @@ void DEMKinematicThread::packDataPointers() {
     granData->relPosNode1 = relPosNode1.data();
     granData->relPosNode2 = relPosNode2.data();
     granData->relPosNode3 = relPosNode3.data();
+    granData->triInMeshBVH = triInMeshBVH.data();
+    granData->meshBVHNodes = meshBVHNodes.data();
+    granData->meshBVHTriIDs = meshBVHTriIDs.data();
+    granData->meshBVHOwner = meshBVHOwner.data();
+    granData->meshBVHRoot = meshBVHRoot.data();
 
     // Template array pointers
     granData->radiiSphere = radiiSphere.data();
@@ -473,9 +710,11 @@ void DEMKinematicThread::setSimParams(unsigned char nvXp2,
                                       binID_t nbX,
                                       binID_t nbY,
                                       binID_t nbZ,
+                                      unsigned int nBinLevels,
                                       float3 LBFPoint,
                                       float3 user_box_min,
                                       float3 user_box_max,
+                                      unsigned int periodic_dirs,
                                       float3 G,
                                       double ts_size,
                                       float expand_factor,
@@ -505,8 +744,16 @@ void DEMKinematicThread::setSimParams(unsigned char nvXp2,
     simParams->nbX = nbX;
     simParams->nbY = nbY;
     simParams->nbZ = nbZ;
+    // Level 0 of the bin hierarchy is the grid above
+    simParams->nBinLevels = nBinLevels;
+    stateParams.numBins = hostCalcBinLevels(simParams->levelNbX, simParams->levelNbY, simParams->levelNbZ,
+                                            simParams->levelBinOffset, nBinLevels, voxelSize, binSize, nvXp2, nvYp2,
+                                            nvZp2);
     simParams->userBoxMin = user_box_min;
     simParams->userBoxMax = user_box_max;
+    simParams->periodicDirs = periodic_dirs;
+    simParams->periodicBoxMin = user_box_min - LBFPoint;
+    simParams->periodicBoxSize = user_box_max - user_box_min;
 
     simParams->nContactWildcards = contact_wildcards.size();
     simParams->nOwnerWildcards = owner_wildcards.size();
@@ -525,8 +772,10 @@ void DEMKinematicThread::allocateManagedArrays(size_t nOwnerBodies,
                                                unsigned int nClumpTopo,
                                                unsigned int nClumpComponents,
                                                unsigned int nJitifiableClumpComponents,
-                                               unsigned int nMatTuples) {
+                                               unsigned int nMatTuples,
+                                               const ArrayReservation& reservation) {
     DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
+    arrayReservation = reservation;
 
     // Sizes of these arrays
     simParams->nSpheresGM = nSpheresGM;
@@ -559,49 +808,7 @@ void DEMKinematicThread::allocateManagedArrays(size_t nOwnerBodies,
     DEME_TRACKED_RESIZE_DEBUGPRINT(marginSize, nOwnerBodies, "marginSize", 0);
 
     // Transfer buffer arrays
-    // It is cudaMalloc-ed memory, not managed, because we want explicit locality control of buffers
-    {
-        // These buffers should be on dT, to save dT access time
-        DEME_GPU_CALL(cudaSetDevice(dT->streamInfo.device));
-        DEME_DEVICE_PTR_ALLOC(granData->voxelID_buffer, nOwnerBodies);
-        DEME_DEVICE_PTR_ALLOC(granData->locX_buffer, nOwnerBodies);
-        DEME_DEVICE_PTR_ALLOC(granData->locY_buffer, nOwnerBodies);
-        DEME_DEVICE_PTR_ALLOC(granData->locZ_buffer, nOwnerBodies);
-        DEME_DEVICE_PTR_ALLOC(granData->oriQ0_buffer, nOwnerBodies);
-        DEME_DEVICE_PTR_ALLOC(granData->oriQ1_buffer, nOwnerBodies);
-        DEME_DEVICE_PTR_ALLOC(granData->oriQ2_buffer, nOwnerBodies);
-        DEME_DEVICE_PTR_ALLOC(granData->oriQ3_buffer, nOwnerBodies);
-        DEME_DEVICE_PTR_ALLOC(granData->absVel_buffer, nOwnerBodies);
-
-        // DEME_TRACKED_RESIZE_DEBUGPRINT(voxelID_buffer, nOwnerBodies, "voxelID_buffer", 0);
-        // DEME_TRACKED_RESIZE_DEBUGPRINT(locX_buffer, nOwnerBodies, "locX_buffer", 0);
-        // DEME_TRACKED_RESIZE_DEBUGPRINT(locY_buffer, nOwnerBodies, "locY_buffer", 0);
-        // DEME_TRACKED_RESIZE_DEBUGPRINT(locZ_buffer, nOwnerBodies, "locZ_buffer", 0);
-        // DEME_TRACKED_RESIZE_DEBUGPRINT(oriQ0_buffer, nOwnerBodies, "oriQ0_buffer", 0);
-        // DEME_TRACKED_RESIZE_DEBUGPRINT(oriQ1_buffer, nOwnerBodies, "oriQ1_buffer", 0);
-        // DEME_TRACKED_RESIZE_DEBUGPRINT(oriQ2_buffer, nOwnerBodies, "oriQ2_buffer", 0);
-        // DEME_TRACKED_RESIZE_DEBUGPRINT(oriQ3_buffer, nOwnerBodies, "oriQ3_buffer", 0);
-        // DEME_ADVISE_DEVICE(voxelID_buffer, dT->streamInfo.device);
-        // DEME_ADVISE_DEVICE(locX_buffer, dT->streamInfo.device);
-        // DEME_ADVISE_DEVICE(locY_buffer, dT->streamInfo.device);
-        // DEME_ADVISE_DEVICE(locZ_buffer, dT->streamInfo.device);
-        // DEME_ADVISE_DEVICE(oriQ0_buffer, dT->streamInfo.device);
-        // DEME_ADVISE_DEVICE(oriQ1_buffer, dT->streamInfo.device);
-        // DEME_ADVISE_DEVICE(oriQ2_buffer, dT->streamInfo.device);
-        // DEME_ADVISE_DEVICE(oriQ3_buffer, dT->streamInfo.device);
-        if (solverFlags.canFamilyChange) {
-            // DEME_TRACKED_RESIZE_DEBUGPRINT(familyID_buffer, nOwnerBodies, "familyID_buffer", 0);
-            // DEME_ADVISE_DEVICE(familyID_buffer, dT->streamInfo.device);
-            DEME_DEVICE_PTR_ALLOC(granData->familyID_buffer, nOwnerBodies);
-        }
-
-        DEME_DEVICE_PTR_ALLOC(granData->relPosNode1_buffer, nTriGM);
-        DEME_DEVICE_PTR_ALLOC(granData->relPosNode2_buffer, nTriGM);
-        DEME_DEVICE_PTR_ALLOC(granData->relPosNode3_buffer, nTriGM);
-
-        // Unset the device change we just did
-        DEME_GPU_CALL(cudaSetDevice(streamInfo.device));
-    }
+    allocateTransferBuffers(nOwnerBodies, nTriGM);
 
     // Resize to the number of spheres (or plus num of triangle facets)
     DEME_TRACKED_RESIZE_DEBUGPRINT(ownerClumpBody, nSpheresGM, "ownerClumpBody", 0);
@@ -611,6 +818,7 @@ void DEMKinematicThread::allocateManagedArrays(size_t nOwnerBodies,
     DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode1, nTriGM, "relPosNode1", make_float3(0));
     DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode2, nTriGM, "relPosNode2", make_float3(0));
     DEME_TRACKED_RESIZE_DEBUGPRINT(relPosNode3, nTriGM, "relPosNode3", make_float3(0));
+    DEME_TRACKED_RESIZE_DEBUGPRINT(triInMeshBVH, nTriGM, "triInMeshBVH", 0);
 
     if (solverFlags.useClumpJitify) {
         DEME_TRACKED_RESIZE_DEBUGPRINT(clumpComponentOffset, nSpheresGM, "clumpComponentOffset", 0);
@@ -630,13 +838,41 @@ void DEMKinematicThread::allocateManagedArrays(size_t nOwnerBodies,
         DEME_TRACKED_RESIZE_DEBUGPRINT(relPosSphereZ, nSpheresGM, "relPosSphereZ", 0);
     }
 
+    // Reserve the room the user instructed, so that owners and geometries added later need no reallocation
+    if (reservation.nOwners > nOwnerBodies) {
+        m_approx_bytes_used += hostReserveAll(reservation.nOwners, familyID, voxelID, locX, locY, locZ, oriQw, oriQx,
+                                              oriQy, oriQz, marginSize);
+        // Buffers that are not swapped in are cudaMalloc-ed for the exact size
+        if (solverFlags.useBufferSwap) {
+            m_approx_bytes_used +=
+                hostReserveAll(reservation.nOwners, voxelID_buffer, locX_buffer, locY_buffer, locZ_buffer, oriQ0_buffer,
+                               oriQ1_buffer, oriQ2_buffer, oriQ3_buffer, absVel_buffer);
+            if (solverFlags.canFamilyChange) {
+                m_approx_bytes_used += hostReserveAll(reservation.nOwners, familyID_buffer);
+            }
+        }
+    }
+    if (reservation.nSpheres > nSpheresGM) {
+        m_approx_bytes_used += hostReserveAll(reservation.nSpheres, ownerClumpBody);
+        if (solverFlags.useClumpJitify) {
+            m_approx_bytes_used += hostReserveAll(reservation.nSpheres, clumpComponentOffset, clumpComponentOffsetExt);
+        } else {
+            m_approx_bytes_used +=
+                hostReserveAll(reservation.nSpheres, radiiSphere, relPosSphereX, relPosSphereY, relPosSphereZ);
+        }
+    }
+    if (reservation.nTriangles > nTriGM) {
+        m_approx_bytes_used +=
+            hostReserveAll(reservation.nTriangles, ownerMesh, relPosNode1, relPosNode2, relPosNode3, triInMeshBVH);
+    }
+
     // Arrays for kT produced contact info
     // The following several arrays will have variable sizes, so here we only used an estimate. My estimate of total
     // contact pairs is 2n, and I think the max is 6n (although I can't prove it). Note the estimate should be large
     // enough to decrease the number of reallocations in the simulation, but not too large that eats too much memory.
     {
-        size_t cnt_arr_size =
-            DEME_MAX(*stateOfSolver_resources.pNumPrevContacts, nSpheresGM * DEME_INIT_CNT_MULTIPLIER);
+        stateParams.cntArrMinLength = DEME_MAX(reservation.nContacts, nSpheresGM * DEME_INIT_CNT_MULTIPLIER);
+        size_t cnt_arr_size = DEME_MAX(*stateOfSolver_resources.pNumPrevContacts, stateParams.cntArrMinLength);
         DEME_TRACKED_RESIZE_DEBUGPRINT(idGeometryA, cnt_arr_size, "idGeometryA", 0);
         DEME_TRACKED_RESIZE_DEBUGPRINT(idGeometryB, cnt_arr_size, "idGeometryB", 0);
         DEME_TRACKED_RESIZE_DEBUGPRINT(contactType, cnt_arr_size, "contactType", NOT_A_CONTACT);
@@ -658,6 +894,7 @@ void DEMKinematicThread::registerPolicies(const std::vector<notStupidBool_t>& fa
 void DEMKinematicThread::populateEntityArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                                               const std::vector<unsigned int>& input_ext_obj_family,
                                               const std::vector<unsigned int>& input_mesh_obj_family,
+                                              const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                                               const std::vector<unsigned int>& input_mesh_facet_owner,
                                               const std::vector<DEMTriangle>& input_mesh_facets,
                                               const ClumpTemplateFlatten& clump_templates,
@@ -770,6 +1007,7 @@ void DEMKinematicThread::populateEntityArrays(const std::vector<std::shared_ptr<
             relPosNode1.at(nExistingFacets + k) = this_tri.p1;
             relPosNode2.at(nExistingFacets + k) = this_tri.p2;
             relPosNode3.at(nExistingFacets + k) = this_tri.p3;
+            triInMeshBVH.at(nExistingFacets + k) = input_mesh_obj_use_bvh.at(i);
         }
 
         family_t this_family_num = input_mesh_obj_family.at(i);
@@ -777,11 +1015,16 @@ void DEMKinematicThread::populateEntityArrays(const std::vector<std::shared_ptr<
         // DEME_DEBUG_PRINTF("kT just loaded a mesh in family %u", +(this_family_num));
         // DEME_DEBUG_PRINTF("Number of triangle facets loaded thus far: %zu", k);
     }
+
+    if (input_mesh_obj_family.size() > 0) {
+        buildMeshBVHs();
+    }
 }
 
 void DEMKinematicThread::initManagedArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                                            const std::vector<unsigned int>& input_ext_obj_family,
                                            const std::vector<unsigned int>& input_mesh_obj_family,
+                                           const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                                            const std::vector<unsigned int>& input_mesh_facet_owner,
                                            const std::vector<DEMTriangle>& input_mesh_facets,
                                            const std::vector<notStupidBool_t>& family_mask_matrix,
@@ -791,13 +1034,14 @@ void DEMKinematicThread::initManagedArrays(const std::vector<std::shared_ptr<DEM
 
     registerPolicies(family_mask_matrix);
 
-    populateEntityArrays(input_clump_batches, input_ext_obj_family, input_mesh_obj_family, input_mesh_facet_owner,
-                         input_mesh_facets, clump_templates, 0, 0, 0);
+    populateEntityArrays(input_clump_batches, input_ext_obj_family, input_mesh_obj_family, input_mesh_obj_use_bvh,
+                         input_mesh_facet_owner, input_mesh_facets, clump_templates, 0, 0, 0);
 }
 
 void DEMKinematicThread::updateClumpMeshArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                                                const std::vector<unsigned int>& input_ext_obj_family,
                                                const std::vector<unsigned int>& input_mesh_obj_family,
+                                               const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                                                const std::vector<unsigned int>& input_mesh_facet_owner,
                                                const std::vector<DEMTriangle>& input_mesh_facets,
                                                const std::vector<notStupidBool_t>& family_mask_matrix,
@@ -809,8 +1053,9 @@ void DEMKinematicThread::updateClumpMeshArrays(const std::vector<std::shared_ptr
                                                size_t nExistingFacets,
                                                unsigned int nExistingObj,
                                                unsigned int nExistingAnalGM) {
-    populateEntityArrays(input_clump_batches, input_ext_obj_family, input_mesh_obj_family, input_mesh_facet_owner,
-                         input_mesh_facets, clump_templates, nExistingOwners, nExistingSpheres, nExistingFacets);
+    populateEntityArrays(input_clump_batches, input_ext_obj_family, input_mesh_obj_family, input_mesh_obj_use_bvh,
+                         input_mesh_facet_owner, input_mesh_facets, clump_templates, nExistingOwners, nExistingSpheres,
+                         nExistingFacets);
 }
 
 void DEMKinematicThread::updatePrevContactArrays(DEMDataDT* dT_data, size_t nContacts) {
@@ -824,35 +1069,35 @@ void DEMKinematicThread::updatePrevContactArrays(DEMDataDT* dT_data, size_t nCon
 void DEMKinematicThread::jitifyKernels(const std::unordered_map<std::string, std::string>& Subs) {
     // First one is bin_sphere_kernels kernels, which figure out the bin--sphere touch pairs
     {
-        bin_sphere_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        bin_sphere_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMBinSphereKernels", JitHelper::KERNEL_DIR / "DEMBinSphereKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
     }
     // Then CD kernels
     {
-        sphere_contact_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        sphere_contact_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMContactKernels_SphereSphere", JitHelper::KERNEL_DIR / "DEMContactKernels_SphereSphere.cu", Subs,
             DEME_JITIFY_OPTIONS)));
     }
     // Then triangle--bin intersection-related kernels
     {
-        bin_triangle_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        bin_triangle_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMBinTriangleKernels", JitHelper::KERNEL_DIR / "DEMBinTriangleKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
     }
     // Then sphere--triangle contact detection-related kernels
     {
-        sphTri_contact_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        sphTri_contact_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMContactKernels_SphereTriangle", JitHelper::KERNEL_DIR / "DEMContactKernels_SphereTriangle.cu", Subs,
             DEME_JITIFY_OPTIONS)));
     }
     // Then contact history mapping kernels
     {
-        history_kernels = std::make_shared<jitify::Program>(std::move(
+        history_kernels = std::make_shared<JitProgram>(std::move(
             JitHelper::buildProgram("DEMHistoryMappingKernels", JitHelper::KERNEL_DIR / "DEMHistoryMappingKernels.cu",
                                     Subs, DEME_JITIFY_OPTIONS)));
     }
     // Then misc kernels
     {
-        misc_kernels = std::make_shared<jitify::Program>(std::move(JitHelper::buildProgram(
+        misc_kernels = std::make_shared<JitProgram>(std::move(JitHelper::buildProgram(
             "DEMMiscKernels", JitHelper::KERNEL_DIR / "DEMMiscKernels.cu", Subs, DEME_JITIFY_OPTIONS)));
     }
 }
@@ -862,28 +1107,66 @@ void DEMKinematicThread::initAllocation() {
 }
 
 void DEMKinematicThread::deallocateEverything() {
-    DEME_DEVICE_PTR_DEALLOC(dT->granData->idGeometryA_buffer);
-    DEME_DEVICE_PTR_DEALLOC(dT->granData->idGeometryB_buffer);
-    DEME_DEVICE_PTR_DEALLOC(dT->granData->contactType_buffer);
-    DEME_DEVICE_PTR_DEALLOC(dT->granData->contactMapping_buffer);
-
-    DEME_DEVICE_PTR_DEALLOC(granData->voxelID_buffer);
-    DEME_DEVICE_PTR_DEALLOC(granData->locX_buffer);
-    DEME_DEVICE_PTR_DEALLOC(granData->locY_buffer);
-    DEME_DEVICE_PTR_DEALLOC(granData->locZ_buffer);
-    DEME_DEVICE_PTR_DEALLOC(granData->oriQ0_buffer);
-    DEME_DEVICE_PTR_DEALLOC(granData->oriQ1_buffer);
-    DEME_DEVICE_PTR_DEALLOC(granData->oriQ2_buffer);
-    DEME_DEVICE_PTR_DEALLOC(granData->oriQ3_buffer);
-    DEME_DEVICE_PTR_DEALLOC(granData->absVel_buffer);
-
-    DEME_DEVICE_PTR_DEALLOC(granData->familyID_buffer);
-
+    // Swapped buffers are managed vectors, which free themselves
+    if (!solverFlags.useBufferSwap) {
+        DEME_DEVICE_PTR_DEALLOC(granData->voxelID_buffer);
+        DEME_DEVICE_PTR_DEALLOC(granData->locX_buffer);
+        DEME_DEVICE_PTR_DEALLOC(granData->locY_buffer);
+        DEME_DEVICE_PTR_DEALLOC(granData->locZ_buffer);
+        DEME_DEVICE_PTR_DEALLOC(granData->oriQ0_buffer);
+        DEME_DEVICE_PTR_DEALLOC(granData->oriQ1_buffer);
+        DEME_DEVICE_PTR_DEALLOC(granData->oriQ2_buffer);
+        DEME_DEVICE_PTR_DEALLOC(granData->oriQ3_buffer);
+        DEME_DEVICE_PTR_DEALLOC(granData->absVel_buffer);
+        DEME_DEVICE_PTR_DEALLOC(granData->familyID_buffer);
+    }
     DEME_DEVICE_PTR_DEALLOC(granData->relPosNode1_buffer);
     DEME_DEVICE_PTR_DEALLOC(granData->relPosNode2_buffer);
     DEME_DEVICE_PTR_DEALLOC(granData->relPosNode3_buffer);
 }
 
+void DEMKinematicThread::buildMeshBVHs() {
+    meshBVHNodes.clear();
+    meshBVHTriIDs.clear();
+    meshBVHOwner.clear();
+    meshBVHRoot.clear();
+    stateParams.nTriInMeshBVHs = 0;
+    // The facets of a mesh are stored contiguously, so a run of the same owner in ownerMesh is a mesh
+    size_t tri_start = 0;
+    while (tri_start < simParams->nTriGM) {
+        size_t tri_end = tri_start + 1;
+        while (tri_end < simParams->nTriGM && ownerMesh[tri_end] == ownerMesh[tri_start]) {
+            tri_end++;
+        }
+        if (triInMeshBVH[tri_start]) {
+            meshBVHOwner.push_back(ownerMesh[tri_start]);
+            meshBVHRoot.push_back(hostBuildMeshBVH(meshBVHNodes, meshBVHTriIDs, relPosNode1.data(), relPosNode2.data(),
+                                                   relPosNode3.data(), tri_start, tri_end, DEME_MESH_BVH_LEAF_SIZE));
+            stateParams.nTriInMeshBVHs += tri_end - tri_start;
+        }
+        tri_start = tri_end;
+    }
+    simParams->nMeshBVHs = meshBVHOwner.size();
+
+    // The arrays may have been re-allocated
+    granData->meshBVHNodes = meshBVHNodes.data();
+    granData->meshBVHTriIDs = meshBVHTriIDs.data();
+    granData->meshBVHOwner = meshBVHOwner.data();
+    granData->meshBVHRoot = meshBVHRoot.data();
+    DEME_DEBUG_PRINTF("kT built BVHs for %u meshes (%zu facets, %zu BVH nodes)", simParams->nMeshBVHs,
+                      stateParams.nTriInMeshBVHs, meshBVHNodes.size());
+}
+
+void DEMKinematicThread::refitMeshBVHs() {
+    if (simParams->nMeshBVHs == 0) {
+        return;
+    }
+    // The BVH topology stays, only the boxes follow the nodes. The node update copies may still be in flight.
+    DEME_GPU_CALL(cudaDeviceSynchronize());
+    hostRefitMeshBVH(meshBVHNodes.data(), meshBVHTriIDs.data(), relPosNode1.data(), relPosNode2.data(),
+                     relPosNode3.data(), 0, meshBVHNodes.size());
+}
+
 void DEMKinematicThread::setTriNodeRelPos(size_t start, const std::vector<DEMTriangle>& triangles) {
     for (size_t i = 0; i < triangles.size(); i++) {
         relPosNode1[start + i] = triangles[i].p1;
@@ -13,7 +13,7 @@
 // #include <set>
 
 #include <core/ApiVersion.h>
-#include <core/utils/ManagedAllocator.hpp>
+#include <core/utils/AllocatorPolicy.hpp>
 #include <core/utils/ThreadManager.h>
 #include <core/utils/GpuManager.h>
 #include <nvmath/helper_math.cuh>
@@ -26,10 +26,8 @@
 
 // #include <core/utils/JitHelper.h>
 
-// Forward declare jitify::Program to avoid downstream dependency
-namespace jitify {
-class Program;
-}
+// Forward declare JitProgram to avoid downstream dependency on jitify
+class JitProgram;
 
 namespace deme {
 
@@ -59,10 +57,14 @@ class DEMKinematicThread {
     // Object which stores the device and stream IDs for this thread
     GpuManager::StreamInfo streamInfo;
 
-    // A class that contains scratch pad and system status data (constructed with the number of temp arrays we need)
-    DEMSolverStateData stateOfSolver_resources = DEMSolverStateData(15);
+    // A class that contains scratch pad and system status data (including the arena the temp arrays come from)
+    DEMSolverStateData stateOfSolver_resources;
 
     size_t m_approx_bytes_used = 0;
+    // Number of times the contact arrays (and dT's contact buffers) were reallocated, and the capacities the user
+    // instructed to reserve
+    size_t m_num_cnt_arr_reallocs = 0;
+    ArrayReservation arrayReservation;
 
     // kT should break out of its inner loop and return to a state where it awaits a `start' call at the outer loop
     bool kTShouldReset = false;
@@ -77,21 +79,25 @@ class DEMKinematicThread {
     WorkerAnomalies anomalies = WorkerAnomalies();
 
     // Buffer arrays for storing info from the dT side.
-    // dT modifies these arrays; kT uses them only.
-
-    // // kT gets clump locations and rotations from dT
-    // // The voxel ID
-    // std::vector<voxelID_t, ManagedAllocator<voxelID_t>> voxelID_buffer;
-    // // The XYZ local location inside a voxel
-    // std::vector<subVoxelPos_t, ManagedAllocator<subVoxelPos_t>> locX_buffer;
-    // std::vector<subVoxelPos_t, ManagedAllocator<subVoxelPos_t>> locY_buffer;
-    // std::vector<subVoxelPos_t, ManagedAllocator<subVoxelPos_t>> locZ_buffer;
-    // // The clump quaternion
-    // std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQ0_buffer;
-    // std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQ1_buffer;
-    // std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQ2_buffer;
-    // std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQ3_buffer;
-    // std::vector<family_t, ManagedAllocator<family_t>> familyID_buffer;
+    // dT modifies these arrays; kT uses them only. When kT and dT share a device, kT takes in a work order by swapping
+    // these with its working arrays (ping-pong), rather than copying them over. Otherwise they stay empty, and the
+    // buffers are cudaMalloc-ed on dT's device instead (see allocateTransferBuffers).
+
+    // kT gets clump locations and rotations from dT
+    // The voxel ID
+    std::vector<voxelID_t, DEMEAllocator<voxelID_t>> voxelID_buffer;
+    // The XYZ local location inside a voxel
+    std::vector<subVoxelPos_t, DEMEAllocator<subVoxelPos_t>> locX_buffer;
+    std::vector<subVoxelPos_t, DEMEAllocator<subVoxelPos_t>> locY_buffer;
+    std::vector<subVoxelPos_t, DEMEAllocator<subVoxelPos_t>> locZ_buffer;
+    // The clump quaternion
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQ0_buffer;
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQ1_buffer;
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQ2_buffer;
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQ3_buffer;
+    // Owner velocities, which kT turns into margin sizes (in place)
+    std::vector<float, DEMEAllocator<float>> absVel_buffer;
+    std::vector<family_t, DEMEAllocator<family_t>> familyID_buffer;
 
     // kT's copy of family map
     // std::unordered_map<unsigned int, family_t> familyUserImplMap;
@@ -103,88 +109,97 @@ class DEMKinematicThread {
     // long, and only a part of it is jitified. The jitified part of it is typically the frequently used clump and maybe
     // triangle tempates; the other part may be the components for a few large clump bodies which are not frequently
     // used. Component sphere's radius
-    std::vector<float, ManagedAllocator<float>> radiiSphere;
+    std::vector<float, DEMEAllocator<float>> radiiSphere;
     // The distinct sphere local position (wrt CoM) values
-    std::vector<float, ManagedAllocator<float>> relPosSphereX;
-    std::vector<float, ManagedAllocator<float>> relPosSphereY;
-    std::vector<float, ManagedAllocator<float>> relPosSphereZ;
+    std::vector<float, DEMEAllocator<float>> relPosSphereX;
+    std::vector<float, DEMEAllocator<float>> relPosSphereY;
+    std::vector<float, DEMEAllocator<float>> relPosSphereZ;
 
     // Triangles (templates) are given a special place (unlike other analytical shapes), b/c we expect them to appear
     // frequently as meshes.
-    std::vector<float3, ManagedAllocator<float3>> relPosNode1;
-    std::vector<float3, ManagedAllocator<float3>> relPosNode2;
-    std::vector<float3, ManagedAllocator<float3>> relPosNode3;
+    std::vector<float3, DEMEAllocator<float3>> relPosNode1;
+    std::vector<float3, DEMEAllocator<float3>> relPosNode2;
+    std::vector<float3, DEMEAllocator<float3>> relPosNode3;
 
     // External object's components may need the following arrays to store some extra defining features of them. We
     // assume there are usually not too many of them in a simulation.
     // Relative position w.r.t. the owner. For example, the following 3 arrays may hold center points for plates, or tip
     // positions for cones.
-    std::vector<float, ManagedAllocator<float>> relPosEntityX;
-    std::vector<float, ManagedAllocator<float>> relPosEntityY;
-    std::vector<float, ManagedAllocator<float>> relPosEntityZ;
+    std::vector<float, DEMEAllocator<float>> relPosEntityX;
+    std::vector<float, DEMEAllocator<float>> relPosEntityY;
+    std::vector<float, DEMEAllocator<float>> relPosEntityZ;
     // Some orientation specifiers. For example, the following 3 arrays may hold normal vectors for planes, or center
     // axis vectors for cylinders.
-    std::vector<float, ManagedAllocator<float>> oriEntityX;
-    std::vector<float, ManagedAllocator<float>> oriEntityY;
-    std::vector<float, ManagedAllocator<float>> oriEntityZ;
+    std::vector<float, DEMEAllocator<float>> oriEntityX;
+    std::vector<float, DEMEAllocator<float>> oriEntityY;
+    std::vector<float, DEMEAllocator<float>> oriEntityZ;
     // Some size specifiers. For example, the following 3 arrays may hold top, bottom and length information for finite
     // cylinders.
-    std::vector<float, ManagedAllocator<float>> sizeEntity1;
-    std::vector<float, ManagedAllocator<float>> sizeEntity2;
-    std::vector<float, ManagedAllocator<float>> sizeEntity3;
+    std::vector<float, DEMEAllocator<float>> sizeEntity1;
+    std::vector<float, DEMEAllocator<float>> sizeEntity2;
+    std::vector<float, DEMEAllocator<float>> sizeEntity3;
 
     // The voxel ID (split into 3 parts, representing XYZ location)
-    std::vector<voxelID_t, ManagedAllocator<voxelID_t>> voxelID;
+    std::vector<voxelID_t, DEMEAllocator<voxelID_t>> voxelID;
 
     // The XYZ local location inside a voxel
-    std::vector<subVoxelPos_t, ManagedAllocator<subVoxelPos_t>> locX;
-    std::vector<subVoxelPos_t, ManagedAllocator<subVoxelPos_t>> locY;
-    std::vector<subVoxelPos_t, ManagedAllocator<subVoxelPos_t>> locZ;
+    std::vector<subVoxelPos_t, DEMEAllocator<subVoxelPos_t>> locX;
+    std::vector<subVoxelPos_t, DEMEAllocator<subVoxelPos_t>> locY;
+    std::vector<subVoxelPos_t, DEMEAllocator<subVoxelPos_t>> locZ;
 
     // The clump quaternion
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQw;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQx;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQy;
-    std::vector<oriQ_t, ManagedAllocator<oriQ_t>> oriQz;
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQw;
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQx;
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQy;
+    std::vector<oriQ_t, DEMEAllocator<oriQ_t>> oriQz;
 
     // dT-supplied system velocity
-    std::vector<float, ManagedAllocator<float>> marginSize;
+    std::vector<float, DEMEAllocator<float>> marginSize;
 
     // Clump's family identification code. Used in determining whether they can be contacts between two families, and
     // whether a family has prescribed motions.
-    std::vector<family_t, ManagedAllocator<family_t>> familyID;
+    std::vector<family_t, DEMEAllocator<family_t>> familyID;
 
     // A long array (usually 32640 elements) registering whether between 2 families there should be contacts
-    std::vector<notStupidBool_t, ManagedAllocator<notStupidBool_t>> familyMaskMatrix;
+    std::vector<notStupidBool_t, DEMEAllocator<notStupidBool_t>> familyMaskMatrix;
 
     // The amount of contact margin that each family should add to its associated contact geometries. Default is 0, and
     // that means geometries should be considered in contact when they are physically in contact.
-    std::vector<float, ManagedAllocator<float>> familyExtraMarginSize;
+    std::vector<float, DEMEAllocator<float>> familyExtraMarginSize;
 
     // kT computed contact pair info
-    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> idGeometryA;
-    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> idGeometryB;
-    std::vector<contact_t, ManagedAllocator<contact_t>> contactType;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> idGeometryA;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> idGeometryB;
+    std::vector<contact_t, DEMEAllocator<contact_t>> contactType;
 
     // Contact pair info at the previous time step. This is needed by dT so persistent contacts are identified in
     // history-based models.
-    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> previous_idGeometryA;
-    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> previous_idGeometryB;
-    std::vector<contact_t, ManagedAllocator<contact_t>> previous_contactType;
-    std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>> contactMapping;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> previous_idGeometryA;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> previous_idGeometryB;
+    std::vector<contact_t, DEMEAllocator<contact_t>> previous_contactType;
+    std::vector<contactPairs_t, DEMEAllocator<contactPairs_t>> contactMapping;
 
     // Sphere-related arrays in managed memory
     // Owner body ID of this component
-    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> ownerClumpBody;
-    std::vector<bodyID_t, ManagedAllocator<bodyID_t>> ownerMesh;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> ownerClumpBody;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> ownerMesh;
+    // Whether a facet belongs to a mesh that finds its sphere contacts by querying its BVH (such facets are not binned)
+    std::vector<notStupidBool_t, DEMEAllocator<notStupidBool_t>> triInMeshBVH;
+
+    // Mesh BVHs, built in the meshes' own frames. They are re-built when meshes are added or removed, and refit when
+    // meshes deform.
+    std::vector<DEMMeshBVHNode, DEMEAllocator<DEMMeshBVHNode>> meshBVHNodes;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> meshBVHTriIDs;
+    std::vector<bodyID_t, DEMEAllocator<bodyID_t>> meshBVHOwner;
+    std::vector<unsigned int, DEMEAllocator<unsigned int>> meshBVHRoot;
 
     // The ID that maps this sphere component's geometry-defining parameters, when this component is jitified
-    std::vector<clumpComponentOffset_t, ManagedAllocator<clumpComponentOffset_t>> clumpComponentOffset;
+    std::vector<clumpComponentOffset_t, DEMEAllocator<clumpComponentOffset_t>> clumpComponentOffset;
     // The ID that maps this sphere component's geometry-defining parameters, when this component is not jitified (too
     // many templates)
-    std::vector<clumpComponentOffsetExt_t, ManagedAllocator<clumpComponentOffsetExt_t>> clumpComponentOffsetExt;
+    std::vector<clumpComponentOffsetExt_t, DEMEAllocator<clumpComponentOffsetExt_t>> clumpComponentOffsetExt;
     // The ID that maps this analytical entity component's geometry-defining parameters, when this component is jitified
-    // std::vector<clumpComponentOffset_t, ManagedAllocator<clumpComponentOffset_t>> analComponentOffset;
+    // std::vector<clumpComponentOffset_t, DEMEAllocator<clumpComponentOffset_t>> analComponentOffset;
 
     // kT's timers
     std::vector<std::string> timer_names = {"Discretize domain",      "Find contact pairs", "Build history map",
@@ -254,6 +269,8 @@ class DEMKinematicThread {
     void resetUserCallStat();
     /// Return the approximate RAM usage
     size_t estimateMemUsage() const;
+    /// Return the number of times the contact arrays were reallocated
+    size_t getNumCntArrReallocs() const { return m_num_cnt_arr_reallocs; }
 
     /// Resize managed arrays (and perhaps Instruct/Suggest their preferred residence location as well?)
     void allocateManagedArrays(size_t nOwnerBodies,
@@ -268,13 +285,15 @@ class DEMKinematicThread {
                                unsigned int nClumpTopo,
                                unsigned int nClumpComponents,
                                unsigned int nJitifiableClumpComponents,
-                               unsigned int nMatTuples);
+                               unsigned int nMatTuples,
+                               const ArrayReservation& reservation);
 
     // initManagedArrays's components
     void registerPolicies(const std::vector<notStupidBool_t>& family_mask_matrix);
     void populateEntityArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                               const std::vector<unsigned int>& input_ext_obj_family,
                               const std::vector<unsigned int>& input_mesh_obj_family,
+                              const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                               const std::vector<unsigned int>& input_mesh_facet_owner,
                               const std::vector<DEMTriangle>& input_mesh_facets,
                               const ClumpTemplateFlatten& clump_templates,
@@ -286,6 +305,7 @@ class DEMKinematicThread {
     void initManagedArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                            const std::vector<unsigned int>& input_ext_obj_family,
                            const std::vector<unsigned int>& input_mesh_obj_family,
+                           const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                            const std::vector<unsigned int>& input_mesh_facet_owner,
                            const std::vector<DEMTriangle>& input_mesh_facets,
                            const std::vector<notStupidBool_t>& family_mask_matrix,
@@ -296,6 +316,7 @@ class DEMKinematicThread {
     void updateClumpMeshArrays(const std::vector<std::shared_ptr<DEMClumpBatch>>& input_clump_batches,
                                const std::vector<unsigned int>& input_ext_obj_family,
                                const std::vector<unsigned int>& input_mesh_obj_family,
+                               const std::vector<notStupidBool_t>& input_mesh_obj_use_bvh,
                                const std::vector<unsigned int>& input_mesh_facet_owner,
                                const std::vector<DEMTriangle>& input_mesh_facets,
                                const std::vector<notStupidBool_t>& family_mask_matrix,
@@ -308,6 +329,11 @@ class DEMKinematicThread {
                                unsigned int nExistingObj,
                                unsigned int nExistingAnalGM);
 
+    /// Build the BVHs of the meshes that use one (all of them, as mesh facets may have been added or removed)
+    void buildMeshBVHs();
+    /// Refit the mesh BVHs to the current mesh node positions (after meshes deform)
+    void refitMeshBVHs();
+
     /// Set SimParams items
     void setSimParams(unsigned char nvXp2,
                       unsigned char nvYp2,
@@ -318,9 +344,11 @@ class DEMKinematicThread {
                       binID_t nbX,
                       binID_t nbY,
                       binID_t nbZ,
+                      unsigned int nBinLevels,
                       float3 LBFPoint,
                       float3 user_box_min,
                       float3 user_box_max,
+                      unsigned int periodic_dirs,
                       float3 G,
                       double ts_size,
                       float expand_factor,
@@ -348,6 +376,13 @@ class DEMKinematicThread {
     /// Change all entities with (user-level) family number ID_from to have a new number ID_to
     void changeFamily(unsigned int ID_from, unsigned int ID_to);
 
+    /// Remove the entities marked in purge from all kT arrays (and transfer buffers) and translate the IDs of the
+    /// survivors
+    void purgeEntities(const EntityPurgeMap& purge);
+
+    /// Permute the clumps and spheres in all kT arrays as reorder says
+    void reorderEntities(const EntityReorderMap& reorder);
+
     /// Change radii and relPos info of these owners (if these owners are clumps)
     void changeOwnerSizes(const std::vector<bodyID_t>& IDs, const std::vector<float>& factors);
 
@@ -371,8 +406,12 @@ class DEMKinematicThread {
     inline void unpackMyBuffer();
     // Send produced data to dT-owned biffers
     void sendToTheirBuffer();
-    // Resize dT's buffer arrays based on the number of contact pairs
+    // Resize dT's buffer arrays to the given length (capacity included), which should come from decideCntArrLength
     inline void transferArraysResize(size_t nContactPairs);
+    // Re-point granData (and dT's send targets) to kT's working and buffer arrays, after they are swapped
+    inline void packBufferPointers();
+    // (Re)allocate the buffers dT sends work orders to, for this many owners and triangles
+    inline void allocateTransferBuffers(size_t nOwnerBodies, size_t nTriGM);
     // Automatic adjustments to sim params
     void calibrateParams();
     // The kT-side allocations that can be done at initialization time
@@ -381,13 +420,13 @@ class DEMKinematicThread {
     void deallocateEverything();
 
     // Just-in-time compiled kernels
-    // jitify::Program bin_sphere_kernels = JitHelper::buildProgram("bin_sphere_kernels", " ");
-    std::shared_ptr<jitify::Program> bin_sphere_kernels;
-    std::shared_ptr<jitify::Program> bin_triangle_kernels;
-    std::shared_ptr<jitify::Program> sphTri_contact_kernels;
-    std::shared_ptr<jitify::Program> sphere_contact_kernels;
-    std::shared_ptr<jitify::Program> history_kernels;
-    std::shared_ptr<jitify::Program> misc_kernels;
+    // JitProgram bin_sphere_kernels = JitHelper::buildProgram("bin_sphere_kernels", " ");
+    std::shared_ptr<JitProgram> bin_sphere_kernels;
+    std::shared_ptr<JitProgram> bin_triangle_kernels;
+    std::shared_ptr<JitProgram> sphTri_contact_kernels;
+    std::shared_ptr<JitProgram> sphere_contact_kernels;
+    std::shared_ptr<JitProgram> history_kernels;
+    std::shared_ptr<JitProgram> misc_kernels;
 
     // Adjuster for bin size
     class AccumTimer {
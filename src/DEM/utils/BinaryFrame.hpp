@@ -0,0 +1,515 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_BINARY_FRAME_HPP
+#define DEME_BINARY_FRAME_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#ifdef DEME_USE_ZLIB
+    #include <zlib.h>
+#endif
+
+namespace deme {
+
+// =============================================================================
+// A columnar binary frame format, used by the BINARY output format.
+//
+// Layout (all numbers little-endian):
+//   char[8]   magic "DEMEFRM\0"
+//   uint32    format version
+//   uint32    flags (bit 0: column payloads are compressed)
+//   uint64    number of rows
+//   uint32    number of columns
+//   for each column:
+//     uint32  name length, then the name chars
+//     uint8   column type (FRAME_COL_TYPE)
+//     uint64  payload size before compression
+//     uint64  payload size as stored
+//   then the payloads of all columns, in the same order.
+// A numeric column's payload is its raw array. A STRING column's payload is a dictionary (uint32 number of entries,
+// then uint32 length + chars for each entry) followed by a uint32 dictionary index per row. If compressed, a payload
+// has its bytes shuffled by element size (which makes float arrays much more compressible) then deflated by zlib.
+// =============================================================================
+
+enum class FRAME_COL_TYPE : uint8_t { FLOAT32, FLOAT64, UINT8, UINT16, UINT32, UINT64, INT32, STRING };
+
+namespace binary_frame {
+
+const char MAGIC[8] = {'D', 'E', 'M', 'E', 'F', 'R', 'M', '\0'};
+const uint32_t VERSION = 1;
+const uint32_t FLAG_COMPRESSED = 1;
+
+inline bool hostIsLittleEndian() {
+    const uint16_t probe = 1;
+    uint8_t first_byte;
+    std::memcpy(&first_byte, &probe, 1);
+    return first_byte == 1;
+}
+
+template <typename T>
+inline FRAME_COL_TYPE colTypeOf() {
+    if (std::is_same<T, float>::value)
+        return FRAME_COL_TYPE::FLOAT32;
+    if (std::is_same<T, double>::value)
+        return FRAME_COL_TYPE::FLOAT64;
+    if (std::is_same<T, uint8_t>::value)
+        return FRAME_COL_TYPE::UINT8;
+    if (std::is_same<T, uint16_t>::value)
+        return FRAME_COL_TYPE::UINT16;
+    if (std::is_same<T, uint32_t>::value)
+        return FRAME_COL_TYPE::UINT32;
+    if (std::is_same<T, uint64_t>::value)
+        return FRAME_COL_TYPE::UINT64;
+    if (std::is_same<T, int32_t>::value)
+        return FRAME_COL_TYPE::INT32;
+    throw std::runtime_error("Unsupported column data type in a binary frame.");
+}
+
+inline size_t colTypeSize(FRAME_COL_TYPE type) {
+    switch (type) {
+        case FRAME_COL_TYPE::FLOAT64:
+        case FRAME_COL_TYPE::UINT64:
+            return 8;
+        case FRAME_COL_TYPE::UINT16:
+            return 2;
+        case FRAME_COL_TYPE::UINT8:
+            return 1;
+        default:
+            return 4;
+    }
+}
+
+// Append n elements of size elem_size to out as little-endian
+inline void appendLE(std::string& out, const void* data, size_t n, size_t elem_size) {
+    const char* bytes = static_cast<const char*>(data);
+    if (hostIsLittleEndian() || elem_size == 1) {
+        out.append(bytes, n * elem_size);
+        return;
+    }
+    size_t start = out.size();
+    out.resize(start + n * elem_size);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t b = 0; b < elem_size; b++) {
+            out[start + i * elem_size + b] = bytes[i * elem_size + elem_size - 1 - b];
+        }
+    }
+}
+
+template <typename T>
+inline void appendScalar(std::string& out, T val) {
+    appendLE(out, &val, 1, sizeof(T));
+}
+
+// Copy n little-endian elements of size elem_size from in to data
+inline void readLE(void* data, const char* in, size_t n, size_t elem_size) {
+    char* bytes = static_cast<char*>(data);
+    if (hostIsLittleEndian() || elem_size == 1) {
+        std::memcpy(bytes, in, n * elem_size);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (size_t b = 0; b < elem_size; b++) {
+            bytes[i * elem_size + b] = in[i * elem_size + elem_size - 1 - b];
+        }
+    }
+}
+
+// Group byte k of all elements together; the sign/exponent bytes of similar floats then form long, repetitive runs
+inline std::string shuffleBytes(const std::string& in, size_t elem_size) {
+    if (elem_size <= 1) {
+        return in;
+    }
+    size_t n = in.size() / elem_size;
+    std::string out(in.size(), '\0');
+    for (size_t i = 0; i < n; i++) {
+        for (size_t b = 0; b < elem_size; b++) {
+            out[b * n + i] = in[i * elem_size + b];
+        }
+    }
+    // Leftover bytes (only possible for STRING payloads, which are shuffled with size 1 anyway)
+    std::memcpy(&out[n * elem_size], in.data() + n * elem_size, in.size() - n * elem_size);
+    return out;
+}
+
+inline std::string unshuffleBytes(const std::string& in, size_t elem_size) {
+    if (elem_size <= 1) {
+        return in;
+    }
+    size_t n = in.size() / elem_size;
+    std::string out(in.size(), '\0');
+    for (size_t i = 0; i < n; i++) {
+        for (size_t b = 0; b < elem_size; b++) {
+            out[i * elem_size + b] = in[b * n + i];
+        }
+    }
+    std::memcpy(&out[n * elem_size], in.data() + n * elem_size, in.size() - n * elem_size);
+    return out;
+}
+
+inline std::string compress(const std::string& in, size_t elem_size) {
+#ifdef DEME_USE_ZLIB
+    std::string shuffled = shuffleBytes(in, elem_size);
+    uLongf out_size = compressBound(shuffled.size());
+    std::string out(out_size, '\0');
+    // Output is usually written every many steps; favor speed over ratio
+    if (compress2(reinterpret_cast<Bytef*>(&out[0]), &out_size, reinterpret_cast<const Bytef*>(shuffled.data()),
+                  shuffled.size(), Z_BEST_SPEED) != Z_OK) {
+        throw std::runtime_error("Failed to compress a binary frame column.");
+    }
+    out.resize(out_size);
+    return out;
+#else
+    (void)in;
+    (void)elem_size;
+    throw std::runtime_error("Compressed binary frames need the library to be compiled with zlib (USE_ZLIB).");
+#endif
+}
+
+inline std::string decompress(const char* in, size_t in_size, size_t out_size, size_t elem_size) {
+#ifdef DEME_USE_ZLIB
+    std::string out(out_size, '\0');
+    uLongf actual_size = out_size;
+    if (uncompress(reinterpret_cast<Bytef*>(&out[0]), &actual_size, reinterpret_cast<const Bytef*>(in), in_size) !=
+            Z_OK ||
+        actual_size != out_size) {
+        throw std::runtime_error("Failed to decompress a binary frame column.");
+    }
+    return unshuffleBytes(out, elem_size);
+#else
+    (void)in;
+    (void)in_size;
+    (void)out_size;
+    (void)elem_size;
+    throw std::runtime_error("This binary frame is compressed, but the library was compiled without zlib (USE_ZLIB).");
+#endif
+}
+
+}  // namespace binary_frame
+
+/// The columns of one output frame (a snapshot of spheres, clumps or contacts), which can then be written as BINARY
+/// or as CSV. Gathering a frame is cheap compared to formatting and writing it, so the latter can be done elsewhere
+/// (e.g. by the asynchronous output writer) while the simulation moves on.
+class OutputFrame {
+  public:
+    explicit OutputFrame(size_t n_rows = 0) : nRows(n_rows) {}
+
+    size_t GetNumRows() const { return nRows; }
+
+    /// Add a numeric column. Only the first n_rows elements are used.
+    template <typename T>
+    void AddColumn(const std::string& name, const std::vector<T>& data) {
+        if (data.size() < nRows) {
+            throw std::runtime_error("Column " + name + " is shorter than the frame it is added to.");
+        }
+        Column col;
+        col.name = name;
+        col.type = binary_frame::colTypeOf<T>();
+        binary_frame::appendLE(col.payload, data.data(), nRows, sizeof(T));
+        columns.push_back(std::move(col));
+    }
+
+    /// Add a string column, given as a dictionary and a dictionary index for each row.
+    void AddStringColumn(const std::string& name,
+                         const std::vector<std::string>& dict,
+                         const std::vector<uint32_t>& indices) {
+        if (indices.size() < nRows) {
+            throw std::runtime_error("Column " + name + " is shorter than the frame it is added to.");
+        }
+        Column col;
+        col.name = name;
+        col.type = FRAME_COL_TYPE::STRING;
+        col.dict = dict;
+        binary_frame::appendScalar<uint32_t>(col.payload, dict.size());
+        for (const auto& entry : dict) {
+            binary_frame::appendScalar<uint32_t>(col.payload, entry.size());
+            col.payload.append(entry);
+        }
+        col.indexOffset = col.payload.size();
+        binary_frame::appendLE(col.payload, indices.data(), nRows, sizeof(uint32_t));
+        columns.push_back(std::move(col));
+    }
+
+    /// Write this frame in the BINARY format
+    void WriteBinary(std::ostream& out, bool compress = false) const {
+        std::vector<std::string> stored(columns.size());
+        for (size_t i = 0; i < columns.size(); i++) {
+            if (compress) {
+                size_t elem_size =
+                    (columns[i].type == FRAME_COL_TYPE::STRING) ? 1 : binary_frame::colTypeSize(columns[i].type);
+                stored[i] = binary_frame::compress(columns[i].payload, elem_size);
+            }
+        }
+
+        std::string header(binary_frame::MAGIC, sizeof(binary_frame::MAGIC));
+        binary_frame::appendScalar<uint32_t>(header, binary_frame::VERSION);
+        binary_frame::appendScalar<uint32_t>(header, compress ? binary_frame::FLAG_COMPRESSED : 0);
+        binary_frame::appendScalar<uint64_t>(header, nRows);
+        binary_frame::appendScalar<uint32_t>(header, columns.size());
+        for (size_t i = 0; i < columns.size(); i++) {
+            binary_frame::appendScalar<uint32_t>(header, columns[i].name.size());
+            header.append(columns[i].name);
+            binary_frame::appendScalar<uint8_t>(header, static_cast<uint8_t>(columns[i].type));
+            binary_frame::appendScalar<uint64_t>(header, columns[i].payload.size());
+            binary_frame::appendScalar<uint64_t>(header, compress ? stored[i].size() : columns[i].payload.size());
+        }
+        out.write(header.data(), header.size());
+        for (size_t i = 0; i < columns.size(); i++) {
+            const std::string& payload = compress ? stored[i] : columns[i].payload;
+            out.write(payload.data(), payload.size());
+        }
+    }
+
+    /// Write this frame as CSV, with a header line of column names. Floating-point numbers are written with the given
+    /// precision, integers as integers and string columns as their strings.
+    void WriteCsv(std::ostream& out, unsigned int precision = 6) const {
+        std::ostringstream outstrstream;
+        outstrstream.precision(precision);
+        for (size_t j = 0; j < columns.size(); j++) {
+            outstrstream << (j > 0 ? "," : "") << columns[j].name;
+        }
+        outstrstream << "\n";
+        for (size_t i = 0; i < nRows; i++) {
+            for (size_t j = 0; j < columns.size(); j++) {
+                if (j > 0) {
+                    outstrstream << ",";
+                }
+                writeCsvEntry(outstrstream, columns[j], i);
+            }
+            outstrstream << "\n";
+            // Hand the text over in chunks, so a huge frame is never held as text all at once
+            if ((i + 1) % CSV_CHUNK_ROWS == 0) {
+                out << outstrstream.str();
+                outstrstream.str("");
+            }
+        }
+        out << outstrstream.str();
+    }
+
+  private:
+    struct Column {
+        std::string name;
+        FRAME_COL_TYPE type;
+        std::string payload;
+        // For STRING columns: the dictionary, and where the per-row indices start in payload
+        std::vector<std::string> dict;
+        size_t indexOffset = 0;
+    };
+    static const size_t CSV_CHUNK_ROWS = 65536;
+    size_t nRows;
+    std::vector<Column> columns;
+
+    template <typename T>
+    static T entryAt(const Column& col, size_t offset, size_t row) {
+        T val;
+        binary_frame::readLE(&val, col.payload.data() + offset + row * sizeof(T), 1, sizeof(T));
+        return val;
+    }
+
+    static void writeCsvEntry(std::ostream& out, const Column& col, size_t row) {
+        switch (col.type) {
+            case FRAME_COL_TYPE::FLOAT32:
+                out << entryAt<float>(col, 0, row);
+                break;
+            case FRAME_COL_TYPE::FLOAT64:
+                out << entryAt<double>(col, 0, row);
+                break;
+            case FRAME_COL_TYPE::UINT8:
+                out << +(entryAt<uint8_t>(col, 0, row));
+                break;
+            case FRAME_COL_TYPE::UINT16:
+                out << entryAt<uint16_t>(col, 0, row);
+                break;
+            case FRAME_COL_TYPE::UINT32:
+                out << entryAt<uint32_t>(col, 0, row);
+                break;
+            case FRAME_COL_TYPE::UINT64:
+                out << entryAt<uint64_t>(col, 0, row);
+                break;
+            case FRAME_COL_TYPE::INT32:
+                out << entryAt<int32_t>(col, 0, row);
+                break;
+            case FRAME_COL_TYPE::STRING:
+                out << col.dict.at(entryAt<uint32_t>(col, col.indexOffset, row));
+                break;
+        }
+    }
+};
+
+/// One frame read back from a binary output file.
+class BinaryFrame {
+  public:
+    /// Load a frame from a file written with the BINARY output format
+    explicit BinaryFrame(const std::string& infilename) {
+        std::ifstream input(infilename, std::ios::binary);
+        if (!input) {
+            throw std::runtime_error("Cannot open binary frame file " + infilename + ".");
+        }
+        std::stringstream buffer;
+        buffer << input.rdbuf();
+        parse(buffer.str(), infilename);
+    }
+
+    size_t GetNumRows() const { return nRows; }
+    const std::vector<std::string>& GetColumnNames() const { return names; }
+    bool HasColumn(const std::string& name) const { return columns.count(name) > 0; }
+
+    /// Get a numeric column, converted to T
+    template <typename T>
+    std::vector<T> GetColumn(const std::string& name) const {
+        const Column& col = findColumn(name);
+        std::vector<T> out(nRows);
+        switch (col.type) {
+            case FRAME_COL_TYPE::FLOAT32:
+                convertColumn<float, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::FLOAT64:
+                convertColumn<double, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::UINT8:
+                convertColumn<uint8_t, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::UINT16:
+                convertColumn<uint16_t, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::UINT32:
+                convertColumn<uint32_t, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::UINT64:
+                convertColumn<uint64_t, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::INT32:
+                convertColumn<int32_t, T>(col, out);
+                break;
+            default:
+                throw std::runtime_error("Column " + name + " is a string column, not a numeric one.");
+        }
+        return out;
+    }
+
+    /// Get a string column, expanded to one string per row
+    std::vector<std::string> GetStringColumn(const std::string& name) const {
+        const Column& col = findColumn(name);
+        if (col.type != FRAME_COL_TYPE::STRING) {
+            throw std::runtime_error("Column " + name + " is a numeric column, not a string one.");
+        }
+        const std::string& p = col.payload;
+        size_t pos = 0;
+        uint32_t n_dict = readScalar<uint32_t>(p, pos);
+        std::vector<std::string> dict(n_dict);
+        for (auto& entry : dict) {
+            uint32_t len = readScalar<uint32_t>(p, pos);
+            checkBounds(p, pos, len);
+            entry = p.substr(pos, len);
+            pos += len;
+        }
+        checkBounds(p, pos, nRows * sizeof(uint32_t));
+        std::vector<uint32_t> indices(nRows);
+        binary_frame::readLE(indices.data(), p.data() + pos, nRows, sizeof(uint32_t));
+        std::vector<std::string> out(nRows);
+        for (size_t i = 0; i < nRows; i++) {
+            out[i] = dict.at(indices[i]);
+        }
+        return out;
+    }
+
+  private:
+    struct Column {
+        FRAME_COL_TYPE type;
+        std::string payload;
+    };
+    size_t nRows = 0;
+    std::vector<std::string> names;
+    std::unordered_map<std::string, Column> columns;
+
+    static void checkBounds(const std::string& buf, size_t pos, size_t len) {
+        if (pos + len > buf.size()) {
+            throw std::runtime_error("Binary frame is truncated or corrupted.");
+        }
+    }
+
+    template <typename T>
+    static T readScalar(const std::string& buf, size_t& pos) {
+        checkBounds(buf, pos, sizeof(T));
+        T val;
+        binary_frame::readLE(&val, buf.data() + pos, 1, sizeof(T));
+        pos += sizeof(T);
+        return val;
+    }
+
+    const Column& findColumn(const std::string& name) const {
+        auto it = columns.find(name);
+        if (it == columns.end()) {
+            throw std::runtime_error("Column " + name + " does not exist in this binary frame.");
+        }
+        return it->second;
+    }
+
+    template <typename S, typename T>
+    void convertColumn(const Column& col, std::vector<T>& out) const {
+        if (col.payload.size() < nRows * sizeof(S)) {
+            throw std::runtime_error("Binary frame is truncated or corrupted.");
+        }
+        std::vector<S> raw(nRows);
+        binary_frame::readLE(raw.data(), col.payload.data(), nRows, sizeof(S));
+        for (size_t i = 0; i < nRows; i++) {
+            out[i] = static_cast<T>(raw[i]);
+        }
+    }
+
+    void parse(const std::string& buf, const std::string& infilename) {
+        if (buf.size() < sizeof(binary_frame::MAGIC) ||
+            std::memcmp(buf.data(), binary_frame::MAGIC, sizeof(binary_frame::MAGIC)) != 0) {
+            throw std::runtime_error(infilename + " is not a binary frame file.");
+        }
+        size_t pos = sizeof(binary_frame::MAGIC);
+        uint32_t version = readScalar<uint32_t>(buf, pos);
+        if (version > binary_frame::VERSION) {
+            throw std::runtime_error(infilename + " is written by a newer version of the binary frame format.");
+        }
+        uint32_t flags = readScalar<uint32_t>(buf, pos);
+        bool compressed = flags & binary_frame::FLAG_COMPRESSED;
+        nRows = readScalar<uint64_t>(buf, pos);
+        uint32_t n_cols = readScalar<uint32_t>(buf, pos);
+
+        std::vector<FRAME_COL_TYPE> types(n_cols);
+        std::vector<uint64_t> raw_sizes(n_cols), stored_sizes(n_cols);
+        names.resize(n_cols);
+        for (uint32_t i = 0; i < n_cols; i++) {
+            uint32_t name_len = readScalar<uint32_t>(buf, pos);
+            checkBounds(buf, pos, name_len);
+            names[i] = buf.substr(pos, name_len);
+            pos += name_len;
+            types[i] = static_cast<FRAME_COL_TYPE>(readScalar<uint8_t>(buf, pos));
+            raw_sizes[i] = readScalar<uint64_t>(buf, pos);
+            stored_sizes[i] = readScalar<uint64_t>(buf, pos);
+        }
+        for (uint32_t i = 0; i < n_cols; i++) {
+            checkBounds(buf, pos, stored_sizes[i]);
+            Column col;
+            col.type = types[i];
+            if (compressed) {
+                size_t elem_size = (types[i] == FRAME_COL_TYPE::STRING) ? 1 : binary_frame::colTypeSize(types[i]);
+                col.payload = binary_frame::decompress(buf.data() + pos, stored_sizes[i], raw_sizes[i], elem_size);
+            } else {
+                col.payload = buf.substr(pos, stored_sizes[i]);
+            }
+            pos += stored_sizes[i];
+            columns[names[i]] = std::move(col);
+        }
+    }
+};
+
+}  // namespace deme
+
+#endif
@@ -0,0 +1,123 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_CLUMP_CSV_HPP
+#define DEME_CLUMP_CSV_HPP
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/CsvFrame.hpp>
+
+namespace deme {
+
+// Column names of the clump output file
+const std::string OUTPUT_FILE_X_COL_NAME = std::string("X");
+const std::string OUTPUT_FILE_Y_COL_NAME = std::string("Y");
+const std::string OUTPUT_FILE_Z_COL_NAME = std::string("Z");
+const std::string OUTPUT_FILE_R_COL_NAME = std::string("r");
+const std::string OUTPUT_FILE_QW_COL_NAME = std::string("Qw");
+const std::string OUTPUT_FILE_QX_COL_NAME = std::string("Qx");
+const std::string OUTPUT_FILE_QY_COL_NAME = std::string("Qy");
+const std::string OUTPUT_FILE_QZ_COL_NAME = std::string("Qz");
+const std::string OUTPUT_FILE_VEL_X_COL_NAME = std::string("v_x");
+const std::string OUTPUT_FILE_VEL_Y_COL_NAME = std::string("v_y");
+const std::string OUTPUT_FILE_VEL_Z_COL_NAME = std::string("v_z");
+const std::string OUTPUT_FILE_ANGVEL_X_COL_NAME = std::string("w_x");
+const std::string OUTPUT_FILE_ANGVEL_Y_COL_NAME = std::string("w_y");
+const std::string OUTPUT_FILE_ANGVEL_Z_COL_NAME = std::string("w_z");
+const std::string OUTPUT_FILE_CLUMP_TYPE_NAME = std::string("clump_type");
+
+/// Group 3 float columns of a clump CSV frame by the clump type column
+inline std::unordered_map<std::string, std::vector<float3>> GroupClumpFloat3ByType(const CsvFrame& frame,
+                                                                                   const std::string& clump_header,
+                                                                                   const std::string& x_header,
+                                                                                   const std::string& y_header,
+                                                                                   const std::string& z_header) {
+    std::vector<std::string> type_names;
+    std::vector<uint32_t> types;
+    frame.GetStringColumn(clump_header, type_names, types);
+    std::vector<float> X = frame.GetColumn<float>(x_header);
+    std::vector<float> Y = frame.GetColumn<float>(y_header);
+    std::vector<float> Z = frame.GetColumn<float>(z_header);
+    // Group into vectors indexed by type first, so the map is not looked up for every row
+    std::vector<std::vector<float3>> grouped(type_names.size());
+    for (size_t i = 0; i < frame.GetNumRows(); i++) {
+        grouped[types[i]].push_back(host_make_float3(X[i], Y[i], Z[i]));
+    }
+    std::unordered_map<std::string, std::vector<float3>> type_xyz_map;
+    for (size_t t = 0; t < type_names.size(); t++) {
+        type_xyz_map[type_names[t]] = std::move(grouped[t]);
+    }
+    return type_xyz_map;
+}
+
+/// Group the quaternion columns of a clump CSV frame by clump type
+inline std::unordered_map<std::string, std::vector<float4>> GroupClumpQuatByType(const CsvFrame& frame) {
+    std::vector<std::string> type_names;
+    std::vector<uint32_t> types;
+    frame.GetStringColumn(OUTPUT_FILE_CLUMP_TYPE_NAME, type_names, types);
+    std::vector<float> Qw = frame.GetColumn<float>(OUTPUT_FILE_QW_COL_NAME);
+    std::vector<float> Qx = frame.GetColumn<float>(OUTPUT_FILE_QX_COL_NAME);
+    std::vector<float> Qy = frame.GetColumn<float>(OUTPUT_FILE_QY_COL_NAME);
+    std::vector<float> Qz = frame.GetColumn<float>(OUTPUT_FILE_QZ_COL_NAME);
+    std::vector<std::vector<float4>> grouped(type_names.size());
+    for (size_t i = 0; i < frame.GetNumRows(); i++) {
+        grouped[types[i]].push_back(host_make_float4(Qx[i], Qy[i], Qz[i], Qw[i]));
+    }
+    std::unordered_map<std::string, std::vector<float4>> type_Q_map;
+    for (size_t t = 0; t < type_names.size(); t++) {
+        type_Q_map[type_names[t]] = std::move(grouped[t]);
+    }
+    return type_Q_map;
+}
+
+/// Read 3 float columns of a CSV clump output file, grouped by the clump type column
+inline std::unordered_map<std::string, std::vector<float3>> ReadClumpFloat3FromCsvFile(
+    const std::string& infilename,
+    const std::string& x_header,
+    const std::string& y_header,
+    const std::string& z_header,
+    const std::string& clump_header) {
+    CsvFrame frame(infilename, {{clump_header, FRAME_COL_TYPE::STRING},
+                                {x_header, FRAME_COL_TYPE::FLOAT32},
+                                {y_header, FRAME_COL_TYPE::FLOAT32},
+                                {z_header, FRAME_COL_TYPE::FLOAT32}});
+    return GroupClumpFloat3ByType(frame, clump_header, x_header, y_header, z_header);
+}
+
+/// Read the quaternions of a CSV clump output file, grouped by clump type
+inline std::unordered_map<std::string, std::vector<float4>> ReadClumpQuatFromCsvFile(const std::string& infilename) {
+    CsvFrame frame(infilename, {{OUTPUT_FILE_CLUMP_TYPE_NAME, FRAME_COL_TYPE::STRING},
+                                {OUTPUT_FILE_QW_COL_NAME, FRAME_COL_TYPE::FLOAT32},
+                                {OUTPUT_FILE_QX_COL_NAME, FRAME_COL_TYPE::FLOAT32},
+                                {OUTPUT_FILE_QY_COL_NAME, FRAME_COL_TYPE::FLOAT32},
+                                {OUTPUT_FILE_QZ_COL_NAME, FRAME_COL_TYPE::FLOAT32}});
+    return GroupClumpQuatByType(frame);
+}
+
+/// Read the coordinates and quaternions of a CSV clump output file, grouped by clump type, in one pass over the file
+inline void ReadClumpXyzQuatFromCsvFile(const std::string& infilename,
+                                        std::unordered_map<std::string, std::vector<float3>>& clump_xyz,
+                                        std::unordered_map<std::string, std::vector<float4>>& clump_quat) {
+    CsvFrame frame(infilename, {{OUTPUT_FILE_CLUMP_TYPE_NAME, FRAME_COL_TYPE::STRING},
+                                {OUTPUT_FILE_X_COL_NAME, FRAME_COL_TYPE::FLOAT32},
+                                {OUTPUT_FILE_Y_COL_NAME, FRAME_COL_TYPE::FLOAT32},
+                                {OUTPUT_FILE_Z_COL_NAME, FRAME_COL_TYPE::FLOAT32},
+                                {OUTPUT_FILE_QW_COL_NAME, FRAME_COL_TYPE::FLOAT32},
+                                {OUTPUT_FILE_QX_COL_NAME, FRAME_COL_TYPE::FLOAT32},
+                                {OUTPUT_FILE_QY_COL_NAME, FRAME_COL_TYPE::FLOAT32},
+                                {OUTPUT_FILE_QZ_COL_NAME, FRAME_COL_TYPE::FLOAT32}});
+    clump_xyz = GroupClumpFloat3ByType(frame, OUTPUT_FILE_CLUMP_TYPE_NAME, OUTPUT_FILE_X_COL_NAME,
+                                       OUTPUT_FILE_Y_COL_NAME, OUTPUT_FILE_Z_COL_NAME);
+    clump_quat = GroupClumpQuatByType(frame);
+}
+
+}  // namespace deme
+
+#endif
@@ -0,0 +1,511 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_CSV_FRAME_HPP
+#define DEME_CSV_FRAME_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <core/utils/MappedFile.hpp>
+#include <core/utils/NumberParsing.hpp>
+#include <DEM/utils/BinaryFrame.hpp>
+
+namespace deme {
+
+/// A column to be loaded by CsvFrame: its header name, and the type to store it as (use STRING for text columns)
+struct CsvColumnRequest {
+    std::string name;
+    FRAME_COL_TYPE type;
+};
+
+/// Some columns of a CSV file, loaded in one pass. The file is memory-mapped and cut into chunks at line boundaries,
+/// and the chunks are parsed by several threads at once; only the requested columns are converted, the rest are just
+/// skipped over. The format is the one of this solver's CSV output: a header line, comma-separated fields without
+/// quoting, spaces and tabs around fields ignored, blank lines ignored.
+class CsvFrame {
+  public:
+    /// Load the requested columns of a CSV file. n_threads = 0 means use all hardware threads.
+    CsvFrame(const std::string& infilename, const std::vector<CsvColumnRequest>& requests, unsigned int n_threads = 0)
+        : file(infilename) {
+        const char* begin = file.data();
+        const char* end = begin + file.size();
+        const char* body = parseHeaderNames(begin, end, infilename, names);
+
+        // Which requested column, if any, each field of a row goes to
+        std::vector<int> field_to_col(names.size(), -1);
+        for (const auto& req : requests) {
+            auto it = std::find(names.begin(), names.end(), req.name);
+            if (it == names.end()) {
+                throw std::runtime_error("Column " + req.name + " does not exist in CSV file " + infilename + ".");
+            }
+            size_t field = it - names.begin();
+            if (field_to_col[field] < 0) {
+                field_to_col[field] = (int)columns.size();
+                Column col;
+                col.type = req.type;
+                columns.push_back(std::move(col));
+                colIndex[req.name] = columns.size() - 1;
+            }
+        }
+        lastUsedField = -1;
+        for (size_t i = 0; i < field_to_col.size(); i++) {
+            if (field_to_col[i] >= 0) {
+                lastUsedField = (int)i;
+            }
+        }
+
+        // Cut the body into chunks that start at line starts. Small files are not worth the threads.
+        if (n_threads == 0) {
+            n_threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        size_t body_size = end - body;
+        size_t n_chunks = std::max<size_t>(1, std::min<size_t>(n_threads, body_size / MIN_CHUNK_BYTES));
+        std::vector<const char*> bounds(n_chunks + 1, end);
+        bounds[0] = body;
+        for (size_t i = 1; i < n_chunks; i++) {
+            const char* p = std::max(bounds[i - 1], body + body_size / n_chunks * i);
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            bounds[i] = nl ? nl + 1 : end;
+        }
+
+        std::vector<Chunk> chunks(n_chunks);
+        std::vector<std::exception_ptr> errors(n_chunks);
+        auto work = [&](size_t i) {
+            try {
+                parseChunk(bounds[i], bounds[i + 1], field_to_col, chunks[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        };
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < n_chunks; i++) {
+            workers.emplace_back(work, i);
+        }
+        work(0);
+        for (auto& t : workers) {
+            t.join();
+        }
+        // Report the first error in file order. The chunks before it were parsed in full, so their row counts tell
+        // which row of the file a row error is in.
+        size_t rows_before = 0;
+        for (size_t i = 0; i < n_chunks; i++) {
+            if (errors[i]) {
+                try {
+                    std::rethrow_exception(errors[i]);
+                } catch (const RowError& e) {
+                    throw std::runtime_error("CSV file " + infilename + ", data row " +
+                                             std::to_string(rows_before + e.row + 1) + ": " + e.what());
+                }
+            }
+            rows_before += chunks[i].nRows;
+        }
+        merge(chunks);
+    }
+
+    size_t GetNumRows() const { return nRows; }
+    /// All column names in the header of the file (not just the loaded ones)
+    const std::vector<std::string>& GetColumnNames() const { return names; }
+    bool HasColumn(const std::string& name) const { return colIndex.count(name) > 0; }
+
+    /// Get a loaded numeric column, converted to T
+    template <typename T>
+    std::vector<T> GetColumn(const std::string& name) const {
+        const Column& col = findColumn(name);
+        std::vector<T> out(nRows);
+        switch (col.type) {
+            case FRAME_COL_TYPE::FLOAT32:
+                convertColumn<float, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::FLOAT64:
+                convertColumn<double, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::UINT8:
+                convertColumn<uint8_t, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::UINT16:
+                convertColumn<uint16_t, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::UINT32:
+                convertColumn<uint32_t, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::UINT64:
+                convertColumn<uint64_t, T>(col, out);
+                break;
+            case FRAME_COL_TYPE::INT32:
+                convertColumn<int32_t, T>(col, out);
+                break;
+            default:
+                throw std::runtime_error("Column " + name + " is a string column, not a numeric one.");
+        }
+        return out;
+    }
+
+    /// Get a loaded string column as its distinct values, plus an index into them for each row. Grouping rows by such
+    /// a column (e.g. by clump type) is much cheaper this way than by comparing strings.
+    void GetStringColumn(const std::string& name,
+                         std::vector<std::string>& dict,
+                         std::vector<uint32_t>& indices) const {
+        const Column& col = findStringColumn(name);
+        dict = col.dict;
+        indices.resize(nRows);
+        if (nRows > 0) {
+            std::memcpy(indices.data(), col.payload.data(), nRows * sizeof(uint32_t));
+        }
+    }
+
+    /// Get a loaded string column, expanded to one string per row
+    std::vector<std::string> GetStringColumn(const std::string& name) const {
+        const Column& col = findStringColumn(name);
+        const uint32_t* indices = reinterpret_cast<const uint32_t*>(col.payload.data());
+        std::vector<std::string> out(nRows);
+        for (size_t i = 0; i < nRows; i++) {
+            out[i] = col.dict[indices[i]];
+        }
+        return out;
+    }
+
+    /// Read only the header names of a CSV file
+    static std::vector<std::string> ReadHeader(const std::string& infilename) {
+        MappedFile mapped(infilename);
+        std::vector<std::string> header;
+        parseHeaderNames(mapped.data(), mapped.data() + mapped.size(), infilename, header);
+        return header;
+    }
+
+  private:
+    // Below this many bytes per chunk, starting another thread costs more than it saves
+    static const size_t MIN_CHUNK_BYTES = 1 << 20;
+    // Up to this many distinct strings in a column, they are looked up by linear search
+    static const size_t LINEAR_LOOKUP_MAX = 16;
+
+    struct Column {
+        FRAME_COL_TYPE type;
+        // Raw array of the column's type; for STRING columns, uint32 indices into dict
+        std::string payload;
+        std::vector<std::string> dict;
+    };
+    struct Chunk {
+        size_t nRows = 0;
+        std::vector<Column> columns;
+        // Distinct strings seen so far for each column, pointing into the mapped file
+        std::vector<std::vector<std::string_view>> dictViews;
+        std::vector<std::unordered_map<std::string_view, uint32_t>> dictLookup;
+    };
+
+    // A malformed row; row counts from the start of the chunk being parsed
+    struct RowError : public std::runtime_error {
+        RowError(const std::string& msg, size_t r) : std::runtime_error(msg), row(r) {}
+        size_t row;
+    };
+
+    MappedFile file;
+    size_t nRows = 0;
+    std::vector<std::string> names;
+    std::vector<Column> columns;
+    std::unordered_map<std::string, size_t> colIndex;
+    int lastUsedField = -1;
+
+    static bool isTrimChar(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    static void trim(const char*& first, const char*& last) {
+        while (first < last && isTrimChar(*first)) {
+            first++;
+        }
+        while (last > first && isTrimChar(*(last - 1))) {
+            last--;
+        }
+    }
+
+
+    // Fills header with the field names of the first non-blank line; returns where the line after it starts
+    static const char* parseHeaderNames(const char* begin,
+                                        const char* end,
+                                        const std::string& infilename,
+                                        std::vector<std::string>& header) {
+        const char* p = begin;
+        while (p < end) {
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+            const char* line_end = nl ? nl : end;
+            const char* first = p;
+            const char* last = line_end;
+            trim(first, last);
+            if (first != last) {
+                const char* field = p;
+                while (true) {
+                    const char* comma = static_cast<const char*>(std::memchr(field, ',', line_end - field));
+                    const char* field_end = comma ? comma : line_end;
+                    first = field;
+                    last = field_end;
+                    trim(first, last);
+                    header.emplace_back(first, last);
+                    if (!comma) {
+                        break;
+                    }
+                    field = comma + 1;
+                }
+                return nl ? nl + 1 : end;
+            }
+            p = nl ? nl + 1 : end;
+        }
+        throw std::runtime_error("CSV file " + infilename + " is empty or has no header.");
+    }
+
+    static size_t typeSize(FRAME_COL_TYPE type) {
+        switch (type) {
+            case FRAME_COL_TYPE::FLOAT64:
+            case FRAME_COL_TYPE::UINT64:
+                return 8;
+            case FRAME_COL_TYPE::UINT8:
+                return 1;
+            case FRAME_COL_TYPE::UINT16:
+                return 2;
+            default:
+                // Including the dictionary indices of STRING columns
+                return 4;
+        }
+    }
+
+    template <typename T>
+    static void setValue(std::string& payload, size_t row, T val) {
+        size_t offset = row * sizeof(T);
+        if (offset + sizeof(T) > payload.size()) {
+            payload.resize(std::max(2 * payload.size(), offset + sizeof(T)));
+        }
+        std::memcpy(&payload[offset], &val, sizeof(T));
+    }
+
+    // Store an integer field, refusing values that would wrap around in the column's type (e.g. a negative family)
+    template <typename T>
+    static void setInteger(std::string& payload,
+                           size_t row,
+                           long long val,
+                           const char* first,
+                           const char* last,
+                           const std::string& col_name) {
+        bool in_range;
+        if (std::numeric_limits<T>::is_signed) {
+            in_range =
+                val >= (long long)std::numeric_limits<T>::min() && val <= (long long)std::numeric_limits<T>::max();
+        } else {
+            in_range = val >= 0 && (unsigned long long)val <= (unsigned long long)std::numeric_limits<T>::max();
+        }
+        if (!in_range) {
+            throw RowError("field \"" + std::string(first, last) + "\" of column " + col_name +
+                               " is out of the range of its type (" + std::to_string(std::numeric_limits<T>::min()) +
+                               " to " + std::to_string(std::numeric_limits<T>::max()) + ").",
+                           row);
+        }
+        setValue<T>(payload, row, (T)val);
+    }
+
+    static void parseNumber(const char* first,
+                            const char* last,
+                            FRAME_COL_TYPE type,
+                            std::string& payload,
+                            size_t row,
+                            const std::string& col_name) {
+        bool is_float = (type == FRAME_COL_TYPE::FLOAT32 || type == FRAME_COL_TYPE::FLOAT64);
+        double fval = 0.;
+        long long ival = 0;
+        bool parsed = is_float ? parseDouble(first, last, fval) : parseInteger(first, last, ival);
+        if (!parsed) {
+            throw RowError("field \"" + std::string(first, last) + "\" of column " + col_name +
+                               (is_float ? " is not a valid number." : " is not a valid integer, or is too large."),
+                           row);
+        }
+        switch (type) {
+            case FRAME_COL_TYPE::FLOAT32:
+                setValue<float>(payload, row, (float)fval);
+                break;
+            case FRAME_COL_TYPE::FLOAT64:
+                setValue<double>(payload, row, fval);
+                break;
+            case FRAME_COL_TYPE::UINT8:
+                setInteger<uint8_t>(payload, row, ival, first, last, col_name);
+                break;
+            case FRAME_COL_TYPE::UINT16:
+                setInteger<uint16_t>(payload, row, ival, first, last, col_name);
+                break;
+            case FRAME_COL_TYPE::UINT32:
+                setInteger<uint32_t>(payload, row, ival, first, last, col_name);
+                break;
+            case FRAME_COL_TYPE::UINT64:
+                setInteger<uint64_t>(payload, row, ival, first, last, col_name);
+                break;
+            default:
+                setInteger<int32_t>(payload, row, ival, first, last, col_name);
+        }
+    }
+
+    // The dictionary index of a string, added to the chunk's dictionary if new. Files usually hold few distinct
+    // strings (clump types, contact types), so a linear search beats hashing until the dictionary grows.
+    static uint32_t lookupString(std::string_view str, Chunk& chunk, size_t c) {
+        auto& views = chunk.dictViews[c];
+        if (views.size() <= LINEAR_LOOKUP_MAX) {
+            for (size_t i = 0; i < views.size(); i++) {
+                if (views[i] == str) {
+                    return (uint32_t)i;
+                }
+            }
+            if (views.size() == LINEAR_LOOKUP_MAX) {
+                // From now on, use the hash map
+                for (size_t i = 0; i < views.size(); i++) {
+                    chunk.dictLookup[c].emplace(views[i], (uint32_t)i);
+                }
+            }
+        } else {
+            auto it = chunk.dictLookup[c].find(str);
+            if (it != chunk.dictLookup[c].end()) {
+                return it->second;
+            }
+        }
+        uint32_t index = (uint32_t)views.size();
+        views.push_back(str);
+        chunk.columns[c].dict.emplace_back(str);
+        if (views.size() > LINEAR_LOOKUP_MAX) {
+            chunk.dictLookup[c].emplace(str, index);
+        }
+        return index;
+    }
+
+    void parseChunk(const char* begin, const char* end, const std::vector<int>& field_to_col, Chunk& chunk) const {
+        chunk.columns.resize(columns.size());
+        chunk.dictViews.resize(columns.size());
+        chunk.dictLookup.resize(columns.size());
+        // Guess the number of rows from a sample, so the columns rarely need to grow
+        size_t sample_bytes = std::min<size_t>(end - begin, 1 << 16);
+        size_t sample_lines = std::count(begin, begin + sample_bytes, '\n');
+        size_t est_rows = (sample_lines > 0) ? (size_t)((end - begin) / sample_bytes * sample_lines * 1.05) + 16 : 16;
+        for (size_t c = 0; c < columns.size(); c++) {
+            chunk.columns[c].type = columns[c].type;
+            chunk.columns[c].payload.resize(est_rows * typeSize(columns[c].type));
+        }
+        const char* p = begin;
+        while (p < end) {
+            const char* line = p;
+            while (p < end && isTrimChar(*p)) {
+                p++;
+            }
+            if (p == end) {
+                break;
+            }
+            if (*p == '\n') {
+                // Blank line
+                p++;
+                continue;
+            }
+            // Fields up to the last requested one are scanned char by char, the rest of the line is skipped at once
+            const char* field = line;
+            bool line_done = false;
+            for (int f = 0; f <= lastUsedField; f++) {
+                if (line_done) {
+                    throw RowError("row \"" + std::string(line, p) + "\" has too few fields.", chunk.nRows);
+                }
+                p = field;
+                while (p < end && *p != ',' && *p != '\n') {
+                    p++;
+                }
+                int c = field_to_col[f];
+                if (c >= 0) {
+                    const char* first = field;
+                    const char* last = p;
+                    trim(first, last);
+                    Column& col = chunk.columns[c];
+                    if (col.type == FRAME_COL_TYPE::STRING) {
+                        setValue<uint32_t>(col.payload, chunk.nRows,
+                                           lookupString(std::string_view(first, last - first), chunk, c));
+                    } else {
+                        parseNumber(first, last, col.type, col.payload, chunk.nRows, names[f]);
+                    }
+                }
+                line_done = (p == end || *p == '\n');
+                field = p + 1;
+            }
+            if (!line_done) {
+                const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+                p = nl ? nl : end;
+            }
+            if (p < end) {
+                p++;
+            }
+            chunk.nRows++;
+        }
+    }
+
+    // Concatenate the chunks in file order. String columns get one dictionary for the whole file.
+    void merge(std::vector<Chunk>& chunks) {
+        for (const auto& chunk : chunks) {
+            nRows += chunk.nRows;
+        }
+        for (size_t c = 0; c < columns.size(); c++) {
+            Column& col = columns[c];
+            if (col.type != FRAME_COL_TYPE::STRING) {
+                size_t elem_size = typeSize(col.type);
+                col.payload.reserve(nRows * elem_size);
+                for (auto& chunk : chunks) {
+                    col.payload.append(chunk.columns[c].payload, 0, chunk.nRows * elem_size);
+                    std::string().swap(chunk.columns[c].payload);
+                }
+                continue;
+            }
+            std::unordered_map<std::string, uint32_t> lookup;
+            col.payload.resize(nRows * sizeof(uint32_t));
+            size_t row = 0;
+            for (auto& chunk : chunks) {
+                const Column& local = chunk.columns[c];
+                std::vector<uint32_t> remap(local.dict.size());
+                for (size_t d = 0; d < local.dict.size(); d++) {
+                    auto res = lookup.emplace(local.dict[d], (uint32_t)col.dict.size());
+                    if (res.second) {
+                        col.dict.push_back(local.dict[d]);
+                    }
+                    remap[d] = res.first->second;
+                }
+                const uint32_t* local_indices = reinterpret_cast<const uint32_t*>(local.payload.data());
+                for (size_t i = 0; i < chunk.nRows; i++) {
+                    setValue<uint32_t>(col.payload, row++, remap[local_indices[i]]);
+                }
+            }
+        }
+    }
+
+    const Column& findColumn(const std::string& name) const {
+        auto it = colIndex.find(name);
+        if (it == colIndex.end()) {
+            throw std::runtime_error("Column " + name + " was not loaded from the CSV file.");
+        }
+        return columns[it->second];
+    }
+
+    const Column& findStringColumn(const std::string& name) const {
+        const Column& col = findColumn(name);
+        if (col.type != FRAME_COL_TYPE::STRING) {
+            throw std::runtime_error("Column " + name + " is a numeric column, not a string one.");
+        }
+        return col;
+    }
+
+    template <typename S, typename T>
+    void convertColumn(const Column& col, std::vector<T>& out) const {
+        const S* raw = reinterpret_cast<const S*>(col.payload.data());
+        for (size_t i = 0; i < nRows; i++) {
+            out[i] = static_cast<T>(raw[i]);
+        }
+    }
+};
+
+}  // namespace deme
+
+#endif
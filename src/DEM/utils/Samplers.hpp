@@ -38,6 +38,7 @@
 #include <random>
 #include <utility>
 #include <vector>
+#include <DEM/Defines.h>
 #include <DEM/HostSideHelpers.hpp>
 
 namespace deme {
@@ -236,7 +237,8 @@ class PDGrid {
         m_dimX = dimX;
         m_dimY = dimY;
         m_dimZ = dimZ;
-        m_data.resize(dimX * dimY * dimZ, Content(host_make_float3(0, 0, 0), true));
+        // Every cell starts empty, also when the grid is reused by another sampling run
+        m_data.assign(dimX * dimY * dimZ, Content(host_make_float3(0, 0, 0), true));
     }
 
     void SetCellPoint(int i, int j, int k, const float3& p) {
@@ -0,0 +1,159 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_STEP_METRICS_HPP
+#define DEME_STEP_METRICS_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <core/utils/AsyncWriter.hpp>
+
+namespace deme {
+
+/// One record of the solver's state, taken by dT every N steps. The contact detection counters are those of the kT
+/// produce dT is currently using.
+struct StepMetrics {
+    /// Steps taken since the metrics output was set up, and the simulation time
+    uint64_t step = 0;
+    double simTime = 0.;
+    /// Number of contact pairs, and average number of contacts per sphere
+    size_t nContactPairs = 0;
+    float avgCntsPerSphere = 0.;
+    /// Most spheres and triangles found in one bin
+    size_t maxSphFoundInBin = 0;
+    size_t maxTriFoundInBin = 0;
+    /// Number of bins (of all bin levels) and bin size
+    size_t numBins = 0;
+    double binSize = 0.;
+    /// The number of steps dT is currently allowed to drift ahead of kT
+    unsigned int perhapsIdealFutureDrift = 0;
+    /// Times dT waited for kT, and kT waited for dT (cumulative)
+    uint64_t nTimesDynamicHeldBack = 0;
+    uint64_t nTimesKinematicHeldBack = 0;
+    /// Average wall time of one step since the previous record, in seconds
+    double stepWallTime = 0.;
+};
+
+/// Where dT hands its StepMetrics records. Records are batched, and each batch is formatted and written (or passed to
+/// the callback) by a background thread, so all dT pays per record is a copy. Add records from one thread only.
+class StepMetricsSink {
+  public:
+    enum class FORMAT { CSV, JSONL };
+
+    /// Write the records to a file, as CSV (with a header line) or as JSON lines
+    StepMetricsSink(const std::string& filename, FORMAT format, unsigned int every_n_steps)
+        : nSteps(every_n_steps > 0 ? every_n_steps : 1), fileFormat(format) {
+        file = std::make_shared<std::ofstream>(filename, std::ios::out);
+        if (!file->good()) {
+            throw std::runtime_error("Could not open the step metrics output file " + filename);
+        }
+        if (fileFormat == FORMAT::CSV) {
+            *file << "step,sim_time,n_contact_pairs,avg_cnts_per_sphere,max_sph_found_in_bin,max_tri_found_in_bin,"
+                     "num_bins,bin_size,future_drift,n_times_dT_held_back,n_times_kT_held_back,step_wall_time\n";
+        }
+        batch.reserve(BATCH_SIZE);
+    }
+    /// Pass each record to a callback, which runs on the background thread
+    StepMetricsSink(std::function<void(const StepMetrics&)> callback, unsigned int every_n_steps)
+        : nSteps(every_n_steps > 0 ? every_n_steps : 1), userCallback(std::move(callback)) {
+        batch.reserve(BATCH_SIZE);
+    }
+
+    ~StepMetricsSink() {
+        try {
+            Flush();
+        } catch (...) {
+            // Nothing to report a failed write to at this point
+        }
+    }
+
+    StepMetricsSink(const StepMetricsSink&) = delete;
+    StepMetricsSink& operator=(const StepMetricsSink&) = delete;
+
+    unsigned int GetStepInterval() const { return nSteps; }
+
+    void Add(const StepMetrics& record) {
+        batch.push_back(record);
+        if (batch.size() >= BATCH_SIZE) {
+            submitBatch();
+        }
+    }
+
+    /// Hand over the partial batch without waiting for it to be written. Call it from the adding thread, or while that
+    /// thread is idle.
+    void Submit() {
+        if (!batch.empty()) {
+            submitBatch();
+        }
+    }
+
+    /// Hand over the partial batch and wait until every record is written
+    void Flush() {
+        Submit();
+        writer.Flush();
+        if (file) {
+            file->flush();
+        }
+    }
+
+  private:
+    static constexpr size_t BATCH_SIZE = 256;
+
+    unsigned int nSteps;
+    FORMAT fileFormat = FORMAT::CSV;
+    std::shared_ptr<std::ofstream> file;
+    std::function<void(const StepMetrics&)> userCallback;
+    std::vector<StepMetrics> batch;
+    // Declared last, so it is destroyed (finishing its jobs) before anything those jobs use
+    AsyncWriter writer{4};
+
+    void submitBatch() {
+        std::vector<StepMetrics> records;
+        records.swap(batch);
+        batch.reserve(BATCH_SIZE);
+        if (userCallback) {
+            writer.Submit([records = std::move(records), callback = userCallback]() {
+                for (const auto& record : records) {
+                    callback(record);
+                }
+            });
+        } else {
+            writer.Submit([records = std::move(records), out = file, format = fileFormat]() {
+                std::ostringstream text;
+                text.precision(9);
+                for (const auto& r : records) {
+                    if (format == FORMAT::CSV) {
+                        text << r.step << "," << r.simTime << "," << r.nContactPairs << "," << r.avgCntsPerSphere << ","
+                             << r.maxSphFoundInBin << "," << r.maxTriFoundInBin << "," << r.numBins << "," << r.binSize
+                             << "," << r.perhapsIdealFutureDrift << "," << r.nTimesDynamicHeldBack << ","
+                             << r.nTimesKinematicHeldBack << "," << r.stepWallTime << "\n";
+                    } else {
+                        text << "{\"step\": " << r.step << ", \"sim_time\": " << r.simTime
+                             << ", \"n_contact_pairs\": " << r.nContactPairs
+                             << ", \"avg_cnts_per_sphere\": " << r.avgCntsPerSphere
+                             << ", \"max_sph_found_in_bin\": " << r.maxSphFoundInBin
+                             << ", \"max_tri_found_in_bin\": " << r.maxTriFoundInBin << ", \"num_bins\": " << r.numBins
+                             << ", \"bin_size\": " << r.binSize << ", \"future_drift\": " << r.perhapsIdealFutureDrift
+                             << ", \"n_times_dT_held_back\": " << r.nTimesDynamicHeldBack
+                             << ", \"n_times_kT_held_back\": " << r.nTimesKinematicHeldBack
+                             << ", \"step_wall_time\": " << r.stepWallTime << "}\n";
+                    }
+                }
+                *out << text.str();
+            });
+        }
+    }
+};
+
+}  // namespace deme
+
+#endif
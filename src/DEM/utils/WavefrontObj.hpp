@@ -0,0 +1,267 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_WAVEFRONT_OBJ_HPP
+#define DEME_WAVEFRONT_OBJ_HPP
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <DEM/HostSideHelpers.hpp>
+#include <core/utils/NumberParsing.hpp>
+
+namespace deme {
+
+/// The geometry held by a Wavefront OBJ file. Faces are triangulated, and all indices are 0-based.
+struct ObjGeometry {
+    std::vector<float3> vertices;
+    std::vector<float3> normals;
+    std::vector<float3> uv;
+    std::vector<int3> face_v_indices;
+    std::vector<int3> face_n_indices;
+    std::vector<int3> face_uv_indices;
+};
+
+namespace detail {
+
+// Below this many bytes per chunk, starting another thread costs more than it saves
+constexpr size_t OBJ_MIN_CHUNK_BYTES = 1 << 20;
+
+// What the lines of one chunk of an OBJ file hold. Face indices are 0-based; negative (relative) ones are resolved
+// against the counts local to the chunk, and their positions remembered so the counts of earlier chunks can be added
+// once known.
+struct ObjChunk {
+    std::vector<float3> vertices;
+    std::vector<float3> normals;
+    std::vector<float3> uv;
+    std::vector<int> face_v;
+    std::vector<int> face_n;
+    std::vector<int> face_uv;
+    std::vector<size_t> rel_v;
+    std::vector<size_t> rel_n;
+    std::vector<size_t> rel_uv;
+};
+
+inline bool isObjSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool keywordIs(const char* first, const char* last, const char* keyword) {
+    size_t len = std::strlen(keyword);
+    if ((size_t)(last - first) != len) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (std::tolower((unsigned char)first[i]) != keyword[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline float parseObjFloat(const char* first, const char* last) {
+    double val;
+    if (!parseDouble(first, last, val)) {
+        throw std::runtime_error("\"" + std::string(first, last) + "\" is not a valid number.");
+    }
+    return (float)val;
+}
+
+// Parse one index of a face vertex (1-based in the file) and append it as 0-based
+inline void addObjIndex(const char* first,
+                        const char* last,
+                        size_t n_defined,
+                        std::vector<int>& indices,
+                        std::vector<size_t>& relative) {
+    long long idx = 0;
+    if (first != last && !parseInteger(first, last, idx)) {
+        throw std::runtime_error("\"" + std::string(first, last) + "\" is not a valid index.");
+    }
+    if (idx < 0) {
+        relative.push_back(indices.size());
+        indices.push_back((int)(n_defined + idx));
+    } else {
+        indices.push_back((int)(idx - 1));
+    }
+}
+
+// Face vertex forms: v, v/t, v//n, v/t/n
+inline void addObjFaceVertex(const char* first, const char* last, ObjChunk& chunk) {
+    const char* slash1 = static_cast<const char*>(std::memchr(first, '/', last - first));
+    addObjIndex(first, slash1 ? slash1 : last, chunk.vertices.size(), chunk.face_v, chunk.rel_v);
+    if (!slash1) {
+        return;
+    }
+    const char* t_first = slash1 + 1;
+    const char* slash2 = static_cast<const char*>(std::memchr(t_first, '/', last - t_first));
+    const char* t_last = slash2 ? slash2 : last;
+    // A face that specifies vertices and normals only has an empty texel index
+    if (t_first != t_last) {
+        addObjIndex(t_first, t_last, chunk.uv.size(), chunk.face_uv, chunk.rel_uv);
+    }
+    if (slash2) {
+        addObjIndex(slash2 + 1, last, chunk.normals.size(), chunk.face_n, chunk.rel_n);
+    }
+}
+
+inline void parseObjChunk(const char* begin, const char* end, ObjChunk& chunk) {
+    // Token bounds of the current line; grown on demand so polygons of any size are kept whole
+    std::vector<const char*> tok_first, tok_last;
+    const char* p = begin;
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        const char* line_end = nl ? nl : end;
+        const char* hash = static_cast<const char*>(std::memchr(p, '#', line_end - p));
+        const char* data_end = hash ? hash : line_end;
+
+        tok_first.clear();
+        tok_last.clear();
+        while (p < data_end) {
+            while (p < data_end && isObjSpace(*p)) {
+                p++;
+            }
+            if (p == data_end) {
+                break;
+            }
+            tok_first.push_back(p);
+            while (p < data_end && !isObjSpace(*p)) {
+                p++;
+            }
+            tok_last.push_back(p);
+        }
+        const size_t n_tok = tok_first.size();
+
+        if (n_tok > 0) {
+            const char* k0 = tok_first[0];
+            const char* k1 = tok_last[0];
+            if (keywordIs(k0, k1, "v") && n_tok >= 4) {
+                // Possible w or vertex color components are ignored
+                chunk.vertices.push_back(host_make_float3(parseObjFloat(tok_first[1], tok_last[1]),
+                                                          parseObjFloat(tok_first[2], tok_last[2]),
+                                                          parseObjFloat(tok_first[3], tok_last[3])));
+            } else if (keywordIs(k0, k1, "vt") && n_tok >= 3) {
+                // Ignore 3rd component if present
+                chunk.uv.push_back(host_make_float3(parseObjFloat(tok_first[1], tok_last[1]),
+                                                    parseObjFloat(tok_first[2], tok_last[2]), 0));
+            } else if (keywordIs(k0, k1, "vn") && n_tok >= 4) {
+                chunk.normals.push_back(host_make_float3(parseObjFloat(tok_first[1], tok_last[1]),
+                                                         parseObjFloat(tok_first[2], tok_last[2]),
+                                                         parseObjFloat(tok_first[3], tok_last[3])));
+            } else if (keywordIs(k0, k1, "f") && n_tok >= 4) {
+                // Triangle fan around the first vertex for quad/poly faces
+                for (size_t i = 3; i < n_tok; i++) {
+                    addObjFaceVertex(tok_first[1], tok_last[1], chunk);
+                    addObjFaceVertex(tok_first[i - 1], tok_last[i - 1], chunk);
+                    addObjFaceVertex(tok_first[i], tok_last[i], chunk);
+                }
+            }
+        }
+        p = nl ? nl + 1 : end;
+    }
+}
+
+// Append the chunks' indices, in order, making the relative ones absolute
+inline void mergeObjIndices(std::vector<ObjChunk>& chunks,
+                            std::vector<int> ObjChunk::*indices,
+                            std::vector<size_t> ObjChunk::*relative,
+                            std::vector<float3> ObjChunk::*defined,
+                            std::vector<int3>& out) {
+    size_t total = 0;
+    for (const auto& chunk : chunks) {
+        total += (chunk.*indices).size();
+    }
+    out.resize(total / 3);
+    int* dst = reinterpret_cast<int*>(out.data());
+    size_t n_defined_before = 0;
+    size_t offset = 0;
+    for (auto& chunk : chunks) {
+        std::vector<int>& idx = chunk.*indices;
+        for (size_t pos : chunk.*relative) {
+            idx[pos] += (int)n_defined_before;
+        }
+        // Normal and texel indices may not come in full triples if only some face vertices have them; the
+        // incomplete tail is dropped
+        size_t capacity = out.size() * 3;
+        size_t n_copy = (offset < capacity) ? std::min(idx.size(), capacity - offset) : 0;
+        std::memcpy(dst + offset, idx.data(), n_copy * sizeof(int));
+        offset += idx.size();
+        n_defined_before += (chunk.*defined).size();
+        std::vector<int>().swap(idx);
+    }
+}
+
+inline void mergeObjValues(std::vector<ObjChunk>& chunks,
+                           std::vector<float3> ObjChunk::*values,
+                           std::vector<float3>& out) {
+    size_t total = 0;
+    for (const auto& chunk : chunks) {
+        total += (chunk.*values).size();
+    }
+    out.reserve(total);
+    for (auto& chunk : chunks) {
+        out.insert(out.end(), (chunk.*values).begin(), (chunk.*values).end());
+        std::vector<float3>().swap(chunk.*values);
+    }
+}
+
+}  // namespace detail
+
+/// Parse the content of a Wavefront OBJ file. Line-aligned chunks of it are parsed by several threads at once. Throws
+/// std::runtime_error on malformed content.
+inline ObjGeometry ParseWavefrontObj(const char* begin, const char* end) {
+    using namespace detail;
+    const size_t size = end - begin;
+    size_t n_threads = std::max(1u, std::thread::hardware_concurrency());
+    size_t n_chunks = std::max<size_t>(1, std::min<size_t>(n_threads, size / OBJ_MIN_CHUNK_BYTES));
+    std::vector<const char*> bounds(n_chunks + 1, end);
+    bounds[0] = begin;
+    for (size_t i = 1; i < n_chunks; i++) {
+        const char* p = std::max(bounds[i - 1], begin + size / n_chunks * i);
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        bounds[i] = nl ? nl + 1 : end;
+    }
+    std::vector<ObjChunk> chunks(n_chunks);
+    std::vector<std::exception_ptr> errors(n_chunks);
+    auto work = [&](size_t i) {
+        try {
+            parseObjChunk(bounds[i], bounds[i + 1], chunks[i]);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < n_chunks; i++) {
+        workers.emplace_back(work, i);
+    }
+    work(0);
+    for (auto& t : workers) {
+        t.join();
+    }
+    for (const auto& e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+
+    // Indices first, as they need the per-chunk counts of vertices, normals and texels
+    ObjGeometry geo;
+    mergeObjIndices(chunks, &ObjChunk::face_v, &ObjChunk::rel_v, &ObjChunk::vertices, geo.face_v_indices);
+    mergeObjIndices(chunks, &ObjChunk::face_n, &ObjChunk::rel_n, &ObjChunk::normals, geo.face_n_indices);
+    mergeObjIndices(chunks, &ObjChunk::face_uv, &ObjChunk::rel_uv, &ObjChunk::uv, geo.face_uv_indices);
+    mergeObjValues(chunks, &ObjChunk::vertices, geo.vertices);
+    mergeObjValues(chunks, &ObjChunk::normals, geo.normals);
+    mergeObjValues(chunks, &ObjChunk::uv, geo.uv);
+    return geo;
+}
+
+}  // namespace deme
+
+#endif
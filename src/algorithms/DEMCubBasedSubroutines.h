@@ -6,7 +6,7 @@
 #include <DEM/Structs.h>
 #include <DEM/Defines.h>
 #include <core/utils/GpuManager.h>
-#include <core/utils/ManagedAllocator.hpp>
+#include <core/utils/AllocatorPolicy.hpp>
 
 namespace deme {
 
@@ -101,29 +101,32 @@ void doubleSortByKey(notStupidBool_t* d_keys_in,
 // For kT and dT's private usage
 ////////////////////////////////////////////////////////////////////////////////
 
-void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
-                      std::shared_ptr<jitify::Program>& bin_triangle_kernels,
-                      std::shared_ptr<jitify::Program>& sphere_contact_kernels,
-                      std::shared_ptr<jitify::Program>& sphTri_contact_kernels,
-                      std::shared_ptr<jitify::Program>& history_kernels,
+void contactDetection(std::shared_ptr<JitProgram>& bin_sphere_kernels,
+                      std::shared_ptr<JitProgram>& bin_triangle_kernels,
+                      std::shared_ptr<JitProgram>& sphere_contact_kernels,
+                      std::shared_ptr<JitProgram>& sphTri_contact_kernels,
+                      std::shared_ptr<JitProgram>& history_kernels,
                       DEMDataKT* granData,
                       DEMSimParams* simParams,
                       SolverFlags& solverFlags,
                       VERBOSITY& verbosity,
                       // The following arrays may need to change sizes, so we can't pass pointers
-                      std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& idGeometryA,
-                      std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& idGeometryB,
-                      std::vector<contact_t, ManagedAllocator<contact_t>>& contactType,
-                      std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryA,
-                      std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryB,
-                      std::vector<contact_t, ManagedAllocator<contact_t>>& previous_contactType,
-                      std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>>& contactMapping,
+                      std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& idGeometryA,
+                      std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& idGeometryB,
+                      std::vector<contact_t, DEMEAllocator<contact_t>>& contactType,
+                      std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& previous_idGeometryA,
+                      std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& previous_idGeometryB,
+                      std::vector<contact_t, DEMEAllocator<contact_t>>& previous_contactType,
+                      std::vector<contactPairs_t, DEMEAllocator<contactPairs_t>>& contactMapping,
                       cudaStream_t& this_stream,
                       DEMSolverStateData& scratchPad,
                       SolverTimers& timers,
-                      kTStateParams& stateParams);
+                      kTStateParams& stateParams,
+                      // kT's memory tally, and its count of contact array reallocations
+                      size_t& approx_bytes_used,
+                      size_t& num_cnt_arr_reallocs);
 
-void collectContactForcesThruCub(std::shared_ptr<jitify::Program>& collect_force_kernels,
+void collectContactForcesThruCub(std::shared_ptr<JitProgram>& collect_force_kernels,
                                  DEMDataDT* granData,
                                  const size_t nContactPairs,
                                  const size_t nClumps,
@@ -134,9 +137,9 @@ void collectContactForcesThruCub(std::shared_ptr<jitify::Program>& collect_force
 
 void overwritePrevContactArrays(DEMDataKT* kT_data,
                                 DEMDataDT* dT_data,
-                                std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryA,
-                                std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryB,
-                                std::vector<contact_t, ManagedAllocator<contact_t>>& previous_contactType,
+                                std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& previous_idGeometryA,
+                                std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& previous_idGeometryB,
+                                std::vector<contact_t, DEMEAllocator<contact_t>>& previous_contactType,
                                 DEMSimParams* simParams,
                                 DEMSolverStateData& scratchPad,
                                 cudaStream_t& this_stream,
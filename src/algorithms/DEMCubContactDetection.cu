@@ -17,18 +17,18 @@
 
 namespace deme {
 
+// Resize kT's contact arrays to the given length (capacity included), which should come from decideCntArrLength
 inline void contactEventArraysResize(size_t nContactPairs,
-                                     std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& idGeometryA,
-                                     std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& idGeometryB,
-                                     std::vector<contact_t, ManagedAllocator<contact_t>>& contactType,
-                                     DEMDataKT* granData) {
-    //// TODO: not tracked? Gotta do something on it
-    // DEME_TRACKED_RESIZE(idGeometryA, nContactPairs);
-    // DEME_TRACKED_RESIZE(idGeometryB, nContactPairs);
-    // DEME_TRACKED_RESIZE(contactType, nContactPairs);
-    idGeometryA.resize(nContactPairs);
-    idGeometryB.resize(nContactPairs);
-    contactType.resize(nContactPairs);
+                                     std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& idGeometryA,
+                                     std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& idGeometryB,
+                                     std::vector<contact_t, DEMEAllocator<contact_t>>& contactType,
+                                     DEMDataKT* granData,
+                                     size_t& approx_bytes_used,
+                                     size_t& num_cnt_arr_reallocs) {
+    approx_bytes_used += hostResizeExact(idGeometryA, nContactPairs, 0);
+    approx_bytes_used += hostResizeExact(idGeometryB, nContactPairs, 0);
+    approx_bytes_used += hostResizeExact(contactType, nContactPairs, NOT_A_CONTACT);
+    num_cnt_arr_reallocs++;
 
     // Re-pack pointers in case the arrays got reallocated
     granData->idGeometryA = idGeometryA.data();
@@ -36,26 +36,28 @@ inline void contactEventArraysResize(size_t nContactPairs,
     granData->contactType = contactType.data();
 }
 
-void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
-                      std::shared_ptr<jitify::Program>& bin_triangle_kernels,
-                      std::shared_ptr<jitify::Program>& sphere_contact_kernels,
-                      std::shared_ptr<jitify::Program>& sphTri_contact_kernels,
-                      std::shared_ptr<jitify::Program>& history_kernels,
+void contactDetection(std::shared_ptr<JitProgram>& bin_sphere_kernels,
+                      std::shared_ptr<JitProgram>& bin_triangle_kernels,
+                      std::shared_ptr<JitProgram>& sphere_contact_kernels,
+                      std::shared_ptr<JitProgram>& sphTri_contact_kernels,
+                      std::shared_ptr<JitProgram>& history_kernels,
                       DEMDataKT* granData,
                       DEMSimParams* simParams,
                       SolverFlags& solverFlags,
                       VERBOSITY& verbosity,
-                      std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& idGeometryA,
-                      std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& idGeometryB,
-                      std::vector<contact_t, ManagedAllocator<contact_t>>& contactType,
-                      std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryA,
-                      std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryB,
-                      std::vector<contact_t, ManagedAllocator<contact_t>>& previous_contactType,
-                      std::vector<contactPairs_t, ManagedAllocator<contactPairs_t>>& contactMapping,
+                      std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& idGeometryA,
+                      std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& idGeometryB,
+                      std::vector<contact_t, DEMEAllocator<contact_t>>& contactType,
+                      std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& previous_idGeometryA,
+                      std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& previous_idGeometryB,
+                      std::vector<contact_t, DEMEAllocator<contact_t>>& previous_contactType,
+                      std::vector<contactPairs_t, DEMEAllocator<contactPairs_t>>& contactMapping,
                       cudaStream_t& this_stream,
                       DEMSolverStateData& scratchPad,
                       SolverTimers& timers,
-                      kTStateParams& stateParams) {
+                      kTStateParams& stateParams,
+                      size_t& approx_bytes_used,
+                      size_t& num_cnt_arr_reallocs) {
     // A dumb check
     if (simParams->nSpheresGM == 0) {
         *scratchPad.pNumContacts = 0;
@@ -73,6 +75,8 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
     size_t CD_temp_arr_bytes = 0;
 
     {
+        // Temp arrays of binning and contact pair finding are all released at the end of this block
+        auto scratch_scope = scratchPad.tempScope("Contact detection");
         timers.GetTimer("Discretize domain").start();
         ////////////////////////////////////////////////////////////////////////////////
         // Sphere-related discretization & sphere--analytical contact detection
@@ -81,18 +85,27 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         // 1st step: register the number of sphere--bin touching pairs for each sphere for further processing
         CD_temp_arr_bytes = simParams->nSpheresGM * sizeof(binsSphereTouches_t);
         binsSphereTouches_t* numBinsSphereTouches =
-            (binsSphereTouches_t*)scratchPad.allocateTempVector(0, CD_temp_arr_bytes);
+            (binsSphereTouches_t*)scratchPad.allocateTemp("numBinsSphereTouches", CD_temp_arr_bytes);
         // This kernel is also tasked to find how many analytical objects each sphere touches
-        // We'll use a new vector 2 to store this
         CD_temp_arr_bytes = simParams->nSpheresGM * sizeof(objID_t);
-        objID_t* numAnalGeoSphereTouches = (objID_t*)scratchPad.allocateTempVector(2, CD_temp_arr_bytes);
+        objID_t* numAnalGeoSphereTouches =
+            (objID_t*)scratchPad.allocateTemp("numAnalGeoSphereTouches", CD_temp_arr_bytes);
+        // With hierarchical binning, the same kernel also finds the number of bins each sphere visits on the coarser
+        // levels
+        const bool use_bin_levels = (simParams->nBinLevels > 1);
+        binsSphereTouches_t* numBinsSphereVisits = nullptr;
+        if (use_bin_levels) {
+            CD_temp_arr_bytes = simParams->nSpheresGM * sizeof(binsSphereTouches_t);
+            numBinsSphereVisits =
+                (binsSphereTouches_t*)scratchPad.allocateTemp("numBinsSphereVisits", CD_temp_arr_bytes);
+        }
         size_t blocks_needed_for_bodies =
             (simParams->nSpheresGM + DEME_NUM_BODIES_PER_BLOCK - 1) / DEME_NUM_BODIES_PER_BLOCK;
 
         bin_sphere_kernels->kernel("getNumberOfBinsEachSphereTouches")
             .instantiate()
             .configure(dim3(blocks_needed_for_bodies), dim3(DEME_NUM_BODIES_PER_BLOCK), 0, this_stream)
-            .launch(simParams, granData, numBinsSphereTouches, numAnalGeoSphereTouches);
+            .launch(simParams, granData, numBinsSphereTouches, numAnalGeoSphereTouches, numBinsSphereVisits);
         DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
 
         // 2nd step: prefix scan sphere--bin touching pairs
@@ -100,42 +113,75 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         // conclusion on bin--sph touch pairs
         CD_temp_arr_bytes = (simParams->nSpheresGM + 1) * sizeof(binSphereTouchPairs_t);
         binSphereTouchPairs_t* numBinsSphereTouchesScan =
-            (binSphereTouchPairs_t*)scratchPad.allocateTempVector(1, CD_temp_arr_bytes);
+            (binSphereTouchPairs_t*)scratchPad.allocateTemp("numBinsSphereTouchesScan", CD_temp_arr_bytes);
         cubDEMPrefixScan<binsSphereTouches_t, binSphereTouchPairs_t, DEMSolverStateData>(
             numBinsSphereTouches, numBinsSphereTouchesScan, simParams->nSpheresGM, this_stream, scratchPad);
         size_t* pNumBinSphereTouchPairs = scratchPad.pTempSizeVar1;
         *pNumBinSphereTouchPairs = (size_t)numBinsSphereTouchesScan[simParams->nSpheresGM - 1] +
                                    (size_t)numBinsSphereTouches[simParams->nSpheresGM - 1];
         numBinsSphereTouchesScan[simParams->nSpheresGM] = *pNumBinSphereTouchPairs;
-        // The same process is done for sphere--analytical geometry pairs as well. Use vector 3 for this.
+        // The same process is done for sphere--analytical geometry pairs as well.
         // One extra elem is used for storing the final elem in scan result.
         CD_temp_arr_bytes = (simParams->nSpheresGM + 1) * sizeof(binSphereTouchPairs_t);
         binSphereTouchPairs_t* numAnalGeoSphereTouchesScan =
-            (binSphereTouchPairs_t*)scratchPad.allocateTempVector(3, CD_temp_arr_bytes);
+            (binSphereTouchPairs_t*)scratchPad.allocateTemp("numAnalGeoSphereTouchesScan", CD_temp_arr_bytes);
         cubDEMPrefixScan<objID_t, binSphereTouchPairs_t, DEMSolverStateData>(
             numAnalGeoSphereTouches, numAnalGeoSphereTouchesScan, simParams->nSpheresGM, this_stream, scratchPad);
         *(scratchPad.pNumContacts) = (size_t)numAnalGeoSphereTouches[simParams->nSpheresGM - 1] +
                                      (size_t)numAnalGeoSphereTouchesScan[simParams->nSpheresGM - 1];
         numAnalGeoSphereTouchesScan[simParams->nSpheresGM] = *(scratchPad.pNumContacts);
+        // Only sphere--analytical contacts are counted so far, so only grow the contact arrays here
         if (*scratchPad.pNumContacts > idGeometryA.size()) {
-            contactEventArraysResize(*scratchPad.pNumContacts, idGeometryA, idGeometryB, contactType, granData);
+            size_t cnt_arr_len = decideCntArrLength(*scratchPad.pNumContacts, idGeometryA.size(),
+                                                    stateParams.cntArrMinLength, false);
+            contactEventArraysResize(cnt_arr_len, idGeometryA, idGeometryB, contactType, granData, approx_bytes_used,
+                                     num_cnt_arr_reallocs);
+        }
+        // And the sphere--bin visiting pairs
+        binSphereTouchPairs_t* numBinsSphereVisitsScan = nullptr;
+        size_t numBinSphereVisitPairs = 0;
+        if (use_bin_levels) {
+            CD_temp_arr_bytes = (simParams->nSpheresGM + 1) * sizeof(binSphereTouchPairs_t);
+            numBinsSphereVisitsScan =
+                (binSphereTouchPairs_t*)scratchPad.allocateTemp("numBinsSphereVisitsScan", CD_temp_arr_bytes);
+            cubDEMPrefixScan<binsSphereTouches_t, binSphereTouchPairs_t, DEMSolverStateData>(
+                numBinsSphereVisits, numBinsSphereVisitsScan, simParams->nSpheresGM, this_stream, scratchPad);
+            numBinSphereVisitPairs = (size_t)numBinsSphereVisitsScan[simParams->nSpheresGM - 1] +
+                                     (size_t)numBinsSphereVisits[simParams->nSpheresGM - 1];
+            numBinsSphereVisitsScan[simParams->nSpheresGM] = numBinSphereVisitPairs;
         }
         // std::cout << *pNumBinSphereTouchPairs << std::endl;
         // displayArray<binsSphereTouches_t>(numBinsSphereTouches, simParams->nSpheresGM);
         // displayArray<binSphereTouchPairs_t>(numBinsSphereTouchesScan, simParams->nSpheresGM);
 
-        // 3rd step: use a custom kernel to figure out all sphere--bin touching pairs. Note numBinsSphereTouches can
-        // retire now so we allocate on temp vector 0 and re-use vector 2.
+        // 3rd step: use a custom kernel to figure out all sphere--bin touching pairs. Note numBinsSphereTouches and
+        // numAnalGeoSphereTouches (and numBinsSphereVisits) can retire now.
+        scratchPad.releaseTemp(numBinsSphereTouches);
+        scratchPad.releaseTemp(numAnalGeoSphereTouches);
+        if (use_bin_levels) {
+            scratchPad.releaseTemp(numBinsSphereVisits);
+        }
         CD_temp_arr_bytes = (*pNumBinSphereTouchPairs) * sizeof(binID_t);
-        binID_t* binIDsEachSphereTouches = (binID_t*)scratchPad.allocateTempVector(0, CD_temp_arr_bytes);
+        binID_t* binIDsEachSphereTouches =
+            (binID_t*)scratchPad.allocateTemp("binIDsEachSphereTouches", CD_temp_arr_bytes);
         CD_temp_arr_bytes = (*pNumBinSphereTouchPairs) * sizeof(bodyID_t);
-        bodyID_t* sphereIDsEachBinTouches = (bodyID_t*)scratchPad.allocateTempVector(2, CD_temp_arr_bytes);
+        bodyID_t* sphereIDsEachBinTouches =
+            (bodyID_t*)scratchPad.allocateTemp("sphereIDsEachBinTouches", CD_temp_arr_bytes);
+        binID_t* binIDsEachSphereVisits = nullptr;
+        bodyID_t* sphereIDsEachBinVisits = nullptr;
+        if (use_bin_levels) {
+            CD_temp_arr_bytes = numBinSphereVisitPairs * sizeof(binID_t);
+            binIDsEachSphereVisits = (binID_t*)scratchPad.allocateTemp("binIDsEachSphereVisits", CD_temp_arr_bytes);
+            CD_temp_arr_bytes = numBinSphereVisitPairs * sizeof(bodyID_t);
+            sphereIDsEachBinVisits = (bodyID_t*)scratchPad.allocateTemp("sphereIDsEachBinVisits", CD_temp_arr_bytes);
+        }
         // This kernel is also responsible of figuring out sphere--analytical geometry pairs
         bin_sphere_kernels->kernel("populateBinSphereTouchingPairs")
             .instantiate()
             .configure(dim3(blocks_needed_for_bodies), dim3(DEME_NUM_BODIES_PER_BLOCK), 0, this_stream)
             .launch(simParams, granData, numBinsSphereTouchesScan, numAnalGeoSphereTouchesScan, binIDsEachSphereTouches,
-                    sphereIDsEachBinTouches, granData->idGeometryA, granData->idGeometryB, granData->contactType);
+                    sphereIDsEachBinTouches, numBinsSphereVisitsScan, binIDsEachSphereVisits, sphereIDsEachBinVisits,
+                    granData->idGeometryA, granData->idGeometryB, granData->contactType);
         DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
         // std::cout << "Unsorted bin IDs: ";
         // displayArray<binID_t>(binIDsEachSphereTouches, *pNumBinSphereTouchPairs);
@@ -143,12 +189,16 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         // displayArray<bodyID_t>(sphereIDsEachBinTouches, *pNumBinSphereTouchPairs);
 
         // 4th step: allocate and populate SORTED binIDsEachSphereTouches and sphereIDsEachBinTouches. Note
-        // numBinsSphereTouchesScan can retire now so we re-use vector 1 and 3 (analytical contacts have been
+        // numBinsSphereTouchesScan and numAnalGeoSphereTouchesScan can retire now (analytical contacts have been
         // processed).
+        scratchPad.releaseTemp(numBinsSphereTouchesScan);
+        scratchPad.releaseTemp(numAnalGeoSphereTouchesScan);
         CD_temp_arr_bytes = (*pNumBinSphereTouchPairs) * sizeof(bodyID_t);
-        bodyID_t* sphereIDsEachBinTouches_sorted = (bodyID_t*)scratchPad.allocateTempVector(1, CD_temp_arr_bytes);
+        bodyID_t* sphereIDsEachBinTouches_sorted =
+            (bodyID_t*)scratchPad.allocateTemp("sphereIDsEachBinTouches_sorted", CD_temp_arr_bytes);
         CD_temp_arr_bytes = (*pNumBinSphereTouchPairs) * sizeof(binID_t);
-        binID_t* binIDsEachSphereTouches_sorted = (binID_t*)scratchPad.allocateTempVector(3, CD_temp_arr_bytes);
+        binID_t* binIDsEachSphereTouches_sorted =
+            (binID_t*)scratchPad.allocateTemp("binIDsEachSphereTouches_sorted", CD_temp_arr_bytes);
         // hostSortByKey<binID_t, bodyID_t>(granData->binIDsEachSphereTouches, granData->sphereIDsEachBinTouches,
         //                                  *pNumBinSphereTouchPairs);
         cubDEMSortByKeys<binID_t, bodyID_t, DEMSolverStateData>(binIDsEachSphereTouches, binIDsEachSphereTouches_sorted,
@@ -166,13 +216,15 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         size_t* pNumActiveBins = scratchPad.pTempSizeVar2;
         cubDEMUnique<binID_t, DEMSolverStateData>(binIDsEachSphereTouches_sorted, binIDsUnique, pNumActiveBins,
                                                   *pNumBinSphereTouchPairs, this_stream, scratchPad);
-        // Allocate space for encoding output, and run it. Note the (unsorted) binIDsEachSphereTouches and
-        // sphereIDsEachBinTouches can retire now, so we allocate on temp vectors 0 and 2.
+        // Allocate space for encoding output, and run it. Note the (unsorted) binIDsEachSphereTouches (holding
+        // binIDsUnique) and sphereIDsEachBinTouches can retire now.
+        scratchPad.releaseTemp(binIDsEachSphereTouches);
+        scratchPad.releaseTemp(sphereIDsEachBinTouches);
         CD_temp_arr_bytes = (*pNumActiveBins) * sizeof(binID_t);
-        binID_t* activeBinIDs = (binID_t*)scratchPad.allocateTempVector(0, CD_temp_arr_bytes);
+        binID_t* activeBinIDs = (binID_t*)scratchPad.allocateTemp("activeBinIDs", CD_temp_arr_bytes);
         CD_temp_arr_bytes = (*pNumActiveBins) * sizeof(spheresBinTouches_t);
         spheresBinTouches_t* numSpheresBinTouches =
-            (spheresBinTouches_t*)scratchPad.allocateTempVector(2, CD_temp_arr_bytes);
+            (spheresBinTouches_t*)scratchPad.allocateTemp("numSpheresBinTouches", CD_temp_arr_bytes);
         cubDEMRunLengthEncode<binID_t, spheresBinTouches_t, DEMSolverStateData>(
             binIDsEachSphereTouches_sorted, activeBinIDs, numSpheresBinTouches, pNumActiveBins,
             *pNumBinSphereTouchPairs, this_stream, scratchPad);
@@ -191,22 +243,83 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         stateParams.maxSphFoundInBin = (size_t)(*pMaxGeoInBin);
 
         // Then, scan to find the offsets that are used to index into sphereIDsEachBinTouches_sorted to obtain bin-wise
-        // spheres. Note binIDsEachSphereTouches_sorted can retire so we allocate on temp vector 3.
+        // spheres. Note binIDsEachSphereTouches_sorted can retire now.
+        scratchPad.releaseTemp(binIDsEachSphereTouches_sorted);
         CD_temp_arr_bytes = (*pNumActiveBins) * sizeof(binSphereTouchPairs_t);
         binSphereTouchPairs_t* sphereIDsLookUpTable =
-            (binSphereTouchPairs_t*)scratchPad.allocateTempVector(3, CD_temp_arr_bytes);
+            (binSphereTouchPairs_t*)scratchPad.allocateTemp("sphereIDsLookUpTable", CD_temp_arr_bytes);
         cubDEMPrefixScan<spheresBinTouches_t, binSphereTouchPairs_t, DEMSolverStateData>(
             numSpheresBinTouches, sphereIDsLookUpTable, *pNumActiveBins, this_stream, scratchPad);
         // std::cout << "sphereIDsLookUpTable: ";
         // displayArray<binSphereTouchPairs_t>(sphereIDsLookUpTable, *pNumActiveBins);
 
+        ////////////////////////////////////////////////////////////////////////////////
+        // Hierarchical binning: smaller spheres visiting the bins of coarser levels
+        ////////////////////////////////////////////////////////////////////////////////
+
+        // The visiting pairs go through the same sort--encode--scan process as the pairs above, then the visited
+        // active bins are mapped to activeBinIDs to find the spheres living there, just like for triangles.
+        size_t* pNumActiveBinsForVisitors = scratchPad.pTempSizeVar4;
+        *pNumActiveBinsForVisitors = 0;
+        binID_t *activeBinIDsForVisitors, *mapVisitedBinToSphActBin;
+        bodyID_t* sphereIDsEachBinVisits_sorted;
+        binSphereTouchPairs_t *numSpheresBinVisits, *visitorIDsLookUpTable;
+        if (use_bin_levels && numBinSphereVisitPairs > 0) {
+            // Sort. numBinsSphereVisitsScan can retire now.
+            scratchPad.releaseTemp(numBinsSphereVisitsScan);
+            CD_temp_arr_bytes = numBinSphereVisitPairs * sizeof(bodyID_t);
+            sphereIDsEachBinVisits_sorted =
+                (bodyID_t*)scratchPad.allocateTemp("sphereIDsEachBinVisits_sorted", CD_temp_arr_bytes);
+            CD_temp_arr_bytes = numBinSphereVisitPairs * sizeof(binID_t);
+            binID_t* binIDsEachSphereVisits_sorted =
+                (binID_t*)scratchPad.allocateTemp("binIDsEachSphereVisits_sorted", CD_temp_arr_bytes);
+            cubDEMSortByKeys<binID_t, bodyID_t, DEMSolverStateData>(
+                binIDsEachSphereVisits, binIDsEachSphereVisits_sorted, sphereIDsEachBinVisits,
+                sphereIDsEachBinVisits_sorted, numBinSphereVisitPairs, this_stream, scratchPad);
+
+            // Find the visited active bins
+            binID_t* visitedBinIDsUnique = binIDsEachSphereVisits;
+            cubDEMUnique<binID_t, DEMSolverStateData>(binIDsEachSphereVisits_sorted, visitedBinIDsUnique,
+                                                      pNumActiveBinsForVisitors, numBinSphereVisitPairs, this_stream,
+                                                      scratchPad);
+            // The unsorted binIDsEachSphereVisits (holding visitedBinIDsUnique) and sphereIDsEachBinVisits can retire
+            scratchPad.releaseTemp(binIDsEachSphereVisits);
+            scratchPad.releaseTemp(sphereIDsEachBinVisits);
+            CD_temp_arr_bytes = (*pNumActiveBinsForVisitors) * sizeof(binID_t);
+            activeBinIDsForVisitors =
+                (binID_t*)scratchPad.allocateTemp("activeBinIDsForVisitors", CD_temp_arr_bytes);
+            CD_temp_arr_bytes = (*pNumActiveBinsForVisitors) * sizeof(binSphereTouchPairs_t);
+            numSpheresBinVisits =
+                (binSphereTouchPairs_t*)scratchPad.allocateTemp("numSpheresBinVisits", CD_temp_arr_bytes);
+            cubDEMRunLengthEncode<binID_t, binSphereTouchPairs_t, DEMSolverStateData>(
+                binIDsEachSphereVisits_sorted, activeBinIDsForVisitors, numSpheresBinVisits, pNumActiveBinsForVisitors,
+                numBinSphereVisitPairs, this_stream, scratchPad);
+
+            // Map them to activeBinIDs. Most visited bins on a coarse level have no sphere living there, and they will
+            // be skipped as NULL_BINID.
+            CD_temp_arr_bytes = (*pNumActiveBinsForVisitors) * sizeof(binID_t);
+            mapVisitedBinToSphActBin =
+                (binID_t*)scratchPad.allocateTemp("mapVisitedBinToSphActBin", CD_temp_arr_bytes);
+            hostMergeSearchMapGen(activeBinIDsForVisitors, activeBinIDs, mapVisitedBinToSphActBin,
+                                  *pNumActiveBinsForVisitors, *pNumActiveBins, deme::NULL_BINID);
+
+            // Offsets to index into sphereIDsEachBinVisits_sorted. binIDsEachSphereVisits_sorted can retire now.
+            scratchPad.releaseTemp(binIDsEachSphereVisits_sorted);
+            CD_temp_arr_bytes = (*pNumActiveBinsForVisitors) * sizeof(binSphereTouchPairs_t);
+            visitorIDsLookUpTable =
+                (binSphereTouchPairs_t*)scratchPad.allocateTemp("visitorIDsLookUpTable", CD_temp_arr_bytes);
+            cubDEMPrefixScan<binSphereTouchPairs_t, binSphereTouchPairs_t, DEMSolverStateData>(
+                numSpheresBinVisits, visitorIDsLookUpTable, *pNumActiveBinsForVisitors, this_stream, scratchPad);
+        }
+
         ////////////////////////////////////////////////////////////////////////////////
         // Triangle-related discretization
         ////////////////////////////////////////////////////////////////////////////////
 
-        // If there are meshes, they need to be processed too. All sphere--related temp arrays are in use, so we have to
-        // start from 6.
+        // If there are meshes, they need to be processed too. The sphere--related temp arrays still live are all needed
+        // for the contact pair finding below.
         size_t* pNumActiveBinsForTri = scratchPad.pTempSizeVar1;  // TempVar1 is now free (Temp2 is not tho)
+        *pNumActiveBinsForTri = 0;
         binID_t *mapTriActBinToSphActBin, *activeBinIDsForTri;
         bodyID_t* triIDsEachBinTouches_sorted;
         trianglesBinTouches_t* numTrianglesBinTouches;
@@ -218,10 +331,10 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // the 2 prism surfaces is smaller than its radius, it has contact with this prism, hence potentially with
             // this triangle.
             CD_temp_arr_bytes = simParams->nTriGM * sizeof(float3) * 3;
-            sandwichANode1 = (float3*)scratchPad.allocateTempVector(6, CD_temp_arr_bytes);
+            sandwichANode1 = (float3*)scratchPad.allocateTemp("sandwichANode1", CD_temp_arr_bytes);
             sandwichANode2 = sandwichANode1 + simParams->nTriGM;
             sandwichANode3 = sandwichANode2 + simParams->nTriGM;
-            sandwichBNode1 = (float3*)scratchPad.allocateTempVector(7, CD_temp_arr_bytes);
+            sandwichBNode1 = (float3*)scratchPad.allocateTemp("sandwichBNode1", CD_temp_arr_bytes);
             sandwichBNode2 = sandwichBNode1 + simParams->nTriGM;
             sandwichBNode3 = sandwichBNode2 + simParams->nTriGM;
             size_t blocks_needed_for_tri =
@@ -232,12 +345,17 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                 .launch(simParams, granData, sandwichANode1, sandwichANode2, sandwichANode3, sandwichBNode1,
                         sandwichBNode2, sandwichBNode3);
             DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+        }
+        // The sandwiches are for all triangles, but the facets of meshes that use a BVH are not binned
+        if (simParams->nTriGM > stateParams.nTriInMeshBVHs) {
+            size_t blocks_needed_for_tri =
+                (simParams->nTriGM + DEME_NUM_TRIANGLE_PER_BLOCK - 1) / DEME_NUM_TRIANGLE_PER_BLOCK;
 
             // 1st step: register the number of triangle--bin touching pairs for each triangle for further processing.
             // Because we do a `sandwich' contact detection, we are
             CD_temp_arr_bytes = simParams->nTriGM * sizeof(binsTriangleTouches_t);
             binsTriangleTouches_t* numBinsTriTouches =
-                (binsTriangleTouches_t*)scratchPad.allocateTempVector(8, CD_temp_arr_bytes);
+                (binsTriangleTouches_t*)scratchPad.allocateTemp("numBinsTriTouches", CD_temp_arr_bytes);
             {
                 bin_triangle_kernels->kernel("getNumberOfBinsEachTriangleTouches")
                     .instantiate()
@@ -255,7 +373,7 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // conclusion on bin--tri touch pairs
             CD_temp_arr_bytes = (simParams->nTriGM + 1) * sizeof(binsTriangleTouchPairs_t);
             binsTriangleTouchPairs_t* numBinsTriTouchesScan =
-                (binsTriangleTouchPairs_t*)scratchPad.allocateTempVector(9, CD_temp_arr_bytes);
+                (binsTriangleTouchPairs_t*)scratchPad.allocateTemp("numBinsTriTouchesScan", CD_temp_arr_bytes);
             cubDEMPrefixScan<binsTriangleTouches_t, binsTriangleTouchPairs_t, DEMSolverStateData>(
                 numBinsTriTouches, numBinsTriTouchesScan, simParams->nTriGM, this_stream, scratchPad);
             size_t numBinTriTouchPairs =
@@ -264,11 +382,14 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                 numBinTriTouchPairs;  // Again, this is used in populateBinTriangleTouchingPairs
 
             // 3rd step: use a custom kernel to figure out all sphere--bin touching pairs. Note numBinsTriTouches can
-            // retire now so we allocate on temp vector 8.
+            // retire now.
+            scratchPad.releaseTemp(numBinsTriTouches);
             CD_temp_arr_bytes = numBinTriTouchPairs * sizeof(binID_t);
-            binID_t* binIDsEachTriTouches = (binID_t*)scratchPad.allocateTempVector(8, CD_temp_arr_bytes);
+            binID_t* binIDsEachTriTouches =
+                (binID_t*)scratchPad.allocateTemp("binIDsEachTriTouches", CD_temp_arr_bytes);
             CD_temp_arr_bytes = numBinTriTouchPairs * sizeof(bodyID_t);
-            bodyID_t* triIDsEachBinTouches = (bodyID_t*)scratchPad.allocateTempVector(10, CD_temp_arr_bytes);
+            bodyID_t* triIDsEachBinTouches =
+                (bodyID_t*)scratchPad.allocateTemp("triIDsEachBinTouches", CD_temp_arr_bytes);
             {
                 bin_triangle_kernels->kernel("populateBinTriangleTouchingPairs")
                     .instantiate()
@@ -282,11 +403,14 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // displayArray<binsTriangleTouches_t>(binIDsEachTriTouches, numBinTriTouchPairs);
 
             // 4th step: allocate and populate SORTED binIDsEachTriTouches and triIDsEachBinTouches. Note
-            // numBinsTriTouchesScan can retire now so we re-use vector 9 and allocate 11.
+            // numBinsTriTouchesScan can retire now.
+            scratchPad.releaseTemp(numBinsTriTouchesScan);
             CD_temp_arr_bytes = numBinTriTouchPairs * sizeof(bodyID_t);
-            triIDsEachBinTouches_sorted = (bodyID_t*)scratchPad.allocateTempVector(9, CD_temp_arr_bytes);
+            triIDsEachBinTouches_sorted =
+                (bodyID_t*)scratchPad.allocateTemp("triIDsEachBinTouches_sorted", CD_temp_arr_bytes);
             CD_temp_arr_bytes = numBinTriTouchPairs * sizeof(binID_t);
-            binID_t* binIDsEachTriTouches_sorted = (binID_t*)scratchPad.allocateTempVector(11, CD_temp_arr_bytes);
+            binID_t* binIDsEachTriTouches_sorted =
+                (binID_t*)scratchPad.allocateTemp("binIDsEachTriTouches_sorted", CD_temp_arr_bytes);
             cubDEMSortByKeys<binID_t, bodyID_t, DEMSolverStateData>(binIDsEachTriTouches, binIDsEachTriTouches_sorted,
                                                                     triIDsEachBinTouches, triIDsEachBinTouches_sorted,
                                                                     numBinTriTouchPairs, this_stream, scratchPad);
@@ -297,12 +421,15 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             binID_t* binIDsUnique = (binID_t*)binIDsEachTriTouches;
             cubDEMUnique<binID_t, DEMSolverStateData>(binIDsEachTriTouches_sorted, binIDsUnique, pNumActiveBinsForTri,
                                                       numBinTriTouchPairs, this_stream, scratchPad);
-            // Allocate space for encoding output, and run it. Note the (unsorted) binIDsEachTriTouches and
-            // triIDsEachBinTouches can retire now, so we allocate on temp vectors 8 and 10.
+            // Allocate space for encoding output, and run it. Note the (unsorted) binIDsEachTriTouches (holding
+            // binIDsUnique) and triIDsEachBinTouches can retire now.
+            scratchPad.releaseTemp(binIDsEachTriTouches);
+            scratchPad.releaseTemp(triIDsEachBinTouches);
             CD_temp_arr_bytes = (*pNumActiveBinsForTri) * sizeof(binID_t);
-            activeBinIDsForTri = (binID_t*)scratchPad.allocateTempVector(8, CD_temp_arr_bytes);
+            activeBinIDsForTri = (binID_t*)scratchPad.allocateTemp("activeBinIDsForTri", CD_temp_arr_bytes);
             CD_temp_arr_bytes = (*pNumActiveBinsForTri) * sizeof(trianglesBinTouches_t);
-            numTrianglesBinTouches = (trianglesBinTouches_t*)scratchPad.allocateTempVector(10, CD_temp_arr_bytes);
+            numTrianglesBinTouches =
+                (trianglesBinTouches_t*)scratchPad.allocateTemp("numTrianglesBinTouches", CD_temp_arr_bytes);
             cubDEMRunLengthEncode<binID_t, trianglesBinTouches_t, DEMSolverStateData>(
                 binIDsEachTriTouches_sorted, activeBinIDsForTri, numTrianglesBinTouches, pNumActiveBinsForTri,
                 numBinTriTouchPairs, this_stream, scratchPad);
@@ -324,7 +451,8 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // activeBinIDsForTri, we know where to find the corresponding bin that resides in activeBinIDs, to bring
             // spheres into this bin-wise contact detection sweep.
             CD_temp_arr_bytes = (*pNumActiveBinsForTri) * sizeof(binID_t);
-            mapTriActBinToSphActBin = (binID_t*)scratchPad.allocateTempVector(12, CD_temp_arr_bytes);
+            mapTriActBinToSphActBin =
+                (binID_t*)scratchPad.allocateTemp("mapTriActBinToSphActBin", CD_temp_arr_bytes);
             {
                 // size_t blocks_needed_for_map =
                 //     (*pNumActiveBinsForTri + DEME_KT_CD_NTHREADS_PER_BLOCK - 1) / DEME_KT_CD_NTHREADS_PER_BLOCK;
@@ -344,9 +472,11 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // displayArray<binID_t>(mapTriActBinToSphActBin, *pNumActiveBinsForTri);
 
             // 7th step: scan to find the offsets that are used to index into triIDsEachBinTouches_sorted to obtain
-            // bin-wise triangles. Note binIDsEachTriTouches_sorted can retire so we allocate on temp vector 11.
+            // bin-wise triangles. Note binIDsEachTriTouches_sorted can retire now.
+            scratchPad.releaseTemp(binIDsEachTriTouches_sorted);
             CD_temp_arr_bytes = (*pNumActiveBinsForTri) * sizeof(binsTriangleTouchPairs_t);
-            triIDsLookUpTable = (binsTriangleTouchPairs_t*)scratchPad.allocateTempVector(11, CD_temp_arr_bytes);
+            triIDsLookUpTable =
+                (binsTriangleTouchPairs_t*)scratchPad.allocateTemp("triIDsLookUpTable", CD_temp_arr_bytes);
             cubDEMPrefixScan<trianglesBinTouches_t, binsTriangleTouchPairs_t, DEMSolverStateData>(
                 numTrianglesBinTouches, triIDsLookUpTable, *pNumActiveBinsForTri, this_stream, scratchPad);
         }
@@ -363,16 +493,25 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         // type).
         CD_temp_arr_bytes = (*pNumActiveBins) * sizeof(binContactPairs_t);
         binContactPairs_t* numSphContactsInEachBin =
-            (binContactPairs_t*)scratchPad.allocateTempVector(4, CD_temp_arr_bytes);
+            (binContactPairs_t*)scratchPad.allocateTemp("numSphContactsInEachBin", CD_temp_arr_bytes);
         size_t blocks_needed_for_bins_sph = *pNumActiveBins;
         // Some quantities and arrays for triangles as well, should we need them
         size_t blocks_needed_for_bins_tri = 0;
         // binContactPairs_t also doubles as the type for the number of tri--sph contact pairs
         binContactPairs_t* numTriSphContactsInEachBin;
-        if (simParams->nTriGM > 0) {
+        if (*pNumActiveBinsForTri > 0) {
             blocks_needed_for_bins_tri = *pNumActiveBinsForTri;
             CD_temp_arr_bytes = (*pNumActiveBinsForTri) * sizeof(binContactPairs_t);
-            numTriSphContactsInEachBin = (binContactPairs_t*)scratchPad.allocateTempVector(13, CD_temp_arr_bytes);
+            numTriSphContactsInEachBin =
+                (binContactPairs_t*)scratchPad.allocateTemp("numTriSphContactsInEachBin", CD_temp_arr_bytes);
+        }
+        // And for resident--visitor sphere pairs, should we use hierarchical binning
+        size_t blocks_needed_for_bins_visitor = *pNumActiveBinsForVisitors;
+        binContactPairs_t* numVisitorContactsInEachBin;
+        if (blocks_needed_for_bins_visitor > 0) {
+            CD_temp_arr_bytes = (*pNumActiveBinsForVisitors) * sizeof(binContactPairs_t);
+            numVisitorContactsInEachBin =
+                (binContactPairs_t*)scratchPad.allocateTemp("numVisitorContactsInEachBin", CD_temp_arr_bytes);
         }
 
         if (blocks_needed_for_bins_sph > 0) {
@@ -397,6 +536,18 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                 // displayArray<binContactPairs_t>(numTriSphContactsInEachBin, *pNumActiveBinsForTri);
             }
 
+            if (blocks_needed_for_bins_visitor > 0) {
+                sphere_contact_kernels->kernel("getNumberOfSphVisitorContactsEachBin")
+                    .instantiate()
+                    .configure(dim3(blocks_needed_for_bins_visitor), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0,
+                               this_stream)
+                    .launch(simParams, granData, sphereIDsEachBinTouches_sorted, numSpheresBinTouches,
+                            sphereIDsLookUpTable, mapVisitedBinToSphActBin, sphereIDsEachBinVisits_sorted,
+                            activeBinIDsForVisitors, numSpheresBinVisits, visitorIDsLookUpTable,
+                            numVisitorContactsInEachBin, *pNumActiveBinsForVisitors);
+                DEME_GPU_CALL_WATCH_BETA(cudaStreamSynchronize(this_stream));
+            }
+
             //// TODO: sphere should have jitified and non-jitified part. Use a component ID > max_comp_id to signal
             /// bringing data from global memory. / TODO: Add tri--sphere CD kernel (if mesh support is to be added).
             /// This kernel integrates tri--boundary CD. Note triangle facets can have jitified (many bodies of the same
@@ -411,17 +562,51 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // other.
             CD_temp_arr_bytes = (*pNumActiveBins + 1) * sizeof(contactPairs_t);
             contactPairs_t* sphSphContactReportOffsets =
-                (contactPairs_t*)scratchPad.allocateTempVector(5, CD_temp_arr_bytes);
+                (contactPairs_t*)scratchPad.allocateTemp("sphSphContactReportOffsets", CD_temp_arr_bytes);
             cubDEMPrefixScan<binContactPairs_t, contactPairs_t, DEMSolverStateData>(
                 numSphContactsInEachBin, sphSphContactReportOffsets, *pNumActiveBins, this_stream, scratchPad);
             contactPairs_t* triSphContactReportOffsets;
-            if (simParams->nTriGM > 0) {
+            if (blocks_needed_for_bins_tri > 0) {
                 CD_temp_arr_bytes = (*pNumActiveBinsForTri + 1) * sizeof(contactPairs_t);
-                triSphContactReportOffsets = (contactPairs_t*)scratchPad.allocateTempVector(14, CD_temp_arr_bytes);
+                triSphContactReportOffsets =
+                    (contactPairs_t*)scratchPad.allocateTemp("triSphContactReportOffsets", CD_temp_arr_bytes);
                 cubDEMPrefixScan<binContactPairs_t, contactPairs_t, DEMSolverStateData>(
                     numTriSphContactsInEachBin, triSphContactReportOffsets, *pNumActiveBinsForTri, this_stream,
                     scratchPad);
             }
+            contactPairs_t* visitorContactReportOffsets;
+            if (blocks_needed_for_bins_visitor > 0) {
+                CD_temp_arr_bytes = (*pNumActiveBinsForVisitors + 1) * sizeof(contactPairs_t);
+                visitorContactReportOffsets =
+                    (contactPairs_t*)scratchPad.allocateTemp("visitorContactReportOffsets", CD_temp_arr_bytes);
+                cubDEMPrefixScan<binContactPairs_t, contactPairs_t, DEMSolverStateData>(
+                    numVisitorContactsInEachBin, visitorContactReportOffsets, *pNumActiveBinsForVisitors, this_stream,
+                    scratchPad);
+            }
+            // Sphere contacts with the meshes that use a BVH are found sphere-wise, by querying the BVHs
+            size_t blocks_needed_for_bvh_query =
+                (simParams->nSpheresGM + DEME_KT_CD_NTHREADS_PER_BLOCK - 1) / DEME_KT_CD_NTHREADS_PER_BLOCK;
+            contactPairs_t* sphMeshBVHContactOffsets;
+            size_t nMeshBVHContact = 0;
+            if (simParams->nMeshBVHs > 0) {
+                CD_temp_arr_bytes = simParams->nSpheresGM * sizeof(geoSphereTouches_t);
+                geoSphereTouches_t* numSphMeshBVHContacts =
+                    (geoSphereTouches_t*)scratchPad.allocateTemp("numSphMeshBVHContacts", CD_temp_arr_bytes);
+                sphTri_contact_kernels->kernel("getNumberOfSphMeshBVHContacts")
+                    .instantiate()
+                    .configure(dim3(blocks_needed_for_bvh_query), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
+                    .launch(simParams, granData, numSphMeshBVHContacts, sandwichANode1, sandwichANode2,
+                            sandwichANode3, sandwichBNode1, sandwichBNode2, sandwichBNode3);
+                DEME_GPU_CALL_WATCH_BETA(cudaStreamSynchronize(this_stream));
+                CD_temp_arr_bytes = (simParams->nSpheresGM + 1) * sizeof(contactPairs_t);
+                sphMeshBVHContactOffsets =
+                    (contactPairs_t*)scratchPad.allocateTemp("sphMeshBVHContactOffsets", CD_temp_arr_bytes);
+                cubDEMPrefixScan<geoSphereTouches_t, contactPairs_t, DEMSolverStateData>(
+                    numSphMeshBVHContacts, sphMeshBVHContactOffsets, simParams->nSpheresGM, this_stream, scratchPad);
+                nMeshBVHContact = (size_t)numSphMeshBVHContacts[simParams->nSpheresGM - 1] +
+                                  (size_t)sphMeshBVHContactOffsets[simParams->nSpheresGM - 1];
+                sphMeshBVHContactOffsets[simParams->nSpheresGM] = nMeshBVHContact;
+            }
             // DEME_DEBUG_PRINTF("Num contacts each bin:");
             // DEME_DEBUG_EXEC(displayArray<binContactPairs_t>(numSphContactsInEachBin, *pNumActiveBins));
             // DEME_DEBUG_PRINTF("Tri contact report offsets:");
@@ -435,8 +620,17 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                                           (size_t)sphSphContactReportOffsets[*pNumActiveBins - 1];
             sphSphContactReportOffsets[*pNumActiveBins] = nSphereSphereContact;
 
+            // Resident--visitor sphere pairs are sphere--sphere contacts too
+            size_t nVisitorContact = 0;
+            if (blocks_needed_for_bins_visitor > 0) {
+                nVisitorContact = (size_t)numVisitorContactsInEachBin[*pNumActiveBinsForVisitors - 1] +
+                                  (size_t)visitorContactReportOffsets[*pNumActiveBinsForVisitors - 1];
+                visitorContactReportOffsets[*pNumActiveBinsForVisitors] = nVisitorContact;
+                nSphereSphereContact += nVisitorContact;
+            }
+
             size_t nTriSphereContact = 0;
-            if (simParams->nTriGM > 0) {
+            if (blocks_needed_for_bins_tri > 0) {
                 nTriSphereContact = (size_t)numTriSphContactsInEachBin[*pNumActiveBinsForTri - 1] +
                                     (size_t)triSphContactReportOffsets[*pNumActiveBinsForTri - 1];
                 triSphContactReportOffsets[*pNumActiveBinsForTri] = nTriSphereContact;
@@ -444,9 +638,14 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // std::cout << "nSphereGeoContact: " << nSphereGeoContact << std::endl;
             // std::cout << "nSphereSphereContact: " << nSphereSphereContact << std::endl;
 
-            *scratchPad.pNumContacts = nSphereSphereContact + nSphereGeoContact + nTriSphereContact;
-            if (*scratchPad.pNumContacts > idGeometryA.size()) {
-                contactEventArraysResize(*scratchPad.pNumContacts, idGeometryA, idGeometryB, contactType, granData);
+            *scratchPad.pNumContacts = nSphereSphereContact + nSphereGeoContact + nTriSphereContact + nMeshBVHContact;
+            // The sphere--analytical contacts already in the arrays are kept even if they are cut back, since they are
+            // never cut shorter than the total number of contacts
+            size_t cnt_arr_len = decideCntArrLength(*scratchPad.pNumContacts, idGeometryA.size(),
+                                                    stateParams.cntArrMinLength, true);
+            if (cnt_arr_len != idGeometryA.size()) {
+                contactEventArraysResize(cnt_arr_len, idGeometryA, idGeometryB, contactType, granData,
+                                         approx_bytes_used, num_cnt_arr_reallocs);
             }
 
             // Sphere--sphere contact pairs go after sphere--anal-geo contacts
@@ -461,6 +660,23 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                         sphereIDsLookUpTable, sphSphContactReportOffsets, idSphA, idSphB, dType, *pNumActiveBins);
             DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
 
+            // Resident--visitor pairs go right after the same-level ones
+            if (blocks_needed_for_bins_visitor > 0) {
+                const size_t nSameLevelContact = nSphereSphereContact - nVisitorContact;
+                idSphA = (granData->idGeometryA + nSphereGeoContact + nSameLevelContact);
+                idSphB = (granData->idGeometryB + nSphereGeoContact + nSameLevelContact);
+                dType = (granData->contactType + nSphereGeoContact + nSameLevelContact);
+                sphere_contact_kernels->kernel("populateSphVisitorContactPairsEachBin")
+                    .instantiate()
+                    .configure(dim3(blocks_needed_for_bins_visitor), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0,
+                               this_stream)
+                    .launch(simParams, granData, sphereIDsEachBinTouches_sorted, numSpheresBinTouches,
+                            sphereIDsLookUpTable, mapVisitedBinToSphActBin, sphereIDsEachBinVisits_sorted,
+                            activeBinIDsForVisitors, numSpheresBinVisits, visitorIDsLookUpTable,
+                            visitorContactReportOffsets, idSphA, idSphB, dType, *pNumActiveBinsForVisitors);
+                DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+            }
+
             // Triangle--sphere contact pairs go after sphere--sphere contacts. Remember to mark their type.
             if (blocks_needed_for_bins_tri > 0) {
                 idSphA = (granData->idGeometryA + nSphereGeoContact + nSphereSphereContact);
@@ -480,6 +696,20 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                 // displayArray<bodyID_t>(granData->idGeometryB, *scratchPad.pNumContacts);
                 // displayArray<contact_t>(granData->contactType, *scratchPad.pNumContacts);
             }
+
+            // And the BVH-found sphere--mesh contacts go last
+            if (nMeshBVHContact > 0) {
+                const size_t nBeforeMeshBVH = nSphereGeoContact + nSphereSphereContact + nTriSphereContact;
+                idSphA = (granData->idGeometryA + nBeforeMeshBVH);
+                bodyID_t* idTriB = (granData->idGeometryB + nBeforeMeshBVH);
+                dType = (granData->contactType + nBeforeMeshBVH);
+                sphTri_contact_kernels->kernel("populateSphMeshBVHContacts")
+                    .instantiate()
+                    .configure(dim3(blocks_needed_for_bvh_query), dim3(DEME_KT_CD_NTHREADS_PER_BLOCK), 0, this_stream)
+                    .launch(simParams, granData, sphMeshBVHContactOffsets, idSphA, idTriB, dType, sandwichANode1,
+                            sandwichANode2, sandwichANode3, sandwichBNode1, sandwichBNode2, sandwichBNode3);
+                DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
+            }
         }  // End of bin-wise contact detection subroutine
         timers.GetTimer("Find contact pairs").stop();
     }
@@ -491,12 +721,13 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
     timers.GetTimer("Build history map").start();
     // Now, sort idGeometryAB by their owners. Needed for identifying persistent contacts in history-based models.
     if (*scratchPad.pNumContacts > 0) {
-        // All temp vectors are free now, and all of them are fairly long...
+        // All temp arrays of the binning are released now
+        auto scratch_scope = scratchPad.tempScope("History mapping");
         size_t type_arr_bytes = (*scratchPad.pNumContacts) * sizeof(contact_t);
-        contact_t* contactType_sorted = (contact_t*)scratchPad.allocateTempVector(0, type_arr_bytes);
+        contact_t* contactType_sorted = (contact_t*)scratchPad.allocateTemp("contactType_sorted", type_arr_bytes);
         size_t id_arr_bytes = (*scratchPad.pNumContacts) * sizeof(bodyID_t);
-        bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTempVector(1, id_arr_bytes);
-        bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTempVector(2, id_arr_bytes);
+        bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTemp("idA_sorted", id_arr_bytes);
+        bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTemp("idB_sorted", id_arr_bytes);
 
         //// TODO: But do I have to SortByKey twice?? Can I zip these value arrays together??
         // Although it is stupid, do pay attention to that it does leverage the fact that RadixSort is stable.
@@ -511,6 +742,9 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         DEME_GPU_CALL(cudaMemcpy(granData->idGeometryA, idA_sorted, id_arr_bytes, cudaMemcpyDeviceToDevice));
         DEME_GPU_CALL(cudaMemcpy(granData->idGeometryB, idB_sorted, id_arr_bytes, cudaMemcpyDeviceToDevice));
         DEME_GPU_CALL(cudaMemcpy(granData->contactType, contactType_sorted, type_arr_bytes, cudaMemcpyDeviceToDevice));
+        scratchPad.releaseTemp(contactType_sorted);
+        scratchPad.releaseTemp(idA_sorted);
+        scratchPad.releaseTemp(idB_sorted);
         // DEME_DEBUG_PRINTF("New contact IDs (A):");
         // DEME_DEBUG_EXEC(displayArray<bodyID_t>(granData->idGeometryA, *scratchPad.pNumContacts));
         // DEME_DEBUG_PRINTF("New contact IDs (B):");
@@ -533,9 +767,10 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
 
         // First, identify the new and old idA run-length
         size_t run_length_bytes = nSpheresSafe * sizeof(geoSphereTouches_t);
-        geoSphereTouches_t* new_idA_runlength = (geoSphereTouches_t*)scratchPad.allocateTempVector(0, run_length_bytes);
+        geoSphereTouches_t* new_idA_runlength =
+            (geoSphereTouches_t*)scratchPad.allocateTemp("new_idA_runlength", run_length_bytes);
         size_t unique_id_bytes = nSpheresSafe * sizeof(bodyID_t);
-        bodyID_t* unique_new_idA = (bodyID_t*)scratchPad.allocateTempVector(1, unique_id_bytes);
+        bodyID_t* unique_new_idA = (bodyID_t*)scratchPad.allocateTemp("unique_new_idA", unique_id_bytes);
         size_t* pNumUniqueNewA = scratchPad.pTempSizeVar1;
         cubDEMRunLengthEncode<bodyID_t, geoSphereTouches_t, DEMSolverStateData>(
             granData->idGeometryA, unique_new_idA, new_idA_runlength, pNumUniqueNewA, *scratchPad.pNumContacts,
@@ -563,8 +798,8 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         // Only need to proceed if history-based
         if (!solverFlags.isHistoryless) {
             geoSphereTouches_t* old_idA_runlength =
-                (geoSphereTouches_t*)scratchPad.allocateTempVector(2, run_length_bytes);
-            bodyID_t* unique_old_idA = (bodyID_t*)scratchPad.allocateTempVector(3, unique_id_bytes);
+                (geoSphereTouches_t*)scratchPad.allocateTemp("old_idA_runlength", run_length_bytes);
+            bodyID_t* unique_old_idA = (bodyID_t*)scratchPad.allocateTemp("unique_old_idA", unique_id_bytes);
             size_t* pNumUniqueOldA = scratchPad.pTempSizeVar2;
             cubDEMRunLengthEncode<bodyID_t, geoSphereTouches_t, DEMSolverStateData>(
                 granData->previous_idGeometryA, unique_old_idA, old_idA_runlength, pNumUniqueOldA,
@@ -573,9 +808,9 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // Then, add zeros to run-length arrays such that even if a sphereID is not present in idA, it has a
             // place in the run-length arrays that indicates 0 run-length
             geoSphereTouches_t* new_idA_runlength_full =
-                (geoSphereTouches_t*)scratchPad.allocateTempVector(4, run_length_bytes);
+                (geoSphereTouches_t*)scratchPad.allocateTemp("new_idA_runlength_full", run_length_bytes);
             geoSphereTouches_t* old_idA_runlength_full =
-                (geoSphereTouches_t*)scratchPad.allocateTempVector(5, run_length_bytes);
+                (geoSphereTouches_t*)scratchPad.allocateTemp("old_idA_runlength_full", run_length_bytes);
             DEME_GPU_CALL(cudaMemset((void*)new_idA_runlength_full, 0, run_length_bytes));
             DEME_GPU_CALL(cudaMemset((void*)old_idA_runlength_full, 0, run_length_bytes));
             size_t blocks_needed_for_mapping =
@@ -604,9 +839,9 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // Then, prescan to find run-length offsets, in preparation for custom kernels
             size_t scanned_runlength_bytes = nSpheresSafe * sizeof(contactPairs_t);
             contactPairs_t* new_idA_scanned_runlength =
-                (contactPairs_t*)scratchPad.allocateTempVector(0, scanned_runlength_bytes);
+                (contactPairs_t*)scratchPad.allocateTemp("new_idA_scanned_runlength", scanned_runlength_bytes);
             contactPairs_t* old_idA_scanned_runlength =
-                (contactPairs_t*)scratchPad.allocateTempVector(1, scanned_runlength_bytes);
+                (contactPairs_t*)scratchPad.allocateTemp("old_idA_scanned_runlength", scanned_runlength_bytes);
             cubDEMPrefixScan<geoSphereTouches_t, contactPairs_t, DEMSolverStateData>(
                 new_idA_runlength_full, new_idA_scanned_runlength, nSpheresSafe, this_stream, scratchPad);
             cubDEMPrefixScan<geoSphereTouches_t, contactPairs_t, DEMSolverStateData>(
@@ -615,8 +850,11 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // Then, each thread will scan a sphere, if this sphere has non-zero run-length in both new and old idA,
             // manually store the mapping. This mapping's elemental values are the indices of the corresponding
             // contacts in the previous contact array.
-            if (*scratchPad.pNumContacts > contactMapping.size()) {
-                contactMapping.resize(*scratchPad.pNumContacts);
+            size_t mapping_arr_len = decideCntArrLength(*scratchPad.pNumContacts, contactMapping.size(),
+                                                        stateParams.cntArrMinLength, true);
+            if (mapping_arr_len != contactMapping.size()) {
+                approx_bytes_used += hostResizeExact(contactMapping, mapping_arr_len, NULL_MAPPING_PARTNER);
+                num_cnt_arr_reallocs++;
                 granData->contactMapping = contactMapping.data();
             }
             blocks_needed_for_mapping = (nSpheresSafe + DEME_NUM_BODIES_PER_BLOCK - 1) / DEME_NUM_BODIES_PER_BLOCK;
@@ -637,8 +875,9 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             contactPairs_t* old_arr_unsort_to_sort_map;
             if (solverFlags.should_sort_pairs) {
                 size_t map_arr_bytes = (*scratchPad.pNumPrevContacts) * sizeof(contactPairs_t);
-                old_arr_unsort_to_sort_map = (contactPairs_t*)scratchPad.allocateTempVector(1, map_arr_bytes);
-                contactPairs_t* one_to_n = (contactPairs_t*)scratchPad.allocateTempVector(0, map_arr_bytes);
+                old_arr_unsort_to_sort_map =
+                    (contactPairs_t*)scratchPad.allocateTemp("old_arr_unsort_to_sort_map", map_arr_bytes);
+                contactPairs_t* one_to_n = (contactPairs_t*)scratchPad.allocateTemp("one_to_n", map_arr_bytes);
                 size_t blocks_needed_for_mapping =
                     (*scratchPad.pNumPrevContacts + DEME_MAX_THREADS_PER_BLOCK - 1) / DEME_MAX_THREADS_PER_BLOCK;
                 if (blocks_needed_for_mapping > 0) {
@@ -648,8 +887,8 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                         .launch(one_to_n, *scratchPad.pNumPrevContacts);
                     DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
 
-                    contact_t* old_contactType_sorted = (contact_t*)scratchPad.allocateTempVector(
-                        2, (*scratchPad.pNumPrevContacts) * sizeof(contact_t));
+                    contact_t* old_contactType_sorted = (contact_t*)scratchPad.allocateTemp(
+                        "old_contactType_sorted", (*scratchPad.pNumPrevContacts) * sizeof(contact_t));
                     cubDEMSortByKeys<contact_t, contactPairs_t, DEMSolverStateData>(
                         granData->previous_contactType, old_contactType_sorted, one_to_n, old_arr_unsort_to_sort_map,
                         *scratchPad.pNumPrevContacts, this_stream, scratchPad);
@@ -660,17 +899,20 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
                         .launch(old_arr_unsort_to_sort_map, one_to_n, *scratchPad.pNumPrevContacts);
                     DEME_GPU_CALL(cudaStreamSynchronize(this_stream));
                 }
-                // one_to_n used for temp storage; now give it back to the true mapping we wanted. And now, vector 0 is
-                // in use.
+                // one_to_n used for temp storage; now give it back to the true mapping we wanted. Both arrays live
+                // until the end of the history mapping scope.
                 old_arr_unsort_to_sort_map = one_to_n;
             }
 
             // Finally, copy new contact array to old contact array for the record. Note we register old contact pairs
             // with the array sorted by A, but when supplying dT, it was sorted by contact type.
-            if (*scratchPad.pNumContacts > previous_idGeometryA.size()) {
-                previous_idGeometryA.resize(*scratchPad.pNumContacts);
-                previous_idGeometryB.resize(*scratchPad.pNumContacts);
-                previous_contactType.resize(*scratchPad.pNumContacts);
+            size_t prev_arr_len = decideCntArrLength(*scratchPad.pNumContacts, previous_idGeometryA.size(),
+                                                     stateParams.cntArrMinLength, true);
+            if (prev_arr_len != previous_idGeometryA.size()) {
+                approx_bytes_used += hostResizeExact(previous_idGeometryA, prev_arr_len, 0);
+                approx_bytes_used += hostResizeExact(previous_idGeometryB, prev_arr_len, 0);
+                approx_bytes_used += hostResizeExact(previous_contactType, prev_arr_len, NOT_A_CONTACT);
+                num_cnt_arr_reallocs++;
 
                 granData->previous_idGeometryA = previous_idGeometryA.data();
                 granData->previous_idGeometryB = previous_idGeometryB.data();
@@ -686,12 +928,13 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
             // dT potentially benefits from type-sorted contact array
             if (solverFlags.should_sort_pairs) {
                 size_t type_arr_bytes = (*scratchPad.pNumContacts) * sizeof(contact_t);
-                contact_t* contactType_sorted = (contact_t*)scratchPad.allocateTempVector(1, type_arr_bytes);
+                contact_t* contactType_sorted =
+                    (contact_t*)scratchPad.allocateTemp("contactType_sorted", type_arr_bytes);
                 size_t id_arr_bytes = (*scratchPad.pNumContacts) * sizeof(bodyID_t);
-                bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTempVector(2, id_arr_bytes);
-                bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTempVector(3, id_arr_bytes);
+                bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTemp("idA_sorted", id_arr_bytes);
+                bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTemp("idB_sorted", id_arr_bytes);
                 size_t cnt_arr_bytes = (*scratchPad.pNumContacts) * sizeof(contactPairs_t);
-                contactPairs_t* map_sorted = (contactPairs_t*)scratchPad.allocateTempVector(4, cnt_arr_bytes);
+                contactPairs_t* map_sorted = (contactPairs_t*)scratchPad.allocateTemp("map_sorted", cnt_arr_bytes);
 
                 cubDEMSortByKeys<contact_t, bodyID_t, DEMSolverStateData>(
                     granData->contactType, contactType_sorted, granData->idGeometryB, idB_sorted,
@@ -725,10 +968,11 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
         } else {  // If historyless, might still want to sort based on type
             if (solverFlags.should_sort_pairs) {
                 size_t type_arr_bytes = (*scratchPad.pNumContacts) * sizeof(contact_t);
-                contact_t* contactType_sorted = (contact_t*)scratchPad.allocateTempVector(1, type_arr_bytes);
+                contact_t* contactType_sorted =
+                    (contact_t*)scratchPad.allocateTemp("contactType_sorted", type_arr_bytes);
                 size_t id_arr_bytes = (*scratchPad.pNumContacts) * sizeof(bodyID_t);
-                bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTempVector(2, id_arr_bytes);
-                bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTempVector(3, id_arr_bytes);
+                bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTemp("idA_sorted", id_arr_bytes);
+                bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTemp("idB_sorted", id_arr_bytes);
 
                 cubDEMSortByKeys<contact_t, bodyID_t, DEMSolverStateData>(
                     granData->contactType, contactType_sorted, granData->idGeometryB, idB_sorted,
@@ -756,25 +1000,26 @@ void contactDetection(std::shared_ptr<jitify::Program>& bin_sphere_kernels,
 
 void overwritePrevContactArrays(DEMDataKT* kT_data,
                                 DEMDataDT* dT_data,
-                                std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryA,
-                                std::vector<bodyID_t, ManagedAllocator<bodyID_t>>& previous_idGeometryB,
-                                std::vector<contact_t, ManagedAllocator<contact_t>>& previous_contactType,
+                                std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& previous_idGeometryA,
+                                std::vector<bodyID_t, DEMEAllocator<bodyID_t>>& previous_idGeometryB,
+                                std::vector<contact_t, DEMEAllocator<contact_t>>& previous_contactType,
                                 DEMSimParams* simParams,
                                 DEMSolverStateData& scratchPad,
                                 cudaStream_t& this_stream,
                                 size_t nContacts) {
+    auto scratch_scope = scratchPad.tempScope("Contact array overwrite");
     // Copy to temp array for easier usage
-    bodyID_t* idA = (bodyID_t*)scratchPad.allocateTempVector(0, nContacts * sizeof(bodyID_t));
-    bodyID_t* idB = (bodyID_t*)scratchPad.allocateTempVector(1, nContacts * sizeof(bodyID_t));
-    contact_t* cType = (contact_t*)scratchPad.allocateTempVector(2, nContacts * sizeof(contact_t));
+    bodyID_t* idA = (bodyID_t*)scratchPad.allocateTemp("idA", nContacts * sizeof(bodyID_t));
+    bodyID_t* idB = (bodyID_t*)scratchPad.allocateTemp("idB", nContacts * sizeof(bodyID_t));
+    contact_t* cType = (contact_t*)scratchPad.allocateTemp("cType", nContacts * sizeof(contact_t));
     DEME_GPU_CALL(cudaMemcpy(idA, dT_data->idGeometryA, nContacts * sizeof(bodyID_t), cudaMemcpyDeviceToDevice));
     DEME_GPU_CALL(cudaMemcpy(idB, dT_data->idGeometryB, nContacts * sizeof(bodyID_t), cudaMemcpyDeviceToDevice));
     DEME_GPU_CALL(cudaMemcpy(cType, dT_data->contactType, nContacts * sizeof(contact_t), cudaMemcpyDeviceToDevice));
 
     // Prev contact arrays actually need to be sorted based on idA
-    bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTempVector(3, nContacts * sizeof(bodyID_t));
-    bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTempVector(4, nContacts * sizeof(bodyID_t));
-    contact_t* cType_sorted = (contact_t*)scratchPad.allocateTempVector(5, nContacts * sizeof(contact_t));
+    bodyID_t* idA_sorted = (bodyID_t*)scratchPad.allocateTemp("idA_sorted", nContacts * sizeof(bodyID_t));
+    bodyID_t* idB_sorted = (bodyID_t*)scratchPad.allocateTemp("idB_sorted", nContacts * sizeof(bodyID_t));
+    contact_t* cType_sorted = (contact_t*)scratchPad.allocateTemp("cType_sorted", nContacts * sizeof(contact_t));
     //// TODO: Why the CUB-based routine will just not run here? Is it related to when and where this method is called?
     /// I have to for now use the host to do the sorting.
     DEME_GPU_CALL(cudaMemcpy(idA_sorted, idA, nContacts * sizeof(bodyID_t), cudaMemcpyDeviceToDevice));
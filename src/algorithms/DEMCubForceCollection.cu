@@ -17,7 +17,7 @@
 
 namespace deme {
 
-void collectContactForcesThruCub(std::shared_ptr<jitify::Program>& collect_force_kernels,
+void collectContactForcesThruCub(std::shared_ptr<JitProgram>& collect_force_kernels,
                                  DEMDataDT* granData,
                                  const size_t nContactPairs,
                                  const size_t nClumps,
@@ -29,8 +29,8 @@ void collectContactForcesThruCub(std::shared_ptr<jitify::Program>& collect_force
     // if contactPairArr_isFresh is false, then this allocation should not alter the size and content of the temp array
     // space, so the information in it can be used in the next iteration.
     size_t cachedArraySizeOwner = (size_t)2 * nContactPairs * sizeof(bodyID_t);
-    // Use temp vector 0 to store the flattened owner IDs. So the rest of the temp arrays start from number 1.
-    bodyID_t* idAOwner = (bodyID_t*)scratchPad.allocateTempVector(0, cachedArraySizeOwner);
+    // The flattened owner IDs are kept between calls, so they are in a retained vector, not a temp array
+    bodyID_t* idAOwner = (bodyID_t*)scratchPad.allocateRetained("idOwner", cachedArraySizeOwner);
     bodyID_t* idBOwner = (bodyID_t*)(idAOwner + nContactPairs);
     // size_t cachedArraySizeMass = (size_t)2 * nContactPairs * sizeof(float);
     // size_t cachedArraySizeMOI = (size_t)2 * nContactPairs * sizeof(float3);
@@ -70,15 +70,16 @@ void collectContactForcesThruCub(std::shared_ptr<jitify::Program>& collect_force
     size_t tempArraySizeAcc_sorted = (size_t)2 * nContactPairs * sizeof(float3);
     size_t tempArraySizeOwnerAcc = (size_t)nClumps * sizeof(float3);
     size_t tempArraySizeOwner = (size_t)nClumps * sizeof(bodyID_t);
-    float3* acc_A = (float3*)scratchPad.allocateTempVector(1, tempArraySizeAcc);
+    auto scratch_scope = scratchPad.tempScope("Force collection");
+    float3* acc_A = (float3*)scratchPad.allocateTemp("acc_A", tempArraySizeAcc);
     float3* acc_B = (float3*)(acc_A + nContactPairs);
-    float3* acc_A_sorted = (float3*)scratchPad.allocateTempVector(2, tempArraySizeAcc_sorted);
+    float3* acc_A_sorted = (float3*)scratchPad.allocateTemp("acc_A_sorted", tempArraySizeAcc_sorted);
     // float3* acc_B_sorted = (float3*)(acc_A_sorted  + nContactPairs);
-    bodyID_t* idAOwner_sorted = (bodyID_t*)scratchPad.allocateTempVector(3, cachedArraySizeOwner);
+    bodyID_t* idAOwner_sorted = (bodyID_t*)scratchPad.allocateTemp("idAOwner_sorted", cachedArraySizeOwner);
     // bodyID_t* idBOwner_sorted = (bodyID_t*)(idAOwner_sorted + nContactPairs);
-    float3* accOwner = (float3*)scratchPad.allocateTempVector(
-        4, tempArraySizeOwnerAcc);  // can store both linear and angular acceleration
-    bodyID_t* uniqueOwner = (bodyID_t*)scratchPad.allocateTempVector(5, tempArraySizeOwner);
+    float3* accOwner = (float3*)scratchPad.allocateTemp(
+        "accOwner", tempArraySizeOwnerAcc);  // can store both linear and angular acceleration
+    bodyID_t* uniqueOwner = (bodyID_t*)scratchPad.allocateTemp("uniqueOwner", tempArraySizeOwner);
     // Collect accelerations for body A (modifier used to be h * h / l when we stored acc as h^2*acc)
     // NOTE!! If you pass floating point number to kernels, the number needs to be something like 1.f, not 1.0.
     // Somtimes 1.0 got converted to 0.f with the kernel call.
@@ -0,0 +1,318 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// The deme_bench suite: micro-benchmarks of the host-side paths the solver
+// depends on (kernel source substitution, CSV clump input, Wavefront mesh
+// loading, samplers, voxel ID decoding, sorting and CSV output formatting).
+// Nothing here runs on a GPU, and it is built against the host-only sources
+// alone, so it can be configured without CUDA (DEME_BUILD_BENCH_ONLY). Results
+// are printed as a table, and optionally written as JSON so they can be
+// tracked across versions.
+// Usage: deme_bench [--reps N] [--json <output file>]
+// =============================================================================
+
+#include <core/ApiVersion.h>
+#include <core/utils/DEMEPaths.h>
+#include <core/utils/JitSubstitution.h>
+#include <core/utils/MappedFile.hpp>
+#include <core/utils/RuntimeData.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+#include <DEM/utils/BinaryFrame.hpp>
+#include <DEM/utils/ClumpCsv.hpp>
+#include <DEM/utils/WavefrontObj.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace deme;
+
+namespace {
+
+struct BenchResult {
+    std::string name;
+    size_t items;  // Work items (rows, points, bytes...) processed per repetition
+    int reps;
+    double seconds;  // Total over all repetitions
+};
+
+// Keep a checksum of the outputs around so the work cannot be optimized away
+size_t checksum = 0;
+
+template <typename Func>
+BenchResult timeIt(const std::string& name, size_t items, int reps, Func&& func) {
+    // One untimed pass to warm up caches and the file system
+    func();
+    auto start = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < reps; rep++) {
+        func();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return {name, items, reps, seconds};
+}
+
+std::string readFile(const std::filesystem::path& file) {
+    std::ifstream input(file);
+    return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+// A clump output file of n_rows rows, in the format this solver writes
+void writeClumpCsv(const std::filesystem::path& file, size_t n_rows) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    OutputFrame frame(n_rows);
+    std::vector<uint32_t> type_idx(n_rows);
+    std::vector<float> cols[7];
+    for (auto& col : cols) {
+        col.resize(n_rows);
+    }
+    for (size_t i = 0; i < n_rows; i++) {
+        type_idx[i] = i % 4;
+        for (auto& col : cols) {
+            col[i] = dist(gen);
+        }
+    }
+    frame.AddStringColumn(OUTPUT_FILE_CLUMP_TYPE_NAME, {"Clump_0", "Clump_1", "Clump_2", "Clump_3"}, type_idx);
+    const std::string names[7] = {OUTPUT_FILE_X_COL_NAME,  OUTPUT_FILE_Y_COL_NAME,  OUTPUT_FILE_Z_COL_NAME,
+                                  OUTPUT_FILE_QW_COL_NAME, OUTPUT_FILE_QX_COL_NAME, OUTPUT_FILE_QY_COL_NAME,
+                                  OUTPUT_FILE_QZ_COL_NAME};
+    for (int j = 0; j < 7; j++) {
+        frame.AddColumn(names[j], cols[j]);
+    }
+    std::ofstream out(file);
+    frame.WriteCsv(out);
+}
+
+void writeJson(const std::string& file, const std::vector<BenchResult>& results) {
+    std::ofstream out(file);
+    out << "{\n";
+    out << "  \"deme_version\": \"" << DEME_VERSION_MAJOR << "." << DEME_VERSION_MINOR << "." << DEME_VERSION_PATCH
+        << "\",\n";
+    out << "  \"precision_policy\": \"" << DEME_PRECISION_POLICY_NAME << "\",\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& res = results[i];
+        out << "    {\"name\": \"" << res.name << "\", \"items\": " << res.items << ", \"repetitions\": " << res.reps
+            << ", \"seconds_per_rep\": " << res.seconds / res.reps
+            << ", \"items_per_second\": " << (double)res.items * res.reps / res.seconds << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int n_reps = 5;
+    std::string json_file;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            n_reps = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_file = argv[++i];
+        } else {
+            printf("Usage: %s [--reps N] [--json <output file>]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (n_reps < 1) {
+        n_reps = 1;
+    }
+
+    std::filesystem::path work_dir = std::filesystem::temp_directory_path() / "deme_bench";
+    std::filesystem::create_directories(work_dir);
+    std::vector<BenchResult> results;
+
+    // Jitify source substitution, over all shipped kernels with a substitution map like the solver builds
+    {
+        std::vector<std::string> sources;
+        size_t total_bytes = 0;
+        const std::filesystem::path kernel_dir = RuntimeDataHelper::data_path / "kernel";
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(kernel_dir)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".cu") {
+                sources.push_back(readFile(entry.path()));
+                total_bytes += sources.back().size();
+            }
+        }
+        std::unordered_map<std::string, std::string> substitutions;
+        std::regex placeholder("\\b_[A-Za-z0-9]+_\\b");
+        for (const auto& code : sources) {
+            for (auto it = std::sregex_iterator(code.begin(), code.end(), placeholder); it != std::sregex_iterator();
+                 ++it) {
+                substitutions[it->str()] = std::string(16 * 14, '0');
+            }
+        }
+        results.push_back(timeIt("jit_substitution", total_bytes, n_reps, [&]() {
+            for (const auto& code : sources) {
+                checksum += ExpandJitSubstitutions(code, substitutions).size();
+            }
+        }));
+    }
+
+    // Clump CSV input
+    {
+        const size_t n_rows = 500000;
+        std::filesystem::path csv_file = work_dir / "clumps.csv";
+        writeClumpCsv(csv_file, n_rows);
+        results.push_back(timeIt("read_clump_xyz_from_csv", n_rows, n_reps, [&]() {
+            auto clump_xyz = ReadClumpFloat3FromCsvFile(csv_file.string(), OUTPUT_FILE_X_COL_NAME,
+                                                        OUTPUT_FILE_Y_COL_NAME, OUTPUT_FILE_Z_COL_NAME,
+                                                        OUTPUT_FILE_CLUMP_TYPE_NAME);
+            checksum += clump_xyz.size();
+        }));
+        results.push_back(timeIt("read_clump_xyz_quat_from_csv", n_rows, n_reps, [&]() {
+            std::unordered_map<std::string, std::vector<float3>> clump_xyz;
+            std::unordered_map<std::string, std::vector<float4>> clump_quat;
+            ReadClumpXyzQuatFromCsvFile(csv_file.string(), clump_xyz, clump_quat);
+            checksum += clump_xyz.size() + clump_quat.size();
+        }));
+        std::filesystem::remove(csv_file);
+    }
+
+    // Wavefront mesh loading, of the largest mesh shipped
+    {
+        const std::string mesh_file = GetDEMEDataFile("mesh/excavator.obj");
+        size_t n_bytes = std::filesystem::file_size(mesh_file);
+        results.push_back(timeIt("load_wavefront_mesh", n_bytes, n_reps, [&]() {
+            MappedFile file(mesh_file);
+            checksum += ParseWavefrontObj(file.data(), file.data() + file.size()).face_v_indices.size();
+        }));
+    }
+
+    // Samplers, filling the same box
+    {
+        const float3 center = make_float3(0, 0, 0);
+        const float3 half_dim = make_float3(1.f, 1.f, 1.f);
+        const float separation = 0.04f;
+        // Each repetition must produce the full point set, or the points/s figure means nothing
+        auto checkCount = [](const std::string& name, size_t got, size_t expected) {
+            if (got != expected) {
+                throw std::runtime_error(name + " produced " + std::to_string(got) + " points in a repetition, " +
+                                         std::to_string(expected) + " expected.");
+            }
+            checksum += got;
+        };
+        // A fresh PD sampler per repetition, so every run starts from the same seed
+        size_t n_points = PDSampler(separation).SampleBox(center, half_dim).size();
+        results.push_back(timeIt("pd_sampler", n_points, n_reps, [&]() {
+            PDSampler pd_sampler(separation);
+            checkCount("pd_sampler", pd_sampler.SampleBox(center, half_dim).size(), n_points);
+        }));
+        HCPSampler hcp_sampler(separation);
+        n_points = hcp_sampler.SampleBox(center, half_dim).size();
+        results.push_back(timeIt("hcp_sampler", n_points, n_reps, [&]() {
+            checkCount("hcp_sampler", hcp_sampler.SampleBox(center, half_dim).size(), n_points);
+        }));
+        GridSampler grid_sampler(separation);
+        n_points = grid_sampler.SampleBox(center, half_dim).size();
+        results.push_back(timeIt("grid_sampler", n_points, n_reps, [&]() {
+            checkCount("grid_sampler", grid_sampler.SampleBox(center, half_dim).size(), n_points);
+        }));
+    }
+
+    // Voxel ID decoding, as done for every owner when output is gathered
+    {
+        const size_t n = 4000000;
+        const unsigned char nvXp2 = 21, nvYp2 = 21;
+        std::mt19937_64 gen(42);
+        std::vector<voxelID_t> ids(n);
+        std::vector<subVoxelPos_t> locs(3 * n);
+        for (size_t i = 0; i < n; i++) {
+            ids[i] = gen() >> 1;
+            locs[3 * i] = (subVoxelPos_t)gen();
+            locs[3 * i + 1] = (subVoxelPos_t)gen();
+            locs[3 * i + 2] = (subVoxelPos_t)gen();
+        }
+        results.push_back(timeIt("host_voxel_id_to_position", n, n_reps, [&]() {
+            double sum = 0.;
+            for (size_t i = 0; i < n; i++) {
+                double X, Y, Z;
+                hostVoxelIDToPosition<double, voxelID_t, subVoxelPos_t>(X, Y, Z, ids[i], locs[3 * i], locs[3 * i + 1],
+                                                                        locs[3 * i + 2], nvXp2, nvYp2, 1e-3, 1e-8);
+                sum += X + Y + Z;
+            }
+            checksum += (size_t)sum;
+        }));
+    }
+
+    // Sorting
+    {
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<float> dist(0.f, 1.f);
+        const size_t n_indices = 2000000;
+        std::vector<float> keys(n_indices);
+        for (auto& key : keys) {
+            key = dist(gen);
+        }
+        results.push_back(timeIt("host_sort_indices", n_indices, n_reps,
+                                 [&]() { checksum += hostSortIndices(keys)[0]; }));
+        // hostSortByKey is meant for short arrays
+        const size_t n_by_key = 4096;
+        std::vector<float> short_keys(keys.begin(), keys.begin() + n_by_key);
+        std::vector<float> keys_copy(n_by_key);
+        std::vector<unsigned int> vals(n_by_key);
+        results.push_back(timeIt("host_sort_by_key", n_by_key, n_reps, [&]() {
+            keys_copy = short_keys;
+            std::iota(vals.begin(), vals.end(), 0);
+            hostSortByKey(keys_copy.data(), vals.data(), n_by_key);
+            checksum += vals[0];
+        }));
+    }
+
+    // CSV output formatting, of a clump frame
+    {
+        const size_t n_rows = 500000;
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<float> dist(-1.f, 1.f);
+        OutputFrame frame(n_rows);
+        std::vector<uint32_t> type_idx(n_rows);
+        std::vector<float> col(n_rows);
+        for (size_t i = 0; i < n_rows; i++) {
+            type_idx[i] = i % 4;
+        }
+        frame.AddStringColumn(OUTPUT_FILE_CLUMP_TYPE_NAME, {"Clump_0", "Clump_1", "Clump_2", "Clump_3"}, type_idx);
+        for (const auto& name : {OUTPUT_FILE_X_COL_NAME, OUTPUT_FILE_Y_COL_NAME, OUTPUT_FILE_Z_COL_NAME,
+                                 OUTPUT_FILE_QW_COL_NAME, OUTPUT_FILE_QX_COL_NAME, OUTPUT_FILE_QY_COL_NAME,
+                                 OUTPUT_FILE_QZ_COL_NAME}) {
+            for (auto& val : col) {
+                val = dist(gen);
+            }
+            frame.AddColumn(name, col);
+        }
+        results.push_back(timeIt("output_frame_write_csv", n_rows, n_reps, [&]() {
+            std::ostringstream out;
+            frame.WriteCsv(out);
+            checksum += out.tellp();
+        }));
+    }
+
+    std::filesystem::remove_all(work_dir);
+
+    printf("%-32s %12s %14s %16s\n", "benchmark", "items", "ms per rep", "items per sec");
+    for (const auto& res : results) {
+        printf("%-32s %12zu %14.3f %16.4g\n", res.name.c_str(), res.items, res.seconds * 1e3 / res.reps,
+               (double)res.items * res.reps / res.seconds);
+    }
+    printf("(checksum %zu)\n", checksum);
+    if (!json_file.empty()) {
+        writeJson(json_file, results);
+        printf("Results written to %s\n", json_file.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,117 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// Micro-benchmark of the string substitution step of kernel jitification. It
+// runs every shipped kernel file through both the old approach (one regex
+// replacement over the whole source per substitution key) and the single-pass
+// placeholder expander that JitHelper::buildProgram now uses, checks that the
+// results match, and reports the time each takes. No GPU is needed.
+// Usage: DEMbench_JitSubstitution [number of repetitions]
+// =============================================================================
+
+#include <core/utils/JitHelper.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <regex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+std::string regexSubstitute(std::string code, const std::unordered_map<std::string, std::string>& substitutions) {
+    for (const auto& subst : substitutions) {
+        code = std::regex_replace(code, std::regex(subst.first), subst.second);
+    }
+    return code;
+}
+
+std::string readFile(const std::filesystem::path& file) {
+    std::ifstream input(file);
+    return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int n_reps = (argc > 1) ? std::atoi(argv[1]) : 20;
+    if (n_reps < 1) {
+        n_reps = 1;
+    }
+
+    // All shipped kernels, the customizable policies included
+    std::vector<std::string> sources;
+    size_t total_bytes = 0;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(JitHelper::KERNEL_DIR)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".cu") {
+            sources.push_back(readFile(entry.path()));
+            total_bytes += sources.back().size();
+        }
+    }
+    if (sources.empty()) {
+        printf("No kernel files found in %s\n", JitHelper::KERNEL_DIR.string().c_str());
+        return 1;
+    }
+
+    // Mimic the substitution map the solver builds: every stand-alone placeholder that appears in the kernels (not
+    // pieces of identifiers like DEME_NUM_SPHERES_PER_CD_BATCH), plus a value of a typical length (jitified arrays and
+    // strategies are often hundreds of chars)
+    std::unordered_map<std::string, std::string> substitutions;
+    std::regex placeholder("\\b_[A-Za-z0-9]+_\\b");
+    for (const auto& code : sources) {
+        for (auto it = std::sregex_iterator(code.begin(), code.end(), placeholder); it != std::sregex_iterator();
+             ++it) {
+            substitutions[it->str()] = "";
+        }
+    }
+    for (auto& subst : substitutions) {
+        for (int i = 0; i < 16; i++) {
+            subst.second += "0.123456789f, ";
+        }
+    }
+    printf("%zu kernel files (%zu bytes), %zu substitution keys, %d repetitions\n", sources.size(), total_bytes,
+           substitutions.size(), n_reps);
+
+    size_t mismatches = 0;
+    for (const auto& code : sources) {
+        if (regexSubstitute(code, substitutions) != JitHelper::expandSubstitutions(code, substitutions)) {
+            mismatches++;
+        }
+    }
+    if (mismatches > 0) {
+        printf("ERROR: %zu kernel files are substituted differently by the 2 approaches\n", mismatches);
+        return 1;
+    }
+
+    // Keep a checksum of the outputs around so the work cannot be optimized away
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < n_reps; rep++) {
+        for (const auto& code : sources) {
+            checksum += regexSubstitute(code, substitutions).size();
+        }
+    }
+    double regex_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (int rep = 0; rep < n_reps; rep++) {
+        for (const auto& code : sources) {
+            checksum += JitHelper::expandSubstitutions(code, substitutions).size();
+        }
+    }
+    double expand_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("Regex per key:     %.3f ms per pass over all kernels\n", regex_time * 1e3 / n_reps);
+    printf("Single-pass:       %.3f ms per pass over all kernels\n", expand_time * 1e3 / n_reps);
+    printf("Speedup:           %.1fx\n", regex_time / expand_time);
+    printf("(checksum %zu)\n", checksum);
+    return 0;
+}
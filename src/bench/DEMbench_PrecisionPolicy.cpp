@@ -0,0 +1,86 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// Benchmark of the precision policy the solver is built with (the
+// DEME_PRECISION_POLICY CMake option: FAST, MIXED or ACCURATE). A box of
+// spheres settles under gravity; the steps taken per second are reported next
+// to the bound on position error this policy implies, which is the storage
+// resolution plus the rounding of the coordinates contact detection works in.
+// Build it once per policy to compare them.
+// Usage: DEMbench_PrecisionPolicy [number of spheres per side] [number of steps]
+// =============================================================================
+
+#include <core/ApiVersion.h>
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+using namespace deme;
+
+int main(int argc, char* argv[]) {
+    int n_per_side = (argc > 1) ? std::atoi(argv[1]) : 40;
+    int n_steps = (argc > 2) ? std::atoi(argv[2]) : 2000;
+    if (n_per_side < 2) {
+        n_per_side = 2;
+    }
+    if (n_steps < 1) {
+        n_steps = 1;
+    }
+
+    DEMSolver DEMSim;
+    DEMSim.SetVerbosity("ERROR");
+    DEMSim.SetNoForceRecord();
+
+    auto mat_type = DEMSim.LoadMaterial({{"E", 1e8}, {"nu", 0.3}, {"CoR", 0.5}, {"mu", 0.3}, {"Crr", 0.0}});
+    const float radius = 0.01;
+    auto sph_type = DEMSim.LoadSphereType(radius * radius * radius * 4.18879 * 2.6e3, radius, mat_type);
+
+    const float spacing = 2.02 * radius;
+    const float half_width = 0.5 * spacing * n_per_side;
+    GridSampler sampler(spacing);
+    const float fill_half_width = half_width - radius;
+    auto input_xyz = sampler.SampleBox(make_float3(0, 0, half_width),
+                                       make_float3(fill_half_width, fill_half_width, fill_half_width));
+    DEMSim.AddClumps(sph_type, input_xyz);
+
+    const float box_size = 2.f * half_width + 4.f * radius;
+    DEMSim.InstructBoxDomainDimension({-box_size / 2, box_size / 2}, {-box_size / 2, box_size / 2},
+                                      {-2.f * radius, 2.f * half_width + 2.f * radius});
+    DEMSim.InstructBoxDomainBoundingBC("top_open", mat_type);
+    DEMSim.SetInitTimeStep(2e-5);
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.81));
+    DEMSim.SetMaxVelocity(5.);
+    DEMSim.Initialize();
+
+    // Let the initial transients pass before timing
+    DEMSim.DoDynamicsThenSync(200 * DEMSim.GetTimeStepSize());
+
+    auto start = std::chrono::steady_clock::now();
+    DEMSim.DoDynamicsThenSync(n_steps * DEMSim.GetTimeStepSize());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // A position is stored to within one length unit per component. Contact detection then works in cdPos_t on
+    // positions measured from the corner of the world, which is at most twice the enlarged box in size.
+    const double length_unit = DEMSim.GetLengthUnit();
+    const double world_extent = 2. * (1. + DEFAULT_BOX_DOMAIN_ENLARGE_RATIO) * box_size;
+    const double cd_rounding = 0.5 * std::numeric_limits<cdPos_t>::epsilon() * world_extent;
+
+    printf("Precision policy:        %s (subVoxelPos_t %zu bytes, cdPos_t %zu bytes)\n",
+           DEME_PRECISION_POLICY_NAME, sizeof(subVoxelPos_t), sizeof(cdPos_t));
+    printf("Spheres:                 %zu\n", DEMSim.GetNumClumps());
+    printf("Contacts (last step):    %zu\n", DEMSim.GetNumContacts());
+    printf("Steps per second:        %.1f\n", n_steps / seconds);
+    printf("Sphere-steps per second: %.4g\n", (double)DEMSim.GetNumClumps() * n_steps / seconds);
+    printf("Length unit:             %.4g\n", length_unit);
+    printf("Position error bound:    %.4g (%.4g of the sphere radius)\n", length_unit + cd_rounding,
+           (length_unit + cd_rounding) / radius);
+    return 0;
+}
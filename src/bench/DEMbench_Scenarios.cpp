@@ -0,0 +1,428 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// =============================================================================
+// End-to-end scenario benchmarks, for comparing throughput when tuning the
+// contact detection frequency, bin size and integrator. The scenarios are
+// modelled on the repose, rotating drum, hopper and mixer demos, but filled
+// with spheres whose number and size spread are given on the command line.
+// Each run simulates a fixed amount of time and reports the wall time,
+// particle-steps per second, contacts per step, the kT and dT timer breakdowns
+// and the peak device memory (over the synced sample points), as a table and
+// optionally as JSON.
+// Usage: DEMbench_Scenarios [--scenario repose|drum|hopper|mixer|all] [--num N]
+//        [--poly r_max/r_min] [--time T] [--step h] [--cd-freq F]
+//        [--bin-size S] [--integrator I] [--json <output file>]
+// =============================================================================
+
+#include <core/ApiVersion.h>
+#include <DEM/API.h>
+#include <DEM/HostSideHelpers.hpp>
+#include <DEM/utils/Samplers.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace deme;
+
+namespace {
+
+struct ScenarioConfig {
+    std::string scenario;
+    size_t num_particles = 20000;
+    // Ratio of the largest to the smallest particle radius; 1 means monodisperse
+    float polydispersity = 1.f;
+    double sim_time = 0.2;
+    // Zero or negative means the scenario's own default, or the solver's
+    double step_size = 0.;
+    int cd_freq = 0;
+    double bin_size = 0.;
+    std::string integrator;
+};
+
+struct ScenarioResult {
+    ScenarioConfig config;
+    size_t num_particles;
+    size_t num_steps;
+    size_t num_cd;
+    double wall_seconds;
+    double avg_contacts;
+    size_t peak_mem_bytes;
+    std::vector<std::string> kT_timer_names, dT_timer_names;
+    std::vector<double> kT_timer_vals, dT_timer_vals;
+};
+
+// Number of sphere sizes the polydisperse fill uses
+const int NUM_SIZES = 5;
+// The contact count and memory usage are sampled this many times over a run
+const int NUM_SAMPLES = 20;
+
+// Grid spacing that puts about num_particles points in a region of the given volume
+float fillSpacing(double volume, size_t num_particles) {
+    return (float)std::cbrt(volume / (double)num_particles);
+}
+
+// Sphere templates with radii evenly spread between r_max / polydispersity and r_max
+std::vector<std::shared_ptr<DEMClumpTemplate>> loadFillTypes(DEMSolver& DEMSim,
+                                                             float r_max,
+                                                             float polydispersity,
+                                                             const std::shared_ptr<DEMMaterial>& mat,
+                                                             float density = 2.6e3) {
+    std::vector<std::shared_ptr<DEMClumpTemplate>> types;
+    int num_sizes = (polydispersity > 1.f) ? NUM_SIZES : 1;
+    for (int i = 0; i < num_sizes; i++) {
+        float frac = (num_sizes > 1) ? (float)i / (num_sizes - 1) : 0.f;
+        float radius = r_max * (1.f - (1.f - 1.f / polydispersity) * frac);
+        float mass = density * 4. / 3. * PI * radius * radius * radius;
+        types.push_back(DEMSim.LoadSphereType(mass, radius, mat));
+    }
+    return types;
+}
+
+// Add at most num_particles of the sampled points, cycling through the templates
+size_t addFill(DEMSolver& DEMSim,
+               const std::vector<std::shared_ptr<DEMClumpTemplate>>& types,
+               std::vector<float3> xyz,
+               size_t num_particles) {
+    if (xyz.size() > num_particles) {
+        xyz.resize(num_particles);
+    }
+    std::vector<std::shared_ptr<DEMClumpTemplate>> input_types(xyz.size());
+    for (size_t i = 0; i < xyz.size(); i++) {
+        input_types[i] = types.at(i % types.size());
+    }
+    DEMSim.AddClumps(input_types, xyz);
+    return xyz.size();
+}
+
+// Particles pour through a funnel and form a pile
+size_t buildRepose(DEMSolver& DEMSim, const ScenarioConfig& cfg) {
+    auto mat_type_walls = DEMSim.LoadMaterial({{"E", 1e8}, {"nu", 0.3}, {"CoR", 0.3}, {"mu", 1}});
+    auto mat_type_particles = DEMSim.LoadMaterial({{"E", 1e9}, {"nu", 0.3}, {"CoR", 0.7}, {"mu", 1}});
+    DEMSim.SetMaterialPropertyPair("CoR", mat_type_walls, mat_type_particles, 0.3);
+
+    auto funnel = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/funnel.obj"), mat_type_walls);
+    funnel->Scale(0.15);
+    const float funnel_bottom = 0.f;
+
+    const float fill_radius = 5.f;
+    const float fill_height = 10.f;
+    float spacing = fillSpacing(PI * fill_radius * fill_radius * fill_height, cfg.num_particles);
+    auto types = loadFillTypes(DEMSim, 0.45f * spacing, cfg.polydispersity, mat_type_particles);
+    GridSampler sampler(spacing);
+    auto xyz = sampler.SampleCylinderZ(make_float3(0, 0, funnel_bottom + fill_radius + fill_height / 2),
+                                       fill_radius - spacing, fill_height / 2);
+    size_t num_filled = addFill(DEMSim, types, xyz, cfg.num_particles);
+
+    DEMSim.InstructBoxDomainDimension({-10, 10}, {-10, 10}, {funnel_bottom - 10.f, funnel_bottom + 20.f});
+    DEMSim.InstructBoxDomainBoundingBC("top_open", mat_type_walls);
+    DEMSim.SetInitTimeStep(5e-6);
+    DEMSim.SetMaxVelocity(25.);
+    return num_filled;
+}
+
+// Particles tumble in a drum (a big clump) rotating about X
+size_t buildDrum(DEMSolver& DEMSim, const ScenarioConfig& cfg) {
+    DEMSim.DisableJitifyClumpTemplates();
+    auto mat_type_sand = DEMSim.LoadMaterial({{"E", 1e9}, {"nu", 0.3}, {"CoR", 0.6}, {"mu", 0.4}, {"Crr", 0.01}});
+    auto mat_type_drum = DEMSim.LoadMaterial({{"E", 2e9}, {"nu", 0.3}, {"CoR", 0.6}, {"mu", 0.8}, {"Crr", 0.01}});
+    DEMSim.SetMaterialPropertyPair("mu", mat_type_sand, mat_type_drum, 0.8);
+
+    const float CylRad = 2.0;
+    const float CylHeight = 1.0;
+    const float CylMass = 1.0;
+    const float CylParticleRad = 0.05;
+    float IXX = CylMass * CylRad * CylRad;
+    float IYY = (CylMass / 12) * (3 * CylRad * CylRad + CylHeight * CylHeight);
+    auto Drum_particles = DEMCylSurfSampler(make_float3(0), make_float3(1, 0, 0), CylRad, CylHeight, CylParticleRad);
+    auto Drum_template =
+        DEMSim.LoadClumpType(CylMass, make_float3(IXX, IYY, IYY),
+                             std::vector<float>(Drum_particles.size(), CylParticleRad), Drum_particles, mat_type_drum);
+
+    const float safe_delta = 0.03;
+    const float3 fill_half_dim = make_float3(CylHeight / 2.0 - 3.0 * safe_delta, CylRad / 1.5, CylRad / 1.5);
+    float spacing = fillSpacing(8. * fill_half_dim.x * fill_half_dim.y * fill_half_dim.z, cfg.num_particles);
+    auto types = loadFillTypes(DEMSim, 0.45f * spacing, cfg.polydispersity, mat_type_sand);
+    GridSampler sampler(spacing);
+    size_t num_filled = addFill(DEMSim, types, sampler.SampleBox(make_float3(0), fill_half_dim), cfg.num_particles);
+
+    auto Drum = DEMSim.AddClumps(Drum_template, make_float3(0));
+    const unsigned int drum_family = 100;
+    Drum->SetFamilies(drum_family);
+    DEMSim.SetFamilyPrescribedAngVel(drum_family, "3.14159", "0", "0");
+    DEMSim.DisableContactBetweenFamilies(drum_family, drum_family);
+    auto planes = DEMSim.AddExternalObject();
+    planes->AddPlane(make_float3(CylHeight / 2. - safe_delta, 0, 0), make_float3(-1, 0, 0), mat_type_drum);
+    planes->AddPlane(make_float3(-CylHeight / 2. + safe_delta, 0, 0), make_float3(1, 0, 0), mat_type_drum);
+    planes->SetFamily(drum_family);
+
+    DEMSim.InstructBoxDomainDimension(5, 5, 5);
+    DEMSim.SetInitTimeStep(5e-6);
+    DEMSim.SetMaxVelocity(10.);
+    return num_filled;
+}
+
+// Particles discharge from a flat-bottomed hopper through a gate that slides away
+size_t buildHopper(DEMSolver& DEMSim, const ScenarioConfig& cfg) {
+    auto mat_type_flume = DEMSim.LoadMaterial({{"E", 10e9}, {"nu", 0.3}, {"CoR", 0.60}});
+    auto mat_type_walls = DEMSim.LoadMaterial({{"E", 10e9}, {"nu", 0.3}, {"CoR", 0.60}});
+    auto mat_spheres = DEMSim.LoadMaterial({{"E", 1.0e7}, {"nu", 0.35}, {"CoR", 0.85}, {"mu", 0.40}, {"Crr", 0.04}});
+    DEMSim.SetMaterialPropertyPair("CoR", mat_type_walls, mat_spheres, 0.7);
+    DEMSim.SetMaterialPropertyPair("Crr", mat_type_walls, mat_spheres, 0.05);
+    DEMSim.SetMaterialPropertyPair("mu", mat_type_walls, mat_spheres, 0.30);
+    DEMSim.SetMaterialPropertyPair("CoR", mat_type_flume, mat_spheres, 0.70);
+    DEMSim.SetMaterialPropertyPair("Crr", mat_type_flume, mat_spheres, 0.05);
+    DEMSim.SetMaterialPropertyPair("mu", mat_type_flume, mat_spheres, 0.30);
+
+    const double hopperW = 0.04;
+    const double gateWidth = 0.1295;
+    const double gateSpeed = -3.5;
+    const float4 rot = make_float4(0.7071, 0, 0, 0.7071);
+    auto fixed_left = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/funnel_left.obj"), mat_type_flume);
+    fixed_left->Move(make_float3(-hopperW / 2.0, 0, -0.01), rot);
+    auto fixed_right = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/funnel_left.obj"), mat_type_flume);
+    fixed_right->Move(make_float3(gateWidth + hopperW / 2.0, 0, -0.01), rot);
+    auto gate = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/funnel_left.obj"), mat_type_flume);
+    gate->Move(make_float3(gateWidth / 2, 0, -0.011), rot);
+    fixed_left->SetFamily(10);
+    fixed_right->SetFamily(10);
+    gate->SetFamily(4);
+    DEMSim.SetFamilyFixed(10);
+    DEMSim.SetFamilyPrescribedLinVel(4, "0", "0", to_string_with_precision(gateSpeed));
+
+    const float plane_bottom = 0.02f;
+    const float3 fill_half_dim = make_float3(0.1, 0.02, 0.1);
+    float spacing = fillSpacing(8. * fill_half_dim.x * fill_half_dim.y * fill_half_dim.z, cfg.num_particles);
+    auto types = loadFillTypes(DEMSim, 0.45f * spacing, cfg.polydispersity, mat_spheres, 1592);
+    GridSampler sampler(spacing);
+    auto xyz = sampler.SampleBox(make_float3(0, 0, plane_bottom + spacing + fill_half_dim.z),
+                                 fill_half_dim - make_float3(spacing / 2, spacing / 2, 0));
+    size_t num_filled = addFill(DEMSim, types, xyz, cfg.num_particles);
+
+    DEMSim.InstructBoxDomainDimension({-0.10, 0.10}, {-0.02, 0.02}, {-0.50, 1.0});
+    DEMSim.InstructBoxDomainBoundingBC("top_open", mat_type_walls);
+    DEMSim.SetInitTimeStep(5e-6);
+    DEMSim.SetMaxVelocity(25.);
+    return num_filled;
+}
+
+// Particles are stirred by a rotating mesh blade in a cylindrical chamber
+size_t buildMixer(DEMSolver& DEMSim, const ScenarioConfig& cfg) {
+    auto mat_type_mixer = DEMSim.LoadMaterial({{"E", 1e8}, {"nu", 0.3}, {"CoR", 0.6}, {"mu", 0.5}, {"Crr", 0.0}});
+    auto mat_type_granular = DEMSim.LoadMaterial({{"E", 1e8}, {"nu", 0.3}, {"CoR", 0.6}, {"mu", 0.2}, {"Crr", 0.0}});
+    DEMSim.SetMaterialPropertyPair("mu", mat_type_mixer, mat_type_granular, 0.5);
+
+    const double world_size = 1;
+    const float chamber_height = world_size / 3.;
+    const float fill_height = chamber_height;
+    const float chamber_bottom = -world_size / 2.;
+    const float fill_bottom = chamber_bottom + chamber_height;
+    DEMSim.InstructBoxDomainDimension(world_size, world_size, world_size);
+    DEMSim.InstructBoxDomainBoundingBC("all", mat_type_granular);
+    auto walls = DEMSim.AddExternalObject();
+    walls->AddCylinder(make_float3(0), make_float3(0, 0, 1), world_size / 2., mat_type_mixer, 0);
+
+    auto mixer = DEMSim.AddWavefrontMeshObject(GetDEMEDataFile("mesh/internal_mixer.obj"), mat_type_mixer);
+    mixer->Scale(make_float3(world_size / 2, world_size / 2, chamber_height));
+    mixer->SetFamily(10);
+    mixer->SetInitPos(make_float3(0, 0, chamber_bottom + chamber_height / 2.0));
+    DEMSim.SetFamilyPrescribedAngVel(10, "0", "0", "3.14159");
+
+    const float fill_radius = world_size / 2.;
+    float spacing = fillSpacing(PI * fill_radius * fill_radius * fill_height, cfg.num_particles);
+    auto types = loadFillTypes(DEMSim, 0.45f * spacing, cfg.polydispersity, mat_type_granular);
+    GridSampler sampler(spacing);
+    auto xyz = sampler.SampleCylinderZ(make_float3(0, 0, fill_bottom + fill_height / 2), fill_radius - spacing,
+                                       fill_height / 2);
+    size_t num_filled = addFill(DEMSim, types, xyz, cfg.num_particles);
+
+    DEMSim.SetInitTimeStep(5e-6);
+    DEMSim.SetCDUpdateFreq(40);
+    DEMSim.SetExpandSafetyAdder(2.0);
+    return num_filled;
+}
+
+ScenarioResult runScenario(const ScenarioConfig& cfg) {
+    DEMSolver DEMSim;
+    DEMSim.SetVerbosity("ERROR");
+    DEMSim.SetNoForceRecord();
+    DEMSim.SetGravitationalAcceleration(make_float3(0, 0, -9.81));
+
+    // Only the fill counts toward the throughput; walls and the drum are clumps too
+    size_t num_filled;
+    if (cfg.scenario == "repose") {
+        num_filled = buildRepose(DEMSim, cfg);
+    } else if (cfg.scenario == "drum") {
+        num_filled = buildDrum(DEMSim, cfg);
+    } else if (cfg.scenario == "hopper") {
+        num_filled = buildHopper(DEMSim, cfg);
+    } else {
+        num_filled = buildMixer(DEMSim, cfg);
+    }
+
+    // Command line settings override the scenario's own
+    if (cfg.step_size > 0.) {
+        DEMSim.SetInitTimeStep(cfg.step_size);
+    }
+    if (cfg.cd_freq > 0) {
+        DEMSim.SetCDUpdateFreq(cfg.cd_freq);
+    }
+    if (cfg.bin_size > 0.) {
+        DEMSim.SetInitBinSize(cfg.bin_size);
+    }
+    if (!cfg.integrator.empty()) {
+        DEMSim.SetIntegrator(cfg.integrator);
+    }
+    DEMSim.Initialize();
+
+    // Jitification and the first contact detection are not part of the measurement
+    DEMSim.DoDynamicsThenSync(0.);
+    DEMSim.ClearThreadCollaborationStats();
+    DEMSim.ClearTimingStats();
+
+    ScenarioResult res;
+    res.config = cfg;
+    res.num_particles = num_filled;
+    res.avg_contacts = 0.;
+    res.peak_mem_bytes = DEMSim.GetDeviceMemUsage();
+    const double sample_time = cfg.sim_time / NUM_SAMPLES;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_SAMPLES; i++) {
+        // Contacts and memory are only read while both threads are idle, so every sample ends with a sync
+        DEMSim.DoDynamicsThenSync(sample_time);
+        res.avg_contacts += (double)DEMSim.GetNumContacts() / NUM_SAMPLES;
+        res.peak_mem_bytes = std::max(res.peak_mem_bytes, DEMSim.GetDeviceMemUsage());
+    }
+    res.wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    res.num_steps = DEMSim.GetNumDynamicSteps();
+    res.num_cd = DEMSim.GetNumKinematicUpdates();
+    DEMSim.GetTimingStats(res.kT_timer_names, res.kT_timer_vals, res.dT_timer_names, res.dT_timer_vals);
+    return res;
+}
+
+double particleStepsPerSecond(const ScenarioResult& res) {
+    return (double)res.num_particles * res.num_steps / res.wall_seconds;
+}
+
+void writeTimers(std::ofstream& out, const std::vector<std::string>& names, const std::vector<double>& vals) {
+    out << "{";
+    for (size_t i = 0; i < names.size(); i++) {
+        out << (i > 0 ? ", " : "") << "\"" << names[i] << "\": " << vals[i];
+    }
+    out << "}";
+}
+
+void writeJson(const std::string& file, const std::vector<ScenarioResult>& results) {
+    std::ofstream out(file);
+    out << "{\n";
+    out << "  \"deme_version\": \"" << DEME_VERSION_MAJOR << "." << DEME_VERSION_MINOR << "." << DEME_VERSION_PATCH
+        << "\",\n";
+    out << "  \"precision_policy\": \"" << DEME_PRECISION_POLICY_NAME << "\",\n";
+    out << "  \"scenarios\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& res = results[i];
+        const auto& cfg = res.config;
+        out << "    {\n";
+        out << "      \"scenario\": \"" << cfg.scenario << "\",\n";
+        out << "      \"num_particles\": " << res.num_particles << ",\n";
+        out << "      \"polydispersity\": " << cfg.polydispersity << ",\n";
+        out << "      \"sim_time\": " << cfg.sim_time << ",\n";
+        out << "      \"step_size\": " << cfg.step_size << ",\n";
+        out << "      \"cd_freq\": " << cfg.cd_freq << ",\n";
+        out << "      \"bin_size\": " << cfg.bin_size << ",\n";
+        out << "      \"integrator\": \"" << (cfg.integrator.empty() ? "default" : cfg.integrator) << "\",\n";
+        out << "      \"wall_seconds\": " << res.wall_seconds << ",\n";
+        out << "      \"num_steps\": " << res.num_steps << ",\n";
+        out << "      \"num_contact_detections\": " << res.num_cd << ",\n";
+        out << "      \"particle_steps_per_second\": " << particleStepsPerSecond(res) << ",\n";
+        out << "      \"contacts_per_step\": " << res.avg_contacts << ",\n";
+        out << "      \"peak_device_mem_bytes\": " << res.peak_mem_bytes << ",\n";
+        out << "      \"kT_timers\": ";
+        writeTimers(out, res.kT_timer_names, res.kT_timer_vals);
+        out << ",\n";
+        out << "      \"dT_timers\": ";
+        writeTimers(out, res.dT_timer_names, res.dT_timer_vals);
+        out << "\n    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    ScenarioConfig base;
+    std::string scenario = "all";
+    std::string json_file;
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(argv[i], "--scenario") == 0 && has_value) {
+            scenario = argv[++i];
+        } else if (std::strcmp(argv[i], "--num") == 0 && has_value) {
+            base.num_particles = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--poly") == 0 && has_value) {
+            base.polydispersity = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--time") == 0 && has_value) {
+            base.sim_time = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--step") == 0 && has_value) {
+            base.step_size = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--cd-freq") == 0 && has_value) {
+            base.cd_freq = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--bin-size") == 0 && has_value) {
+            base.bin_size = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--integrator") == 0 && has_value) {
+            base.integrator = argv[++i];
+        } else if (std::strcmp(argv[i], "--json") == 0 && has_value) {
+            json_file = argv[++i];
+        } else {
+            printf("Usage: %s [--scenario repose|drum|hopper|mixer|all] [--num N] [--poly r_max/r_min] [--time T]\n"
+                   "       [--step h] [--cd-freq F] [--bin-size S] [--integrator I] [--json <output file>]\n",
+                   argv[0]);
+            return 1;
+        }
+    }
+    if (base.polydispersity < 1.f) {
+        base.polydispersity = 1.f;
+    }
+    if (base.num_particles < 1) {
+        base.num_particles = 1;
+    }
+
+    std::vector<std::string> scenarios;
+    if (scenario == "all") {
+        scenarios = {"repose", "drum", "hopper", "mixer"};
+    } else if (scenario == "repose" || scenario == "drum" || scenario == "hopper" || scenario == "mixer") {
+        scenarios = {scenario};
+    } else {
+        printf("Unknown scenario %s; choose from repose, drum, hopper, mixer or all.\n", scenario.c_str());
+        return 1;
+    }
+
+    std::vector<ScenarioResult> results;
+    for (const auto& name : scenarios) {
+        ScenarioConfig cfg = base;
+        cfg.scenario = name;
+        results.push_back(runScenario(cfg));
+    }
+
+    printf("%-8s %10s %8s %12s %16s %14s %14s\n", "scenario", "particles", "steps", "wall (s)", "particle-steps/s",
+           "contacts/step", "peak mem");
+    for (const auto& res : results) {
+        printf("%-8s %10zu %8zu %12.3f %16.4g %14.1f %14s\n", res.config.scenario.c_str(), res.num_particles,
+               res.num_steps, res.wall_seconds, particleStepsPerSecond(res), res.avg_contacts,
+               pretty_format_bytes(res.peak_mem_bytes).c_str());
+    }
+    if (!json_file.empty()) {
+        writeJson(json_file, results);
+        printf("Results written to %s\n", json_file.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+// Stand-in for the CUDA runtime header, so that deme_bench builds without the CUDA toolkit (e.g. when configured with
+// DEME_BUILD_BENCH_ONLY). It only gives the vector types, their make_ functions and the function space qualifiers,
+// which is all that the host-side headers the benchmark uses need from CUDA. Only deme_bench has it on its include
+// path.
+
+#ifndef DEME_HOST_ONLY_CUDA_RUNTIME_H
+#define DEME_HOST_ONLY_CUDA_RUNTIME_H
+
+#ifdef __CUDACC__
+    #error "This header stands in for cuda_runtime.h in host-only builds and must not be used with nvcc"
+#endif
+
+#define __host__
+#define __device__
+#define __forceinline__ inline
+
+// Same layout and alignment as the CUDA vector types
+#define DEME_HOST_VECTOR_TYPES(T, NAME, ALIGN2, ALIGN4)                                                          \
+    struct alignas(ALIGN2) NAME##2 {                                                                             \
+        T x, y;                                                                                                  \
+    };                                                                                                           \
+    struct NAME##3 {                                                                                             \
+        T x, y, z;                                                                                               \
+    };                                                                                                           \
+    struct alignas(ALIGN4) NAME##4 {                                                                             \
+        T x, y, z, w;                                                                                            \
+    };                                                                                                           \
+    inline NAME##2 make_##NAME##2(T x, T y) { return NAME##2{x, y}; }                                            \
+    inline NAME##3 make_##NAME##3(T x, T y, T z) { return NAME##3{x, y, z}; }                                    \
+    inline NAME##4 make_##NAME##4(T x, T y, T z, T w) { return NAME##4{x, y, z, w}; }
+
+DEME_HOST_VECTOR_TYPES(float, float, 8, 16)
+DEME_HOST_VECTOR_TYPES(int, int, 8, 16)
+DEME_HOST_VECTOR_TYPES(unsigned int, uint, 8, 16)
+DEME_HOST_VECTOR_TYPES(double, double, 16, 16)
+
+#undef DEME_HOST_VECTOR_TYPES
+
+#endif
@@ -0,0 +1,194 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_ALLOCATOR_POLICY_HPP
+#define DEME_ALLOCATOR_POLICY_HPP
+
+#include <core/ApiVersion.h>
+
+#include <cuda_runtime_api.h>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace deme {
+
+// =============================================================================
+// Memory policies. Each one knows how to get and give back a raw chunk of bytes; PolicyAllocator wraps them into a
+// standard allocator, and the worker threads' data containers use the one selected at build time (DEME_ALLOC_POLICY).
+// =============================================================================
+
+// Unified memory: usable from both host and device, pages migrate on demand. This is the default.
+struct ManagedMemPolicy {
+    static const char* Name() { return "MANAGED"; }
+    static void* Allocate(std::size_t bytes) {
+        void* vptr = nullptr;
+        cudaError_t err = cudaMallocManaged(&vptr, bytes, cudaMemAttachGlobal);
+        if (err == cudaErrorMemoryAllocation || err == cudaErrorNotSupported) {
+            throw std::bad_alloc();
+        }
+        return vptr;
+    }
+    static void Release(void* p) { cudaFree(p); }
+};
+
+// Page-locked host memory, mapped into the device address space (zero-copy). Host access is at full speed and the
+// device reads/writes it over the bus, so no page migration ever happens.
+struct PinnedMemPolicy {
+    static const char* Name() { return "PINNED"; }
+    static void* Allocate(std::size_t bytes) {
+        void* vptr = nullptr;
+        cudaError_t err = cudaHostAlloc(&vptr, bytes, cudaHostAllocMapped | cudaHostAllocPortable);
+        if (err != cudaSuccess) {
+            throw std::bad_alloc();
+        }
+        return vptr;
+    }
+    static void Release(void* p) { cudaFreeHost(p); }
+};
+
+// Plain, aligned host memory. Kernels can only touch it on systems with HMM/ATS, so this is mainly for measuring
+// allocation cost and for exercising the host-side data structures without involving the CUDA allocator.
+struct AlignedHostMemPolicy {
+    static constexpr std::size_t Alignment = 256;
+    static const char* Name() { return "HOST"; }
+    static void* Allocate(std::size_t bytes) {
+        // Over-allocate, then stash the original pointer right in front of the aligned address we hand out
+        void* raw = std::malloc(bytes + Alignment + sizeof(void*));
+        if (!raw) {
+            throw std::bad_alloc();
+        }
+        std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);
+        std::uintptr_t aligned = (start + Alignment - 1) & ~(std::uintptr_t)(Alignment - 1);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<void*>(aligned);
+    }
+    static void Release(void* p) {
+        if (p) {
+            std::free(reinterpret_cast<void**>(p)[-1]);
+        }
+    }
+};
+
+// Process-wide bookkeeping of how many allocations the worker containers did and how long they took, so the cost of
+// (re)allocation can be told apart from kernel time.
+struct AllocatorStats {
+    std::atomic<uint64_t> nAllocations{0};
+    std::atomic<uint64_t> nDeallocations{0};
+    std::atomic<uint64_t> bytesAllocated{0};
+    std::atomic<uint64_t> nanosecondsSpent{0};
+
+    void Clear() {
+        nAllocations = 0;
+        nDeallocations = 0;
+        bytesAllocated = 0;
+        nanosecondsSpent = 0;
+    }
+};
+
+inline AllocatorStats& GetAllocatorStats() {
+    static AllocatorStats stats;
+    return stats;
+}
+
+template <class T, class MemPolicy>
+struct PolicyAllocator {
+  public:
+    using value_type = T;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using policy_type = MemPolicy;
+
+#if CXX_OLDER(STD_CXX20)
+    using pointer = T*;
+    using const_pointer = const T*;
+    using reference = T&;
+    using const_reference = const T&;
+
+    template <class U>
+    struct rebind {
+        typedef typename deme::PolicyAllocator<U, MemPolicy> other;
+    };
+#endif
+
+    using propagate_on_container_move_assignment = std::false_type;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_swap = std::false_type;
+    using is_always_equal = std::true_type;
+
+    PolicyAllocator() noexcept {}
+    PolicyAllocator(const PolicyAllocator& other) noexcept {}
+
+    template <class U>
+    PolicyAllocator(const PolicyAllocator<U, MemPolicy>& other) noexcept {}
+
+#if CXX_OLDER(STD_CXX20)
+    size_type max_size() const noexcept { return ULLONG_MAX / sizeof(value_type); }
+
+    template <class U, class... Args>
+    void construct(U* p, Args&&... args) {
+        ::new ((void*)p) U(std::forward<Args>(args)...);
+    }
+
+    template <class U>
+    void destroy(U* p) {
+        p->~U();
+    }
+#endif
+
+    T* allocate(std::size_t n) {
+        auto start = std::chrono::steady_clock::now();
+        T* ptr = (T*)MemPolicy::Allocate(n * sizeof(T));
+        auto end = std::chrono::steady_clock::now();
+        AllocatorStats& stats = GetAllocatorStats();
+        stats.nAllocations++;
+        stats.bytesAllocated += n * sizeof(T);
+        stats.nanosecondsSpent += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        return ptr;
+    }
+    T* allocate(std::size_t n, const void* hint) { return allocate(n); }
+
+    void deallocate(T* p, std::size_t n) {
+        auto start = std::chrono::steady_clock::now();
+        MemPolicy::Release(p);
+        auto end = std::chrono::steady_clock::now();
+        AllocatorStats& stats = GetAllocatorStats();
+        stats.nDeallocations++;
+        stats.nanosecondsSpent += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+
+    template <class T2>
+    bool operator==(const PolicyAllocator<T2, MemPolicy>& other) const noexcept {
+        return true;
+    }
+
+    template <class T2>
+    bool operator!=(const PolicyAllocator<T2, MemPolicy>& other) const noexcept {
+        return false;
+    }
+};
+
+// The policy used by all worker-thread data containers, chosen at configure time via the DEME_ALLOC_POLICY CMake cache
+// variable.
+#if defined(DEME_ALLOC_POLICY_HOST)
+using DEMEMemPolicy = AlignedHostMemPolicy;
+#elif defined(DEME_ALLOC_POLICY_PINNED)
+using DEMEMemPolicy = PinnedMemPolicy;
+#else
+using DEMEMemPolicy = ManagedMemPolicy;
+#endif
+
+template <class T>
+using DEMEAllocator = PolicyAllocator<T, DEMEMemPolicy>;
+
+}  // END namespace deme
+
+#endif
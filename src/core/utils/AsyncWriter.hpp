@@ -0,0 +1,149 @@
+//	Copyright (c) 2021, SBEL GPU Development Team
+//	Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_ASYNC_WRITER_HPP
+#define DEME_ASYNC_WRITER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace deme {
+
+// A background thread that runs output jobs (formatting and writing already-snapshotted data) in submission order.
+// The queue is bounded: Submit blocks while it is full, so a producer that outpaces the disk is throttled instead of
+// piling up snapshots in memory. An exception thrown by a job is re-thrown to the producer at the next Submit or Flush;
+// one that is still pending at destruction (nobody called Flush after the failing job) is printed to stderr instead.
+class AsyncWriter {
+  public:
+    explicit AsyncWriter(size_t max_pending = 2) : maxPending(max_pending > 0 ? max_pending : 1) {
+        worker = std::thread(&AsyncWriter::workerLoop, this);
+    }
+
+    ~AsyncWriter() {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            // Everything already submitted still gets written
+            idleCV.wait(lock, [this]() { return jobs.empty() && !busy; });
+            stopping = true;
+        }
+        jobCV.notify_all();
+        worker.join();
+        // A destructor must not throw, but a failed trailing write must not go unnoticed either
+        if (error) {
+            try {
+                std::rethrow_exception(error);
+            } catch (const std::exception& e) {
+                std::cerr << "WARNING! An asynchronous output job failed: " << e.what() << std::endl;
+            } catch (...) {
+                std::cerr << "WARNING! An asynchronous output job failed with an unknown error." << std::endl;
+            }
+        }
+    }
+
+    AsyncWriter(const AsyncWriter&) = delete;
+    AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+    /// Queue a job; blocks while max_pending jobs are already waiting
+    void Submit(std::function<void()> job) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            rethrowError();
+            if (jobs.size() >= maxPending) {
+                auto start = std::chrono::steady_clock::now();
+                spaceCV.wait(lock, [this]() { return jobs.size() < maxPending || error; });
+                nanosecondsBlocked += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now() - start)
+                                          .count();
+                rethrowError();
+            }
+            jobs.push_back(std::move(job));
+        }
+        jobCV.notify_one();
+    }
+
+    /// Block until all submitted jobs are done
+    void Flush() {
+        std::unique_lock<std::mutex> lock(mtx);
+        idleCV.wait(lock, [this]() { return jobs.empty() && !busy; });
+        rethrowError();
+    }
+
+    void SetMaxPending(size_t max_pending) {
+        std::lock_guard<std::mutex> lock(mtx);
+        maxPending = max_pending > 0 ? max_pending : 1;
+        spaceCV.notify_all();
+    }
+
+    /// Total time Submit spent waiting for room in the queue, in seconds
+    double GetSecondsBlocked() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return (double)nanosecondsBlocked * 1e-9;
+    }
+
+  private:
+    size_t maxPending;
+    std::deque<std::function<void()>> jobs;
+    bool busy = false;
+    bool stopping = false;
+    std::exception_ptr error;
+    uint64_t nanosecondsBlocked = 0;
+
+    mutable std::mutex mtx;
+    std::condition_variable jobCV;    // Worker waits on it for jobs
+    std::condition_variable spaceCV;  // Producer waits on it for room in the queue
+    std::condition_variable idleCV;   // Flush waits on it for the queue to drain
+    std::thread worker;
+
+    // Must hold mtx. The error is reported once.
+    void rethrowError() {
+        if (error) {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                jobCV.wait(lock, [this]() { return !jobs.empty() || stopping; });
+                if (jobs.empty()) {
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                busy = true;
+            }
+            spaceCV.notify_one();
+            try {
+                job();
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                spaceCV.notify_all();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                busy = false;
+            }
+            idleCV.notify_all();
+        }
+    }
+};
+
+}  // namespace deme
+
+#endif
@@ -3,20 +3,149 @@
 //
 //	SPDX-License-Identifier: BSD-3-Clause
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <fstream>
 #include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <sstream>
 #include <string>
 #include <regex>
 
+#if !defined(_WIN32) && !defined(_WIN64)
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include <cuda_runtime_api.h>
+
 #include <core/ApiVersion.h>
 #include <core/utils/RuntimeData.h>
 #include <core/utils/JitHelper.h>
-
-jitify::JitCache JitHelper::kcache;
+#include <core/utils/JitSubstitution.h>
 
 const std::filesystem::path JitHelper::KERNEL_DIR = RuntimeDataHelper::data_path / "kernel";
 const std::filesystem::path JitHelper::KERNEL_INCLUDE_DIR = RuntimeDataHelper::include_path;
 
+namespace {
+
+// 64-bit FNV-1a. Used (with 2 different offset bases) for naming and validating disk cache entries, so it must be
+// stable across runs and platforms, which std::hash is not guaranteed to be.
+const uint64_t FNV_PRIME = 1099511628211ULL;
+const uint64_t FNV_OFFSET_KEY = 14695981039346656037ULL;
+const uint64_t FNV_OFFSET_CHECK = 0x84222325cbf29ce4ULL;
+
+inline uint64_t hashBytes(uint64_t h, const std::string& str) {
+    for (unsigned char c : str) {
+        h ^= c;
+        h *= FNV_PRIME;
+    }
+    // Also hash in the length, so that consecutive fields cannot be shifted into one another
+    size_t len = str.size();
+    for (size_t i = 0; i < sizeof(len); i++) {
+        h ^= (len >> (8 * i)) & 0xff;
+        h *= FNV_PRIME;
+    }
+    return h;
+}
+
+inline std::string toHex(uint64_t h) {
+    std::ostringstream ss;
+    ss << std::hex;
+    ss.width(16);
+    ss.fill('0');
+    ss << h;
+    return ss.str();
+}
+
+// The cache holds code that gets loaded and run, so by default it lives in a per-user location, never in a shared one
+// such as the system temp dir
+inline std::filesystem::path defaultDiskCacheDir() {
+    const char* env_dir = std::getenv("DEME_JIT_CACHE_DIR");
+    if (env_dir && env_dir[0] != '\0') {
+        return std::filesystem::path(env_dir);
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    const char* local_app_data = std::getenv("LOCALAPPDATA");
+    if (local_app_data && local_app_data[0] != '\0') {
+        return std::filesystem::path(local_app_data) / "deme" / "jit_cache";
+    }
+#else
+    const char* xdg_cache = std::getenv("XDG_CACHE_HOME");
+    if (xdg_cache && xdg_cache[0] == '/') {
+        return std::filesystem::path(xdg_cache) / "deme" / "jit";
+    }
+    const char* home = std::getenv("HOME");
+    if (home && home[0] == '/') {
+        return std::filesystem::path(home) / ".cache" / "deme" / "jit";
+    }
+#endif
+    // No per-user location is known; an empty path disables the disk cache
+    return std::filesystem::path();
+}
+
+// Whether dir is a directory that only the current user can write to. A cache directory that others can write to would
+// let them plant kernels that this process then loads and runs.
+inline bool isPrivateDir(const std::filesystem::path& dir) {
+#if defined(_WIN32) || defined(_WIN64)
+    std::error_code ec;
+    return std::filesystem::is_directory(std::filesystem::symlink_status(dir, ec));
+#else
+    struct stat st;
+    if (lstat(dir.c_str(), &st) != 0) {
+        return false;
+    }
+    return S_ISDIR(st.st_mode) && st.st_uid == geteuid() && (st.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+#endif
+}
+
+// Check that the cache directory is safe to use, optionally creating it (accessible to the current user only). An
+// unsafe directory is reported once per process, and then the disk cache is just not used.
+inline bool prepareDiskCacheDir(const std::filesystem::path& dir, bool create) {
+    if (dir.empty()) {
+        return false;
+    }
+    std::error_code ec;
+    if (create && !std::filesystem::exists(std::filesystem::symlink_status(dir, ec))) {
+        if (dir.has_parent_path()) {
+            std::filesystem::create_directories(dir.parent_path(), ec);
+        }
+        if (std::filesystem::create_directory(dir, ec)) {
+            std::filesystem::permissions(dir, std::filesystem::perms::owner_all, std::filesystem::perm_options::replace,
+                                         ec);
+        }
+    }
+    if (!std::filesystem::exists(std::filesystem::symlink_status(dir, ec))) {
+        return false;
+    }
+    if (!isPrivateDir(dir)) {
+        static std::once_flag warned;
+        std::call_once(warned, [&dir]() {
+            std::cerr << "WARNING! The JIT disk cache directory " << dir.string()
+                      << " is not a directory owned by the current user, or others can write to it. The disk cache "
+                         "is not used."
+                      << std::endl;
+        });
+        return false;
+    }
+    return true;
+}
+
+const std::string DISK_CACHE_EXT = ".jit";
+const std::string DISK_CACHE_MAGIC = "DEMEJIT1";
+
+}  // namespace
+
+bool JitHelper::diskCacheEnabled = true;
+std::filesystem::path JitHelper::diskCacheDir = defaultDiskCacheDir();
+size_t JitHelper::diskCacheSizeLimit = (size_t)256 * 1024 * 1024;
+std::atomic<uint64_t> JitHelper::diskCacheHits{0};
+std::atomic<uint64_t> JitHelper::diskCacheMisses{0};
+std::atomic<uint64_t> JitHelper::diskCacheNanosecondsSaved{0};
+
 JitHelper::Header::Header(const std::filesystem::path& sourcefile) {
     this->_source = JitHelper::loadSourceFile(sourcefile);
 }
@@ -33,7 +162,12 @@ void JitHelper::Header::substitute(const std::string& symbol, const std::string&
     }
 }
 
-jitify::Program JitHelper::buildProgram(
+std::string JitHelper::expandSubstitutions(const std::string& code,
+                                           const std::unordered_map<std::string, std::string>& substitutions) {
+    return deme::ExpandJitSubstitutions(code, substitutions);
+}
+
+JitProgram JitHelper::buildProgram(
     const std::string& name,
     const std::filesystem::path& source,
     std::unordered_map<std::string, std::string> substitutions,
@@ -43,9 +177,7 @@ jitify::Program JitHelper::buildProgram(
 
     code.append(JitHelper::loadSourceFile(source));
     // Apply the substitutions
-    for (auto& subst : substitutions) {
-        code = std::regex_replace(code, std::regex(subst.first), subst.second);
-    }
+    code = expandSubstitutions(code, substitutions);
 
     std::vector<std::string> header_code;
     // THIS BLOCK IS ONLY NEEDED IF THE headers PARAMETER IS USED
@@ -55,5 +187,188 @@ jitify::Program JitHelper::buildProgram(
     }
     */
 
-    return kcache.program(code, header_code, flags);
+    return JitProgram(std::move(code), std::move(flags));
+}
+
+JitHelper::DiskCacheStats JitHelper::GetDiskCacheStats() {
+    DiskCacheStats stats;
+    stats.nHits = diskCacheHits.load();
+    stats.nMisses = diskCacheMisses.load();
+    stats.secondsSaved = (double)diskCacheNanosecondsSaved.load() * 1e-9;
+    return stats;
+}
+
+uint64_t JitHelper::environmentHash() {
+    // Computed once per process: the kernel files and headers do not change while we run
+    static const uint64_t env_hash = []() {
+        uint64_t h = hashBytes(FNV_OFFSET_KEY, std::to_string(DEME_VERSION_MAJOR) + "." +
+                                                   std::to_string(DEME_VERSION_MINOR) + "." +
+                                                   std::to_string(DEME_VERSION_PATCH));
+        h = hashBytes(h, std::to_string(CUDART_VERSION));
+        // Kernel files (including the ones pulled in via #include, and the customizable policies) and the headers
+        // that kernels include. Sort them so the result does not depend on directory iteration order.
+        std::vector<std::filesystem::path> files;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(KERNEL_DIR, ec)) {
+            if (entry.is_regular_file()) {
+                files.push_back(entry.path());
+            }
+        }
+        for (const auto& header : {"Defines.h", "VariableTypes.h"}) {
+            std::filesystem::path p = KERNEL_INCLUDE_DIR / "DEM" / header;
+            if (std::filesystem::exists(p, ec)) {
+                files.push_back(p);
+            }
+        }
+        std::sort(files.begin(), files.end());
+        for (const auto& file : files) {
+            h = hashBytes(h, file.filename().string());
+            h = hashBytes(h, loadSourceFile(file));
+        }
+        return h;
+    }();
+    return env_hash;
+}
+
+bool JitHelper::diskCacheLoad(uint64_t key, uint64_t check, std::string& blob, double& compile_seconds) {
+    if (!prepareDiskCacheDir(diskCacheDir, false)) {
+        return false;
+    }
+    std::filesystem::path file = diskCacheDir / (toHex(key) + DISK_CACHE_EXT);
+    std::ifstream input(file, std::ios::binary);
+    if (!input) {
+        return false;
+    }
+    std::string magic, check_hex;
+    input >> magic >> check_hex >> compile_seconds;
+    input.get();  // The newline that ends the header
+    if (!input || magic != DISK_CACHE_MAGIC || check_hex != toHex(check)) {
+        return false;
+    }
+    std::ostringstream ss;
+    ss << input.rdbuf();
+    blob = ss.str();
+    input.close();
+    // Mark it as recently used, for eviction purposes
+    std::error_code ec;
+    std::filesystem::last_write_time(file, std::filesystem::file_time_type::clock::now(), ec);
+    return true;
+}
+
+void JitHelper::diskCacheStore(uint64_t key, uint64_t check, const std::string& blob, double compile_seconds) {
+    std::error_code ec;
+    if (!prepareDiskCacheDir(diskCacheDir, true)) {
+        return;
+    }
+    // Write to a uniquely named temp file then rename it in place, so concurrent jobs sharing this cache never see a
+    // partially written entry
+    static thread_local std::mt19937_64 rng(std::random_device{}());
+    std::filesystem::path file = diskCacheDir / (toHex(key) + DISK_CACHE_EXT);
+    std::filesystem::path tmp_file = diskCacheDir / (toHex(key) + "." + toHex(rng()) + ".tmp");
+    {
+        std::ofstream output(tmp_file, std::ios::binary);
+        if (!output) {
+            return;
+        }
+        output << DISK_CACHE_MAGIC << " " << toHex(check) << " " << compile_seconds << "\n";
+        output.write(blob.data(), blob.size());
+        if (!output) {
+            output.close();
+            std::filesystem::remove(tmp_file, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tmp_file, file, ec);
+    if (ec) {
+        std::filesystem::remove(tmp_file, ec);
+        return;
+    }
+
+    // Evict the least recently used entries if the cache grew over the limit
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> entries;
+    size_t total_bytes = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(diskCacheDir, ec)) {
+        if (entry.is_regular_file(ec) && entry.path().extension() == DISK_CACHE_EXT) {
+            total_bytes += entry.file_size(ec);
+            entries.emplace_back(entry.last_write_time(ec), entry.path());
+        }
+    }
+    if (total_bytes <= diskCacheSizeLimit) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end());
+    for (const auto& entry : entries) {
+        if (total_bytes <= diskCacheSizeLimit) {
+            break;
+        }
+        size_t bytes = std::filesystem::file_size(entry.second, ec);
+        if (!ec && std::filesystem::remove(entry.second, ec)) {
+            total_bytes -= bytes;
+        }
+    }
+}
+
+JitProgram::JitProgram(std::string source, std::vector<std::string> flags)
+    : _source(std::move(source)), _flags(std::move(flags)) {
+    _key = hashBytes(JitHelper::environmentHash(), _source);
+    _check = hashBytes(FNV_OFFSET_CHECK, _source);
+    for (const auto& flag : _flags) {
+        _key = hashBytes(_key, flag);
+        _check = hashBytes(_check, flag);
+    }
+}
+
+const jitify::experimental::KernelInstantiation& JitProgram::getInstance(const std::string& name) {
+    // kT, dT and the main thread may all instantiate kernels of the same program
+    std::lock_guard<std::mutex> lock(*_instancesMutex);
+    auto it = _instances.find(name);
+    if (it != _instances.end()) {
+        return *(it->second);
+    }
+
+    // Kernels are compiled for the architecture of the current device
+    int device = 0, cc_major = 0, cc_minor = 0;
+    cudaGetDevice(&device);
+    cudaDeviceGetAttribute(&cc_major, cudaDevAttrComputeCapabilityMajor, device);
+    cudaDeviceGetAttribute(&cc_minor, cudaDevAttrComputeCapabilityMinor, device);
+    const std::string arch = std::to_string(cc_major * 10 + cc_minor);
+    const uint64_t key = hashBytes(hashBytes(_key, name), arch);
+    const uint64_t check = hashBytes(hashBytes(_check, name), arch);
+
+    std::unique_ptr<jitify::experimental::KernelInstantiation> instance;
+    auto start = std::chrono::steady_clock::now();
+    if (JitHelper::diskCacheEnabled) {
+        std::string blob;
+        double compile_seconds;
+        if (JitHelper::diskCacheLoad(key, check, blob, compile_seconds)) {
+            try {
+                instance = std::make_unique<jitify::experimental::KernelInstantiation>(
+                    jitify::experimental::KernelInstantiation::deserialize(blob));
+                double load_seconds =
+                    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                JitHelper::diskCacheHits++;
+                if (compile_seconds > load_seconds) {
+                    JitHelper::diskCacheNanosecondsSaved += (uint64_t)((compile_seconds - load_seconds) * 1e9);
+                }
+            } catch (const std::exception&) {
+                // A stale or corrupted entry; just compile it again, and the entry will be overwritten
+                instance.reset();
+            }
+        }
+    }
+
+    if (!instance) {
+        start = std::chrono::steady_clock::now();
+        if (!_program) {
+            _program = std::make_unique<jitify::experimental::Program>(_source, std::vector<std::string>(), _flags);
+        }
+        instance = std::make_unique<jitify::experimental::KernelInstantiation>(_program->kernel(name).instantiate());
+        double compile_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (JitHelper::diskCacheEnabled) {
+            JitHelper::diskCacheMisses++;
+            JitHelper::diskCacheStore(key, check, instance->serialize(), compile_seconds);
+        }
+    }
+
+    return *(_instances[name] = std::move(instance));
 }
@@ -6,7 +6,11 @@
 #ifndef DEME_JIT_HELPER_H
 #define DEME_JIT_HELPER_H
 
+#include <atomic>
+#include <cstdint>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -19,6 +23,41 @@
     #undef strtok_r
 #endif
 
+// A jitified program. A kernel is compiled at its first instantiation and then kept in memory; if the disk cache is
+// enabled, it is also stored on disk, so that a later run with the same (post-substitution) source, flags and kernel
+// files loads it without invoking NVRTC at all.
+class JitProgram {
+  public:
+    class Kernel {
+      public:
+        const jitify::experimental::KernelInstantiation& instantiate() { return _program->getInstance(_name); }
+
+      private:
+        friend class JitProgram;
+        Kernel(JitProgram* program, const std::string& name) : _program(program), _name(name) {}
+        JitProgram* _program;
+        std::string _name;
+    };
+
+    JitProgram(std::string source, std::vector<std::string> flags);
+
+    Kernel kernel(const std::string& name) { return Kernel(this, name); }
+
+  private:
+    std::string _source;
+    std::vector<std::string> _flags;
+    // Hashes of the source, flags and the kernel files, used for keying disk cache entries
+    uint64_t _key;
+    uint64_t _check;
+    // The preprocessed program is only needed if a kernel is not found in the disk cache
+    std::unique_ptr<jitify::experimental::Program> _program;
+    std::unordered_map<std::string, std::unique_ptr<jitify::experimental::KernelInstantiation>> _instances;
+    // Guards _instances and _program (held by pointer, so that the program stays movable)
+    std::unique_ptr<std::mutex> _instancesMutex = std::make_unique<std::mutex>();
+
+    const jitify::experimental::KernelInstantiation& getInstance(const std::string& name);
+};
+
 class JitHelper {
   public:
     class Header {
@@ -31,12 +70,24 @@ class JitHelper {
         std::string _source;
     };
 
-    static jitify::Program buildProgram(
+    struct DiskCacheStats {
+        uint64_t nHits = 0;
+        uint64_t nMisses = 0;
+        // Compile time the hits would have cost, minus the time spent loading them
+        double secondsSaved = 0.;
+    };
+
+    static JitProgram buildProgram(
         const std::string& name,
         const std::filesystem::path& source,
         std::unordered_map<std::string, std::string> substitutions = std::unordered_map<std::string, std::string>(),
         std::vector<std::string> flags = std::vector<std::string>());
 
+    /// Replace all _identifier_ placeholders in code with their values in substitutions, in one pass over the code.
+    /// Values are inserted as-is, i.e. placeholders inside of them are not expanded.
+    static std::string expandSubstitutions(const std::string& code,
+                                           const std::unordered_map<std::string, std::string>& substitutions);
+
     //// I'm pretty sure C++17 auto-converts this
     // static jitify::Program buildProgram(
     // 	const std::string& name, const std::string& code,
@@ -44,11 +95,37 @@ class JitHelper {
     // 	std::vector<std::string> flags = 0
     // );
 
+    /// Enable or disable the on-disk cache of compiled kernels (process-wide, enabled by default)
+    static void SetDiskCacheEnabled(bool use) { diskCacheEnabled = use; }
+    static bool IsDiskCacheEnabled() { return diskCacheEnabled; }
+    /// Set the directory of the disk cache. Default is $DEME_JIT_CACHE_DIR, or deme/jit in $XDG_CACHE_HOME (or in
+    /// $HOME/.cache). It is only used if it is owned by the current user and not group- or world-writable.
+    static void SetDiskCacheDir(const std::filesystem::path& dir) { diskCacheDir = dir; }
+    static const std::filesystem::path& GetDiskCacheDir() { return diskCacheDir; }
+    /// Set the size limit of the disk cache; least recently used entries are evicted beyond it
+    static void SetDiskCacheSizeLimit(size_t bytes) { diskCacheSizeLimit = bytes; }
+    /// Get the disk cache hit/miss statistics accumulated in this process
+    static DiskCacheStats GetDiskCacheStats();
+
     static const std::filesystem::path KERNEL_DIR;
     static const std::filesystem::path KERNEL_INCLUDE_DIR;
 
   private:
-    static jitify::JitCache kcache;
+    friend class JitProgram;
+
+    static bool diskCacheEnabled;
+    static std::filesystem::path diskCacheDir;
+    static size_t diskCacheSizeLimit;
+    static std::atomic<uint64_t> diskCacheHits;
+    static std::atomic<uint64_t> diskCacheMisses;
+    static std::atomic<uint64_t> diskCacheNanosecondsSaved;
+
+    // Hash of everything a program may pull in besides its own source (kernel files, headers, toolkit version)
+    static uint64_t environmentHash();
+    // Read a cache entry; false if it does not exist or does not match check
+    static bool diskCacheLoad(uint64_t key, uint64_t check, std::string& blob, double& compile_seconds);
+    // Write a cache entry, then evict old entries if over the size limit
+    static void diskCacheStore(uint64_t key, uint64_t check, const std::string& blob, double compile_seconds);
 
     inline static std::string loadSourceFile(const std::filesystem::path& sourcefile) {
         std::string code;
@@ -0,0 +1,71 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#include <algorithm>
+#include <regex>
+#include <string>
+
+#include <core/utils/JitSubstitution.h>
+
+namespace deme {
+
+namespace {
+
+inline bool isPlaceholderChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+// Whether a substitution key looks like _identifier_, with no underscores in the middle
+inline bool isPlaceholder(const std::string& key) {
+    if (key.size() < 3 || key.front() != '_' || key.back() != '_') {
+        return false;
+    }
+    return std::all_of(key.begin() + 1, key.end() - 1, isPlaceholderChar);
+}
+
+}  // namespace
+
+std::string ExpandJitSubstitutions(const std::string& code,
+                                   const std::unordered_map<std::string, std::string>& substitutions) {
+    // Keys that are not plain _identifier_ placeholders cannot be found by the tokenizer below; those (if any) go
+    // through the old regex replacement first
+    std::string expanded;
+    const std::string* src = &code;
+    for (const auto& subst : substitutions) {
+        if (!isPlaceholder(subst.first)) {
+            expanded = std::regex_replace(*src, std::regex(subst.first), subst.second);
+            src = &expanded;
+        }
+    }
+
+    std::string out;
+    out.reserve(src->size() + src->size() / 4);
+    const size_t len = src->size();
+    size_t copied = 0;  // Everything before this has been appended to out
+    size_t i = src->find('_');
+    while (i != std::string::npos) {
+        // Scan the identifier chars after this underscore; a placeholder must close with another underscore
+        size_t j = i + 1;
+        while (j < len && isPlaceholderChar((*src)[j])) {
+            j++;
+        }
+        if (j < len && (*src)[j] == '_' && j > i + 1) {
+            auto it = substitutions.find(src->substr(i, j - i + 1));
+            if (it != substitutions.end()) {
+                out.append(*src, copied, i - copied);
+                out.append(it->second);
+                copied = j + 1;
+                i = src->find('_', copied);
+                continue;
+            }
+        }
+        // Not a known placeholder. The closing underscore (if any) may still open the next one.
+        i = (j < len && (*src)[j] == '_') ? j : src->find('_', j);
+    }
+    out.append(*src, copied, std::string::npos);
+    return out;
+}
+
+}  // namespace deme
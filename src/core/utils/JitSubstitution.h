@@ -0,0 +1,24 @@
+//  Copyright (c) 2021, SBEL GPU Development Team
+//  Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_JIT_SUBSTITUTION_H
+#define DEME_JIT_SUBSTITUTION_H
+
+#include <string>
+#include <unordered_map>
+
+// The source substitution step of kernel jitification. It is kept apart from JitHelper so that it can be built (and
+// benchmarked) without the CUDA toolkit.
+
+namespace deme {
+
+/// Replace all _identifier_ placeholders in code with their values in substitutions, in one pass over the code.
+/// Values are inserted as-is, i.e. placeholders inside of them are not expanded.
+std::string ExpandJitSubstitutions(const std::string& code,
+                                   const std::unordered_map<std::string, std::string>& substitutions);
+
+}  // namespace deme
+
+#endif
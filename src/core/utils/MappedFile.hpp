@@ -0,0 +1,128 @@
+//	Copyright (c) 2021, SBEL GPU Development Team
+//	Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_MAPPED_FILE_HPP
+#define DEME_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#if defined(_WIN32) || defined(_WIN64)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace deme {
+
+// A read-only memory mapping of a whole file. The content is paged in by the OS as it is touched, so large input files
+// can be parsed in place (and by several threads at once) without first being copied into a buffer. Note the mapped
+// content is not null-terminated.
+class MappedFile {
+  public:
+    explicit MappedFile(const std::string& filename) {
+#if defined(_WIN32) || defined(_WIN64)
+        fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                 FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Cannot open file " + filename + ".");
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(fileHandle, &file_size)) {
+            CloseHandle(fileHandle);
+            throw std::runtime_error("Cannot get the size of file " + filename + ".");
+        }
+        mSize = (size_t)file_size.QuadPart;
+        if (mSize == 0) {
+            return;
+        }
+        mapHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapHandle != NULL) {
+            mData = static_cast<const char*>(MapViewOfFile(mapHandle, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (mData == nullptr) {
+            release();
+            throw std::runtime_error("Cannot memory-map file " + filename + ".");
+        }
+#else
+        fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open file " + filename + ".");
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            release();
+            throw std::runtime_error("Cannot get the size of file " + filename + ".");
+        }
+        mSize = (size_t)st.st_size;
+        if (mSize == 0) {
+            return;
+        }
+        void* addr = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            release();
+            throw std::runtime_error("Cannot memory-map file " + filename + ".");
+        }
+        mData = static_cast<const char*>(addr);
+        // We parse front to back
+        madvise(addr, mSize, MADV_SEQUENTIAL);
+#endif
+    }
+
+    ~MappedFile() { release(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return mData; }
+    size_t size() const { return mSize; }
+
+  private:
+    const char* mData = nullptr;
+    size_t mSize = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE fileHandle = INVALID_HANDLE_VALUE;
+    HANDLE mapHandle = NULL;
+
+    void release() {
+        if (mData) {
+            UnmapViewOfFile(mData);
+            mData = nullptr;
+        }
+        if (mapHandle != NULL) {
+            CloseHandle(mapHandle);
+            mapHandle = NULL;
+        }
+        if (fileHandle != INVALID_HANDLE_VALUE) {
+            CloseHandle(fileHandle);
+            fileHandle = INVALID_HANDLE_VALUE;
+        }
+    }
+#else
+    int fd = -1;
+
+    void release() {
+        if (mData) {
+            munmap(const_cast<char*>(mData), mSize);
+            mData = nullptr;
+        }
+        if (fd >= 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+#endif
+};
+
+}  // namespace deme
+
+#endif
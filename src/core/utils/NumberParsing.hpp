@@ -0,0 +1,149 @@
+//	Copyright (c) 2021, SBEL GPU Development Team
+//	Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_NUMBER_PARSING_HPP
+#define DEME_NUMBER_PARSING_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace deme {
+
+// Parsers for numbers given as a [first, last) char range that is not necessarily null-terminated, such as a field in
+// a memory-mapped text file. Leading/trailing whitespace is not skipped; a range with anything but the number in it is
+// invalid.
+
+// Exact for decimals with at most 19 significant digits and a small exponent, which covers what text output files
+// usually hold; otherwise false is returned and parseDouble falls back to strtod
+inline bool fastParseDouble(const char* p, const char* last, double& val) {
+    static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    bool negative = false;
+    if (p < last && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    uint64_t mantissa = 0;
+    int n_digits = 0;
+    int exponent = 0;
+    bool any_digit = false;
+    for (; p < last && *p >= '0' && *p <= '9'; p++) {
+        any_digit = true;
+        if (mantissa == 0 && *p == '0') {
+            continue;
+        }
+        if (++n_digits > 19) {
+            return false;
+        }
+        mantissa = mantissa * 10 + (*p - '0');
+    }
+    if (p < last && *p == '.') {
+        p++;
+        for (; p < last && *p >= '0' && *p <= '9'; p++) {
+            any_digit = true;
+            exponent--;
+            if (mantissa == 0 && *p == '0') {
+                continue;
+            }
+            if (++n_digits > 19) {
+                return false;
+            }
+            mantissa = mantissa * 10 + (*p - '0');
+        }
+    }
+    if (!any_digit) {
+        return false;
+    }
+    if (p < last && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool exp_negative = false;
+        if (p < last && (*p == '-' || *p == '+')) {
+            exp_negative = (*p == '-');
+            p++;
+        }
+        if (p == last) {
+            return false;
+        }
+        int exp_val = 0;
+        for (; p < last && *p >= '0' && *p <= '9'; p++) {
+            if (exp_val > 10000) {
+                return false;
+            }
+            exp_val = exp_val * 10 + (*p - '0');
+        }
+        exponent += exp_negative ? -exp_val : exp_val;
+    }
+    // Both the mantissa and 10^|exponent| are exact doubles here, so one multiplication/division rounds correctly
+    if (p != last || mantissa > (uint64_t(1) << 53) || exponent < -22 || exponent > 22) {
+        return false;
+    }
+    val = (double)mantissa;
+    val = (exponent < 0) ? val / pow10[-exponent] : val * pow10[exponent];
+    if (negative) {
+        val = -val;
+    }
+    return true;
+}
+
+/// Parse a floating-point number; false if the range is not one
+inline bool parseDouble(const char* first, const char* last, double& val) {
+    if (fastParseDouble(first, last, val)) {
+        return true;
+    }
+    // The C parser needs a null-terminated copy
+    char buf[64];
+    size_t len = last - first;
+    if (len == 0 || len >= sizeof(buf)) {
+        return false;
+    }
+    std::memcpy(buf, first, len);
+    buf[len] = '\0';
+    char* parse_end;
+    val = std::strtod(buf, &parse_end);
+    return parse_end == buf + len;
+}
+
+/// Parse a decimal integer; false if the range is not one, or if it does not fit in a long long
+inline bool parseInteger(const char* first, const char* last, long long& val) {
+    const char* p = first;
+    bool negative = false;
+    if (p < last && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    size_t n_digits = last - p;
+    if (n_digits == 0) {
+        return false;
+    }
+    // Up to 18 digits cannot overflow
+    if (n_digits <= 18) {
+        long long v = 0;
+        for (; p < last; p++) {
+            if (*p < '0' || *p > '9') {
+                return false;
+            }
+            v = v * 10 + (*p - '0');
+        }
+        val = negative ? -v : v;
+        return true;
+    }
+    char buf[64];
+    size_t len = last - first;
+    if (len >= sizeof(buf)) {
+        return false;
+    }
+    std::memcpy(buf, first, len);
+    buf[len] = '\0';
+    char* parse_end;
+    errno = 0;
+    val = std::strtoll(buf, &parse_end, 10);
+    return parse_end == buf + len && errno != ERANGE;
+}
+
+}  // namespace deme
+
+#endif
@@ -0,0 +1,255 @@
+//	Copyright (c) 2021, SBEL GPU Development Team
+//	Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_SCRATCH_ARENA_HPP
+#define DEME_SCRATCH_ARENA_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace deme {
+
+// An arena for the temporary arrays a worker thread needs within one phase of its work. Allocations are named, and
+// live until they are released or until the Scope they were made in ends, whichever comes first. A new allocation
+// takes the first gap between live allocations that is large enough, so memory retired mid-phase is reused right away.
+// Memory is held in blocks that never move while anything in them is live; when the arena empties out, the blocks are
+// merged into one block as large as the previous peak, so in steady state a phase is served from a single block.
+// The arena records the peak bytes in use during each named scope. In debug mode, it also checks that no two live
+// allocations overlap and that a name is not allocated again while still live, and it fills allocated and released
+// memory with a poison pattern, so code that reads retired or not-yet-written scratch gives itself away.
+// Use it from one thread only. The memory must be host-accessible in debug mode.
+template <typename Allocator = std::allocator<char>>
+class ScratchArena {
+  public:
+    using byte_t = typename Allocator::value_type;
+    static_assert(sizeof(byte_t) == 1, "ScratchArena needs a 1-byte element type");
+
+    // Every allocation starts at this alignment, same as what cudaMalloc gives
+    static constexpr size_t ALIGNMENT = 256;
+    // The smallest block the arena will allocate
+    static constexpr size_t MIN_BLOCK_BYTES = (size_t)1 << 20;
+    static constexpr unsigned char POISON = 0xFF;
+
+    struct PhaseStats {
+        size_t peakBytes = 0;
+        size_t nScopes = 0;
+    };
+
+    // Releases, at its destruction, every allocation made since its construction, and records the peak bytes in use
+    // in between under its name
+    class Scope {
+      public:
+        Scope(ScratchArena& arena, const std::string& phase) : owner(arena) { owner.beginScope(phase); }
+        ~Scope() { owner.endScope(); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+      private:
+        ScratchArena& owner;
+    };
+
+    ScratchArena() = default;
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    void SetDebug(bool debug) { debugMode = debug; }
+    bool GetDebug() const { return debugMode; }
+
+    // Get at least `bytes' bytes, aligned to ALIGNMENT. The content is not initialized.
+    byte_t* Allocate(const std::string& name, size_t bytes) {
+        if (scopes.empty()) {
+            throw std::runtime_error("Scratch array " + name + " is requested outside of any scratch scope.");
+        }
+        // Even an empty allocation takes some room, so that every live allocation has its own address
+        size_t padded = roundUp(std::max<size_t>(bytes, 1));
+        if (debugMode) {
+            for (const auto& live : allocations) {
+                if (live.name == name) {
+                    throw std::runtime_error("Scratch array " + name +
+                                             " is allocated again while its previous allocation is still live.");
+                }
+            }
+        }
+        Allocation a;
+        a.name = name;
+        a.bytes = padded;
+        a.id = nextId++;
+        if (!findGap(padded, a.block, a.offset)) {
+            addBlock(padded);
+            a.block = blocks.size() - 1;
+            a.offset = 0;
+        }
+        byte_t* ptr = blocks[a.block]->data() + a.offset;
+        if (debugMode) {
+            checkNoOverlap(a);
+            std::fill(ptr, ptr + padded, (byte_t)POISON);
+        }
+        allocations.push_back(a);
+        bytesInUse += padded;
+        for (auto& s : scopes) {
+            s.peakBytes = std::max(s.peakBytes, bytesInUse);
+        }
+        peakSinceMerge = std::max(peakSinceMerge, highWaterFootprint());
+        return ptr;
+    }
+
+    // Retire an allocation before its scope ends
+    void Release(const void* ptr) {
+        for (size_t i = 0; i < allocations.size(); i++) {
+            if (blocks[allocations[i].block]->data() + allocations[i].offset == ptr) {
+                retire(i);
+                return;
+            }
+        }
+        throw std::runtime_error("Releasing a pointer that is not a live scratch allocation.");
+    }
+
+    // Bytes currently allocated, and bytes held in blocks
+    size_t GetBytesInUse() const { return bytesInUse; }
+    size_t GetCapacity() const {
+        size_t n = 0;
+        for (const auto& b : blocks) {
+            n += b->size();
+        }
+        return n;
+    }
+    const std::map<std::string, PhaseStats>& GetPhaseStats() const { return phaseStats; }
+    void ClearPhaseStats() { phaseStats.clear(); }
+
+    // Free all memory. Nothing may be live.
+    void Clear() {
+        if (!allocations.empty()) {
+            throw std::runtime_error("Clearing a scratch arena that still has live allocations.");
+        }
+        blocks.clear();
+        peakSinceMerge = 0;
+    }
+
+  private:
+    struct Allocation {
+        std::string name;
+        size_t block;
+        size_t offset;
+        size_t bytes;
+        uint64_t id;
+    };
+    struct ActiveScope {
+        std::string phase;
+        uint64_t firstId;
+        size_t peakBytes;
+    };
+
+    std::vector<std::unique_ptr<std::vector<byte_t, Allocator>>> blocks;
+    // Live allocations, in the order they were made
+    std::vector<Allocation> allocations;
+    std::vector<ActiveScope> scopes;
+    std::map<std::string, PhaseStats> phaseStats;
+    uint64_t nextId = 0;
+    size_t bytesInUse = 0;
+    // The most block space the allocations have spanned since the blocks were last merged
+    size_t peakSinceMerge = 0;
+    bool debugMode = false;
+
+    static size_t roundUp(size_t bytes) { return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+    void beginScope(const std::string& phase) { scopes.push_back({phase, nextId, bytesInUse}); }
+
+    void endScope() {
+        const ActiveScope& s = scopes.back();
+        for (size_t i = allocations.size(); i > 0; i--) {
+            if (allocations[i - 1].id >= s.firstId) {
+                retire(i - 1);
+            }
+        }
+        PhaseStats& stats = phaseStats[s.phase];
+        stats.peakBytes = std::max(stats.peakBytes, s.peakBytes);
+        stats.nScopes++;
+        scopes.pop_back();
+        if (allocations.empty() && blocks.size() > 1) {
+            mergeBlocks();
+        }
+    }
+
+    void retire(size_t i) {
+        const Allocation& a = allocations[i];
+        if (debugMode) {
+            byte_t* ptr = blocks[a.block]->data() + a.offset;
+            std::fill(ptr, ptr + a.bytes, (byte_t)POISON);
+        }
+        bytesInUse -= a.bytes;
+        allocations.erase(allocations.begin() + i);
+    }
+
+    // First fit among the gaps between live allocations, block by block
+    bool findGap(size_t bytes, size_t& block, size_t& offset) const {
+        for (size_t b = 0; b < blocks.size(); b++) {
+            std::vector<std::pair<size_t, size_t>> taken;
+            for (const auto& a : allocations) {
+                if (a.block == b) {
+                    taken.emplace_back(a.offset, a.offset + a.bytes);
+                }
+            }
+            std::sort(taken.begin(), taken.end());
+            size_t start = 0;
+            for (const auto& t : taken) {
+                if (t.first - start >= bytes) {
+                    break;
+                }
+                start = std::max(start, t.second);
+            }
+            if (start + bytes <= blocks[b]->size()) {
+                block = b;
+                offset = start;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // A new block doubles the capacity, or fits the request if that is larger
+    void addBlock(size_t bytes) {
+        size_t n = std::max(std::max(bytes, GetCapacity()), MIN_BLOCK_BYTES);
+        blocks.push_back(std::make_unique<std::vector<byte_t, Allocator>>(n));
+    }
+
+    size_t highWaterFootprint() const {
+        size_t n = 0;
+        for (size_t b = 0; b < blocks.size(); b++) {
+            size_t end = 0;
+            for (const auto& a : allocations) {
+                if (a.block == b) {
+                    end = std::max(end, a.offset + a.bytes);
+                }
+            }
+            n += end;
+        }
+        return n;
+    }
+
+    void mergeBlocks() {
+        size_t n = std::max(peakSinceMerge, MIN_BLOCK_BYTES);
+        blocks.clear();
+        blocks.push_back(std::make_unique<std::vector<byte_t, Allocator>>(n));
+        peakSinceMerge = 0;
+    }
+
+    void checkNoOverlap(const Allocation& a) const {
+        for (const auto& live : allocations) {
+            if (live.block == a.block && live.offset < a.offset + a.bytes && a.offset < live.offset + live.bytes) {
+                throw std::runtime_error("Scratch array " + a.name + " overlaps live scratch array " + live.name +
+                                         ", this is a bug in the scratch arena.");
+            }
+        }
+    }
+};
+
+}  // namespace deme
+
+#endif
@@ -35,6 +35,8 @@
 
 #include <chrono>
 
+#include "TraceRecorder.hpp"
+
 namespace deme {
 
 template <class seconds_type = double>
@@ -43,6 +45,9 @@ class Timer {
     std::chrono::high_resolution_clock::time_point m_start;
     std::chrono::high_resolution_clock::time_point m_end;
     std::chrono::duration<seconds_type> m_total;
+    // If set, each start()..stop() span is also recorded on this timeline lane
+    TraceLane* m_trace_lane = nullptr;
+    const char* m_trace_name = nullptr;
 
   public:
     Timer() { m_total = std::chrono::duration<seconds_type>(0); }
@@ -54,6 +59,15 @@ class Timer {
     void stop() {
         m_end = std::chrono::high_resolution_clock::now();
         m_total += m_end - m_start;
+        if (m_trace_lane) {
+            m_trace_lane->RecordSpan(m_trace_name, m_start, m_end);
+        }
+    }
+
+    /// Record the spans of this timer on a timeline lane under the given name (nullptr lane to stop)
+    void SetTraceLane(TraceLane* lane, const char* name) {
+        m_trace_lane = lane;
+        m_trace_name = name;
     }
 
     /// Reset the total accumulated time (when repeating multiple start() stop() start() stop() )
@@ -0,0 +1,129 @@
+//	Copyright (c) 2021, SBEL GPU Development Team
+//	Copyright (c) 2021, University of Wisconsin - Madison
+//
+//	SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DEME_TRACE_RECORDER_HPP
+#define DEME_TRACE_RECORDER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace deme {
+
+// One timeline event. A span has its begin and end; an instant event (a buffer hand-off, say) has no duration.
+struct TraceEvent {
+    const char* name;
+    std::chrono::high_resolution_clock::time_point begin;
+    std::chrono::high_resolution_clock::time_point end;
+    bool instant;
+};
+
+// Fixed-capacity ring buffer of the events of one thread. Only the owning thread records into it, so recording takes
+// no lock; once it is full, the oldest events are overwritten. Names must outlive the lane (string literals, or the
+// keys of a timer map).
+class TraceLane {
+  public:
+    TraceLane(const std::string& name, size_t capacity)
+        : laneName(name), events(capacity > 0 ? capacity : 1), nRecorded(0) {}
+
+    void RecordSpan(const char* name,
+                    std::chrono::high_resolution_clock::time_point begin,
+                    std::chrono::high_resolution_clock::time_point end) {
+        events[nRecorded % events.size()] = {name, begin, end, false};
+        nRecorded++;
+    }
+    void RecordInstant(const char* name) {
+        auto now = std::chrono::high_resolution_clock::now();
+        events[nRecorded % events.size()] = {name, now, now, true};
+        nRecorded++;
+    }
+
+    const std::string& GetName() const { return laneName; }
+    // Number of events currently held, and number lost to wrap-around
+    size_t GetNumEvents() const { return nRecorded < events.size() ? nRecorded : events.size(); }
+    size_t GetNumDropped() const { return nRecorded - GetNumEvents(); }
+    // The i-th held event, oldest first
+    const TraceEvent& GetEvent(size_t i) const { return events[(GetNumDropped() + i) % events.size()]; }
+
+    void Clear() { nRecorded = 0; }
+
+  private:
+    std::string laneName;
+    std::vector<TraceEvent> events;
+    size_t nRecorded;
+};
+
+// A set of trace lanes, one per thread, that can be dumped as a Chrome trace (the JSON format Perfetto and
+// chrome://tracing open). Dump only when the recording threads are idle.
+class TraceRecorder {
+  public:
+    explicit TraceRecorder(size_t events_per_lane)
+        : capacity(events_per_lane), epoch(std::chrono::high_resolution_clock::now()) {}
+
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+    TraceLane* AddLane(const std::string& name) {
+        lanes.push_back(std::make_unique<TraceLane>(name, capacity));
+        return lanes.back().get();
+    }
+
+    void Clear() {
+        for (auto& lane : lanes) {
+            lane->Clear();
+        }
+    }
+
+    size_t GetNumDropped() const {
+        size_t n = 0;
+        for (const auto& lane : lanes) {
+            n += lane->GetNumDropped();
+        }
+        return n;
+    }
+
+    void WriteChromeTrace(std::ostream& out) const {
+        // Timestamps are in microseconds; keep them to the nanosecond
+        std::ios_base::fmtflags old_flags = out.flags();
+        std::streamsize old_precision = out.precision(3);
+        out << std::fixed;
+        out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        out << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"DEME\"}}";
+        for (size_t tid = 0; tid < lanes.size(); tid++) {
+            const TraceLane& lane = *lanes[tid];
+            out << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << tid
+                << ", \"args\": {\"name\": \"" << lane.GetName() << "\"}}";
+            for (size_t i = 0; i < lane.GetNumEvents(); i++) {
+                const TraceEvent& ev = lane.GetEvent(i);
+                out << ",\n{\"name\": \"" << ev.name << "\", \"pid\": 1, \"tid\": " << tid
+                    << ", \"ts\": " << toMicroseconds(ev.begin - epoch);
+                if (ev.instant) {
+                    out << ", \"ph\": \"i\", \"s\": \"t\"}";
+                } else {
+                    out << ", \"ph\": \"X\", \"dur\": " << toMicroseconds(ev.end - ev.begin) << "}";
+                }
+            }
+        }
+        out << "\n]}\n";
+        out.flags(old_flags);
+        out.precision(old_precision);
+    }
+
+  private:
+    size_t capacity;
+    std::chrono::high_resolution_clock::time_point epoch;
+    std::vector<std::unique_ptr<TraceLane>> lanes;
+
+    static double toMicroseconds(std::chrono::high_resolution_clock::duration d) {
+        return std::chrono::duration<double, std::micro>(d).count();
+    }
+};
+
+}  // namespace deme
+
+#endif
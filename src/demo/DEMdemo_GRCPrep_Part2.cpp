@@ -84,8 +84,10 @@ int main() {
     }
 
     // Now we load part1 clump locations from a part1 output file
-    auto part1_clump_xyz = DEMSim.ReadClumpXyzFromCsv("./DemoOutput_GRCPrep_Part1/GRC_3e5.csv");
-    auto part1_clump_quaternion = DEMSim.ReadClumpQuatFromCsv("./DemoOutput_GRCPrep_Part1/GRC_3e5.csv");
+    std::unordered_map<std::string, std::vector<float3>> part1_clump_xyz;
+    std::unordered_map<std::string, std::vector<float4>> part1_clump_quaternion;
+    DEMSim.ReadClumpXyzQuatFromCsv("./DemoOutput_GRCPrep_Part1/GRC_3e5.csv", part1_clump_xyz,
+                                   part1_clump_quaternion);
     auto part1_pairs = DEMSim.ReadContactPairsFromCsv("./DemoOutput_GRCPrep_Part1/Contact_pairs_3e5.csv");
     auto part1_wcs = DEMSim.ReadContactWildcardsFromCsv("./DemoOutput_GRCPrep_Part1/Contact_pairs_3e5.csv");
 
@@ -85,8 +85,10 @@ int main() {
     }
 
     // Now we load part2 clump locations from a part1 output file
-    auto part2_clump_xyz = DEMSim.ReadClumpXyzFromCsv("./DemoOutput_GRCPrep_Part2/GRC_3e6.csv");
-    auto part2_clump_quaternion = DEMSim.ReadClumpQuatFromCsv("./DemoOutput_GRCPrep_Part2/GRC_3e6.csv");
+    std::unordered_map<std::string, std::vector<float3>> part2_clump_xyz;
+    std::unordered_map<std::string, std::vector<float4>> part2_clump_quaternion;
+    DEMSim.ReadClumpXyzQuatFromCsv("./DemoOutput_GRCPrep_Part2/GRC_3e6.csv", part2_clump_xyz,
+                                   part2_clump_quaternion);
     // auto part2_pairs = DEMSim.ReadContactPairsFromCsv("./DemoOutput_GRCPrep_Part2/Contact_pairs_3e6.csv");
     // auto part2_wcs = DEMSim.ReadContactWildcardsFromCsv("./DemoOutput_GRCPrep_Part2/Contact_pairs_3e6.csv");
     std::vector<float3> in_xyz;
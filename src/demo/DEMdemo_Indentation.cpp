@@ -31,12 +31,11 @@ inline void buildContactMap(std::vector<std::vector<bodyID_t>>& map,
     relative_pos.clear();
     map.resize(num_particles);
     relative_pos.resize(num_particles);
-    std::vector<float3> particle_xyz(num_particles);
     // At system-level, the clump's ID may not start from 0; but a batch of clumps loaded together have consecutive IDs.
     size_t clump_ID_offset = particle_tracker->GetOwnerID();
-    for (unsigned int i = 0; i < num_particles; i++) {
-        particle_xyz[i] = particle_tracker->Pos(i);
-    }
+    // Fetching all positions in one go is much cheaper than querying owners one by one
+    std::vector<float3> particle_xyz = particle_tracker->Positions();
+    std::vector<float3> owner_xyz = DEMSim.GetAllOwnerPositions();
     for (unsigned int i = 0; i < cnt_pairs.size(); i++) {
         const auto& pair = cnt_pairs.at(i);
         map[pair.first - clump_ID_offset].push_back(pair.second);
@@ -48,7 +47,7 @@ inline void buildContactMap(std::vector<std::vector<bodyID_t>>& map,
         std::vector<float3> init_rel_pos;
         // Compute all this guy's partners' relative positions wrt to itself
         for (const auto& ID : map[i]) {
-            init_rel_pos.push_back(DEMSim.GetOwnerPosition(ID) - main_loc);
+            init_rel_pos.push_back(owner_xyz[ID] - main_loc);
         }
         relative_pos[i] = init_rel_pos;
     }
@@ -200,12 +199,14 @@ int main() {
         if (curr_step % out_steps == 0) {
             // Compute relative displacement
             std::vector<float> gran_strain(num_particles);
+            std::vector<float3> particle_xyz = particle_tracker->Positions();
+            std::vector<float3> owner_xyz = DEMSim.GetAllOwnerPositions();
             for (unsigned int i = 0; i < num_particles; i++) {
-                float3 main_loc = particle_tracker->Pos(i);
+                float3 main_loc = particle_xyz[i];
                 // Compute contact partners' new locations
                 std::vector<float3> rel_pos;
                 for (auto& ID : particle_cnt_map.at(i)) {
-                    rel_pos.push_back(DEMSim.GetOwnerPosition(ID) - main_loc);
+                    rel_pos.push_back(owner_xyz[ID] - main_loc);
                 }
                 // How large is the strain?
                 // float3 strains = make_float3(0);
@@ -8,10 +8,61 @@ _clumpTemplateDefs_;
 // Definitions of analytical entites are below
 _analyticalEntityDefs_;
 
+// Figure out the range of bins (inclusive, by bin indices in X, Y and Z) a sphere touches on a bin level
+inline __device__ void sphereBinRangeAtLevel(deme::DEMSimParams* simParams,
+                                             const double3& myPosXYZ,
+                                             const double& myRadius,
+                                             const unsigned int& level,
+                                             deme::binID_t* L,
+                                             deme::binID_t* U) {
+    const double levelBinSize = getBinSizeAtLevel(simParams, level);
+    // The bin number that I live in (with fractions)?
+    const double myBin[3] = {myPosXYZ.x / levelBinSize, myPosXYZ.y / levelBinSize, myPosXYZ.z / levelBinSize};
+    const deme::binID_t nb[3] = {simParams->levelNbX[level], simParams->levelNbY[level], simParams->levelNbZ[level]};
+    // How many bins my radius spans (with fractions)?
+    const double myRadiusSpan = myRadius / levelBinSize;
+    for (int d = 0; d < 3; d++) {
+        L[d] = (deme::binID_t)((myBin[d] - myRadiusSpan > 0.0) ? myBin[d] - myRadiusSpan : 0.0);
+        U[d] = (myBin[d] + myRadiusSpan < (double)nb[d]) ? (deme::binID_t)(myBin[d] + myRadiusSpan) : nb[d] - 1;
+    }
+}
+
+// With periodic directions, a sphere is also binned as its images one period away across the periodic faces, so that
+// pairs straddling a face share bins. Image img in [0, 27) is shifted by (img % 3 - 1, img / 3 % 3 - 1, img / 9 - 1)
+// periods, so image 13 is the sphere itself. Returns false if the image is not needed: it shifts along a non-periodic
+// direction, or its bounding box does not reach into the periodic box.
+inline __device__ bool getSphereImage(deme::DEMSimParams* simParams,
+                                      const double3& myPosXYZ,
+                                      const double& myRadius,
+                                      const unsigned int& img,
+                                      double3& imgPos) {
+    const int shift[3] = {(int)(img % 3) - 1, (int)(img / 3 % 3) - 1, (int)(img / 9) - 1};
+    const unsigned int dirFlags[3] = {deme::PERIODIC_X, deme::PERIODIC_Y, deme::PERIODIC_Z};
+    const double boxMin[3] = {simParams->periodicBoxMin.x, simParams->periodicBoxMin.y, simParams->periodicBoxMin.z};
+    const double boxSize[3] = {simParams->periodicBoxSize.x, simParams->periodicBoxSize.y,
+                               simParams->periodicBoxSize.z};
+    double pos[3] = {myPosXYZ.x, myPosXYZ.y, myPosXYZ.z};
+    for (int d = 0; d < 3; d++) {
+        if (shift[d] == 0) {
+            continue;
+        }
+        if (!(simParams->periodicDirs & dirFlags[d])) {
+            return false;
+        }
+        pos[d] += shift[d] * boxSize[d];
+        if (pos[d] + myRadius <= boxMin[d] || pos[d] - myRadius >= boxMin[d] + boxSize[d]) {
+            return false;
+        }
+    }
+    imgPos = make_double3(pos[0], pos[1], pos[2]);
+    return true;
+}
+
 __global__ void getNumberOfBinsEachSphereTouches(deme::DEMSimParams* simParams,
                                                  deme::DEMDataKT* granData,
                                                  deme::binsSphereTouches_t* numBinsSphereTouches,
-                                                 deme::objID_t* numAnalGeoSphereTouches) {
+                                                 deme::objID_t* numAnalGeoSphereTouches,
+                                                 deme::binsSphereTouches_t* numBinsSphereVisits) {
     deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
     if (sphereID < simParams->nSpheresGM) {
         // Register sphere--analytical geometry contacts
@@ -48,31 +99,31 @@ __global__ void getNumberOfBinsEachSphereTouches(deme::DEMSimParams* simParams,
                 myPosXYZ = ownerXYZ + to_double3(myRelPos);
             }
 
-            deme::binsSphereTouches_t numX, numY, numZ;
-            {
-                // The bin number that I live in (with fractions)?
-                double myBinX = myPosXYZ.x / simParams->binSize;
-                double myBinY = myPosXYZ.y / simParams->binSize;
-                double myBinZ = myPosXYZ.z / simParams->binSize;
-                // How many bins my radius spans (with fractions)?
-                double myRadiusSpan = myRadius / simParams->binSize;
-                // printf("myRadius: %f\n", myRadiusSpan);
-                // Now, figure out how many bins I touch in each direction
-                numX = ((myBinX + myRadiusSpan < (double)simParams->nbX) ? (unsigned int)(myBinX + myRadiusSpan)
-                                                                         : (unsigned int)simParams->nbX - 1) -
-                       (unsigned int)((myBinX - myRadiusSpan > 0.0) ? myBinX - myRadiusSpan : 0.0) + 1;
-                numY = ((myBinY + myRadiusSpan < (double)simParams->nbY) ? (unsigned int)(myBinY + myRadiusSpan)
-                                                                         : (unsigned int)simParams->nbY - 1) -
-                       (unsigned int)((myBinY - myRadiusSpan > 0.0) ? myBinY - myRadiusSpan : 0.0) + 1;
-                numZ = ((myBinZ + myRadiusSpan < (double)simParams->nbZ) ? (unsigned int)(myBinZ + myRadiusSpan)
-                                                                         : (unsigned int)simParams->nbZ - 1) -
-                       (unsigned int)((myBinZ - myRadiusSpan > 0.0) ? myBinZ - myRadiusSpan : 0.0) + 1;
-                //// TODO: Add an error message if numX * numY * numZ > MAX(binsSphereTouches_t)
+            // I live on the bin level of my size class
+            const unsigned int myLevel = getSphereBinLevel(simParams, (float)myRadius);
+            deme::binID_t L[3], U[3];
+            deme::binsSphereTouches_t numTouches = 0, numVisits = 0;
+            for (unsigned int img = 0; img < 27; img++) {
+                double3 imgPos;
+                if (!getSphereImage(simParams, myPosXYZ, myRadius, img, imgPos)) {
+                    continue;
+                }
+                sphereBinRangeAtLevel(simParams, imgPos, myRadius, myLevel, L, U);
+                numTouches += (U[0] - L[0] + 1) * (U[1] - L[1] + 1) * (U[2] - L[2] + 1);
+                // With hierarchical binning, I also visit the bins of all coarser levels, where the larger spheres
+                // live. Since bins get larger level by level, the bins I visit are fewer than the bins I live in, on
+                // each level.
+                for (unsigned int level = myLevel + 1; level < simParams->nBinLevels; level++) {
+                    sphereBinRangeAtLevel(simParams, imgPos, myRadius, level, L, U);
+                    numVisits += (U[0] - L[0] + 1) * (U[1] - L[1] + 1) * (U[2] - L[2] + 1);
+                }
             }
-
+            //// TODO: Add an error message if the number of bins > MAX(binsSphereTouches_t)
             // Write the number of bins this sphere touches back to the global array
-            numBinsSphereTouches[sphereID] = numX * numY * numZ;
-            // printf("This sp takes num of bins: %u\n", numX * numY * numZ);
+            numBinsSphereTouches[sphereID] = numTouches;
+            if (simParams->nBinLevels > 1) {
+                numBinsSphereVisits[sphereID] = numVisits;
+            }
         }
 
         // Each sphere entity should also check if it overlaps with an analytical boundary-type geometry
@@ -136,6 +187,9 @@ __global__ void populateBinSphereTouchingPairs(deme::DEMSimParams* simParams,
                                                deme::binSphereTouchPairs_t* numAnalGeoSphereTouchesScan,
                                                deme::binID_t* binIDsEachSphereTouches,
                                                deme::bodyID_t* sphereIDsEachBinTouches,
+                                               deme::binSphereTouchPairs_t* numBinsSphereVisitsScan,
+                                               deme::binID_t* binIDsEachSphereVisits,
+                                               deme::bodyID_t* sphereIDsEachBinVisits,
                                                deme::bodyID_t* idGeoA,
                                                deme::bodyID_t* idGeoB,
                                                deme::contact_t* contactType) {
@@ -178,28 +232,29 @@ __global__ void populateBinSphereTouchingPairs(deme::DEMSimParams* simParams,
                 myPosXYZ = ownerXYZ + to_double3(myRelPos);
             }
 
-            // The bin number that I live in (with fractions)?
-            double myBinX = myPosXYZ.x / simParams->binSize;
-            double myBinY = myPosXYZ.y / simParams->binSize;
-            double myBinZ = myPosXYZ.z / simParams->binSize;
-            // How many bins my radius spans (with fractions)?
-            double myRadiusSpan = myRadius / simParams->binSize;
-            // Now, write the IDs of those bins that I touch, back to the global memory
-            deme::binID_t thisBinID;
-            for (deme::binID_t k = (deme::binID_t)((myBinZ - myRadiusSpan > 0.0) ? myBinZ - myRadiusSpan : 0.0);
-                 (k <= (deme::binID_t)(myBinZ + myRadiusSpan)) && (k < simParams->nbZ); k++) {
-                for (deme::binID_t j = (deme::binID_t)((myBinY - myRadiusSpan > 0.0) ? myBinY - myRadiusSpan : 0.0);
-                     (j <= (deme::binID_t)(myBinY + myRadiusSpan)) && (j < simParams->nbY); j++) {
-                    for (deme::binID_t i = (deme::binID_t)((myBinX - myRadiusSpan > 0.0) ? myBinX - myRadiusSpan : 0.0);
-                         (i <= (deme::binID_t)(myBinX + myRadiusSpan)) && (i < simParams->nbX); i++) {
-                        if (myReportOffset >= myReportOffset_end) {
-                            continue;  // No stepping on the next one's domain
+            // Now, write the IDs of those bins that I touch on my level, back to the global memory
+            const unsigned int myLevel = getSphereBinLevel(simParams, (float)myRadius);
+            deme::binID_t L[3], U[3];
+            for (unsigned int img = 0; img < 27; img++) {
+                double3 imgPos;
+                if (!getSphereImage(simParams, myPosXYZ, myRadius, img, imgPos)) {
+                    continue;
+                }
+                sphereBinRangeAtLevel(simParams, imgPos, myRadius, myLevel, L, U);
+                for (deme::binID_t k = L[2]; k <= U[2]; k++) {
+                    for (deme::binID_t j = L[1]; j <= U[1]; j++) {
+                        for (deme::binID_t i = L[0]; i <= U[0]; i++) {
+                            if (myReportOffset >= myReportOffset_end) {
+                                continue;  // No stepping on the next one's domain
+                            }
+                            binIDsEachSphereTouches[myReportOffset] =
+                                simParams->levelBinOffset[myLevel] +
+                                binIDFrom3Indices<deme::binID_t>(i, j, k, simParams->levelNbX[myLevel],
+                                                                 simParams->levelNbY[myLevel],
+                                                                 simParams->levelNbZ[myLevel]);
+                            sphereIDsEachBinTouches[myReportOffset] = sphereID;
+                            myReportOffset++;
                         }
-                        thisBinID =
-                            binIDFrom3Indices<deme::binID_t>(i, j, k, simParams->nbX, simParams->nbY, simParams->nbZ);
-                        binIDsEachSphereTouches[myReportOffset] = thisBinID;
-                        sphereIDsEachBinTouches[myReportOffset] = sphereID;
-                        myReportOffset++;
                     }
                 }
             }
@@ -209,6 +264,38 @@ __global__ void populateBinSphereTouchingPairs(deme::DEMSimParams* simParams,
                 binIDsEachSphereTouches[myReportOffset] = deme::NULL_BINID;
                 sphereIDsEachBinTouches[myReportOffset] = sphereID;
             }
+
+            // Then the bins I visit on the coarser levels, if hierarchical binning is in use
+            if (simParams->nBinLevels > 1) {
+                deme::binSphereTouchPairs_t myVisitOffset = numBinsSphereVisitsScan[sphereID];
+                const deme::binSphereTouchPairs_t myVisitOffset_end = numBinsSphereVisitsScan[sphereID + 1];
+                for (unsigned int img = 0; img < 27; img++) {
+                    double3 imgPos;
+                    if (!getSphereImage(simParams, myPosXYZ, myRadius, img, imgPos)) {
+                        continue;
+                    }
+                    for (unsigned int level = myLevel + 1; level < simParams->nBinLevels; level++) {
+                        sphereBinRangeAtLevel(simParams, imgPos, myRadius, level, L, U);
+                        for (deme::binID_t k = L[2]; k <= U[2]; k++) {
+                            for (deme::binID_t j = L[1]; j <= U[1]; j++) {
+                                for (deme::binID_t i = L[0]; i <= U[0] && myVisitOffset < myVisitOffset_end; i++) {
+                                    binIDsEachSphereVisits[myVisitOffset] =
+                                        simParams->levelBinOffset[level] +
+                                        binIDFrom3Indices<deme::binID_t>(i, j, k, simParams->levelNbX[level],
+                                                                         simParams->levelNbY[level],
+                                                                         simParams->levelNbZ[level]);
+                                    sphereIDsEachBinVisits[myVisitOffset] = sphereID;
+                                    myVisitOffset++;
+                                }
+                            }
+                        }
+                    }
+                }
+                for (; myVisitOffset < myVisitOffset_end; myVisitOffset++) {
+                    binIDsEachSphereVisits[myVisitOffset] = deme::NULL_BINID;
+                    sphereIDsEachBinVisits[myVisitOffset] = sphereID;
+                }
+            }
         }
 
         deme::binSphereTouchPairs_t mySphereGeoReportOffset = numAnalGeoSphereTouchesScan[sphereID];
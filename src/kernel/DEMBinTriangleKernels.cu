@@ -52,17 +52,15 @@ __global__ void makeTriangleSandwich(deme::DEMSimParams* simParams,
     }
 }
 
-inline __device__ void figureOutNodeAndBoundingBox(deme::DEMSimParams* simParams,
-                                                   deme::DEMDataKT* granData,
-                                                   const deme::bodyID_t& triID,
-                                                   float3& vA,
-                                                   float3& vB,
-                                                   float3& vC,
-                                                   deme::binID_t L[],
-                                                   deme::binID_t U[],
-                                                   float3 loc_vA,
-                                                   float3 loc_vB,
-                                                   float3 loc_vC) {
+inline __device__ void figureOutNodes(deme::DEMSimParams* simParams,
+                                      deme::DEMDataKT* granData,
+                                      const deme::bodyID_t& triID,
+                                      float3& vA,
+                                      float3& vB,
+                                      float3& vC,
+                                      float3 loc_vA,
+                                      float3 loc_vB,
+                                      float3 loc_vC) {
     // My sphere voxel ID and my relPos
     deme::bodyID_t myOwnerID = granData->ownerMesh[triID];
 
@@ -80,8 +78,6 @@ inline __device__ void figureOutNodeAndBoundingBox(deme::DEMSimParams* simParams
     vA = ownerXYZ + loc_vA;
     vB = ownerXYZ + loc_vB;
     vC = ownerXYZ + loc_vC;
-
-    boundingBoxIntersectBin(L, U, vA, vB, vC, simParams);
 }
 
 __global__ void getNumberOfBinsEachTriangleTouches(deme::DEMSimParams* simParams,
@@ -95,39 +91,50 @@ __global__ void getNumberOfBinsEachTriangleTouches(deme::DEMSimParams* simParams
                                                    float3* nodeC2) {
     deme::bodyID_t triID = blockIdx.x * blockDim.x + threadIdx.x;
     if (triID < simParams->nTriGM) {
+        // Facets of meshes that use a BVH are not binned
+        if (granData->triInMeshBVH[triID]) {
+            numBinsTriTouches[triID] = 0;
+            return;
+        }
         // 3 vertices of the triangle
         float3 vA1, vB1, vC1, vA2, vB2, vC2;
-        deme::binID_t L1[3], L2[3], U1[3], U2[3];
-        figureOutNodeAndBoundingBox(simParams, granData, triID, vA1, vB1, vC1, L1, U1, nodeA1[triID], nodeB1[triID],
-                                    nodeC1[triID]);
-        figureOutNodeAndBoundingBox(simParams, granData, triID, vA2, vB2, vC2, L2, U2, nodeA2[triID], nodeB2[triID],
-                                    nodeC2[triID]);
-        L1[0] = DEME_MIN(L1[0], L2[0]);
-        L1[1] = DEME_MIN(L1[1], L2[1]);
-        L1[2] = DEME_MIN(L1[2], L2[2]);
-        U1[0] = DEME_MAX(U1[0], U2[0]);
-        U1[1] = DEME_MAX(U1[1], U2[1]);
-        U1[2] = DEME_MAX(U1[2], U2[2]);
+        figureOutNodes(simParams, granData, triID, vA1, vB1, vC1, nodeA1[triID], nodeB1[triID], nodeC1[triID]);
+        figureOutNodes(simParams, granData, triID, vA2, vB2, vC2, nodeA2[triID], nodeB2[triID], nodeC2[triID]);
 
         unsigned int numSDsTouched = 0;
-        // Triangle may span a collection of bins...
-        // BTW, I don't know why Chrono::GPU had to check the so-called 3 cases, and create thread divergence like that.
-        // Just sweep through all potential bins and you are fine.
-        float BinCenter[3];
-        float BinHalfSizes[3];
-        BinHalfSizes[0] = simParams->binSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * simParams->binSize;
-        BinHalfSizes[1] = simParams->binSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * simParams->binSize;
-        BinHalfSizes[2] = simParams->binSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * simParams->binSize;
-        for (deme::binID_t i = L1[0]; i <= U1[0]; i++) {
-            for (deme::binID_t j = L1[1]; j <= U1[1]; j++) {
-                for (deme::binID_t k = L1[2]; k <= U1[2]; k++) {
-                    BinCenter[0] = simParams->binSize * i + simParams->binSize / 2.;
-                    BinCenter[1] = simParams->binSize * j + simParams->binSize / 2.;
-                    BinCenter[2] = simParams->binSize * k + simParams->binSize / 2.;
-
-                    if (check_TriangleBoxOverlap(BinCenter, BinHalfSizes, vA1, vB1, vC1) ||
-                        check_TriangleBoxOverlap(BinCenter, BinHalfSizes, vA2, vB2, vC2)) {
-                        numSDsTouched++;
+        // With hierarchical binning, spheres of each size class live on their own bin level, so the triangle has to
+        // be registered on all levels
+        for (unsigned int level = 0; level < simParams->nBinLevels; level++) {
+            deme::binID_t L1[3], L2[3], U1[3], U2[3];
+            boundingBoxIntersectBin(L1, U1, vA1, vB1, vC1, simParams, level);
+            boundingBoxIntersectBin(L2, U2, vA2, vB2, vC2, simParams, level);
+            L1[0] = DEME_MIN(L1[0], L2[0]);
+            L1[1] = DEME_MIN(L1[1], L2[1]);
+            L1[2] = DEME_MIN(L1[2], L2[2]);
+            U1[0] = DEME_MAX(U1[0], U2[0]);
+            U1[1] = DEME_MAX(U1[1], U2[1]);
+            U1[2] = DEME_MAX(U1[2], U2[2]);
+
+            // Triangle may span a collection of bins...
+            // BTW, I don't know why Chrono::GPU had to check the so-called 3 cases, and create thread divergence like
+            // that. Just sweep through all potential bins and you are fine.
+            const double levelBinSize = getBinSizeAtLevel(simParams, level);
+            float BinCenter[3];
+            float BinHalfSizes[3];
+            BinHalfSizes[0] = levelBinSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * levelBinSize;
+            BinHalfSizes[1] = levelBinSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * levelBinSize;
+            BinHalfSizes[2] = levelBinSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * levelBinSize;
+            for (deme::binID_t i = L1[0]; i <= U1[0]; i++) {
+                for (deme::binID_t j = L1[1]; j <= U1[1]; j++) {
+                    for (deme::binID_t k = L1[2]; k <= U1[2]; k++) {
+                        BinCenter[0] = levelBinSize * i + levelBinSize / 2.;
+                        BinCenter[1] = levelBinSize * j + levelBinSize / 2.;
+                        BinCenter[2] = levelBinSize * k + levelBinSize / 2.;
+
+                        if (check_TriangleBoxOverlap(BinCenter, BinHalfSizes, vA1, vB1, vC1) ||
+                            check_TriangleBoxOverlap(BinCenter, BinHalfSizes, vA2, vB2, vC2)) {
+                            numSDsTouched++;
+                        }
                     }
                 }
             }
@@ -149,45 +156,55 @@ __global__ void populateBinTriangleTouchingPairs(deme::DEMSimParams* simParams,
                                                  float3* nodeC2) {
     deme::bodyID_t triID = blockIdx.x * blockDim.x + threadIdx.x;
     if (triID < simParams->nTriGM) {
+        if (granData->triInMeshBVH[triID]) {
+            return;
+        }
         // 3 vertices of the triangle
         float3 vA1, vB1, vC1, vA2, vB2, vC2;
-        deme::binID_t L1[3], L2[3], U1[3], U2[3];
-        figureOutNodeAndBoundingBox(simParams, granData, triID, vA1, vB1, vC1, L1, U1, nodeA1[triID], nodeB1[triID],
-                                    nodeC1[triID]);
-        figureOutNodeAndBoundingBox(simParams, granData, triID, vA2, vB2, vC2, L2, U2, nodeA2[triID], nodeB2[triID],
-                                    nodeC2[triID]);
-        L1[0] = DEME_MIN(L1[0], L2[0]);
-        L1[1] = DEME_MIN(L1[1], L2[1]);
-        L1[2] = DEME_MIN(L1[2], L2[2]);
-        U1[0] = DEME_MAX(U1[0], U2[0]);
-        U1[1] = DEME_MAX(U1[1], U2[1]);
-        U1[2] = DEME_MAX(U1[2], U2[2]);
+        figureOutNodes(simParams, granData, triID, vA1, vB1, vC1, nodeA1[triID], nodeB1[triID], nodeC1[triID]);
+        figureOutNodes(simParams, granData, triID, vA2, vB2, vC2, nodeA2[triID], nodeB2[triID], nodeC2[triID]);
 
         deme::binsTriangleTouchPairs_t myReportOffset = numBinsTriTouchesScan[triID];
         // In case this sweep does not agree with the previous one, we need to intercept such potential segfaults
         const deme::binsTriangleTouchPairs_t myReportOffset_end = numBinsTriTouchesScan[triID + 1];
 
-        // Triangle may span a collection of bins...
-        float BinCenter[3];
-        float BinHalfSizes[3];
-        BinHalfSizes[0] = simParams->binSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * simParams->binSize;
-        BinHalfSizes[1] = simParams->binSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * simParams->binSize;
-        BinHalfSizes[2] = simParams->binSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * simParams->binSize;
-        for (deme::binID_t i = L1[0]; i <= U1[0]; i++) {
-            for (deme::binID_t j = L1[1]; j <= U1[1]; j++) {
-                for (deme::binID_t k = L1[2]; k <= U1[2]; k++) {
-                    BinCenter[0] = simParams->binSize * i + simParams->binSize / 2.;
-                    BinCenter[1] = simParams->binSize * j + simParams->binSize / 2.;
-                    BinCenter[2] = simParams->binSize * k + simParams->binSize / 2.;
-
-                    if (check_TriangleBoxOverlap(BinCenter, BinHalfSizes, vA1, vB1, vC1) ||
-                        check_TriangleBoxOverlap(BinCenter, BinHalfSizes, vA2, vB2, vC2)) {
-                        binIDsEachTriTouches[myReportOffset] =
-                            binIDFrom3Indices<deme::binID_t>(i, j, k, simParams->nbX, simParams->nbY, simParams->nbZ);
-                        triIDsEachBinTouches[myReportOffset] = triID;
-                        myReportOffset++;
-                        if (myReportOffset >= myReportOffset_end) {
-                            return;  // Don't step on the next triangle's domain
+        for (unsigned int level = 0; level < simParams->nBinLevels; level++) {
+            deme::binID_t L1[3], L2[3], U1[3], U2[3];
+            boundingBoxIntersectBin(L1, U1, vA1, vB1, vC1, simParams, level);
+            boundingBoxIntersectBin(L2, U2, vA2, vB2, vC2, simParams, level);
+            L1[0] = DEME_MIN(L1[0], L2[0]);
+            L1[1] = DEME_MIN(L1[1], L2[1]);
+            L1[2] = DEME_MIN(L1[2], L2[2]);
+            U1[0] = DEME_MAX(U1[0], U2[0]);
+            U1[1] = DEME_MAX(U1[1], U2[1]);
+            U1[2] = DEME_MAX(U1[2], U2[2]);
+
+            // Triangle may span a collection of bins...
+            const double levelBinSize = getBinSizeAtLevel(simParams, level);
+            float BinCenter[3];
+            float BinHalfSizes[3];
+            BinHalfSizes[0] = levelBinSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * levelBinSize;
+            BinHalfSizes[1] = levelBinSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * levelBinSize;
+            BinHalfSizes[2] = levelBinSize / 2. + DEME_BIN_ENLARGE_RATIO_FOR_FACETS * levelBinSize;
+            for (deme::binID_t i = L1[0]; i <= U1[0]; i++) {
+                for (deme::binID_t j = L1[1]; j <= U1[1]; j++) {
+                    for (deme::binID_t k = L1[2]; k <= U1[2]; k++) {
+                        BinCenter[0] = levelBinSize * i + levelBinSize / 2.;
+                        BinCenter[1] = levelBinSize * j + levelBinSize / 2.;
+                        BinCenter[2] = levelBinSize * k + levelBinSize / 2.;
+
+                        if (check_TriangleBoxOverlap(BinCenter, BinHalfSizes, vA1, vB1, vC1) ||
+                            check_TriangleBoxOverlap(BinCenter, BinHalfSizes, vA2, vB2, vC2)) {
+                            binIDsEachTriTouches[myReportOffset] =
+                                simParams->levelBinOffset[level] +
+                                binIDFrom3Indices<deme::binID_t>(i, j, k, simParams->levelNbX[level],
+                                                                 simParams->levelNbY[level],
+                                                                 simParams->levelNbZ[level]);
+                            triIDsEachBinTouches[myReportOffset] = triID;
+                            myReportOffset++;
+                            if (myReportOffset >= myReportOffset_end) {
+                                return;  // Don't step on the next triangle's domain
+                            }
                         }
                     }
                 }
@@ -113,6 +113,14 @@ __global__ void calculateContactForces(deme::DEMSimParams* simParams, deme::DEMD
             _forceModelGeoWildcardAcqForSph_;
 
             equipOwnerPosRot(simParams, granData, myOwner, myRelPos, BOwnerPos, bodyBPos, BOriQ);
+            // Across a periodic face, B is its image closest to A, and so is B's owner for the contact's lever arm
+            if (simParams->periodicDirs) {
+                double3 imgShift = bodyBPos - bodyAPos;
+                applyPeriodicMinImage<double>(simParams, imgShift.x, imgShift.y, imgShift.z);
+                imgShift = bodyAPos + imgShift - bodyBPos;
+                bodyBPos += imgShift;
+                BOwnerPos += imgShift;
+            }
 
             BRadius = myRadius;
             bodyBMatType = granData->sphereMaterialOffset[sphereID];
@@ -253,6 +261,9 @@ __global__ void calculateContactForces(deme::DEMSimParams* simParams, deme::DEMD
 
             // Optionally, the forces can be reduced to acc right here (may be faster)
             _forceCollectInPlaceStrat_;
+
+            // If sleeping is enabled, an awake and moving neighbour wakes up a sleeping owner
+            _sleeperWakeUpStrat_;
         } else {
             // The contact is no longer active, so we need to destroy its contact history recording
             _forceModelContactWildcardDestroy_;
@@ -55,36 +55,48 @@ inline __device__ void fillSharedMemSpheres(deme::DEMSimParams* simParams,
 }
 
 inline __device__ bool calcContactPoint(deme::DEMSimParams* simParams,
-                                        const double& XA,
-                                        const double& YA,
-                                        const double& ZA,
+                                        const deme::cdPos_t& XA,
+                                        const deme::cdPos_t& YA,
+                                        const deme::cdPos_t& ZA,
                                         const float& rA,
-                                        const double& XB,
-                                        const double& YB,
-                                        const double& ZB,
+                                        const deme::cdPos_t& XB,
+                                        const deme::cdPos_t& YB,
+                                        const deme::cdPos_t& ZB,
                                         const float& rB,
+                                        const unsigned int& binLevel,
                                         deme::binID_t& binID,
                                         float artificialMarginA,
                                         float artificialMarginB) {
-    double contactPntX;
-    double contactPntY;
-    double contactPntZ;
+    deme::cdPos_t contactPntX;
+    deme::cdPos_t contactPntY;
+    deme::cdPos_t contactPntZ;
     bool in_contact;
-    float normX;  // Normal directions are placeholders here
-    float normY;
-    float normZ;
-    double overlapDepth;  // overlapDepth is needed for making artificial contacts not too loose.
-
-    //// TODO: I guess <float, float> is fine too.
-    in_contact = checkSpheresOverlap<double, float>(XA, YA, ZA, rA, XB, YB, ZB, rB, contactPntX, contactPntY,
-                                                    contactPntZ, normX, normY, normZ, overlapDepth);
+    deme::cdNormal_t normX;  // Normal directions are placeholders here
+    deme::cdNormal_t normY;
+    deme::cdNormal_t normZ;
+    deme::cdPos_t overlapDepth;  // overlapDepth is needed for making artificial contacts not too loose.
+
+    // The precision of this check is set by the precision policy (see VariableTypes.h)
+    if (simParams->periodicDirs) {
+        // Across a periodic face, B is taken as its image closest to A. The contact point is then wrapped back into the
+        // periodic box, so the pair resolves to the same bin no matter which side of the face it is seen from.
+        deme::cdPos_t dX = XB - XA, dY = YB - YA, dZ = ZB - ZA;
+        applyPeriodicMinImage<deme::cdPos_t>(simParams, dX, dY, dZ);
+        in_contact = checkSpheresOverlap<deme::cdPos_t, deme::cdNormal_t>(XA, YA, ZA, rA, XA + dX, YA + dY, ZA + dZ,
+                                                                          rB, contactPntX, contactPntY, contactPntZ,
+                                                                          normX, normY, normZ, overlapDepth);
+        wrapIntoPeriodicBox<deme::cdPos_t>(simParams, contactPntX, contactPntY, contactPntZ);
+    } else {
+        in_contact = checkSpheresOverlap<deme::cdPos_t, deme::cdNormal_t>(XA, YA, ZA, rA, XB, YB, ZB, rB, contactPntX,
+                                                                          contactPntY, contactPntZ, normX, normY,
+                                                                          normZ, overlapDepth);
+    }
 
     // The contact needs to be larger than the smaller articifical margin so that we don't double count the artificially
     // added margin. This is a design choice, to avoid having too many contact pairs when adding artificial margins.
     float artificialMargin = (artificialMarginA < artificialMarginB) ? artificialMarginA : artificialMarginB;
-    in_contact = in_contact && (overlapDepth > (double)artificialMargin);
-    binID = getPointBinID<deme::binID_t>(contactPntX, contactPntY, contactPntZ, simParams->binSize, simParams->nbX,
-                                         simParams->nbY);
+    in_contact = in_contact && (overlapDepth > (deme::cdPos_t)artificialMargin);
+    binID = getPointBinIDAtLevel(contactPntX, contactPntY, contactPntZ, simParams, binLevel);
     return in_contact;
 }
 
@@ -100,9 +112,9 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
     __shared__ deme::bodyID_t ownerIDs[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ deme::bodyID_t bodyIDs[DEME_NUM_SPHERES_PER_CD_BATCH];  // In this kernel, this is not used
     __shared__ float radii[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyX[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyY[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyZ[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyX[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyY[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyZ[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ deme::family_t ownerFamilies[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ deme::binContactPairs_t blockPairCnt;
 
@@ -126,6 +138,8 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
     }
     const deme::spheresBinTouches_t myThreadID = threadIdx.x;
     const deme::binSphereTouchPairs_t thisBodiesTableEntry = sphereIDsLookUpTable[blockIdx.x];
+    // Contact points are assigned to the bins of this bin's level
+    const unsigned int binLevel = getBinLevel(simParams, binID);
     if (myThreadID == 0)
         blockPairCnt = 0;
     __syncthreads();
@@ -145,8 +159,8 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
         if (myThreadID < this_batch_active_count) {
             deme::bodyID_t sphereID =
                 sphereIDsEachBinTouches_sorted[thisBodiesTableEntry + processed_count + myThreadID];
-            fillSharedMemSpheres<float, double>(simParams, granData, myThreadID, sphereID, ownerIDs, bodyIDs,
-                                                ownerFamilies, radii, bodyX, bodyY, bodyZ);
+            fillSharedMemSpheres<float, deme::cdPos_t>(simParams, granData, myThreadID, sphereID, ownerIDs, bodyIDs,
+                                                       ownerFamilies, radii, bodyX, bodyY, bodyZ);
         }
         __syncthreads();
 
@@ -183,7 +197,7 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
 
                 deme::binID_t contactPntBin;
                 bool in_contact = calcContactPoint(simParams, bodyX[bodyA], bodyY[bodyA], bodyZ[bodyA], radii[bodyA],
-                                                   bodyX[bodyB], bodyY[bodyB], bodyZ[bodyB], radii[bodyB],
+                                                   bodyX[bodyB], bodyY[bodyB], bodyZ[bodyB], radii[bodyB], binLevel,
                                                    contactPntBin, granData->familyExtraMarginSize[bodyAFamily],
                                                    granData->familyExtraMarginSize[bodyBFamily]);
                 /*
@@ -222,7 +236,7 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
             for (deme::spheresBinTouches_t i = 0; i < leftover_count; i++) {
                 deme::bodyID_t cur_ownerID, cur_bodyID;
                 float cur_radii;
-                double cur_bodyX, cur_bodyY, cur_bodyZ;
+                deme::cdPos_t cur_bodyX, cur_bodyY, cur_bodyZ;
                 deme::family_t cur_ownerFamily;
                 {
                     const deme::spheresBinTouches_t cur_ind = processed_count + DEME_NUM_SPHERES_PER_CD_BATCH + i;
@@ -230,9 +244,9 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
 
                     // Get the info of this sphere in question here. Note this is a broadcast so should be relatively
                     // fast.
-                    fillSharedMemSpheres<float, double>(simParams, granData, 0, cur_sphereID, &cur_ownerID, &cur_bodyID,
-                                                        &cur_ownerFamily, &cur_radii, &cur_bodyX, &cur_bodyY,
-                                                        &cur_bodyZ);
+                    fillSharedMemSpheres<float, deme::cdPos_t>(simParams, granData, 0, cur_sphereID, &cur_ownerID,
+                                                               &cur_bodyID, &cur_ownerFamily, &cur_radii, &cur_bodyX,
+                                                               &cur_bodyY, &cur_bodyZ);
                 }
                 // Then each in-shared-mem sphere compares against it. But first, check if same owner...
                 if (ownerIDs[myThreadID] == cur_ownerID)
@@ -249,7 +263,8 @@ __global__ void getNumberOfSphereContactsEachBin(deme::DEMSimParams* simParams,
                 deme::binID_t contactPntBin;
                 bool in_contact = calcContactPoint(simParams, bodyX[myThreadID], bodyY[myThreadID], bodyZ[myThreadID],
                                                    radii[myThreadID], cur_bodyX, cur_bodyY, cur_bodyZ, cur_radii,
-                                                   contactPntBin, granData->familyExtraMarginSize[bodyAFamily],
+                                                   binLevel, contactPntBin,
+                                                   granData->familyExtraMarginSize[bodyAFamily],
                                                    granData->familyExtraMarginSize[cur_ownerFamily]);
 
                 if (in_contact && (contactPntBin == binID)) {
@@ -280,9 +295,9 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
     __shared__ deme::bodyID_t ownerIDs[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ deme::bodyID_t bodyIDs[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ float radii[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyX[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyY[DEME_NUM_SPHERES_PER_CD_BATCH];
-    __shared__ double bodyZ[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyX[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyY[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyZ[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ deme::family_t ownerFamilies[DEME_NUM_SPHERES_PER_CD_BATCH];
     __shared__ deme::binContactPairs_t blockPairCnt;
 
@@ -295,6 +310,8 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
 
     const deme::spheresBinTouches_t myThreadID = threadIdx.x;
     const deme::binSphereTouchPairs_t thisBodiesTableEntry = sphereIDsLookUpTable[blockIdx.x];
+    // Contact points are assigned to the bins of this bin's level
+    const unsigned int binLevel = getBinLevel(simParams, binID);
     if (myThreadID == 0)
         blockPairCnt = 0;
     // Get my offset for writing back to the global arrays that contain contact pair info
@@ -317,8 +334,8 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
         if (myThreadID < this_batch_active_count) {
             deme::bodyID_t sphereID =
                 sphereIDsEachBinTouches_sorted[thisBodiesTableEntry + processed_count + myThreadID];
-            fillSharedMemSpheres<float, double>(simParams, granData, myThreadID, sphereID, ownerIDs, bodyIDs,
-                                                ownerFamilies, radii, bodyX, bodyY, bodyZ);
+            fillSharedMemSpheres<float, deme::cdPos_t>(simParams, granData, myThreadID, sphereID, ownerIDs, bodyIDs,
+                                                       ownerFamilies, radii, bodyX, bodyY, bodyZ);
         }
         __syncthreads();
 
@@ -355,7 +372,7 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
 
                 deme::binID_t contactPntBin;
                 bool in_contact = calcContactPoint(simParams, bodyX[bodyA], bodyY[bodyA], bodyZ[bodyA], radii[bodyA],
-                                                   bodyX[bodyB], bodyY[bodyB], bodyZ[bodyB], radii[bodyB],
+                                                   bodyX[bodyB], bodyY[bodyB], bodyZ[bodyB], radii[bodyB], binLevel,
                                                    contactPntBin, granData->familyExtraMarginSize[bodyAFamily],
                                                    granData->familyExtraMarginSize[bodyBFamily]);
 
@@ -379,7 +396,7 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
             for (deme::spheresBinTouches_t i = 0; i < leftover_count; i++) {
                 deme::bodyID_t cur_ownerID, cur_bodyID;
                 float cur_radii;
-                double cur_bodyX, cur_bodyY, cur_bodyZ;
+                deme::cdPos_t cur_bodyX, cur_bodyY, cur_bodyZ;
                 deme::family_t cur_ownerFamily;
                 {
                     const deme::spheresBinTouches_t cur_ind = processed_count + DEME_NUM_SPHERES_PER_CD_BATCH + i;
@@ -387,9 +404,9 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
 
                     // Get the info of this sphere in question here. Note this is a broadcast so should be relatively
                     // fast.
-                    fillSharedMemSpheres<float, double>(simParams, granData, 0, cur_sphereID, &cur_ownerID, &cur_bodyID,
-                                                        &cur_ownerFamily, &cur_radii, &cur_bodyX, &cur_bodyY,
-                                                        &cur_bodyZ);
+                    fillSharedMemSpheres<float, deme::cdPos_t>(simParams, granData, 0, cur_sphereID, &cur_ownerID,
+                                                               &cur_bodyID, &cur_ownerFamily, &cur_radii, &cur_bodyX,
+                                                               &cur_bodyY, &cur_bodyZ);
                 }
                 // Then each in-shared-mem sphere compares against it. But first, check if same owner...
                 if (ownerIDs[myThreadID] == cur_ownerID)
@@ -406,7 +423,8 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
                 deme::binID_t contactPntBin;
                 bool in_contact = calcContactPoint(simParams, bodyX[myThreadID], bodyY[myThreadID], bodyZ[myThreadID],
                                                    radii[myThreadID], cur_bodyX, cur_bodyY, cur_bodyZ, cur_radii,
-                                                   contactPntBin, granData->familyExtraMarginSize[bodyAFamily],
+                                                   binLevel, contactPntBin,
+                                                   granData->familyExtraMarginSize[bodyAFamily],
                                                    granData->familyExtraMarginSize[cur_ownerFamily]);
 
                 if (in_contact && (contactPntBin == binID)) {
@@ -435,3 +453,197 @@ __global__ void populateSphSphContactPairsEachBin(deme::DEMSimParams* simParams,
         }
     }
 }
+
+// With hierarchical binning, a bin holds the spheres of its level's size class (residents), and is also visited by the
+// smaller spheres from the finer levels (visitors). Resident--resident pairs are found by the kernels above, and
+// resident--visitor pairs by the kernels below: each bin a visitor is in is mapped to the same bin in activeBinIDs to
+// bring in the residents, then each thread takes a visitor and sweeps through the residents, which are brought into
+// shared memory by batch. A pair is reported in the bin (of the coarser level) that holds its contact point.
+__global__ void getNumberOfSphVisitorContactsEachBin(deme::DEMSimParams* simParams,
+                                                     deme::DEMDataKT* granData,
+                                                     deme::bodyID_t* sphereIDsEachBinTouches_sorted,
+                                                     deme::spheresBinTouches_t* numSpheresBinTouches,
+                                                     deme::binSphereTouchPairs_t* sphereIDsLookUpTable,
+                                                     deme::binID_t* mapVisitedBinToSphActBin,
+                                                     deme::bodyID_t* sphereIDsEachBinVisits_sorted,
+                                                     deme::binID_t* activeBinIDsForVisitors,
+                                                     deme::binSphereTouchPairs_t* numSpheresBinVisits,
+                                                     deme::binSphereTouchPairs_t* visitorIDsLookUpTable,
+                                                     deme::binContactPairs_t* numVisitorContactsInEachBin,
+                                                     size_t nActiveBinsForVisitors) {
+    __shared__ deme::bodyID_t ownerIDs[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::bodyID_t bodyIDs[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ float radii[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyX[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyY[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyZ[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::family_t ownerFamilies[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::binContactPairs_t blockPairCnt;
+
+    const deme::binID_t binID = activeBinIDsForVisitors[blockIdx.x];
+    // The index of the same binID in activeBinIDs. If no sphere lives in this bin, then no contact here.
+    const deme::binID_t indForAcqSphInfo = mapVisitedBinToSphActBin[blockIdx.x];
+    if (binID == deme::NULL_BINID || indForAcqSphInfo == deme::NULL_BINID) {
+        if (threadIdx.x == 0) {
+            numVisitorContactsInEachBin[blockIdx.x] = 0;
+        }
+        return;
+    }
+    const unsigned int binLevel = getBinLevel(simParams, binID);
+    const deme::spheresBinTouches_t myThreadID = threadIdx.x;
+    const deme::spheresBinTouches_t nResidentsInBin = numSpheresBinTouches[indForAcqSphInfo];
+    const deme::binSphereTouchPairs_t thisResidentTableEntry = sphereIDsLookUpTable[indForAcqSphInfo];
+    const deme::binSphereTouchPairs_t nVisitorsInBin = numSpheresBinVisits[blockIdx.x];
+    const deme::binSphereTouchPairs_t thisVisitorTableEntry = visitorIDsLookUpTable[blockIdx.x];
+    if (myThreadID == 0)
+        blockPairCnt = 0;
+    __syncthreads();
+
+    for (deme::spheresBinTouches_t processed_count = 0; processed_count < nResidentsInBin;
+         processed_count += DEME_NUM_SPHERES_PER_CD_BATCH) {
+        const deme::spheresBinTouches_t this_batch_active_count =
+            (nResidentsInBin - processed_count > DEME_NUM_SPHERES_PER_CD_BATCH) ? DEME_NUM_SPHERES_PER_CD_BATCH
+                                                                                : nResidentsInBin - processed_count;
+        if (myThreadID < this_batch_active_count) {
+            deme::bodyID_t sphereID =
+                sphereIDsEachBinTouches_sorted[thisResidentTableEntry + processed_count + myThreadID];
+            fillSharedMemSpheres<float, deme::cdPos_t>(simParams, granData, myThreadID, sphereID, ownerIDs, bodyIDs,
+                                                       ownerFamilies, radii, bodyX, bodyY, bodyZ);
+        }
+        __syncthreads();
+
+        for (deme::binSphereTouchPairs_t visitor = myThreadID; visitor < nVisitorsInBin;
+             visitor += DEME_KT_CD_NTHREADS_PER_BLOCK) {
+            deme::bodyID_t cur_ownerID, cur_bodyID;
+            float cur_radii;
+            deme::cdPos_t cur_bodyX, cur_bodyY, cur_bodyZ;
+            deme::family_t cur_ownerFamily;
+            fillSharedMemSpheres<float, deme::cdPos_t>(simParams, granData, 0,
+                                                       sphereIDsEachBinVisits_sorted[thisVisitorTableEntry + visitor],
+                                                       &cur_ownerID, &cur_bodyID, &cur_ownerFamily, &cur_radii,
+                                                       &cur_bodyX, &cur_bodyY, &cur_bodyZ);
+            for (deme::spheresBinTouches_t ind = 0; ind < this_batch_active_count; ind++) {
+                if (ownerIDs[ind] == cur_ownerID)
+                    continue;
+                unsigned int bodyAFamily = ownerFamilies[ind];
+                unsigned int maskMatID = locateMaskPair<unsigned int>(bodyAFamily, cur_ownerFamily);
+                if (granData->familyMasks[maskMatID] != deme::DONT_PREVENT_CONTACT) {
+                    continue;
+                }
+
+                deme::binID_t contactPntBin;
+                bool in_contact = calcContactPoint(simParams, bodyX[ind], bodyY[ind], bodyZ[ind], radii[ind],
+                                                   cur_bodyX, cur_bodyY, cur_bodyZ, cur_radii, binLevel, contactPntBin,
+                                                   granData->familyExtraMarginSize[bodyAFamily],
+                                                   granData->familyExtraMarginSize[cur_ownerFamily]);
+                if (in_contact && (contactPntBin == binID)) {
+                    atomicAdd(&blockPairCnt, 1);
+                }
+            }
+        }
+        __syncthreads();
+    }
+    if (myThreadID == 0) {
+        numVisitorContactsInEachBin[blockIdx.x] = blockPairCnt;
+    }
+}
+
+__global__ void populateSphVisitorContactPairsEachBin(deme::DEMSimParams* simParams,
+                                                      deme::DEMDataKT* granData,
+                                                      deme::bodyID_t* sphereIDsEachBinTouches_sorted,
+                                                      deme::spheresBinTouches_t* numSpheresBinTouches,
+                                                      deme::binSphereTouchPairs_t* sphereIDsLookUpTable,
+                                                      deme::binID_t* mapVisitedBinToSphActBin,
+                                                      deme::bodyID_t* sphereIDsEachBinVisits_sorted,
+                                                      deme::binID_t* activeBinIDsForVisitors,
+                                                      deme::binSphereTouchPairs_t* numSpheresBinVisits,
+                                                      deme::binSphereTouchPairs_t* visitorIDsLookUpTable,
+                                                      deme::contactPairs_t* visitorContactReportOffsets,
+                                                      deme::bodyID_t* idSphA,
+                                                      deme::bodyID_t* idSphB,
+                                                      deme::contact_t* dType,
+                                                      size_t nActiveBinsForVisitors) {
+    __shared__ deme::bodyID_t ownerIDs[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::bodyID_t bodyIDs[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ float radii[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyX[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyY[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::cdPos_t bodyZ[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::family_t ownerFamilies[DEME_NUM_SPHERES_PER_CD_BATCH];
+    __shared__ deme::binContactPairs_t blockPairCnt;
+
+    const deme::binID_t binID = activeBinIDsForVisitors[blockIdx.x];
+    const deme::binID_t indForAcqSphInfo = mapVisitedBinToSphActBin[blockIdx.x];
+    if (binID == deme::NULL_BINID || indForAcqSphInfo == deme::NULL_BINID) {
+        return;
+    }
+    const unsigned int binLevel = getBinLevel(simParams, binID);
+    const deme::spheresBinTouches_t myThreadID = threadIdx.x;
+    const deme::spheresBinTouches_t nResidentsInBin = numSpheresBinTouches[indForAcqSphInfo];
+    const deme::binSphereTouchPairs_t thisResidentTableEntry = sphereIDsLookUpTable[indForAcqSphInfo];
+    const deme::binSphereTouchPairs_t nVisitorsInBin = numSpheresBinVisits[blockIdx.x];
+    const deme::binSphereTouchPairs_t thisVisitorTableEntry = visitorIDsLookUpTable[blockIdx.x];
+    if (myThreadID == 0)
+        blockPairCnt = 0;
+    const deme::contactPairs_t myReportOffset = visitorContactReportOffsets[blockIdx.x];
+    const deme::contactPairs_t myReportOffset_end = visitorContactReportOffsets[blockIdx.x + 1];
+    __syncthreads();
+
+    for (deme::spheresBinTouches_t processed_count = 0; processed_count < nResidentsInBin;
+         processed_count += DEME_NUM_SPHERES_PER_CD_BATCH) {
+        const deme::spheresBinTouches_t this_batch_active_count =
+            (nResidentsInBin - processed_count > DEME_NUM_SPHERES_PER_CD_BATCH) ? DEME_NUM_SPHERES_PER_CD_BATCH
+                                                                                : nResidentsInBin - processed_count;
+        if (myThreadID < this_batch_active_count) {
+            deme::bodyID_t sphereID =
+                sphereIDsEachBinTouches_sorted[thisResidentTableEntry + processed_count + myThreadID];
+            fillSharedMemSpheres<float, deme::cdPos_t>(simParams, granData, myThreadID, sphereID, ownerIDs, bodyIDs,
+                                                       ownerFamilies, radii, bodyX, bodyY, bodyZ);
+        }
+        __syncthreads();
+
+        for (deme::binSphereTouchPairs_t visitor = myThreadID; visitor < nVisitorsInBin;
+             visitor += DEME_KT_CD_NTHREADS_PER_BLOCK) {
+            deme::bodyID_t cur_ownerID, cur_bodyID;
+            float cur_radii;
+            deme::cdPos_t cur_bodyX, cur_bodyY, cur_bodyZ;
+            deme::family_t cur_ownerFamily;
+            fillSharedMemSpheres<float, deme::cdPos_t>(simParams, granData, 0,
+                                                       sphereIDsEachBinVisits_sorted[thisVisitorTableEntry + visitor],
+                                                       &cur_ownerID, &cur_bodyID, &cur_ownerFamily, &cur_radii,
+                                                       &cur_bodyX, &cur_bodyY, &cur_bodyZ);
+            for (deme::spheresBinTouches_t ind = 0; ind < this_batch_active_count; ind++) {
+                if (ownerIDs[ind] == cur_ownerID)
+                    continue;
+                unsigned int bodyAFamily = ownerFamilies[ind];
+                unsigned int maskMatID = locateMaskPair<unsigned int>(bodyAFamily, cur_ownerFamily);
+                if (granData->familyMasks[maskMatID] != deme::DONT_PREVENT_CONTACT) {
+                    continue;
+                }
+
+                deme::binID_t contactPntBin;
+                bool in_contact = calcContactPoint(simParams, bodyX[ind], bodyY[ind], bodyZ[ind], radii[ind],
+                                                   cur_bodyX, cur_bodyY, cur_bodyZ, cur_radii, binLevel, contactPntBin,
+                                                   granData->familyExtraMarginSize[bodyAFamily],
+                                                   granData->familyExtraMarginSize[cur_ownerFamily]);
+                if (in_contact && (contactPntBin == binID)) {
+                    deme::contactPairs_t inBlockOffset = myReportOffset + atomicAdd(&blockPairCnt, 1);
+                    if (inBlockOffset < myReportOffset_end) {
+                        // Like the same-level pairs, the smaller sphere ID goes to A
+                        idSphA[inBlockOffset] = DEME_MIN(bodyIDs[ind], cur_bodyID);
+                        idSphB[inBlockOffset] = DEME_MAX(bodyIDs[ind], cur_bodyID);
+                        dType[inBlockOffset] = deme::SPHERE_SPHERE_CONTACT;
+                    }
+                }
+            }
+        }
+        __syncthreads();
+    }
+
+    if (threadIdx.x == 0) {
+        for (deme::contactPairs_t inBlockOffset = myReportOffset + blockPairCnt; inBlockOffset < myReportOffset_end;
+             inBlockOffset++) {
+            dType[inBlockOffset] = deme::NOT_A_CONTACT;
+        }
+    }
+}
@@ -26,12 +26,12 @@ inline __device__ void fillSharedMemTriangles(deme::DEMSimParams* simParams,
                                               float3* sandwichBNode1,
                                               float3* sandwichBNode2,
                                               float3* sandwichBNode3,
-                                              float3* triANode1,
-                                              float3* triANode2,
-                                              float3* triANode3,
-                                              float3* triBNode1,
-                                              float3* triBNode2,
-                                              float3* triBNode3) {
+                                              deme::cdPos3_t* triANode1,
+                                              deme::cdPos3_t* triANode2,
+                                              deme::cdPos3_t* triANode3,
+                                              deme::cdPos3_t* triBNode1,
+                                              deme::cdPos3_t* triBNode2,
+                                              deme::cdPos3_t* triBNode3) {
     deme::bodyID_t ownerID = granData->ownerMesh[triID];
     triIDs[myThreadID] = triID;
     triOwnerIDs[myThreadID] = ownerID;
@@ -54,9 +54,9 @@ inline __device__ void fillSharedMemTriangles(deme::DEMSimParams* simParams,
         applyOriQToVector3<float, deme::oriQ_t>(node1.x, node1.y, node1.z, myOriQw, myOriQx, myOriQy, myOriQz);
         applyOriQToVector3<float, deme::oriQ_t>(node2.x, node2.y, node2.z, myOriQw, myOriQx, myOriQy, myOriQz);
         applyOriQToVector3<float, deme::oriQ_t>(node3.x, node3.y, node3.z, myOriQw, myOriQx, myOriQy, myOriQz);
-        triANode1[myThreadID] = ownerXYZ + node1;
-        triANode2[myThreadID] = ownerXYZ + node2;
-        triANode3[myThreadID] = ownerXYZ + node3;
+        triANode1[myThreadID] = to_real3<double3, deme::cdPos3_t>(ownerXYZ + to_double3(node1));
+        triANode2[myThreadID] = to_real3<double3, deme::cdPos3_t>(ownerXYZ + to_double3(node2));
+        triANode3[myThreadID] = to_real3<double3, deme::cdPos3_t>(ownerXYZ + to_double3(node3));
     }
     {
         node1 = sandwichBNode1[triID];
@@ -65,9 +65,9 @@ inline __device__ void fillSharedMemTriangles(deme::DEMSimParams* simParams,
         applyOriQToVector3<float, deme::oriQ_t>(node1.x, node1.y, node1.z, myOriQw, myOriQx, myOriQy, myOriQz);
         applyOriQToVector3<float, deme::oriQ_t>(node2.x, node2.y, node2.z, myOriQw, myOriQx, myOriQy, myOriQz);
         applyOriQToVector3<float, deme::oriQ_t>(node3.x, node3.y, node3.z, myOriQw, myOriQx, myOriQy, myOriQz);
-        triBNode1[myThreadID] = ownerXYZ + node1;
-        triBNode2[myThreadID] = ownerXYZ + node2;
-        triBNode3[myThreadID] = ownerXYZ + node3;
+        triBNode1[myThreadID] = to_real3<double3, deme::cdPos3_t>(ownerXYZ + to_double3(node1));
+        triBNode2[myThreadID] = to_real3<double3, deme::cdPos3_t>(ownerXYZ + to_double3(node2));
+        triBNode3[myThreadID] = to_real3<double3, deme::cdPos3_t>(ownerXYZ + to_double3(node3));
     }
 }
 
@@ -135,12 +135,12 @@ __global__ void getNumberOfSphTriContactsEachBin(deme::DEMSimParams* simParams,
     // Shared storage for bodies involved in this bin. Pre-allocated so that each threads can easily use.
     __shared__ deme::bodyID_t triOwnerIDs[DEME_NUM_TRIANGLES_PER_CD_BATCH];
     __shared__ deme::bodyID_t triIDs[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triANode1[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triANode2[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triANode3[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triBNode1[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triBNode2[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triBNode3[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triANode1[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triANode2[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triANode3[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triBNode1[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triBNode2[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triBNode3[DEME_NUM_TRIANGLES_PER_CD_BATCH];
     __shared__ deme::family_t triOwnerFamilies[DEME_NUM_TRIANGLES_PER_CD_BATCH];
     __shared__ deme::binContactPairs_t blockPairCnt;
 
@@ -149,6 +149,8 @@ __global__ void getNumberOfSphTriContactsEachBin(deme::DEMSimParams* simParams,
 
     const deme::trianglesBinTouches_t nTriInBin = numTrianglesBinTouches[blockIdx.x];
     const deme::binID_t binID = activeBinIDsForTri[blockIdx.x];
+    // The spheres in this bin are all of this bin level's size class
+    const unsigned int binLevel = getBinLevel(simParams, binID);
     if (threadIdx.x == 0 && nTriInBin > simParams->errOutBinTriNum) {
         DEME_ABORT_KERNEL(
             "Bin %u contains %u triangular mesh facets, exceeding maximum allowance (%u).\nIf you want the solver to "
@@ -200,11 +202,11 @@ __global__ void getNumberOfSphTriContactsEachBin(deme::DEMSimParams* simParams,
                 deme::bodyID_t ownerID;
                 deme::family_t ownerFamily;
                 float myRadius;
-                float3 sphXYZ;
+                deme::cdPos3_t sphXYZ;
 
                 // Borrow it from another kernel file...
-                fillSharedMemSpheres<float, float>(simParams, granData, 0, sphereID, &ownerID, &sphereID, &ownerFamily,
-                                                   &myRadius, &sphXYZ.x, &sphXYZ.y, &sphXYZ.z);
+                fillSharedMemSpheres<float, deme::cdPos_t>(simParams, granData, 0, sphereID, &ownerID, &sphereID,
+                                                           &ownerFamily, &myRadius, &sphXYZ.x, &sphXYZ.y, &sphXYZ.z);
 
                 // Test contact with each triangle in shared memory
                 for (deme::trianglesBinTouches_t ind = 0; ind < this_batch_active_count; ind++) {
@@ -225,15 +227,15 @@ __global__ void getNumberOfSphTriContactsEachBin(deme::DEMSimParams* simParams,
                                                  ? granData->familyExtraMarginSize[ownerFamily]
                                                  : granData->familyExtraMarginSize[triOwnerFamilies[ind]];
 
-                    float3 cntPnt, normal;
-                    float depth;
+                    deme::cdPos3_t cntPnt, normal;
+                    deme::cdPos_t depth;
                     bool in_contact_A, in_contact_B;
                     // NOTE: triangle_sphere_CD_directional, instead of triangle_sphere_CD, is in use here. This is
                     // because if the later is in use, then if a sphere is between 2 sandwiching triangles, then its
                     // potential contact with the original triangle will not be registered. At the same time, we don't
                     // want to use triangle_sphere_CD_directional for the real force calculation, and the concern is
                     // mainly "sphere near needle tip" scenario. Think about it.
-                    in_contact_A = triangle_sphere_CD_directional<float3, float>(
+                    in_contact_A = triangle_sphere_CD_directional<deme::cdPos3_t, deme::cdPos_t>(
                         triANode1[ind], triANode2[ind], triANode3[ind], sphXYZ, myRadius, normal, depth, cntPnt);
                     // If the contact is too shallow (smaller than the smaller of artificial margin, then it can be
                     // dropped to reduce the overall number of contact pairs). Note triangle_sphere_CD_directional gives
@@ -241,7 +243,7 @@ __global__ void getNumberOfSphTriContactsEachBin(deme::DEMSimParams* simParams,
                     in_contact_A = in_contact_A && (-depth > artificialMargin);
 
                     // And triangle B...
-                    in_contact_B = triangle_sphere_CD_directional<float3, float>(
+                    in_contact_B = triangle_sphere_CD_directional<deme::cdPos3_t, deme::cdPos_t>(
                         triBNode1[ind], triBNode2[ind], triBNode3[ind], sphXYZ, myRadius, normal, depth, cntPnt);
                     // Same treatment for B...
                     in_contact_B = in_contact_B && (-depth > artificialMargin);
@@ -249,9 +251,10 @@ __global__ void getNumberOfSphTriContactsEachBin(deme::DEMSimParams* simParams,
                     // Note the contact point must be calculated through the original triangle, not the 2 phantom
                     // triangles; or we will have double count problems. Use the first triangle as standard.
                     if (in_contact_A || in_contact_B) {
-                        snap_to_face(triANode1[ind], triANode2[ind], triANode3[ind], sphXYZ, cntPnt);
-                        deme::binID_t contactPntBin = getPointBinID<deme::binID_t>(
-                            cntPnt.x, cntPnt.y, cntPnt.z, simParams->binSize, simParams->nbX, simParams->nbY);
+                        snap_to_face<deme::cdPos3_t, deme::cdPos_t>(triANode1[ind], triANode2[ind], triANode3[ind],
+                                                                    sphXYZ, cntPnt);
+                        deme::binID_t contactPntBin =
+                            getPointBinIDAtLevel(cntPnt.x, cntPnt.y, cntPnt.z, simParams, binLevel);
                         if (contactPntBin == binID) {
                             atomicAdd(&blockPairCnt, 1);
                         }
@@ -294,18 +297,20 @@ __global__ void populateTriSphContactsEachBin(deme::DEMSimParams* simParams,
     // Shared storage for bodies involved in this bin. Pre-allocated so that each threads can easily use.
     __shared__ deme::bodyID_t triOwnerIDs[DEME_NUM_TRIANGLES_PER_CD_BATCH];
     __shared__ deme::bodyID_t triIDs[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triANode1[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triANode2[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triANode3[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triBNode1[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triBNode2[DEME_NUM_TRIANGLES_PER_CD_BATCH];
-    __shared__ float3 triBNode3[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triANode1[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triANode2[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triANode3[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triBNode1[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triBNode2[DEME_NUM_TRIANGLES_PER_CD_BATCH];
+    __shared__ deme::cdPos3_t triBNode3[DEME_NUM_TRIANGLES_PER_CD_BATCH];
     __shared__ deme::family_t triOwnerFamilies[DEME_NUM_TRIANGLES_PER_CD_BATCH];
     __shared__ deme::binContactPairs_t blockPairCnt;
 
     const deme::trianglesBinTouches_t nTriInBin = numTrianglesBinTouches[blockIdx.x];
     const deme::spheresBinTouches_t myThreadID = threadIdx.x;
     const deme::binID_t binID = activeBinIDsForTri[blockIdx.x];
+    // The spheres in this bin are all of this bin level's size class
+    const unsigned int binLevel = getBinLevel(simParams, binID);
     // But what is the index of the same binID in array activeBinIDs? Well, mapTriActBinToSphActBin comes to rescure.
     const deme::binID_t indForAcqSphInfo = mapTriActBinToSphActBin[blockIdx.x];
     // If it is not an active bin from the perspective of the spheres, then we can move on
@@ -348,11 +353,11 @@ __global__ void populateTriSphContactsEachBin(deme::DEMSimParams* simParams,
                 deme::bodyID_t ownerID;
                 deme::family_t ownerFamily;
                 float myRadius;
-                float3 sphXYZ;
+                deme::cdPos3_t sphXYZ;
 
                 // Borrow it from another kernel file...
-                fillSharedMemSpheres<float, float>(simParams, granData, 0, sphereID, &ownerID, &sphereID, &ownerFamily,
-                                                   &myRadius, &sphXYZ.x, &sphXYZ.y, &sphXYZ.z);
+                fillSharedMemSpheres<float, deme::cdPos_t>(simParams, granData, 0, sphereID, &ownerID, &sphereID,
+                                                           &ownerFamily, &myRadius, &sphXYZ.x, &sphXYZ.y, &sphXYZ.z);
 
                 // Test contact with each triangle in shared memory
                 for (deme::trianglesBinTouches_t ind = 0; ind < this_batch_active_count; ind++) {
@@ -373,15 +378,15 @@ __global__ void populateTriSphContactsEachBin(deme::DEMSimParams* simParams,
                                                  ? granData->familyExtraMarginSize[ownerFamily]
                                                  : granData->familyExtraMarginSize[triOwnerFamilies[ind]];
 
-                    float3 cntPnt, normal;
-                    float depth;
+                    deme::cdPos3_t cntPnt, normal;
+                    deme::cdPos_t depth;
                     bool in_contact_A, in_contact_B;
                     // NOTE: triangle_sphere_CD_directional, instead of triangle_sphere_CD, is in use here. This is
                     // because if the later is in use, then if a sphere is between 2 sandwiching triangles, then its
                     // potential contact with the original triangle will not be registered. At the same time, we don't
                     // want to use triangle_sphere_CD_directional for the real force calculation, and the concern is
                     // mainly "sphere near needle tip" scenario. Think about it.
-                    in_contact_A = triangle_sphere_CD_directional<float3, float>(
+                    in_contact_A = triangle_sphere_CD_directional<deme::cdPos3_t, deme::cdPos_t>(
                         triANode1[ind], triANode2[ind], triANode3[ind], sphXYZ, myRadius, normal, depth, cntPnt);
                     // If the contact is too shallow (smaller than the smaller of artificial margin, then it can be
                     // dropped to reduce the overall number of contact pairs). Note triangle_sphere_CD_directional gives
@@ -389,7 +394,7 @@ __global__ void populateTriSphContactsEachBin(deme::DEMSimParams* simParams,
                     in_contact_A = in_contact_A && (-depth > artificialMargin);
 
                     // And triangle B...
-                    in_contact_B = triangle_sphere_CD_directional<float3, float>(
+                    in_contact_B = triangle_sphere_CD_directional<deme::cdPos3_t, deme::cdPos_t>(
                         triBNode1[ind], triBNode2[ind], triBNode3[ind], sphXYZ, myRadius, normal, depth, cntPnt);
                     // Same treatment for B...
                     in_contact_B = in_contact_B && (-depth > artificialMargin);
@@ -397,9 +402,10 @@ __global__ void populateTriSphContactsEachBin(deme::DEMSimParams* simParams,
                     // Note the contact point must be calculated through the original triangle, not the 2 phantom
                     // triangles; or we will have double count problems. Use the first triangle as standard.
                     if (in_contact_A || in_contact_B) {
-                        snap_to_face(triANode1[ind], triANode2[ind], triANode3[ind], sphXYZ, cntPnt);
-                        deme::binID_t contactPntBin = getPointBinID<deme::binID_t>(
-                            cntPnt.x, cntPnt.y, cntPnt.z, simParams->binSize, simParams->nbX, simParams->nbY);
+                        snap_to_face<deme::cdPos3_t, deme::cdPos_t>(triANode1[ind], triANode2[ind], triANode3[ind],
+                                                                    sphXYZ, cntPnt);
+                        deme::binID_t contactPntBin =
+                            getPointBinIDAtLevel(cntPnt.x, cntPnt.y, cntPnt.z, simParams, binLevel);
                         if (contactPntBin == binID) {
                             deme::contactPairs_t inBlockOffset = myReportOffset + atomicAdd(&blockPairCnt, 1);
                             if (inBlockOffset < myReportOffset_end) {
@@ -425,3 +431,152 @@ __global__ void populateTriSphContactsEachBin(deme::DEMSimParams* simParams,
         }
     }
 }
+
+// Find the contacts of a sphere with the meshes that use a BVH, by traversing each BVH in its mesh's frame. The
+// contacts are reported starting from myReportOffset, unless idSphA is NULL, in which case they are only counted.
+inline __device__ deme::geoSphereTouches_t querySphMeshBVHs(deme::DEMSimParams* simParams,
+                                                            deme::DEMDataKT* granData,
+                                                            deme::bodyID_t sphereID,
+                                                            float3* sandwichANode1,
+                                                            float3* sandwichANode2,
+                                                            float3* sandwichANode3,
+                                                            float3* sandwichBNode1,
+                                                            float3* sandwichBNode2,
+                                                            float3* sandwichBNode3,
+                                                            deme::contactPairs_t myReportOffset,
+                                                            const deme::contactPairs_t& myReportOffset_end,
+                                                            deme::bodyID_t* idSphA,
+                                                            deme::bodyID_t* idTriB,
+                                                            deme::contact_t* dType) {
+    deme::bodyID_t ownerID;
+    deme::family_t ownerFamily;
+    float myRadius;
+    deme::cdPos3_t sphXYZ;
+    fillSharedMemSpheres<float, deme::cdPos_t>(simParams, granData, 0, sphereID, &ownerID, &sphereID, &ownerFamily,
+                                               &myRadius, &sphXYZ.x, &sphXYZ.y, &sphXYZ.z);
+
+    deme::geoSphereTouches_t nContacts = 0;
+    for (unsigned int meshInd = 0; meshInd < simParams->nMeshBVHs; meshInd++) {
+        const deme::bodyID_t meshOwnerID = granData->meshBVHOwner[meshInd];
+        if (ownerID == meshOwnerID)
+            continue;
+        const deme::family_t meshFamily = granData->familyID[meshOwnerID];
+        unsigned int maskMatID = locateMaskPair<unsigned int>(ownerFamily, meshFamily);
+        if (granData->familyMasks[maskMatID] != deme::DONT_PREVENT_CONTACT) {
+            continue;
+        }
+        // The smaller of the two added margins is recorded...
+        const float artificialMargin =
+            (granData->familyExtraMarginSize[ownerFamily] < granData->familyExtraMarginSize[meshFamily])
+                ? granData->familyExtraMarginSize[ownerFamily]
+                : granData->familyExtraMarginSize[meshFamily];
+
+        // Bring the sphere into the mesh's frame, where the BVH and the sandwich triangles live
+        double meshX, meshY, meshZ;
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            meshX, meshY, meshZ, granData->voxelID[meshOwnerID], granData->locX[meshOwnerID],
+            granData->locY[meshOwnerID], granData->locZ[meshOwnerID], _nvXp2_, _nvYp2_, _voxelSize_, _l_);
+        deme::cdPos3_t sphLocXYZ = to_real3<double3, deme::cdPos3_t>(
+            make_double3(sphXYZ.x - meshX, sphXYZ.y - meshY, sphXYZ.z - meshZ));
+        applyOriQToVector3<deme::cdPos_t, deme::oriQ_t>(sphLocXYZ.x, sphLocXYZ.y, sphLocXYZ.z,
+                                                        granData->oriQw[meshOwnerID], -granData->oriQx[meshOwnerID],
+                                                        -granData->oriQy[meshOwnerID], -granData->oriQz[meshOwnerID]);
+        const float meshMargin = granData->marginSize[meshOwnerID];
+
+        unsigned int nodeStack[DEME_MESH_BVH_MAX_DEPTH];
+        unsigned int stackSize = 0;
+        unsigned int nodeInd = granData->meshBVHRoot[meshInd];
+        while (true) {
+            const deme::DEMMeshBVHNode& node = granData->meshBVHNodes[nodeInd];
+            // The node box holds the facets; the sandwich triangles may reach out of it by marginRatio * margin
+            const float reach = myRadius + meshMargin * node.marginRatio;
+            const bool hit = sphLocXYZ.x >= node.lo.x - reach && sphLocXYZ.x <= node.hi.x + reach &&
+                             sphLocXYZ.y >= node.lo.y - reach && sphLocXYZ.y <= node.hi.y + reach &&
+                             sphLocXYZ.z >= node.lo.z - reach && sphLocXYZ.z <= node.hi.z + reach;
+            if (hit && node.nTri > 0) {
+                for (unsigned int i = node.triStart; i < node.triStart + node.nTri; i++) {
+                    const deme::bodyID_t triID = granData->meshBVHTriIDs[i];
+                    deme::cdPos3_t cntPnt, normal;
+                    deme::cdPos_t depth;
+                    // The same sandwich test as in the bin-wise sweep, only done in the mesh's frame
+                    bool in_contact_A = triangle_sphere_CD_directional<deme::cdPos3_t, deme::cdPos_t>(
+                        to_real3<float3, deme::cdPos3_t>(sandwichANode1[triID]),
+                        to_real3<float3, deme::cdPos3_t>(sandwichANode2[triID]),
+                        to_real3<float3, deme::cdPos3_t>(sandwichANode3[triID]), sphLocXYZ, myRadius, normal, depth,
+                        cntPnt);
+                    in_contact_A = in_contact_A && (-depth > artificialMargin);
+                    bool in_contact_B = triangle_sphere_CD_directional<deme::cdPos3_t, deme::cdPos_t>(
+                        to_real3<float3, deme::cdPos3_t>(sandwichBNode1[triID]),
+                        to_real3<float3, deme::cdPos3_t>(sandwichBNode2[triID]),
+                        to_real3<float3, deme::cdPos3_t>(sandwichBNode3[triID]), sphLocXYZ, myRadius, normal, depth,
+                        cntPnt);
+                    in_contact_B = in_contact_B && (-depth > artificialMargin);
+
+                    // Each sphere goes through each BVH once, so no contact point-based de-duplication is needed
+                    if (in_contact_A || in_contact_B) {
+                        if (idSphA != NULL && myReportOffset < myReportOffset_end) {
+                            idSphA[myReportOffset] = sphereID;
+                            idTriB[myReportOffset] = triID;
+                            dType[myReportOffset] = deme::SPHERE_MESH_CONTACT;
+                            myReportOffset++;
+                        }
+                        nContacts++;
+                    }
+                }
+            }
+            if (hit && node.nTri == 0) {
+                // Go down the left child, and come back for the right one later
+                nodeStack[stackSize++] = node.right;
+                nodeInd++;
+            } else {
+                if (stackSize == 0)
+                    break;
+                nodeInd = nodeStack[--stackSize];
+            }
+        }
+    }
+    // Should the 2 sweeps disagree, the leftover slots are marked
+    if (idSphA != NULL) {
+        for (; myReportOffset < myReportOffset_end; myReportOffset++) {
+            dType[myReportOffset] = deme::NOT_A_CONTACT;
+        }
+    }
+    return nContacts;
+}
+
+__global__ void getNumberOfSphMeshBVHContacts(deme::DEMSimParams* simParams,
+                                              deme::DEMDataKT* granData,
+                                              deme::geoSphereTouches_t* numSphMeshBVHContacts,
+                                              float3* sandwichANode1,
+                                              float3* sandwichANode2,
+                                              float3* sandwichANode3,
+                                              float3* sandwichBNode1,
+                                              float3* sandwichBNode2,
+                                              float3* sandwichBNode3) {
+    deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sphereID < simParams->nSpheresGM) {
+        numSphMeshBVHContacts[sphereID] =
+            querySphMeshBVHs(simParams, granData, sphereID, sandwichANode1, sandwichANode2, sandwichANode3,
+                             sandwichBNode1, sandwichBNode2, sandwichBNode3, 0, 0, NULL, NULL, NULL);
+    }
+}
+
+__global__ void populateSphMeshBVHContacts(deme::DEMSimParams* simParams,
+                                           deme::DEMDataKT* granData,
+                                           deme::contactPairs_t* sphMeshBVHContactOffsets,
+                                           deme::bodyID_t* idSphA,
+                                           deme::bodyID_t* idTriB,
+                                           deme::contact_t* dType,
+                                           float3* sandwichANode1,
+                                           float3* sandwichANode2,
+                                           float3* sandwichANode3,
+                                           float3* sandwichBNode1,
+                                           float3* sandwichBNode2,
+                                           float3* sandwichBNode3) {
+    deme::bodyID_t sphereID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (sphereID < simParams->nSpheresGM) {
+        querySphMeshBVHs(simParams, granData, sphereID, sandwichANode1, sandwichANode2, sandwichANode3, sandwichBNode1,
+                         sandwichBNode2, sandwichBNode3, sphMeshBVHContactOffsets[sphereID],
+                         sphMeshBVHContactOffsets[sphereID + 1], idSphA, idTriB, dType);
+    }
+}
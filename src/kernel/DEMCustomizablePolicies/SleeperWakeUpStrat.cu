@@ -0,0 +1,11 @@
+// If exactly one of A and B is asleep, and the awake one is moving, then wake the sleeper up. Multiple contacts may
+// write to the same sleeper at the same time, but they all write the same values.
+if (granData->ownerSleeping[AOwner] != granData->ownerSleeping[BOwner]) {
+    const deme::bodyID_t awakeOwner = granData->ownerSleeping[AOwner] ? BOwner : AOwner;
+    const deme::bodyID_t sleepingOwner = granData->ownerSleeping[AOwner] ? AOwner : BOwner;
+    const float3 awakeVel = make_float3(granData->vX[awakeOwner], granData->vY[awakeOwner], granData->vZ[awakeOwner]);
+    if (length(awakeVel) > simParams->sleepVelThres) {
+        granData->ownerSleeping[sleepingOwner] = 0;
+        granData->ownerQuietSteps[sleepingOwner] = 0;
+    }
+}
@@ -326,6 +326,77 @@ binIDFrom3Indices(const T1& X, const T1& Y, const T1& Z, const T1& nbX, const T1
     }
 }
 
+// Hierarchical binning: level k has bins of size binSize * 2^k, and its bin IDs start from levelBinOffset[k]. With only
+// 1 level, the following reduce to uniform binning.
+
+// The edge length of a bin on a level
+inline __device__ double getBinSizeAtLevel(const deme::DEMSimParams* simParams, const unsigned int& level) {
+    return simParams->binSize * (double)(1u << level);
+}
+
+// The level a sphere lives on: the finest one whose bins are no smaller than its diameter. Spheres too large for the
+// coarsest level live there anyway.
+inline __device__ unsigned int getSphereBinLevel(const deme::DEMSimParams* simParams, const float& radius) {
+    unsigned int level = 0;
+    double levelBinSize = simParams->binSize;
+    while (level + 1 < simParams->nBinLevels && 2.0 * (double)radius > levelBinSize) {
+        levelBinSize *= 2.0;
+        level++;
+    }
+    return level;
+}
+
+// The level a bin belongs to
+inline __device__ unsigned int getBinLevel(const deme::DEMSimParams* simParams, const deme::binID_t& binID) {
+    unsigned int level = 0;
+    while (level + 1 < simParams->nBinLevels && binID >= simParams->levelBinOffset[level + 1]) {
+        level++;
+    }
+    return level;
+}
+
+// Compute the binID for a point in space, on a bin level
+inline __device__ deme::binID_t getPointBinIDAtLevel(const double& X,
+                                                     const double& Y,
+                                                     const double& Z,
+                                                     const deme::DEMSimParams* simParams,
+                                                     const unsigned int& level) {
+    return simParams->levelBinOffset[level] +
+           getPointBinID<deme::binID_t>(X, Y, Z, getBinSizeAtLevel(simParams, level), simParams->levelNbX[level],
+                                        simParams->levelNbY[level]);
+}
+
+// Map a displacement vector to its minimum image along the periodic directions
+template <typename T1>
+inline __device__ void applyPeriodicMinImage(const deme::DEMSimParams* simParams, T1& dX, T1& dY, T1& dZ) {
+    if (simParams->periodicDirs & deme::PERIODIC_X) {
+        dX -= (T1)simParams->periodicBoxSize.x * floor(dX / (T1)simParams->periodicBoxSize.x + (T1)0.5);
+    }
+    if (simParams->periodicDirs & deme::PERIODIC_Y) {
+        dY -= (T1)simParams->periodicBoxSize.y * floor(dY / (T1)simParams->periodicBoxSize.y + (T1)0.5);
+    }
+    if (simParams->periodicDirs & deme::PERIODIC_Z) {
+        dZ -= (T1)simParams->periodicBoxSize.z * floor(dZ / (T1)simParams->periodicBoxSize.z + (T1)0.5);
+    }
+}
+
+// Wrap a point (relative to the LBF point of the world) into the periodic box along the periodic directions
+template <typename T1>
+inline __device__ void wrapIntoPeriodicBox(const deme::DEMSimParams* simParams, T1& X, T1& Y, T1& Z) {
+    if (simParams->periodicDirs & deme::PERIODIC_X) {
+        X -= (T1)simParams->periodicBoxSize.x *
+             floor((X - (T1)simParams->periodicBoxMin.x) / (T1)simParams->periodicBoxSize.x);
+    }
+    if (simParams->periodicDirs & deme::PERIODIC_Y) {
+        Y -= (T1)simParams->periodicBoxSize.y *
+             floor((Y - (T1)simParams->periodicBoxMin.y) / (T1)simParams->periodicBoxSize.y);
+    }
+    if (simParams->periodicDirs & deme::PERIODIC_Z) {
+        Z -= (T1)simParams->periodicBoxSize.z *
+             floor((Z - (T1)simParams->periodicBoxMin.z) / (T1)simParams->periodicBoxSize.z);
+    }
+}
+
 // This utility function returns the normal to the triangular face defined by
 // the vertices A, B, and C. The face is assumed to be non-degenerate.
 // Note that order of vertices is important!
@@ -524,34 +595,36 @@ inline __device__ deme::contact_t checkSphereEntityOverlap(const T1& A,
 // Triangle-specific helper kernels
 ////////////////////////////////////////////////////////////////////////////////
 
-/// Takes in a triangle ID and figures out an SD AABB for broadphase use
+/// Takes in a triangle ID and figures out an SD AABB for broadphase use, on a bin level
 __inline__ __device__ void boundingBoxIntersectBin(deme::binID_t* L,
                                                    deme::binID_t* U,
                                                    const float3& vA,
                                                    const float3& vB,
                                                    const float3& vC,
-                                                   deme::DEMSimParams* simParams) {
+                                                   deme::DEMSimParams* simParams,
+                                                   const unsigned int& level) {
+    const float levelBinSize = getBinSizeAtLevel(simParams, level);
+    const int3 maxBinIndex = make_int3(simParams->levelNbX[level] - 1, simParams->levelNbY[level] - 1,
+                                       simParams->levelNbZ[level] - 1);
     float3 min_pt;
     min_pt.x = DEME_MIN(vA.x, DEME_MIN(vB.x, vC.x));
     min_pt.y = DEME_MIN(vA.y, DEME_MIN(vB.y, vC.y));
     min_pt.z = DEME_MIN(vA.z, DEME_MIN(vB.z, vC.z));
 
     // Enlarge bounding box, so that no triangle lies right between 2 layers of bins
-    min_pt -= DEME_BIN_ENLARGE_RATIO_FOR_FACETS * simParams->binSize;
+    min_pt -= DEME_BIN_ENLARGE_RATIO_FOR_FACETS * levelBinSize;
     // A point on a mesh can be out of the simulation world. In this case, becasue we only need to detect their contact
     // with spheres, and spheres are all in the simulation world, so we just clamp out the bins that are outside the
     // simulation world.
-    int3 min_bin = clampBetween<float3, int3>(min_pt / simParams->binSize, make_int3(0, 0, 0),
-                                              make_int3(simParams->nbX - 1, simParams->nbY - 1, simParams->nbZ - 1));
+    int3 min_bin = clampBetween<float3, int3>(min_pt / levelBinSize, make_int3(0, 0, 0), maxBinIndex);
 
     float3 max_pt;
     max_pt.x = DEME_MAX(vA.x, DEME_MAX(vB.x, vC.x));
     max_pt.y = DEME_MAX(vA.y, DEME_MAX(vB.y, vC.y));
     max_pt.z = DEME_MAX(vA.z, DEME_MAX(vB.z, vC.z));
 
-    max_pt += DEME_BIN_ENLARGE_RATIO_FOR_FACETS * simParams->binSize;
-    int3 max_bin = clampBetween<float3, int3>(max_pt / simParams->binSize, make_int3(0, 0, 0),
-                                              make_int3(simParams->nbX - 1, simParams->nbY - 1, simParams->nbZ - 1));
+    max_pt += DEME_BIN_ENLARGE_RATIO_FOR_FACETS * levelBinSize;
+    int3 max_bin = clampBetween<float3, int3>(max_pt / levelBinSize, make_int3(0, 0, 0), maxBinIndex);
 
     L[0] = min_bin.x;
     L[1] = min_bin.y;
@@ -210,6 +210,10 @@ inline __device__ void integrateVelPos(deme::bodyID_t ownerID,
         X -= (double)simParams->LBFX;
         Y -= (double)simParams->LBFY;
         Z -= (double)simParams->LBFZ;
+        // Clumps leaving through a periodic face re-enter from the opposite one
+        if (granData->ownerTypes[ownerID] == deme::OWNER_T_CLUMP) {
+            wrapIntoPeriodicBox<double>(simParams, X, Y, Z);
+        }
         positionToVoxelID<deme::voxelID_t, deme::subVoxelPos_t, double>(
             granData->voxelID[ownerID], granData->locX[ownerID], granData->locY[ownerID], granData->locZ[ownerID], X, Y,
             Z, _nvXp2_, _nvYp2_, _voxelSize_, _l_);
@@ -253,12 +257,45 @@ inline __device__ void integrateVelPos(deme::bodyID_t ownerID,
 //     IDPacker<deme::voxelID_t, deme::voxelID_t>(voxel, voxelX, voxelY, voxelZ, _nvXp2_, _nvYp2_);
 // }
 
+// Count the consecutive quiet steps of a clump, and put it to sleep if it has been quiet for long enough
+inline __device__ void updateSleepState(deme::bodyID_t ownerID,
+                                        deme::DEMSimParams* simParams,
+                                        deme::DEMDataDT* granData) {
+    if (granData->ownerTypes[ownerID] != deme::OWNER_T_CLUMP)
+        return;
+    const float3 lin_vel = make_float3(granData->vX[ownerID], granData->vY[ownerID], granData->vZ[ownerID]);
+    const float3 lin_acc = make_float3(granData->aX[ownerID] + simParams->Gx, granData->aY[ownerID] + simParams->Gy,
+                                       granData->aZ[ownerID] + simParams->Gz);
+    if (length(lin_vel) < simParams->sleepVelThres && length(lin_acc) < simParams->sleepAccThres) {
+        unsigned int quiet_steps = granData->ownerQuietSteps[ownerID] + 1;
+        if (quiet_steps >= simParams->sleepSteps) {
+            // Falls asleep and freezes in place
+            granData->ownerSleeping[ownerID] = 1;
+            granData->vX[ownerID] = 0;
+            granData->vY[ownerID] = 0;
+            granData->vZ[ownerID] = 0;
+            granData->omgBarX[ownerID] = 0;
+            granData->omgBarY[ownerID] = 0;
+            granData->omgBarZ[ownerID] = 0;
+            quiet_steps = 0;
+        }
+        granData->ownerQuietSteps[ownerID] = quiet_steps;
+    } else {
+        granData->ownerQuietSteps[ownerID] = 0;
+    }
+}
+
 __global__ void integrateOwners(deme::DEMSimParams* simParams, deme::DEMDataDT* granData) {
     deme::bodyID_t ownerID = blockIdx.x * blockDim.x + threadIdx.x;
     if (ownerID < simParams->nOwnerBodies) {
+        // A sleeping owner is not integrated, until an awake neighbour wakes it up in the force calculation kernel
+        if (_sleepEnabled_ && granData->ownerSleeping[ownerID])
+            return;
         // These 2 quantities mean the velocity and ang vel used for updating position/quaternion for this step.
         // Depending on the integration scheme in use, they can be different.
         float3 v, omgBar;
         integrateVelPos(ownerID, simParams, granData, v, omgBar, simParams->h, simParams->timeElapsed);
+        if (_sleepEnabled_)
+            updateSleepState(ownerID, simParams, granData);
     }
 }
@@ -1,5 +1,6 @@
 // DEM misc. kernels
 #include <DEM/Defines.h>
+#include <DEMHelperKernels.cu>
 
 __global__ void markOwnerToChange(deme::notStupidBool_t* idBool,
                                   float* ownerFactors,
@@ -74,3 +75,102 @@ __global__ void fillMarginValues(deme::DEMSimParams* simParams, deme::DEMDataKT*
         granData->marginSize[ownerID] = simParams->beta + granData->familyExtraMarginSize[my_family];
     }
 }
+
+// Bulk owner state access: the i-th owner worked on is IDs[i], or start + i if no ID list is given
+inline __device__ deme::bodyID_t bulkAccessOwner(const deme::bodyID_t* IDs, deme::bodyID_t start, size_t i) {
+    return (IDs == NULL) ? start + (deme::bodyID_t)i : IDs[i];
+}
+
+__global__ void getOwnerPositions(deme::DEMSimParams* simParams,
+                                  deme::DEMDataDT* granData,
+                                  const deme::bodyID_t* IDs,
+                                  deme::bodyID_t start,
+                                  float3* pos,
+                                  size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        deme::bodyID_t ownerID = bulkAccessOwner(IDs, start, myID);
+        double X, Y, Z;
+        voxelIDToPosition<double, deme::voxelID_t, deme::subVoxelPos_t>(
+            X, Y, Z, granData->voxelID[ownerID], granData->locX[ownerID], granData->locY[ownerID],
+            granData->locZ[ownerID], simParams->nvXp2, simParams->nvYp2, simParams->voxelSize, simParams->l);
+        pos[myID] = make_float3(X + simParams->LBFX, Y + simParams->LBFY, Z + simParams->LBFZ);
+    }
+}
+
+__global__ void setOwnerPositions(deme::DEMSimParams* simParams,
+                                  deme::DEMDataDT* granData,
+                                  const deme::bodyID_t* IDs,
+                                  deme::bodyID_t start,
+                                  const float3* pos,
+                                  size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        deme::bodyID_t ownerID = bulkAccessOwner(IDs, start, myID);
+        // Convert to relative pos wrt LBF point first
+        double X = pos[myID].x - simParams->LBFX;
+        double Y = pos[myID].y - simParams->LBFY;
+        double Z = pos[myID].z - simParams->LBFZ;
+        positionToVoxelID<deme::voxelID_t, deme::subVoxelPos_t, double>(
+            granData->voxelID[ownerID], granData->locX[ownerID], granData->locY[ownerID], granData->locZ[ownerID], X,
+            Y, Z, simParams->nvXp2, simParams->nvYp2, simParams->voxelSize, simParams->l);
+    }
+}
+
+__global__ void getOwnerFloat3(const float* arrX,
+                               const float* arrY,
+                               const float* arrZ,
+                               const deme::bodyID_t* IDs,
+                               deme::bodyID_t start,
+                               float3* res,
+                               size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        deme::bodyID_t ownerID = bulkAccessOwner(IDs, start, myID);
+        res[myID] = make_float3(arrX[ownerID], arrY[ownerID], arrZ[ownerID]);
+    }
+}
+
+__global__ void setOwnerFloat3(float* arrX,
+                               float* arrY,
+                               float* arrZ,
+                               const deme::bodyID_t* IDs,
+                               deme::bodyID_t start,
+                               const float3* vals,
+                               size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        deme::bodyID_t ownerID = bulkAccessOwner(IDs, start, myID);
+        arrX[ownerID] = vals[myID].x;
+        arrY[ownerID] = vals[myID].y;
+        arrZ[ownerID] = vals[myID].z;
+    }
+}
+
+__global__ void getOwnerOriQs(deme::DEMDataDT* granData,
+                              const deme::bodyID_t* IDs,
+                              deme::bodyID_t start,
+                              float4* oriQ,
+                              size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        deme::bodyID_t ownerID = bulkAccessOwner(IDs, start, myID);
+        oriQ[myID] = make_float4(granData->oriQx[ownerID], granData->oriQy[ownerID], granData->oriQz[ownerID],
+                                 granData->oriQw[ownerID]);
+    }
+}
+
+__global__ void setOwnerOriQs(deme::DEMDataDT* granData,
+                              const deme::bodyID_t* IDs,
+                              deme::bodyID_t start,
+                              const float4* oriQ,
+                              size_t n) {
+    size_t myID = blockIdx.x * blockDim.x + threadIdx.x;
+    if (myID < n) {
+        deme::bodyID_t ownerID = bulkAccessOwner(IDs, start, myID);
+        granData->oriQw[ownerID] = oriQ[myID].w;
+        granData->oriQx[ownerID] = oriQ[myID].x;
+        granData->oriQy[ownerID] = oriQ[myID].y;
+        granData->oriQz[ownerID] = oriQ[myID].z;
+    }
+}